@@ -0,0 +1,480 @@
+#include "cashcacheutils.h"
+#include "cashwebutils.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+/* cache file constants */
+#define CACHE_INDEX_FNAME "cwcache.idx"
+#define CACHE_DATA_FNAME "cwcache.dat"
+#define CACHE_MAGIC "CWCACHE1"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_SLOTS_MIN 1024
+#define CACHE_RECORD_SZ(hexLen) (sizeof(struct CacheRecordHeader) + (hexLen))
+#define CACHE_RECORD_AVG_SZ CACHE_RECORD_SZ(CW_TX_DATA_CHARS/2)
+
+/*
+ * the cache is made of two files:
+ * index: header followed by an open-addressed hash table of slots, mapped shared by every process using the cache
+ * data: append-only log of records (header followed by hex data), starting after CACHE_MAGIC
+ * a slot's key is the first 8 bytes of its txid (which is already a hash), and its offset locates the record in the data log
+   (offset 0 marks an empty slot); the table is never let past half full
+ * readers hold a shared flock on the index file, writers an exclusive one
+ */
+struct CacheIndexHeader {
+	char magic[CACHE_MAGIC_LEN];
+	uint64_t slotsCount;
+	uint64_t entriesCount;
+	uint64_t dataEnd;
+	uint64_t maxBytes;
+};
+
+struct CacheIndexSlot {
+	uint64_t key;
+	uint64_t offset;
+};
+
+/*
+ * expires is a unix time, or 0 if the record never expires
+ */
+struct CacheRecordHeader {
+	unsigned char txid[CW_TXID_BYTES];
+	uint32_t hexLen;
+	uint32_t reserved;
+	int64_t expires;
+};
+
+/*
+ * per-process handle on the cache; pid is that of the process which opened the files,
+   so that a forked child can reopen them rather than sharing its parent's flock
+ */
+struct Cache {
+	char *indexPath;
+	char *dataPath;
+	size_t maxBytes;
+	pid_t pid;
+	int indexFd;
+	int dataFd;
+	struct CacheIndexHeader *header;
+	struct CacheIndexSlot *slots;
+	size_t mapSize;
+	pthread_mutex_t lock;
+};
+
+/*
+ * record of data log retained by eviction
+ */
+struct CacheRetained {
+	unsigned char txid[CW_TXID_BYTES];
+	uint64_t offset;
+	size_t size;
+};
+
+/*
+ * opens/maps cache files at paths stored in cache, initializing them if new or unrecognized
+ */
+static CW_STATUS cacheOpenFiles(struct Cache *cache);
+
+/*
+ * unmaps/closes cache files
+ */
+static void cacheCloseFiles(struct Cache *cache);
+
+/*
+ * locks cache for this thread and process (shared or exclusive), reopening files first if in a forked child
+ */
+static CW_STATUS cacheLock(struct Cache *cache, bool exclusive);
+
+/*
+ * unlocks cache
+ */
+static void cacheUnlock(struct Cache *cache);
+
+/*
+ * finds slot for given txid (as bytes); writes true to found if the slot holds it, or false if the slot is the empty one it would go in
+ * returns index of slot, or -1 on read failure
+ */
+static ssize_t cacheFindSlot(struct Cache *cache, const unsigned char *txid, bool *found);
+
+/*
+ * reads unexpired hex data for txid (as bytes) from cache to hexData (must fit CW_TX_DATA_CHARS+1),
+   and whether it was cached as confirmed (i.e. without expiry) to confirmed
+ * cache must be locked
+ * returns true if found
+ */
+static bool cacheGet(struct Cache *cache, const unsigned char *txid, time_t now, char *hexData, bool *confirmed);
+
+/*
+ * appends hex data for txid (as bytes) to cache, evicting older records first if the cache is too full
+ * cache must be locked exclusively
+ */
+static CW_STATUS cachePut(struct Cache *cache, const unsigned char *txid, const char *hexData, size_t hexLen, int64_t expires);
+
+/*
+ * evicts the older half of the data log (along with any expired/superseded records), compacting the remainder in place and rebuilding the index
+ * cache must be locked exclusively
+ */
+static CW_STATUS cacheEvict(struct Cache *cache, time_t now);
+
+/*
+ * converts txid hex string to bytes
+ * returns false if not a valid txid
+ */
+static bool cacheTxidToBytes(const char *txidHex, unsigned char *txid);
+
+/* ------------------------------------- PUBLIC ------------------------------------- */
+
+CW_STATUS initCache(const char *cacheDir, size_t maxBytes, struct CWG_params *params) {
+	struct Cache *cache;
+	if ((cache = malloc(sizeof(struct Cache))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	cache->indexPath = malloc(strlen(cacheDir) + 1 + strlen(CACHE_INDEX_FNAME) + 1);
+	cache->dataPath = malloc(strlen(cacheDir) + 1 + strlen(CACHE_DATA_FNAME) + 1);
+	if (!cache->indexPath || !cache->dataPath) {
+		perror("malloc failed");
+		if (cache->indexPath) { free(cache->indexPath); }
+		if (cache->dataPath) { free(cache->dataPath); }
+		free(cache);
+		return CW_SYS_ERR;
+	}
+	sprintf(cache->indexPath, "%s/%s", cacheDir, CACHE_INDEX_FNAME);
+	sprintf(cache->dataPath, "%s/%s", cacheDir, CACHE_DATA_FNAME);
+	cache->maxBytes = maxBytes;
+	pthread_mutex_init(&cache->lock, NULL);
+
+	if (mkdir(cacheDir, S_IRWXU) != 0 && errno != EEXIST) {
+		fprintf(CWG_err_stream, "cashgettools: failed to create cache directory %s: %s\n", cacheDir, strerror(errno));
+		params->cache = cache;
+		cleanupCache(params);
+		return CW_SYS_ERR;
+	}
+
+	CW_STATUS status;
+	if ((status = cacheOpenFiles(cache)) != CW_OK) {
+		params->cache = cache;
+		cleanupCache(params);
+		return status;
+	}
+
+	params->cache = cache;
+	return CW_OK;
+}
+
+void cleanupCache(struct CWG_params *params) {
+	struct Cache *cache = (struct Cache *)params->cache;
+	if (!cache) { return; }
+
+	cacheCloseFiles(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->indexPath);
+	free(cache->dataPath);
+	free(cache);
+	params->cache = NULL;
+}
+
+CW_STATUS fetchHexDataCached(const char **txids, size_t count, struct CWG_params *params, char *hexDataAll, struct FetchItemInfo *itemInfo,
+			     CW_STATUS (*fetcher)(const char **, size_t, FETCH_TYPE, struct CWG_params *, char **, char *, struct FetchItemInfo *)) {
+	if (count < 1) { return CWG_FETCH_NO; }
+	struct Cache *cache = (struct Cache *)params->cache;
+	time_t now = time(NULL);
+
+	CW_STATUS status = CW_OK;
+	char (*cached)[CW_TX_DATA_CHARS+1] = NULL;
+	const char **missTxids = NULL;
+	char *missHexDataAll = NULL;
+	struct FetchItemInfo *missInfo = NULL;
+
+	unsigned char txidBytes[count][CW_TXID_BYTES];
+	bool valid[count];
+	bool hit[count];
+	bool hitConfirmed[count];
+	size_t missCount = 0;
+	if ((cached = malloc(count*sizeof(cached[0]))) == NULL ||
+	    (missTxids = malloc(count*sizeof(missTxids[0]))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+
+	// look up all txids under a single shared lock
+	bool locked = cacheLock(cache, false) == CW_OK;
+	for (int i=0; i<count; i++) {
+		valid[i] = cacheTxidToBytes(txids[i], txidBytes[i]);
+		hit[i] = locked && valid[i] && cacheGet(cache, txidBytes[i], now, cached[i], &hitConfirmed[i]);
+		if (!hit[i]) { missTxids[missCount++] = txids[i]; }
+	}
+	if (locked) { cacheUnlock(cache); }
+
+	// fetch whatever was missed, and add it to cache
+	if (missCount > 0) {
+		if ((missHexDataAll = malloc(CW_TX_DATA_CHARS*missCount + 1)) == NULL ||
+		    (missInfo = malloc(missCount*sizeof(struct FetchItemInfo))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+		for (int i=0; i<missCount; i++) { initFetchItemInfo(&missInfo[i]); }
+		if ((status = fetcher(missTxids, missCount, BY_TXID, params, NULL, missHexDataAll, missInfo)) != CW_OK) { goto cleanup; }
+
+		size_t offset = 0;
+		for (int i=0; i<missCount; i++) {
+			if (missInfo[i].hexLen == FETCH_ITEM_LEN_UNKNOWN) {
+				// fetcher couldn't report where each hex data begins, so the result can't be spliced with cached hex data
+				if (missCount < count) { status = fetcher(txids, count, BY_TXID, params, NULL, hexDataAll, NULL); }
+				else { strcpy(hexDataAll, missHexDataAll); }
+				goto cleanup;
+			}
+			offset += missInfo[i].hexLen;
+		}
+		if (offset != strlen(missHexDataAll)) { fprintf(CWG_err_stream, "cashgettools: fetched hex data length mismatch; problem with cashgettools\n"); status = CW_SYS_ERR; goto cleanup; }
+
+		if (cacheLock(cache, true) == CW_OK) {
+			offset = 0;
+			int64_t expires;
+			for (int i=0, m=0; i<count; i++) {
+				if (hit[i]) { continue; }
+				expires = missInfo[m].confirmed ? 0 : (params->cacheUnconfirmedTTL > 0 ? now + params->cacheUnconfirmedTTL : -1);
+				if (valid[i] && expires >= 0 && cachePut(cache, txidBytes[i], missHexDataAll+offset, missInfo[m].hexLen, expires) != CW_OK) {
+					fprintf(CWG_err_stream, "cashgettools: failed to write to cache; continuing without\n");
+					break;
+				}
+				offset += missInfo[m++].hexLen;
+			}
+			cacheUnlock(cache);
+		}
+	}
+
+	// assemble hex data in order from cache hits and fetched data
+	char *hexDataPtr = hexDataAll;
+	const char *missHexDataPtr = missHexDataAll;
+	for (int i=0, m=0; i<count; i++) {
+		if (hit[i]) {
+			strcpy(hexDataPtr, cached[i]);
+			hexDataPtr += strlen(cached[i]);
+			if (itemInfo) { itemInfo[i].hexLen = strlen(cached[i]); itemInfo[i].confirmed = hitConfirmed[i]; }
+		} else {
+			memcpy(hexDataPtr, missHexDataPtr, missInfo[m].hexLen);
+			hexDataPtr += missInfo[m].hexLen;
+			missHexDataPtr += missInfo[m].hexLen;
+			if (itemInfo) { itemInfo[i] = missInfo[m]; }
+			++m;
+		}
+	}
+	*hexDataPtr = 0;
+
+	cleanup:
+		if (cached) { free(cached); }
+		if (missTxids) { free(missTxids); }
+		if (missHexDataAll) { free(missHexDataAll); }
+		if (missInfo) { free(missInfo); }
+		return status;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static CW_STATUS cacheOpenFiles(struct Cache *cache) {
+	cache->indexFd = -1;
+	cache->dataFd = -1;
+	cache->header = NULL;
+	cache->slots = NULL;
+	cache->mapSize = 0;
+	cache->pid = getpid();
+
+	if ((cache->indexFd = open(cache->indexPath, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) < 0 ||
+	    (cache->dataFd = open(cache->dataPath, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) < 0) {
+		fprintf(CWG_err_stream, "cashgettools: failed to open cache files: %s\n", strerror(errno));
+		cacheCloseFiles(cache);
+		return CW_SYS_ERR;
+	}
+	if (flock(cache->indexFd, LOCK_EX) != 0) { perror("flock() failed"); cacheCloseFiles(cache); return CW_SYS_ERR; }
+
+	CW_STATUS status = CW_OK;
+
+	// index is (re)initialized if new or unrecognized, in which case data log is emptied as well
+	struct CacheIndexHeader header;
+	long indexSz = fileSize(cache->indexFd);
+	if (indexSz < (long)sizeof(header) ||
+	    pread(cache->indexFd, &header, sizeof(header), 0) < sizeof(header) ||
+	    memcmp(header.magic, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0 ||
+	    indexSz != sizeof(header) + header.slotsCount*sizeof(struct CacheIndexSlot)) {
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, CACHE_MAGIC, CACHE_MAGIC_LEN);
+		header.slotsCount = CACHE_SLOTS_MIN;
+		while (header.slotsCount < 2*(cache->maxBytes/CACHE_RECORD_AVG_SZ)) { header.slotsCount *= 2; }
+		header.dataEnd = CACHE_MAGIC_LEN;
+		if (ftruncate(cache->indexFd, 0) != 0 ||
+		    ftruncate(cache->indexFd, sizeof(header) + header.slotsCount*sizeof(struct CacheIndexSlot)) != 0 ||
+		    pwrite(cache->indexFd, &header, sizeof(header), 0) < sizeof(header) ||
+		    ftruncate(cache->dataFd, 0) != 0 ||
+		    pwrite(cache->dataFd, CACHE_MAGIC, CACHE_MAGIC_LEN, 0) < CACHE_MAGIC_LEN) {
+			perror("cashgettools failed to initialize cache files");
+			status = CW_SYS_ERR;
+			goto end;
+		}
+	}
+
+	cache->mapSize = sizeof(header) + header.slotsCount*sizeof(struct CacheIndexSlot);
+	void *map;
+	if ((map = mmap(NULL, cache->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, cache->indexFd, 0)) == MAP_FAILED) {
+		perror("mmap() failed");
+		cache->mapSize = 0;
+		status = CW_SYS_ERR;
+		goto end;
+	}
+	cache->header = (struct CacheIndexHeader *)map;
+	cache->slots = (struct CacheIndexSlot *)((char *)map + sizeof(header));
+	cache->header->maxBytes = cache->maxBytes;
+
+	end:
+		flock(cache->indexFd, LOCK_UN);
+		if (status != CW_OK) { cacheCloseFiles(cache); }
+		return status;
+}
+
+static void cacheCloseFiles(struct Cache *cache) {
+	if (cache->header) { munmap(cache->header, cache->mapSize); }
+	if (cache->indexFd >= 0) { close(cache->indexFd); }
+	if (cache->dataFd >= 0) { close(cache->dataFd); }
+	cache->header = NULL;
+	cache->slots = NULL;
+	cache->indexFd = -1;
+	cache->dataFd = -1;
+}
+
+static CW_STATUS cacheLock(struct Cache *cache, bool exclusive) {
+	pthread_mutex_lock(&cache->lock);
+	if (cache->pid != getpid()) {
+		cacheCloseFiles(cache);
+		if (cacheOpenFiles(cache) != CW_OK) { pthread_mutex_unlock(&cache->lock); return CW_SYS_ERR; }
+	}
+	if (!cache->header || flock(cache->indexFd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+		pthread_mutex_unlock(&cache->lock);
+		return CW_SYS_ERR;
+	}
+	return CW_OK;
+}
+
+static void cacheUnlock(struct Cache *cache) {
+	flock(cache->indexFd, LOCK_UN);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static ssize_t cacheFindSlot(struct Cache *cache, const unsigned char *txid, bool *found) {
+	uint64_t key;
+	memcpy(&key, txid, sizeof(key));
+	size_t mask = cache->header->slotsCount-1;
+
+	struct CacheRecordHeader rec;
+	for (size_t i=key & mask; ; i = (i+1) & mask) {
+		if (!cache->slots[i].offset) { *found = false; return i; }
+		if (cache->slots[i].key != key) { continue; }
+		if (pread(cache->dataFd, &rec, sizeof(rec), cache->slots[i].offset) < sizeof(rec)) { return -1; }
+		if (memcmp(rec.txid, txid, CW_TXID_BYTES) == 0) { *found = true; return i; }
+	}
+}
+
+static bool cacheGet(struct Cache *cache, const unsigned char *txid, time_t now, char *hexData, bool *confirmed) {
+	bool found;
+	ssize_t slot;
+	if ((slot = cacheFindSlot(cache, txid, &found)) < 0 || !found) { return false; }
+
+	struct CacheRecordHeader rec;
+	uint64_t offset = cache->slots[slot].offset;
+	if (pread(cache->dataFd, &rec, sizeof(rec), offset) < sizeof(rec)) { return false; }
+	if ((rec.expires && rec.expires <= now) || rec.hexLen > CW_TX_DATA_CHARS) { return false; }
+	if (pread(cache->dataFd, hexData, rec.hexLen, offset+sizeof(rec)) < rec.hexLen) { return false; }
+	hexData[rec.hexLen] = 0;
+	*confirmed = rec.expires == 0;
+
+	return true;
+}
+
+static CW_STATUS cachePut(struct Cache *cache, const unsigned char *txid, const char *hexData, size_t hexLen, int64_t expires) {
+	if (hexLen > CW_TX_DATA_CHARS) { return CW_OK; }
+	size_t recSz = CACHE_RECORD_SZ(hexLen);
+
+	CW_STATUS status;
+	if ((cache->header->entriesCount+1)*2 > cache->header->slotsCount || cache->header->dataEnd + recSz > cache->header->maxBytes) {
+		if ((status = cacheEvict(cache, time(NULL))) != CW_OK) { return status; }
+	}
+
+	bool found;
+	ssize_t slot;
+	if ((slot = cacheFindSlot(cache, txid, &found)) < 0) { return CW_SYS_ERR; }
+
+	struct CacheRecordHeader rec;
+	memset(&rec, 0, sizeof(rec));
+	memcpy(rec.txid, txid, CW_TXID_BYTES);
+	rec.hexLen = hexLen;
+	rec.expires = expires;
+
+	// record is written in full before the index is made to point at it
+	uint64_t offset = cache->header->dataEnd;
+	if (pwrite(cache->dataFd, &rec, sizeof(rec), offset) < sizeof(rec) ||
+	    pwrite(cache->dataFd, hexData, hexLen, offset+sizeof(rec)) < hexLen) { perror("pwrite() failed on cache"); return CW_SYS_ERR; }
+
+	memcpy(&cache->slots[slot].key, txid, sizeof(cache->slots[slot].key));
+	cache->slots[slot].offset = offset;
+	if (!found) { ++cache->header->entriesCount; }
+	cache->header->dataEnd = offset + recSz;
+
+	return CW_OK;
+}
+
+static CW_STATUS cacheEvict(struct Cache *cache, time_t now) {
+	uint64_t dataEnd = cache->header->dataEnd;
+	uint64_t cutoff = CACHE_MAGIC_LEN + (dataEnd-CACHE_MAGIC_LEN)/2;
+
+	struct CacheRetained *retained;
+	if ((retained = malloc((cache->header->entriesCount+1)*sizeof(struct CacheRetained))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	size_t retainedCount = 0;
+
+	CW_STATUS status = CW_OK;
+
+	// find records to keep: past the cutoff, unexpired, and still the record that the index points to for their txid
+	struct CacheRecordHeader rec;
+	ssize_t slot;
+	bool found;
+	size_t recSz;
+	for (uint64_t offset = CACHE_MAGIC_LEN; offset < dataEnd; offset += recSz) {
+		if (pread(cache->dataFd, &rec, sizeof(rec), offset) < sizeof(rec)) { perror("pread() failed on cache"); status = CW_SYS_ERR; goto cleanup; }
+		recSz = CACHE_RECORD_SZ(rec.hexLen);
+		if (offset < cutoff || (rec.expires && rec.expires <= now)) { continue; }
+		if ((slot = cacheFindSlot(cache, rec.txid, &found)) < 0) { status = CW_SYS_ERR; goto cleanup; }
+		if (!found || cache->slots[slot].offset != offset || retainedCount > cache->header->entriesCount) { continue; }
+
+		memcpy(retained[retainedCount].txid, rec.txid, CW_TXID_BYTES);
+		retained[retainedCount].offset = offset;
+		retained[retainedCount].size = recSz;
+		++retainedCount;
+	}
+
+	// clear index before data is moved, so that a failure part-way leaves an empty (rather than corrupt) cache
+	memset(cache->slots, 0, cache->header->slotsCount*sizeof(struct CacheIndexSlot));
+	cache->header->entriesCount = 0;
+	cache->header->dataEnd = CACHE_MAGIC_LEN;
+
+	// compact retained records toward front of data log (destination never passes source, so copying forward is safe)
+	char buf[CACHE_RECORD_SZ(CW_TX_DATA_CHARS)];
+	uint64_t dest = CACHE_MAGIC_LEN;
+	for (int i=0; i<retainedCount; i++) {
+		if (retained[i].size > sizeof(buf) ||
+		    pread(cache->dataFd, buf, retained[i].size, retained[i].offset) < retained[i].size ||
+		    pwrite(cache->dataFd, buf, retained[i].size, dest) < retained[i].size) { perror("cashgettools failed to compact cache"); status = CW_SYS_ERR; goto cleanup; }
+		retained[i].offset = dest;
+		dest += retained[i].size;
+	}
+	if (ftruncate(cache->dataFd, dest) != 0) { perror("ftruncate() failed on cache"); }
+
+	// rebuild index
+	for (int i=0; i<retainedCount; i++) {
+		if ((slot = cacheFindSlot(cache, retained[i].txid, &found)) < 0) { status = CW_SYS_ERR; goto cleanup; }
+		memcpy(&cache->slots[slot].key, retained[i].txid, sizeof(cache->slots[slot].key));
+		cache->slots[slot].offset = retained[i].offset;
+		++cache->header->entriesCount;
+	}
+	cache->header->dataEnd = dest;
+
+	cleanup:
+		free(retained);
+		return status;
+}
+
+static bool cacheTxidToBytes(const char *txidHex, unsigned char *txid) {
+	if (strlen(txidHex) != CW_TXID_CHARS) { return false; }
+	for (int i=0; i<CW_TXID_CHARS; i++) { if (!isxdigit(txidHex[i])) { return false; } }
+	hexStrToByteArr(txidHex, 0, (char *)txid);
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef __CASHCACHEUTILS_H__
+#define __CASHCACHEUTILS_H__
+
+#include "cashfetchutils.h"
+
+/*
+ * opens (creating if necessary) the on-disk TXID cache within directory cacheDir, keeping its data log within roughly maxBytes;
+   the cache may be shared by any number of processes/threads at once
+ * will set params->cache on success
+ */
+CW_STATUS initCache(const char *cacheDir, size_t maxBytes, struct CWG_params *params);
+
+/*
+ * closes the TXID cache stored in params (files are kept on disk for later use);
+ * params->cache will be set NULL
+ */
+void cleanupCache(struct CWG_params *params);
+
+/*
+ * fetches hex data at specified txids, answering from cache (params->cache) where possible,
+   and fetching the remainder through given fetcher (the results of which are then added to cache)
+ * confirmed TXs are cached indefinitely, while unconfirmed TXs are kept for params->cacheUnconfirmedTTL seconds (or not cached if 0)
+ * writes all hex data (in order) to hexDataAll, and per-item details to itemInfo if not NULL (as far as the fetcher reports them)
+ */
+CW_STATUS fetchHexDataCached(const char **txids, size_t count, struct CWG_params *params, char *hexDataAll, struct FetchItemInfo *itemInfo,
+			     CW_STATUS (*fetcher)(const char **, size_t, FETCH_TYPE, struct CWG_params *, char **, char *, struct FetchItemInfo *));
+
+#endif
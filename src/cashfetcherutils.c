@@ -0,0 +1,166 @@
+#include "cashfetcherutils.h"
+#include <pthread.h>
+
+/*
+ * a single call to the fetcher, covering a slice of the ids
+ * hexData is written to its own buffer (unless the fetch isn't split) since lengths aren't known until done
+ */
+struct FetcherBatch {
+	const char **ids;
+	size_t count;
+	char **txids;
+	char *hexData;
+	struct CWG_fetch_item *items;
+	CW_STATUS status;
+};
+
+/*
+ * batches shared between the threads working through them
+ */
+struct FetcherWork {
+	const struct CWG_fetcher *fetcher;
+	FETCH_TYPE type;
+	struct FetcherBatch *batches;
+	size_t batchesCount;
+	size_t next;
+	pthread_mutex_t lock;
+};
+
+/*
+ * thread routine for taking batches from given struct FetcherWork until there are none left
+ */
+static void *fetcherWorker(void *arg);
+
+/*
+ * copies items reported by a fetch_batch call (count of them, for its hexData) to itemInfo, if their lengths are all reported and add up;
+   a call of a single TX needs no length reported
+ * otherwise, itemInfo is left as is
+ */
+static void fetcherItemsToInfo(struct CWG_fetch_item *items, size_t count, const char *hexData, struct FetchItemInfo *itemInfo);
+
+/* ------------------------------------- PUBLIC ------------------------------------- */
+
+CW_STATUS fetchHexDataFetcher(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	const struct CWG_fetcher *fetcher = params->fetcher;
+	if (!(fetcher->capabilities & CWG_FETCHER_CAN(type))) {
+		fprintf(CWG_err_stream, "fetcher doesn't support %s queries (unless resolved through local index); bad call\n",
+			type == BY_TXID ? "TXID" : type == BY_INTXID ? "revision" : "nametag");
+		return CW_CALL_NO;
+	}
+	if (count < 1) { return CWG_FETCH_NO; }
+
+	// a nametag fetch is of its nth claim, so can't be split
+	size_t itemsCount = type == BY_NAMETAG ? 1 : count;
+	size_t batchSize = type != BY_NAMETAG && fetcher->maxBatch > 0 && fetcher->maxBatch < count ? fetcher->maxBatch : count;
+	struct CWG_fetch_item *items = NULL;
+	if (itemInfo) {
+		if ((items = malloc(itemsCount*sizeof(struct CWG_fetch_item))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+		for (int i=0; i<itemsCount; i++) { items[i].hexLen = CWG_FETCH_ITEM_LEN_UNKNOWN; items[i].confirmed = false; }
+	}
+	CW_STATUS status;
+	if (batchSize >= count) {
+		status = fetcher->fetch_batch(fetcher->ctx, ids, count, type, txids, hexDataAll, items);
+		if (status == CW_OK && items) { fetcherItemsToInfo(items, itemsCount, hexDataAll, itemInfo); }
+		if (items) { free(items); }
+		return status;
+	}
+
+	struct FetcherWork work;
+	work.fetcher = fetcher;
+	work.type = type;
+	work.batchesCount = count/batchSize + (count % batchSize > 0);
+	work.next = 0;
+	if ((work.batches = calloc(work.batchesCount, sizeof(struct FetcherBatch))) == NULL) { perror("calloc failed"); free(items); return CW_SYS_ERR; }
+
+	status = CW_OK;
+	struct FetcherBatch *batch;
+	size_t threadsCount = fetcher->concurrency > 1 ? fetcher->concurrency : 1;
+	if (threadsCount > work.batchesCount) { threadsCount = work.batchesCount; }
+	pthread_t threads[threadsCount];
+	for (int i=0; i<work.batchesCount; i++) {
+		batch = &work.batches[i];
+		batch->ids = ids+i*batchSize;
+		batch->count = count-i*batchSize > batchSize ? batchSize : count-i*batchSize;
+		batch->txids = txids ? txids+i*batchSize : NULL;
+		batch->items = items ? items+i*batchSize : NULL;
+		batch->status = CW_OK;
+		if ((batch->hexData = malloc(batch->count*CW_TX_DATA_CHARS+1)) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+		batch->hexData[0] = 0;
+	}
+
+	size_t started = 0;
+	if (pthread_mutex_init(&work.lock, NULL) != 0) { perror("pthread_mutex_init() failed"); status = CW_SYS_ERR; goto cleanup; }
+	// the calling thread works through batches too, so one fewer is started
+	for (; started < threadsCount-1; started++) {
+		if (pthread_create(&threads[started], NULL, &fetcherWorker, &work) != 0) { perror("pthread_create() failed"); break; }
+	}
+	fetcherWorker(&work);
+	for (int i=0; i<started; i++) { pthread_join(threads[i], NULL); }
+	pthread_mutex_destroy(&work.lock);
+
+	char *hexDataPtr = hexDataAll;
+	*hexDataPtr = 0;
+	for (int i=0; i<work.batchesCount; i++) {
+		if (work.batches[i].status != CW_OK) { status = work.batches[i].status; goto cleanup; }
+	}
+	for (int i=0; i<work.batchesCount; i++) {
+		batch = &work.batches[i];
+		strcpy(hexDataPtr, batch->hexData);
+		if (items) { fetcherItemsToInfo(batch->items, batch->count, batch->hexData, itemInfo+i*batchSize); }
+		hexDataPtr += strlen(hexDataPtr);
+	}
+
+	cleanup:
+		for (int i=0; i<work.batchesCount; i++) { if (work.batches[i].hexData) { free(work.batches[i].hexData); } }
+		free(work.batches);
+		if (items) { free(items); }
+		return status;
+}
+
+CW_STATUS initFetcherUser(struct CWG_params *params) {
+	if (!params->fetcher->fetch_batch) {
+		fprintf(CWG_err_stream, "ERROR: fetcher is set without a fetch_batch function\n");
+		return CW_CALL_NO;
+	}
+	return params->fetcher->init ? params->fetcher->init(params->fetcher->ctx) : CW_OK;
+}
+
+void cleanupFetcherUser(struct CWG_params *params) {
+	if (params->fetcher->cleanup) { params->fetcher->cleanup(params->fetcher->ctx); }
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static void *fetcherWorker(void *arg) {
+	struct FetcherWork *work = (struct FetcherWork *)arg;
+	struct FetcherBatch *batch;
+	bool failed = false;
+	while (true) {
+		pthread_mutex_lock(&work->lock);
+		batch = !failed && work->next < work->batchesCount ? &work->batches[work->next++] : NULL;
+		pthread_mutex_unlock(&work->lock);
+		if (!batch) { break; }
+
+		batch->status = work->fetcher->fetch_batch(work->fetcher->ctx, batch->ids, batch->count, work->type, batch->txids, batch->hexData, batch->items);
+		// once a batch fails, the fetch fails, so there's no use in this thread going on
+		failed = batch->status != CW_OK;
+	}
+	return NULL;
+}
+
+static void fetcherItemsToInfo(struct CWG_fetch_item *items, size_t count, const char *hexData, struct FetchItemInfo *itemInfo) {
+	size_t hexLen = strlen(hexData);
+	if (count == 1 && items[0].hexLen == CWG_FETCH_ITEM_LEN_UNKNOWN) { items[0].hexLen = hexLen; }
+
+	size_t total = 0;
+	for (int i=0; i<count; i++) {
+		if (items[i].hexLen == CWG_FETCH_ITEM_LEN_UNKNOWN || items[i].hexLen > hexLen-total) { return; }
+		total += items[i].hexLen;
+	}
+	if (total != hexLen) { return; }
+
+	for (int i=0; i<count; i++) {
+		itemInfo[i].hexLen = items[i].hexLen;
+		itemInfo[i].confirmed = items[i].confirmed;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef __CASHFETCHERUTILS_H__
+#define __CASHFETCHERUTILS_H__
+
+#include "cashfetchutils.h"
+
+/*
+ * fetches hex data(s) at specified id(s) of specified type through the user-supplied fetcher (params->fetcher),
+   split into batches of at most its maxBatch, with up to its concurrency of them in flight at once
+ * fails with CW_CALL_NO if the fetcher doesn't support the type
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * if itemInfo is not NULL, the length of each TX's hex data and whether it is confirmed are written to it, as far as the fetcher reports them
+ */
+CW_STATUS fetchHexDataFetcher(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo);
+
+/*
+ * calls the init function of the user-supplied fetcher (params->fetcher), if it has one
+ */
+CW_STATUS initFetcherUser(struct CWG_params *params);
+
+/*
+ * calls the cleanup function of the user-supplied fetcher (params->fetcher), if it has one
+ */
+void cleanupFetcherUser(struct CWG_params *params);
+
+#endif
@@ -2,6 +2,14 @@
 #define __CASHFETCHHTTPUTILS_H__
 
 #include "cashwebutils.h"
+#include "cashjsonscanutils.h"
+#include "cashratelimitutils.h"
+#include "cashtxscanutils.h"
+#include "cashindexutils.h"
+#include <sys/mman.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
 #include <b64/b64.h>
 
 /* general fetch constants */
@@ -12,78 +20,1041 @@
 #define BITDB_QUERY_BUF_SZ (80+strlen(BITDB_QUERY_DATA_TAG)+strlen(BITDB_QUERY_ID_TAG))
 #define BITDB_ID_QUERY_BUF_SZ (20+CW_NAME_MAX_LEN)
 #define BITDB_RESPHANDLE_QUERY_BUF_SZ (30+CW_NAME_MAX_LEN)
+#define BITDB_REVISIONS_QUERY_BUF_SZ (480+CW_TXID_CHARS)
 #define BITDB_HEADER_BUF_SZ 40
 #define BITDB_QUERY_ID_TAG "n"
 #define BITDB_QUERY_INFO_TAG "i"
 #define BITDB_QUERY_TXID_TAG "t"
 #define BITDB_QUERY_DATA_TAG "d"
+#define BITDB_QUERY_DEPTH_TAG "p"
+#define BITDB_CONFIRMED_COLL "c"
 #define BITDB_REQUEST_TIMEOUT 20L
 
 /* REST HTTP constants */
 #define REST_GETTX_URI "/rawtransactions/getRawTransaction"
 
-static CW_STATUS httpRequest(const char *url, const char *postData, bool reqLimit, FILE **respFp);
+/* bitcoind JSON-RPC constants */
+#define RPC_CALL_FMT "{\"jsonrpc\":\"1.0\",\"id\":%zu,\"method\":\"%s\",\"params\":%s}"
+#define RPC_GETRAWTX_PARAMS_FMT "[\"%s\",false]"
+#define RPC_TXID_PARAMS_FMT "[\"%s\"]"
+#define RPC_GETBLOCK_PARAMS_FMT "[\"%.*s\",0]"
+#define RPC_ERR_NO_TX -5
+#define RPC_INDEX_BLOCKS_BATCH 8
+#define RPC_INDEX_COMMIT_INTERVAL 10000
+
+/* HTTP pool constants */
+#define HTTP_POOL_HANDLES_MAX 16
+
+/* HTTP response constants */
+#define HTTP_RESP_BUF_START 4096
+#define HTTP_RESP_MEM_MAX (16*1024*1024)
+#define HTTP_RESP_MSG_MAX 4096
+
+/* HTTP multi-request constants */
+#define HTTP_MULTI_WAIT_MS 1000
+#define HTTP_THROTTLE_RETRIES_MAX 5
+#define HTTP_RETRY_AFTER_DEFAULT_MS 1000L
+#define HTTP_RETRY_AFTER_MAX_MS 60000L
+
+/* HTTP endpoint constants */
+#define HTTP_ENDPOINTS_MAX 16
+#define HTTP_ENDPOINTS_LIST_MAX 8
+#define HTTP_ENDPOINT_MAX_LEN 255
+#define HTTP_ENDPOINT_SAMPLES 32
+#define HTTP_ENDPOINT_SAMPLES_MIN 4
+#define HTTP_ENDPOINT_DOWN_MS 2000L
+#define HTTP_ENDPOINT_DOWN_SHIFT_MAX 7
+#define HTTP_HEALTH_CHECK_INTERVAL 5
+#define HTTP_HEALTH_CHECK_TIMEOUT 5L
+#define HTTP_HEDGE_PERCENTILE 95
+#define HTTP_HEDGE_MIN_MS 50L
+#define HTTP_HEDGE_DEFAULT_MS 3000L
+#define HTTP_BATCH_GROW 2
+
+/*
+ * pool of persistent HTTP handles/connections, shared between threads and successive gets;
+ * opaque outside of the curl implementation (stored in params as void *)
+ */
+struct HttpPool;
+
+/*
+ * growable in-memory buffer for an HTTP response body; data is always kept NUL-terminated
+ * if body exceeds HTTP_RESP_MEM_MAX, everything is moved to spill (a tmpfile) and data is freed;
+   map is set if the spill file has since been mapped into memory for parsing
+ */
+struct HttpResponse {
+	char *data;
+	size_t len;
+	size_t size;
+	FILE *spill;
+	void *map;
+};
+
+/*
+ * initializes struct HttpResponse
+ */
+static inline void initHttpResponse(struct HttpResponse *resp) {
+	resp->data = NULL;
+	resp->len = 0;
+	resp->size = 0;
+	resp->spill = NULL;
+	resp->map = NULL;
+}
+
+/*
+ * frees heap-allocated data/spill file of given struct HttpResponse
+ */
+static inline void freeHttpResponse(struct HttpResponse *resp) {
+	if (resp->data) { free(resp->data); }
+	if (resp->map) { munmap(resp->map, resp->len); }
+	if (resp->spill) { fclose(resp->spill); }
+	initHttpResponse(resp);
+}
+
+/*
+ * appends n bytes to response, growing buffer or spilling to disk as necessary
+ * returns false on failure
+ */
+static bool appendHttpResponse(struct HttpResponse *resp, const void *data, size_t n) {
+	if (!resp->spill && resp->len + n > HTTP_RESP_MEM_MAX) {
+		if ((resp->spill = tmpfile()) == NULL) { perror("tmpfile() failed"); return false; }
+		if (resp->len > 0 && fwrite(resp->data, 1, resp->len, resp->spill) < resp->len) { perror("fwrite() failed on response spill"); return false; }
+		free(resp->data);
+		resp->data = NULL;
+		resp->size = 0;
+	}
+	if (resp->spill) {
+		if (fwrite(data, 1, n, resp->spill) < n) { perror("fwrite() failed on response spill"); return false; }
+		resp->len += n;
+		return true;
+	}
+
+	if (resp->len + n + 1 > resp->size) {
+		size_t newSize = resp->size ? resp->size : HTTP_RESP_BUF_START;
+		while (resp->len + n + 1 > newSize) { newSize *= 2; }
+		char *newData;
+		if ((newData = realloc(resp->data, newSize)) == NULL) { perror("realloc failed"); return false; }
+		resp->data = newData;
+		resp->size = newSize;
+	}
+	memcpy(resp->data + resp->len, data, n);
+	resp->len += n;
+	resp->data[resp->len] = 0;
+	return true;
+}
+
+/*
+ * gets whole response body as contiguous memory (mapping spill file if body was too large to be kept in memory), writing its length to lenPtr
+ * returns NULL on failure
+ */
+static const char *httpResponseBody(struct HttpResponse *resp, size_t *lenPtr) {
+	*lenPtr = resp->len;
+	if (!resp->spill) { return resp->data ? resp->data : ""; }
+
+	if (!resp->map) {
+		if (fflush(resp->spill) != 0) { perror("fflush() failed on response spill"); return NULL; }
+		void *map;
+		if ((map = mmap(NULL, resp->len, PROT_READ, MAP_PRIVATE, fileno(resp->spill), 0)) == MAP_FAILED) { perror("mmap() failed on response spill"); return NULL; }
+		resp->map = map;
+	}
+	return (const char *)resp->map;
+}
+
+/*
+ * gets response body as string, for reporting/matching on errors;
+ * if body was spilled to disk, only the first HTTP_RESP_MSG_MAX bytes are read back
+ * returns NULL on failure
+ */
+static const char *httpResponseStr(struct HttpResponse *resp) {
+	if (!resp->spill) { return resp->data ? resp->data : ""; }
+
+	if (!resp->data) {
+		if ((resp->data = malloc(HTTP_RESP_MSG_MAX+1)) == NULL) { perror("malloc failed"); return NULL; }
+		resp->size = HTTP_RESP_MSG_MAX+1;
+		rewind(resp->spill);
+		resp->data[fread(resp->data, 1, HTTP_RESP_MSG_MAX, resp->spill)] = 0;
+	}
+	return resp->data;
+}
+
+/*
+ * a single HTTP request (POST if postData is set, otherwise GET) and its outcome;
+ * url/postData are heap-allocated by whoever builds the request, and freed with freeHttpRequest()
+ * endpoint is that which the request is to, by which it is rate limited (not limited if NULL)
+ * auth optionally gives credentials for HTTP basic authentication, as "<user>:<password>"
+ * hedge optionally points to an equivalent request (to another endpoint) that is raced against this one once it has been outstanding
+   for hedgeAfterMs, or sent straight away if this one fails; whichever succeeds first has the other abandoned
+ * status is CWG_FETCH_NO for a request that was never sent or was abandoned; elapsedMs is how long it was outstanding
+ * timedOut is set if the request failed by timing out
+ * transfer tallies what the request (and any resends of it) took over the wire
+ */
+struct HttpRequest {
+	char *url;
+	char *postData;
+	const char *endpoint;
+	const char *auth;
+	struct HttpResponse resp;
+	struct HttpRequest *hedge;
+	long hedgeAfterMs;
+	CW_STATUS status;
+	double elapsedMs;
+	bool timedOut;
+	struct CWG_transfer_stats transfer;
+};
+
+/*
+ * initializes struct HttpRequest
+ */
+static inline void initHttpRequest(struct HttpRequest *req) {
+	req->url = NULL;
+	req->postData = NULL;
+	req->endpoint = NULL;
+	req->auth = NULL;
+	initHttpResponse(&req->resp);
+	req->hedge = NULL;
+	req->hedgeAfterMs = 0;
+	req->status = CW_OK;
+	req->elapsedMs = 0;
+	req->timedOut = false;
+	init_CWG_transfer_stats(&req->transfer);
+}
+
+/*
+ * frees heap-allocated url/postData/response of given struct HttpRequest
+ */
+static inline void freeHttpRequest(struct HttpRequest *req) {
+	if (req->url) { free(req->url); }
+	if (req->postData) { free(req->postData); }
+	freeHttpResponse(&req->resp);
+	initHttpRequest(req);
+}
+
+/*
+ * adds given transfer tallies to stats (if not NULL), atomically so that stats may be shared between threads
+ */
+static inline void httpTransferStatsAdd(struct CWG_transfer_stats *stats, const struct CWG_transfer_stats *transfer) {
+	if (!stats) { return; }
+	__atomic_add_fetch(&stats->requests, transfer->requests, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->wireBytes, transfer->wireBytes, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->decodedBytes, transfer->decodedBytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * performs all given requests concurrently, with at most maxInFlight outstanding at a time (treated as 1 if 0), along with their hedges as needed
+   (hedges don't count against maxInFlight, as they stand in for requests already outstanding);
+ * requests are held back (in order) while limiter (if not NULL) has no token for their endpoint, and a request throttled by its endpoint
+   (429, or 503 with Retry-After) is held off as asked and resent, up to HTTP_THROTTLE_RETRIES_MAX times
+ * responses are asked for compressed (with whichever of gzip/deflate/br the engine supports) and decompressed as they arrive;
+   what each request took on the wire, and decoded, is tallied in its transfer
+ * outcome of each is written to its status/resp, and the requests complete in whatever order the server answers them;
+   a server error (5xx) is taken as failure of the request
+ * returns CW_OK unless the engine itself fails, in which case any unperformed requests are marked with the returned status
+ */
+static CW_STATUS httpRequestMulti(struct HttpPool *pool, struct RateLimiter *limiter, struct HttpRequest **reqs, size_t count, bool reqLimit, size_t maxInFlight);
+
+/*
+ * outcome of a batch sent to an endpoint, as fed back to its learned batch size
+ */
+typedef enum HttpBatchOutcome {
+	HTTP_BATCH_OK,
+	HTTP_BATCH_TOO_LARGE,
+	HTTP_BATCH_TIMED_OUT
+} HTTP_BATCH_OUTCOME;
+
+/*
+ * what has been learned of each HTTP endpoint, guarded by lock; shared by all fetches through the same pool (or process, if no pool)
+ * size is the number of ids the endpoint is currently sent per request (SIZE_MAX until it has rejected one);
+   it grows additively by HTTP_BATCH_GROW as batches of that size succeed, and is halved whenever a batch is too large or times out
+ * ceiling is the smallest batch the endpoint has found too large (SIZE_MAX if none), which size never grows to;
+   timeouts are taken as transient and only shrink size
+ * latencies holds the most recent response times (ms) in a ring, from which selection weight and hedging deadline are drawn
+ * failures counts consecutive failed requests, and the endpoint is skipped until downUntil (monotonic ms) after a failure
+ * if path is set (on first use with params->batchSizesPath), sizes are loaded from it and saved back to it whenever they change
+ * seed is the state of the PRNG (rand_r()) that endpoints are picked with, only used under lock
+ */
+struct HttpEndpoints {
+	pthread_mutex_t lock;
+	unsigned int seed;
+	struct {
+		char endpoint[HTTP_ENDPOINT_MAX_LEN+1];
+		size_t size;
+		size_t ceiling;
+		double latencies[HTTP_ENDPOINT_SAMPLES];
+		size_t latenciesCount;
+		unsigned int failures;
+		double downUntil;
+	} entries[HTTP_ENDPOINTS_MAX];
+	size_t entriesCount;
+	char *path;
+};
+
+/*
+ * gets monotonic time in milliseconds
+ */
+static double httpNowMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0;
+}
+
+/*
+ * initializes struct HttpEndpoints
+ */
+static inline void initHttpEndpoints(struct HttpEndpoints *eps) {
+	pthread_mutex_init(&eps->lock, NULL);
+	eps->seed = (unsigned int)time(NULL) ^ (unsigned int)getpid() ^ (unsigned int)(uintptr_t)eps;
+	eps->entriesCount = 0;
+	eps->path = NULL;
+}
+
+/*
+ * frees heap-allocated data of given struct HttpEndpoints
+ */
+static inline void destroyHttpEndpoints(struct HttpEndpoints *eps) {
+	if (eps->path) { free(eps->path); }
+	pthread_mutex_destroy(&eps->lock);
+}
+
+/*
+ * finds entry index of given endpoint, adding it (with nothing learned) if absent and add is set; lock must be held
+ * returns -1 if not found/tracked (endpoint too long or table full)
+ */
+static int httpEndpointsEntry(struct HttpEndpoints *eps, const char *endpoint, bool add) {
+	if (strlen(endpoint) > HTTP_ENDPOINT_MAX_LEN) { return -1; }
+	for (int i=0; i<eps->entriesCount; i++) { if (strcmp(eps->entries[i].endpoint, endpoint) == 0) { return i; } }
+	if (!add || eps->entriesCount >= HTTP_ENDPOINTS_MAX) { return -1; }
+
+	int i = eps->entriesCount++;
+	strcpy(eps->entries[i].endpoint, endpoint);
+	eps->entries[i].size = SIZE_MAX;
+	eps->entries[i].ceiling = SIZE_MAX;
+	eps->entries[i].latenciesCount = 0;
+	eps->entries[i].failures = 0;
+	eps->entries[i].downUntil = 0;
+	return i;
+}
+
+/*
+ * loads learned sizes from file at path (a line of "<size> <ceiling> <endpoint>" per endpoint, with 0 for none), and remembers path for saving; lock must be held
+ * a missing or unreadable file is not an error, as it just means nothing has been learned yet
+ */
+static void httpEndpointsLoad(struct HttpEndpoints *eps, const char *path) {
+	if ((eps->path = strdup(path)) == NULL) { perror("strdup failed"); return; }
+
+	FILE *file;
+	if ((file = fopen(path, "r")) == NULL) { return; }
+	char endpoint[HTTP_ENDPOINT_MAX_LEN+1];
+	char fmt[32];
+	snprintf(fmt, sizeof(fmt), "%%zu %%zu %%%ds", HTTP_ENDPOINT_MAX_LEN);
+	size_t size;
+	size_t ceiling;
+	int i;
+	while (fscanf(file, fmt, &size, &ceiling, endpoint) == 3) {
+		if ((i = httpEndpointsEntry(eps, endpoint, true)) < 0) { continue; }
+		eps->entries[i].size = size > 0 ? size : SIZE_MAX;
+		eps->entries[i].ceiling = ceiling > 1 ? ceiling : SIZE_MAX;
+	}
+	fclose(file);
+}
+
+/*
+ * saves learned sizes to eps->path (if set), through a temporary file so that concurrent readers never see it partially written; lock must be held
+ */
+static void httpEndpointsSave(struct HttpEndpoints *eps) {
+	if (!eps->path) { return; }
+
+	char tmpPath[strlen(eps->path)+24];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.%ld", eps->path, (long)getpid());
+	FILE *file;
+	if ((file = fopen(tmpPath, "w")) == NULL) { perror("fopen() failed on batch sizes file"); return; }
+	for (int i=0; i<eps->entriesCount; i++) {
+		fprintf(file, "%zu %zu %s\n", eps->entries[i].size != SIZE_MAX ? eps->entries[i].size : 0,
+			eps->entries[i].ceiling != SIZE_MAX ? eps->entries[i].ceiling : 0, eps->entries[i].endpoint);
+	}
+	if (fclose(file) != 0 || rename(tmpPath, eps->path) != 0) { perror("failed to save batch sizes file"); remove(tmpPath); }
+}
+
+/*
+ * gets current batch size for endpoint (SIZE_MAX if nothing learned), loading from path (if not NULL) on first use
+ */
+static size_t httpEndpointsBatchSize(struct HttpEndpoints *eps, const char *endpoint, const char *path) {
+	pthread_mutex_lock(&eps->lock);
+	if (path && !eps->path) { httpEndpointsLoad(eps, path); }
+	int i = httpEndpointsEntry(eps, endpoint, false);
+	size_t size = i >= 0 ? eps->entries[i].size : SIZE_MAX;
+	pthread_mutex_unlock(&eps->lock);
+	return size;
+}
+
+/*
+ * records outcome of a batch of count ids sent to endpoint:
+   on failure, size is halved from count (and ceiling lowered to count if too large); on success with a full batch, size grows additively
+ */
+static void httpEndpointsBatchOutcome(struct HttpEndpoints *eps, const char *endpoint, size_t count, HTTP_BATCH_OUTCOME outcome) {
+	pthread_mutex_lock(&eps->lock);
+	int i;
+	size_t size;
+	size_t ceiling;
+	if ((i = httpEndpointsEntry(eps, endpoint, outcome != HTTP_BATCH_OK)) >= 0) {
+		size = eps->entries[i].size;
+		ceiling = eps->entries[i].ceiling;
+		if (outcome != HTTP_BATCH_OK) {
+			if (count/2 < size) { size = count/2 > 0 ? count/2 : 1; }
+			if (outcome == HTTP_BATCH_TOO_LARGE && count < ceiling) { ceiling = count; }
+		}
+		else if (size != SIZE_MAX && count >= size) {
+			size = size+HTTP_BATCH_GROW < ceiling ? size+HTTP_BATCH_GROW : ceiling-1;
+		}
+
+		if (size != eps->entries[i].size || ceiling != eps->entries[i].ceiling) {
+			eps->entries[i].size = size;
+			eps->entries[i].ceiling = ceiling;
+			httpEndpointsSave(eps);
+		}
+	}
+	pthread_mutex_unlock(&eps->lock);
+}
+
+/*
+ * records outcome of a request to endpoint that took elapsedMs: on success its latency is sampled (failures reset),
+   and on failure it is marked down for a backoff that doubles with each consecutive failure
+ * a request abandoned for a hedge is sampled as a success, as its elapsed time is still a (lower bound on) latency
+ */
+static void httpEndpointsRequestOutcome(struct HttpEndpoints *eps, const char *endpoint, double elapsedMs, bool failed) {
+	pthread_mutex_lock(&eps->lock);
+	int i;
+	if ((i = httpEndpointsEntry(eps, endpoint, true)) >= 0) {
+		if (failed) {
+			unsigned int backoffShift = eps->entries[i].failures < HTTP_ENDPOINT_DOWN_SHIFT_MAX ? eps->entries[i].failures : HTTP_ENDPOINT_DOWN_SHIFT_MAX;
+			++eps->entries[i].failures;
+			eps->entries[i].downUntil = httpNowMs() + (HTTP_ENDPOINT_DOWN_MS << backoffShift);
+		} else {
+			eps->entries[i].failures = 0;
+			eps->entries[i].downUntil = 0;
+			eps->entries[i].latencies[eps->entries[i].latenciesCount++ % HTTP_ENDPOINT_SAMPLES] = elapsedMs;
+		}
+	}
+	pthread_mutex_unlock(&eps->lock);
+}
+
+/*
+ * marks endpoint as up again (e.g. upon passing a health check)
+ */
+static void httpEndpointsRecover(struct HttpEndpoints *eps, const char *endpoint) {
+	pthread_mutex_lock(&eps->lock);
+	int i;
+	if ((i = httpEndpointsEntry(eps, endpoint, false)) >= 0) {
+		eps->entries[i].failures = 0;
+		eps->entries[i].downUntil = 0;
+	}
+	pthread_mutex_unlock(&eps->lock);
+}
+
+/*
+ * for qsort of latencies
+ */
+static int compareLatencies(const void *a, const void *b) {
+	double diff = *(const double *)a - *(const double *)b;
+	return (diff > 0) - (diff < 0);
+}
+
+/*
+ * gets given percentile of entry's sampled latencies, or a negative value if too few have been sampled; lock must be held
+ */
+static double httpEndpointsLatency(struct HttpEndpoints *eps, int i, int percentile) {
+	size_t count = eps->entries[i].latenciesCount < HTTP_ENDPOINT_SAMPLES ? eps->entries[i].latenciesCount : HTTP_ENDPOINT_SAMPLES;
+	if (count < HTTP_ENDPOINT_SAMPLES_MIN) { return -1; }
+
+	double sorted[HTTP_ENDPOINT_SAMPLES];
+	memcpy(sorted, eps->entries[i].latencies, count*sizeof(double));
+	qsort(sorted, count, sizeof(double), &compareLatencies);
+	size_t index = count*percentile/100;
+	return sorted[index < count ? index : count-1];
+}
+
+/*
+ * picks one of count equivalent endpoints (other than exclude, if not NULL) at random, weighted by inverse of median latency;
+   endpoints not yet sampled are weighted as the fastest, so as to be tried, and those marked down are skipped
+ * if every candidate is down, picks the one due back soonest
+ * returns NULL if there are no candidates
+ */
+static const char *httpEndpointsPick(struct HttpEndpoints *eps, const char **endpoints, size_t count, const char *exclude) {
+	double weights[count];
+	double latency;
+	double fastest = -1;
+	double now = httpNowMs();
+	double soonest = 0;
+	const char *soonestEndpoint = NULL;
+	int entry;
+	int draw;
+
+	pthread_mutex_lock(&eps->lock);
+	draw = rand_r(&eps->seed);
+	for (int i=0; i<count; i++) {
+		weights[i] = 0;
+		if (endpoints[i] == exclude) { continue; }
+		if ((entry = httpEndpointsEntry(eps, endpoints[i], true)) < 0) { weights[i] = -1; continue; }
+		if (eps->entries[entry].downUntil > now) {
+			if (!soonestEndpoint || eps->entries[entry].downUntil < soonest) { soonest = eps->entries[entry].downUntil; soonestEndpoint = endpoints[i]; }
+			continue;
+		}
+		if ((latency = httpEndpointsLatency(eps, entry, 50)) < 0) { weights[i] = -1; continue; }
+		weights[i] = 1/(latency+1);
+		if (fastest < 0 || latency < fastest) { fastest = latency; }
+	}
+	pthread_mutex_unlock(&eps->lock);
+
+	double total = 0;
+	for (int i=0; i<count; i++) {
+		if (weights[i] < 0) { weights[i] = fastest < 0 ? 1 : 1/(fastest+1); }
+		total += weights[i];
+	}
+	if (total <= 0) { return soonestEndpoint; }
+
+	double r = total*draw/((double)RAND_MAX+1);
+	for (int i=0; i<count; i++) {
+		if (weights[i] <= 0) { continue; }
+		if ((r -= weights[i]) < 0) { return endpoints[i]; }
+	}
+	for (int i=count-1; i>=0; i--) { if (weights[i] > 0) { return endpoints[i]; } }
+	return soonestEndpoint;
+}
+
+/*
+ * gets how long (ms) a request to endpoint should be left outstanding before it is hedged,
+   i.e. the HTTP_HEDGE_PERCENTILE of its sampled latencies (HTTP_HEDGE_DEFAULT_MS if too few samples)
+ */
+static long httpEndpointsHedgeAfter(struct HttpEndpoints *eps, const char *endpoint) {
+	double latency = -1;
+	pthread_mutex_lock(&eps->lock);
+	int i;
+	if ((i = httpEndpointsEntry(eps, endpoint, false)) >= 0) { latency = httpEndpointsLatency(eps, i, HTTP_HEDGE_PERCENTILE); }
+	pthread_mutex_unlock(&eps->lock);
+	if (latency < 0) { return HTTP_HEDGE_DEFAULT_MS; }
+	return latency > HTTP_HEDGE_MIN_MS ? (long)latency : HTTP_HEDGE_MIN_MS;
+}
+
+/*
+ * copies up to max endpoints currently marked down to given buffers
+ * returns number copied
+ */
+static size_t httpEndpointsDown(struct HttpEndpoints *eps, char (*endpoints)[HTTP_ENDPOINT_MAX_LEN+1], size_t max) {
+	size_t count = 0;
+	pthread_mutex_lock(&eps->lock);
+	for (int i=0; i<eps->entriesCount && count<max; i++) {
+		if (eps->entries[i].failures > 0) { strcpy(endpoints[count++], eps->entries[i].endpoint); }
+	}
+	pthread_mutex_unlock(&eps->lock);
+	return count;
+}
+
+/*
+ * splits whitespace-separated list of equivalent endpoints into buf (of at least strlen(list)+1), pointing entries of endpoints into it
+ * returns number of endpoints (up to HTTP_ENDPOINTS_LIST_MAX)
+ */
+static size_t httpEndpointsParseList(const char *list, char *buf, const char **endpoints) {
+	strcpy(buf, list);
+	size_t count = 0;
+	char *savePtr;
+	for (char *tok = strtok_r(buf, " \t\r\n", &savePtr); tok && count < HTTP_ENDPOINTS_LIST_MAX; tok = strtok_r(NULL, " \t\r\n", &savePtr)) {
+		endpoints[count++] = tok;
+	}
+	return count;
+}
+
+/*
+ * gets what has been learned of endpoints through given pool (or for the whole process if pool is NULL)
+ */
+static struct HttpEndpoints *httpPoolEndpoints(struct HttpPool *pool);
+
+/*
+ * ensures that endpoints of given pool marked down are health-checked in the background, so they are taken back as soon as they recover
+   (otherwise, they are retried once their backoff passes)
+ */
+static void httpPoolHealthCheck(struct HttpPool *pool);
 
 #ifndef __EMSCRIPTEN__
 
 #include <curl/curl.h>
 
 /*
- * for writing curl response to specified file stream
- * returns number of bytes written
+ * curl easy handles are kept around after use so that connections, DNS and TLS sessions stay warm;
+ * shareLocks guard the CURLSH per curl_lock_data, and handlesLock guards the handle stack
+ * endpoints holds what has been learned of each endpoint over the pool's lifetime
+ * healthThread health-checks endpoints marked down, once started by httpPoolHealthCheck() (from process healthPid);
+   healthLock/healthCond guard its start and stop
+ */
+struct HttpPool {
+	CURLSH *share;
+	pthread_mutex_t shareLocks[CURL_LOCK_DATA_LAST];
+	pthread_mutex_t handlesLock;
+	CURL *handles[HTTP_POOL_HANDLES_MAX];
+	size_t handlesCount;
+	struct HttpEndpoints endpoints;
+	pthread_t healthThread;
+	pid_t healthPid;
+	bool healthStarted;
+	bool healthStop;
+	pthread_mutex_t healthLock;
+	pthread_cond_t healthCond;
+};
+
+/*
+ * lock/unlock callbacks for curl share interface
  */
-static size_t writeResponseToStream(void *data, size_t size, size_t nmemb, FILE *respStream) {
-	return fwrite(data, size, nmemb, respStream)*size;
+static void httpPoolShareLock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+	pthread_mutex_lock(&((struct HttpPool *)userptr)->shareLocks[data]);
+}
+
+static void httpPoolShareUnlock(CURL *handle, curl_lock_data data, void *userptr) {
+	pthread_mutex_unlock(&((struct HttpPool *)userptr)->shareLocks[data]);
+}
+
+/*
+ * initializes curl environment and allocates new HTTP pool, written to given pointer
+ * must be destroyed with httpPoolDestroy()
+ */
+static CW_STATUS httpPoolNew(struct HttpPool **poolPtr) {
+	if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) { fprintf(CWG_err_stream, "curl_global_init() failed\n"); return CW_SYS_ERR; }
+
+	struct HttpPool *pool;
+	if ((pool = malloc(sizeof(struct HttpPool))) == NULL) { perror("malloc failed"); curl_global_cleanup(); return CW_SYS_ERR; }
+	if ((pool->share = curl_share_init()) == NULL) {
+		fprintf(CWG_err_stream, "curl_share_init() failed\n");
+		free(pool);
+		curl_global_cleanup();
+		return CW_SYS_ERR;
+	}
+	for (int i=0; i<CURL_LOCK_DATA_LAST; i++) { pthread_mutex_init(&pool->shareLocks[i], NULL); }
+	pthread_mutex_init(&pool->handlesLock, NULL);
+	pool->handlesCount = 0;
+	initHttpEndpoints(&pool->endpoints);
+	pool->healthStarted = false;
+	pool->healthStop = false;
+	pthread_mutex_init(&pool->healthLock, NULL);
+	pthread_cond_init(&pool->healthCond, NULL);
+
+	curl_share_setopt(pool->share, CURLSHOPT_LOCKFUNC, &httpPoolShareLock);
+	curl_share_setopt(pool->share, CURLSHOPT_UNLOCKFUNC, &httpPoolShareUnlock);
+	curl_share_setopt(pool->share, CURLSHOPT_USERDATA, pool);
+	curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	curl_share_setopt(pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+
+	*poolPtr = pool;
+	return CW_OK;
 }
 
 /*
- * implementation of httpRequest which operates over libcurl
+ * frees all handles held by given HTTP pool, the pool itself, and cleans up curl environment
  */
-static CW_STATUS httpRequest(const char *url, const char *postData, bool reqLimit, FILE **respFp) {
-	if ((*respFp = tmpfile()) == NULL) { perror("tmpfile() failed"); return CW_SYS_ERR; }
+static void httpPoolDestroy(struct HttpPool *pool) {
+	pthread_mutex_lock(&pool->healthLock);
+	pool->healthStop = true;
+	pthread_cond_signal(&pool->healthCond);
+	pthread_mutex_unlock(&pool->healthLock);
+	if (pool->healthStarted && pool->healthPid == getpid()) { pthread_join(pool->healthThread, NULL); }
+	pthread_mutex_destroy(&pool->healthLock);
+	pthread_cond_destroy(&pool->healthCond);
+
+	for (int i=0; i<pool->handlesCount; i++) { curl_easy_cleanup(pool->handles[i]); }
+	curl_share_cleanup(pool->share);
+	for (int i=0; i<CURL_LOCK_DATA_LAST; i++) { pthread_mutex_destroy(&pool->shareLocks[i]); }
+	pthread_mutex_destroy(&pool->handlesLock);
+	destroyHttpEndpoints(&pool->endpoints);
+	free(pool);
+	curl_global_cleanup();
+}
+
+static struct HttpEndpoints *httpPoolEndpoints(struct HttpPool *pool) {
+	static struct HttpEndpoints processEndpoints = { .lock = PTHREAD_MUTEX_INITIALIZER };
+	return pool ? &pool->endpoints : &processEndpoints;
+}
+
+/*
+ * gets an easy handle from pool (or a new one if none are free), attached to pool's share;
+ * if pool is NULL, simply returns a fresh handle
+ * returns NULL on failure
+ */
+static CURL *httpPoolPop(struct HttpPool *pool) {
+	CURL *curl = NULL;
+	if (pool) {
+		pthread_mutex_lock(&pool->handlesLock);
+		if (pool->handlesCount > 0) { curl = pool->handles[--pool->handlesCount]; }
+		pthread_mutex_unlock(&pool->handlesLock);
+	}
+
+	if (curl) { curl_easy_reset(curl); }
+	else if ((curl = curl_easy_init()) == NULL) { return NULL; }
+
+	if (pool) {
+		curl_easy_setopt(curl, CURLOPT_SHARE, pool->share);
+		curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	}
+	return curl;
+}
+
+/*
+ * returns easy handle to pool for reuse (or cleans it up if pool is full or NULL)
+ */
+static void httpPoolPush(struct HttpPool *pool, CURL *curl) {
+	if (pool) {
+		pthread_mutex_lock(&pool->handlesLock);
+		if (pool->handlesCount < HTTP_POOL_HANDLES_MAX) { pool->handles[pool->handlesCount++] = curl; curl = NULL; }
+		pthread_mutex_unlock(&pool->handlesLock);
+	}
+	if (curl) { curl_easy_cleanup(curl); }
+}
+
+/*
+ * for discarding response body of health check
+ */
+static size_t writeResponseDiscard(void *data, size_t size, size_t nmemb, void *userp) {
+	return size*nmemb;
+}
+
+/*
+ * body of pool's health check thread: every HTTP_HEALTH_CHECK_INTERVAL seconds, requests each endpoint marked down,
+   and takes it back if it answers with anything short of a server error
+ */
+static void *httpPoolHealthThread(void *arg) {
+	struct HttpPool *pool = (struct HttpPool *)arg;
+	char down[HTTP_ENDPOINTS_MAX][HTTP_ENDPOINT_MAX_LEN+1];
+	size_t downCount;
+	struct timespec deadline;
 	CURL *curl;
-	CURLcode res;
-	if (!(curl = curl_easy_init())) { fprintf(CWG_err_stream, "curl_easy_init() failed\n"); return CW_SYS_ERR; }	
+	long code;
+
+	pthread_mutex_lock(&pool->healthLock);
+	while (!pool->healthStop) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += HTTP_HEALTH_CHECK_INTERVAL;
+		pthread_cond_timedwait(&pool->healthCond, &pool->healthLock, &deadline);
+		if (pool->healthStop) { break; }
+		pthread_mutex_unlock(&pool->healthLock);
+
+		downCount = httpEndpointsDown(&pool->endpoints, down, HTTP_ENDPOINTS_MAX);
+		for (int i=0; i<downCount; i++) {
+			if ((curl = httpPoolPop(pool)) == NULL) { continue; }
+			curl_easy_setopt(curl, CURLOPT_URL, down[i]);
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeResponseDiscard);
+			curl_easy_setopt(curl, CURLOPT_TIMEOUT, HTTP_HEALTH_CHECK_TIMEOUT);
+			curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+			code = 0;
+			if (curl_easy_perform(curl) == CURLE_OK && curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code) == CURLE_OK && code > 0 && code < 500) {
+				httpEndpointsRecover(&pool->endpoints, down[i]);
+			}
+			httpPoolPush(pool, curl);
+		}
 
+		pthread_mutex_lock(&pool->healthLock);
+	}
+	pthread_mutex_unlock(&pool->healthLock);
+	return NULL;
+}
+
+static void httpPoolHealthCheck(struct HttpPool *pool) {
+	if (!pool) { return; }
+	pthread_mutex_lock(&pool->healthLock);
+	if (!pool->healthStarted && !pool->healthStop) {
+		if (pthread_create(&pool->healthThread, NULL, &httpPoolHealthThread, pool) == 0) {
+			pool->healthStarted = true;
+			pool->healthPid = getpid();
+		}
+		else { perror("pthread_create() failed for health check"); }
+	}
+	pthread_mutex_unlock(&pool->healthLock);
+}
+
+/*
+ * for writing curl response to specified struct HttpResponse
+ * returns number of bytes written (anything short of size*nmemb signals an error to curl)
+ */
+static size_t writeResponseToBuffer(void *data, size_t size, size_t nmemb, void *resp) {
+	return appendHttpResponse((struct HttpResponse *)resp, data, size*nmemb) ? size*nmemb : 0;
+}
+
+/*
+ * sets up given easy handle for request, with response written to the request's struct HttpResponse;
+ * header list to be freed after the request (if any) is written to headersPtr
+ */
+static void httpSetupHandle(CURL *curl, struct HttpRequest *req, bool reqLimit, struct curl_slist **headersPtr) {
 	struct curl_slist *headers = NULL;
 	if (reqLimit) { // this bit is to trick a server's request limit, although won't necessarily work with every server
 		char buf[BITDB_HEADER_BUF_SZ];
 		snprintf(buf, sizeof(buf), "X-Forwarded-For: %d.%d.%d.%d",
 			rand()%1000 + 1, rand()%1000 + 1, rand()%1000 + 1, rand()%1000 + 1);
 		headers = curl_slist_append(headers, buf);
-		if (postData) { headers = curl_slist_append(headers, "Content-Type: application/json"); }
+		if (req->postData) { headers = curl_slist_append(headers, "Content-Type: application/json"); }
 		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 	}
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeResponseToStream);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, *respFp);
+	curl_easy_setopt(curl, CURLOPT_URL, req->url);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeResponseToBuffer);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req->resp);
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // all encodings this libcurl was built to decode
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
 	curl_easy_setopt(curl, CURLOPT_TIMEOUT, BITDB_REQUEST_TIMEOUT);
-	if (postData) {
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData);
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(postData));
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_USERPWD, req->auth); // unset (NULL) as well, as handles are reused
+	if (req->postData) {
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->postData);
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, strlen(req->postData));
 		curl_easy_setopt(curl, CURLOPT_POST, 1L);
 	}
-	res = curl_easy_perform(curl);
+	*headersPtr = headers;
+}
 
-	if (headers) { curl_slist_free_all(headers); }
-	curl_easy_cleanup(curl);
-	if (res != CURLE_OK) {
-		fprintf(CWG_err_stream, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-		return CWG_FETCH_ERR;
+/*
+ * detaches easy handle from multi handle and returns it to the pool, freeing its header list;
+   what the handle received is tallied in its request's transfer beforehand (so must be called before the response is freed)
+ */
+static void httpReleaseHandle(CURLM *multi, struct HttpPool *pool, CURL *curl, struct curl_slist *headers) {
+	struct HttpRequest *req;
+	long headerBytes = 0;
+	if (curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&req) == CURLE_OK && req) {
+		// size downloaded is counted before content decoding, so is the body's size on the wire
+#if LIBCURL_VERSION_NUM >= 0x073700
+		curl_off_t bodyBytes = 0;
+		curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bodyBytes);
+#else
+		double bodyBytes = 0;
+		curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &bodyBytes);
+#endif
+		curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headerBytes);
+		++req->transfer.requests;
+		req->transfer.wireBytes += (size_t)bodyBytes + (size_t)headerBytes;
+		req->transfer.decodedBytes += req->resp.len;
 	}
 
+	curl_multi_remove_handle(multi, curl);
+	// header list must outlive the handle's use of it, so it is unset before the handle goes back to the pool
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+	if (headers) { curl_slist_free_all(headers); }
+	httpPoolPush(pool, curl);
+}
+
+/*
+ * takes an easy handle from pool, sets it up for req, and adds it to multi handle; handle and header list are written to curlPtr/headersPtr
+ */
+static CW_STATUS httpStartRequest(CURLM *multi, struct HttpPool *pool, struct HttpRequest *req, bool reqLimit, CURL **curlPtr, struct curl_slist **headersPtr) {
+	CURL *curl;
+	if ((curl = httpPoolPop(pool)) == NULL) { fprintf(CWG_err_stream, "curl_easy_init() failed\n"); return CW_SYS_ERR; }
+	httpSetupHandle(curl, req, reqLimit, headersPtr);
+
+	CURLMcode mc;
+	if ((mc = curl_multi_add_handle(multi, curl)) != CURLM_OK) {
+		fprintf(CWG_err_stream, "curl_multi_add_handle() failed: %s\n", curl_multi_strerror(mc));
+		httpReleaseHandle(multi, pool, curl, *headersPtr);
+		return CW_SYS_ERR;
+	}
+	*curlPtr = curl;
 	return CW_OK;
 }
 
+/*
+ * gets how long (ms) the response's Retry-After header asks to hold off for (capped at HTTP_RETRY_AFTER_MAX_MS)
+ * returns 0 if there is no such header (or it can't be read with this version of libcurl)
+ */
+static long httpRetryAfterMs(CURL *curl) {
+#if LIBCURL_VERSION_NUM >= 0x074200
+	curl_off_t retryAfter = 0;
+	if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK && retryAfter > 0) {
+		return retryAfter < HTTP_RETRY_AFTER_MAX_MS/1000 ? (long)retryAfter*1000 : HTTP_RETRY_AFTER_MAX_MS;
+	}
+#endif
+	return 0;
+}
+
+/*
+ * implementation of httpRequestMulti which operates over libcurl's multi interface
+ * if pool is specified, handles/connections will be drawn from it rather than made anew
+ * slots 0..count-1 hold the given requests, and count..2*count-1 their hedges (if any);
+   a slot that has been throttled is queued to be sent again no earlier than its notBefore
+ */
+static CW_STATUS httpRequestMulti(struct HttpPool *pool, struct RateLimiter *limiter, struct HttpRequest **reqs, size_t count, bool reqLimit, size_t maxInFlight) {
+	if (count < 1) { return CW_OK; }
+	if (maxInFlight < 1) { maxInFlight = 1; }
+
+	CURLM *multi;
+	if ((multi = curl_multi_init()) == NULL) { fprintf(CWG_err_stream, "curl_multi_init() failed\n"); return CW_SYS_ERR; }
+
+	size_t slotsCount = 2*count;
+	struct HttpRequest *slotReqs[slotsCount];
+	CURL *handles[slotsCount];
+	struct curl_slist *headers[slotsCount];
+	double startedAt[slotsCount];
+	double notBefore[slotsCount];
+	unsigned int throttles[slotsCount];
+	bool queued[slotsCount];
+	bool finished[slotsCount];
+	for (int i=0; i<slotsCount; i++) {
+		slotReqs[i] = i < count ? reqs[i] : reqs[i-count]->hedge;
+		handles[i] = NULL;
+		throttles[i] = 0;
+		queued[i] = false;
+		finished[i] = false;
+		if (slotReqs[i]) {
+			slotReqs[i]->status = CWG_FETCH_NO;
+			slotReqs[i]->elapsedMs = 0;
+			slotReqs[i]->timedOut = false;
+			init_CWG_transfer_stats(&slotReqs[i]->transfer);
+		}
+	}
+	size_t next = 0;
+	size_t inFlight = 0;
+	size_t primariesInFlight = 0;
+	size_t queuedCount = 0;
+	CW_STATUS status = CW_OK;
+
+	CURLMcode mc;
+	CURLMsg *msg;
+	int running;
+	int msgsLeft;
+	struct HttpRequest *req;
+	double now;
+	long waitMs;
+	long limitWaitMs;
+	long retryMs;
+	long code;
+	size_t slot;
+	size_t partner;
+	for (;;) {
+		now = httpNowMs();
+		waitMs = HTTP_MULTI_WAIT_MS;
+
+		// resend throttled requests once they may be, ahead of any new ones
+		for (slot=0; slot<slotsCount && queuedCount > 0; slot++) {
+			if (!queued[slot] || (slot < count && primariesInFlight >= maxInFlight)) { continue; }
+			if (notBefore[slot] > now) { if (notBefore[slot]-now < waitMs) { waitMs = (long)(notBefore[slot]-now)+1; } continue; }
+			if ((limitWaitMs = rateLimiterAcquire(limiter, slotReqs[slot]->endpoint)) > 0) { if (limitWaitMs < waitMs) { waitMs = limitWaitMs; } continue; }
+			if ((status = httpStartRequest(multi, pool, slotReqs[slot], reqLimit, &handles[slot], &headers[slot])) != CW_OK) { goto cleanup; }
+			startedAt[slot] = now;
+			queued[slot] = false;
+			--queuedCount; ++inFlight;
+			if (slot < count) { ++primariesInFlight; }
+		}
+
+		// top up in-flight requests to the limit, as the rate limiter allows
+		while (next < count && primariesInFlight < maxInFlight) {
+			if ((limitWaitMs = rateLimiterAcquire(limiter, reqs[next]->endpoint)) > 0) { if (limitWaitMs < waitMs) { waitMs = limitWaitMs; } break; }
+			if ((status = httpStartRequest(multi, pool, reqs[next], reqLimit, &handles[next], &headers[next])) != CW_OK) { goto cleanup; }
+			startedAt[next] = now;
+			++next; ++inFlight; ++primariesInFlight;
+		}
+
+		// send hedges for requests that have failed or been outstanding past their deadline, and wait no longer than the next deadline
+		for (int i=0; i<next; i++) {
+			slot = count+i;
+			if (!slotReqs[slot] || handles[slot] || queued[slot] || finished[slot]) { continue; }
+			if (finished[i] ? reqs[i]->status != CW_OK : !queued[i] && now-startedAt[i] >= reqs[i]->hedgeAfterMs) {
+				if ((limitWaitMs = rateLimiterAcquire(limiter, slotReqs[slot]->endpoint)) > 0) { if (limitWaitMs < waitMs) { waitMs = limitWaitMs; } continue; }
+				if ((status = httpStartRequest(multi, pool, slotReqs[slot], reqLimit, &handles[slot], &headers[slot])) != CW_OK) { goto cleanup; }
+				startedAt[slot] = now;
+				++inFlight;
+			}
+			else if (!finished[i] && !queued[i] && startedAt[i]+reqs[i]->hedgeAfterMs-now < waitMs) { waitMs = (long)(startedAt[i]+reqs[i]->hedgeAfterMs-now)+1; }
+		}
+		if (inFlight < 1 && next >= count && queuedCount < 1) { break; }
+		if (inFlight < 1) {
+			// all remaining requests are held off, so there is nothing for curl to wait on
+			usleep(waitMs*1000);
+			continue;
+		}
+
+		if ((mc = curl_multi_perform(multi, &running)) != CURLM_OK) {
+			fprintf(CWG_err_stream, "curl_multi_perform() failed: %s\n", curl_multi_strerror(mc));
+			status = CWG_FETCH_ERR;
+			goto cleanup;
+		}
+
+		// collect finished requests, queueing throttled ones to be resent and abandoning the other of each pair that succeeds
+		while ((msg = curl_multi_info_read(multi, &msgsLeft))) {
+			if (msg->msg != CURLMSG_DONE) { continue; }
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+			for (slot=0; slot<slotsCount && slotReqs[slot] != req; slot++);
+			now = httpNowMs();
+			code = 0;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &code);
+			if (msg->data.result == CURLE_OK && (code == 429 || code == 503) && throttles[slot] < HTTP_THROTTLE_RETRIES_MAX) {
+				retryMs = httpRetryAfterMs(msg->easy_handle);
+				if (code == 429 || retryMs > 0) {
+					if (retryMs < 1) { retryMs = HTTP_RETRY_AFTER_DEFAULT_MS << throttles[slot]; }
+					rateLimiterBackoff(limiter, req->endpoint, retryMs);
+					httpReleaseHandle(multi, pool, handles[slot], headers[slot]);
+					handles[slot] = NULL;
+					freeHttpResponse(&req->resp);
+					notBefore[slot] = now+retryMs;
+					++throttles[slot];
+					queued[slot] = true;
+					++queuedCount;
+					--inFlight;
+					if (slot < count) { --primariesInFlight; }
+					continue;
+				}
+			}
+
+			if (msg->data.result != CURLE_OK) {
+				fprintf(CWG_err_stream, "curl request failed: %s\n", curl_easy_strerror(msg->data.result));
+				req->status = CWG_FETCH_ERR;
+				req->timedOut = msg->data.result == CURLE_OPERATION_TIMEDOUT;
+			}
+			else if (code >= 500 || code == 429) {
+				fprintf(CWG_err_stream, "HTTP %ld response from %s\n", code, req->url);
+				req->status = CWG_FETCH_ERR;
+			}
+			else { req->status = CW_OK; }
+			req->elapsedMs = now-startedAt[slot];
+			httpReleaseHandle(multi, pool, handles[slot], headers[slot]);
+			handles[slot] = NULL;
+			finished[slot] = true;
+			--inFlight;
+			if (slot < count) { --primariesInFlight; }
+
+			partner = slot < count ? slot+count : slot-count;
+			if (req->status != CW_OK || !slotReqs[partner] || finished[partner]) { continue; }
+			if (handles[partner]) {
+				httpReleaseHandle(multi, pool, handles[partner], headers[partner]);
+				handles[partner] = NULL;
+				slotReqs[partner]->elapsedMs = now-startedAt[partner];
+				--inFlight;
+				if (partner < count) { --primariesInFlight; }
+			}
+			if (queued[partner]) { queued[partner] = false; --queuedCount; }
+			finished[partner] = true;
+		}
+
+		if (inFlight > 0 && (mc = curl_multi_wait(multi, NULL, 0, waitMs, NULL)) != CURLM_OK) {
+			fprintf(CWG_err_stream, "curl_multi_wait() failed: %s\n", curl_multi_strerror(mc));
+			status = CWG_FETCH_ERR;
+			goto cleanup;
+		}
+	}
+
+	cleanup:
+		if (status != CW_OK) {
+			for (int i=0; i<slotsCount; i++) {
+				if (handles[i]) { httpReleaseHandle(multi, pool, handles[i], headers[i]); }
+				if (slotReqs[i] && !finished[i]) { slotReqs[i]->status = status; }
+			}
+		}
+		curl_multi_cleanup(multi);
+		return status;
+}
+
 #else
 
 #include <emscripten.h>
 /*
  * javascript for emscripten fetching compatibility
+ * response body is copied into heap memory allocated by malloc (to be freed by caller), and its length written to respLen;
+ * the body's size on the wire (by Content-Length, which is that of the encoded body, or else its decoded length) is written to wireLen;
+   compression needn't be asked for, as fetch() negotiates and decodes it itself
+ * returns NULL on failure
  */
-EM_JS(void, jsFetch, (const char *url, bool isPost, const char *postData, bool reqLimit, const char *fTmpNam), {
+EM_JS(char *, jsFetch, (const char *url, bool isPost, const char *postData, const char *auth, bool reqLimit, size_t *respLen, size_t *wireLen), {
 	const urlStr = UTF8ToString(url);	
-	const tmpNamStr = UTF8ToString(fTmpNam);	
 
 	const headersJ = reqLimit ? {
 				"X-Forwarded-For": Math.floor(Math.random() * 1000).toString(10) + "." + Math.floor(Math.random() * 1000) + "." + Math.floor(Math.random() * 1000) + "." + Math.floor(Math.random() * 100),
@@ -93,8 +1064,9 @@ EM_JS(void, jsFetch, (const char *url, bool isPost, const char *postData, bool r
 				"Accept": 'application/json',
 				"Content-Type": 'application/json'
 			};
+	if (auth) { headersJ["Authorization"] = "Basic " + btoa(UTF8ToString(auth)); }
 
-	Asyncify.handleSleep(function(wakeUp) {
+	return Asyncify.handleSleep(function(wakeUp) {
 		fetch(urlStr, !isPost ? {
 			method: "GET",
 			credentials: "omit",
@@ -104,59 +1076,400 @@ EM_JS(void, jsFetch, (const char *url, bool isPost, const char *postData, bool r
 			body: UTF8ToString(postData),
 			credentials: "omit",
 			headers: headersJ
-		}).then(response => response.text()).then(text => {
-			FS.writeFile(tmpNamStr, text);
-			wakeUp();
+		}).then(response => {
+			const contentLength = parseInt(response.headers.get("Content-Length"), 10);
+			return response.arrayBuffer().then(buf => [buf, contentLength]);
+		}).then(([buf, contentLength]) => {
+			const bytes = new Uint8Array(buf);
+			const ptr = _malloc(bytes.length + 1);
+			if (ptr) {
+				HEAPU8.set(bytes, ptr);
+				HEAPU8[ptr + bytes.length] = 0;
+				HEAPU32[respLen >> 2] = bytes.length;
+				HEAPU32[wireLen >> 2] = contentLength >= 0 ? contentLength : bytes.length;
+			}
+			wakeUp(ptr);
 		}).catch(error => {
-			FS.writeFile(tmpNamStr, "");
-			wakeUp();
+			HEAPU32[respLen >> 2] = 0;
+			HEAPU32[wireLen >> 2] = 0;
+			wakeUp(0);
 		});
 	});
 });
 
-/*
- * implementation of httpRequest which operates via javascript for emscripten
- */
-static CW_STATUS httpRequest(const char *url, const char *postData, bool reqLimit, FILE **respFp) {
-	char respTmpNam[] = "cw-resp-tmp-XXXXXX";	
-	if (!mktemp(respTmpNam)) { perror("mktemp() failed"); return CW_SYS_ERR; }
-	jsFetch(url, postData != NULL, postData, reqLimit, respTmpNam);
-	if ((*respFp = fopen(respTmpNam, "rb")) == NULL) { perror("fopen() failed on response"); unlink(respTmpNam); return CW_SYS_ERR; }
-	return CW_OK;
+/*
+ * implementation of httpRequestMulti which operates via javascript for emscripten
+ * asyncify only allows a single suspended call at a time, so requests are performed one after another,
+   and a hedge can only be sent as a fallback once its request has failed;
+ * requests are paced by limiter, but as fetch() doesn't hand back the response status here, throttling responses can't be told apart;
+ * the body is handed over in memory as fetched, and since the browser already holds it whole, it is never spilled to disk
+ */
+static CW_STATUS httpRequestMulti(struct HttpPool *pool, struct RateLimiter *limiter, struct HttpRequest **reqs, size_t count, bool reqLimit, size_t maxInFlight) {
+	size_t respLen;
+	size_t wireLen;
+	char *respData;
+	double startedAt;
+	long limitWaitMs;
+	struct HttpRequest *req;
+	for (int i=0; i<count; i++) {
+		init_CWG_transfer_stats(&reqs[i]->transfer);
+		if (reqs[i]->hedge) { reqs[i]->hedge->status = CWG_FETCH_NO; init_CWG_transfer_stats(&reqs[i]->hedge->transfer); }
+		for (req = reqs[i]; req; req = req != reqs[i] || req->status == CW_OK ? NULL : req->hedge) {
+			while ((limitWaitMs = rateLimiterAcquire(limiter, req->endpoint)) > 0) { emscripten_sleep(limitWaitMs); }
+			respLen = 0;
+			wireLen = 0;
+			startedAt = httpNowMs();
+			respData = jsFetch(req->url, req->postData != NULL, req->postData, req->auth, reqLimit, &respLen, &wireLen);
+			req->elapsedMs = httpNowMs()-startedAt;
+			++req->transfer.requests;
+			req->transfer.wireBytes += wireLen;
+			req->transfer.decodedBytes += respLen;
+			if (respData == NULL) {
+				fprintf(CWG_err_stream, "fetch failed on %s\n", req->url);
+				req->status = CWG_FETCH_ERR;
+				continue;
+			}
+
+			freeHttpResponse(&req->resp);
+			req->resp.data = respData;
+			req->resp.len = respLen;
+			req->resp.size = respLen+1;
+			req->status = CW_OK;
+		}
+	}
+	return CW_OK;
+}
+
+#define CURL_GLOBAL_DEFAULT
+static void curl_global_init() { /* dummy */ }
+static void curl_global_cleanup() { /* dummy */ }
+
+/*
+ * connection pooling is left to the browser under emscripten
+ */
+static CW_STATUS httpPoolNew(struct HttpPool **poolPtr) { return CW_CALL_NO; }
+static void httpPoolDestroy(struct HttpPool *pool) { /* dummy */ }
+
+static struct HttpEndpoints *httpPoolEndpoints(struct HttpPool *pool) {
+	static struct HttpEndpoints processEndpoints = { .lock = PTHREAD_MUTEX_INITIALIZER };
+	return &processEndpoints;
+}
+
+/*
+ * no background threads under emscripten, so endpoints marked down are just retried once their backoff passes
+ */
+static void httpPoolHealthCheck(struct HttpPool *pool) { /* dummy */ }
+
+#endif
+
+/*
+ * a batch of ids to be fetched in one HTTP request, along with the request itself;
+ * txids/itemInfo point into the caller's txids/itemInfo (or are NULL), and hexData is the batch's own output buffer
+ * endpoint is that which req is sent to; if hedgeEndpoint is set, hedge is the same request to it (see struct HttpRequest),
+   and the two are swapped if the hedge is the one that served the batch
+ * attempts counts rounds in which the batch has failed at every endpoint it was sent to
+ * split is set by the response parser if the batch turned out to be too large and should be retried as two halves
+ * claims is the number of nametag claims fetched (from the nth, where count is n) when fetching by nametag, or of revisions looked ahead for
+   when following the revisions of a single id by INTXID (see fetchHexDataBitDBNodeRevisions()), and is otherwise 1
+ */
+struct HttpFetchBatch {
+	const char **ids;
+	size_t count;
+	size_t claims;
+	char **txids;
+	struct FetchItemInfo *itemInfo;
+	char *hexData;
+	size_t queryLen;
+	const char *endpoint;
+	const char *hedgeEndpoint;
+	struct HttpRequest req;
+	struct HttpRequest hedge;
+	size_t attempts;
+	CW_STATUS status;
+	bool done;
+	bool split;
+};
+
+/*
+ * HTTP fetch backend, broken into the two halves around the request so that many batches may be in flight at once
+ * build: constructs batch->req (url and, if POST, postData) and sets batch->queryLen
+ * parse: interprets batch->req.resp, writing to batch->hexData/batch->txids/batch->itemInfo; sets batch->split to request a split
+ * auth: credentials sent with every request (see struct HttpRequest), or NULL
+ */
+struct HttpFetchBackend {
+	CW_STATUS (*build)(struct HttpFetchBatch *, FETCH_TYPE, const char *);
+	CW_STATUS (*parse)(struct HttpFetchBatch *, FETCH_TYPE);
+	const char *auth;
+};
+
+/*
+ * initializes struct HttpFetchBatch for ids/txids, allocating its hex data buffer
+ * when fetching by nametag, count is the nth occurrence, and hex datas of claims claims from it are fetched;
+   when fetching by INTXID, claims revisions may be fetched following the one id (claims is otherwise ignored)
+ * returns false on failure
+ */
+static bool initHttpFetchBatch(struct HttpFetchBatch *batch, const char **ids, size_t count, FETCH_TYPE type, size_t claims, char **txids, struct FetchItemInfo *itemInfo) {
+	batch->ids = ids;
+	batch->count = count;
+	batch->claims = type != BY_TXID ? claims : 1;
+	batch->txids = txids;
+	batch->itemInfo = itemInfo;
+	batch->queryLen = 0;
+	batch->endpoint = NULL;
+	batch->hedgeEndpoint = NULL;
+	initHttpRequest(&batch->req);
+	initHttpRequest(&batch->hedge);
+	batch->attempts = 0;
+	batch->status = CW_OK;
+	batch->done = false;
+	batch->split = false;
+	if ((batch->hexData = malloc(CW_TX_DATA_CHARS*(type == BY_NAMETAG || batch->claims > 1 ? batch->claims : count) + 1)) == NULL) { perror("malloc failed"); return false; }
+	batch->hexData[0] = 0;
+	return true;
+}
+
+/*
+ * frees heap-allocated data of given struct HttpFetchBatch
+ */
+static void freeHttpFetchBatch(struct HttpFetchBatch *batch) {
+	freeHttpRequest(&batch->req);
+	freeHttpRequest(&batch->hedge);
+	if (batch->hexData) { free(batch->hexData); }
+	batch->hexData = NULL;
+}
+
+/*
+ * replaces each batch marked for splitting with its two halves (in place of it, so order is kept)
+ * batches array/count are updated accordingly
+ * returns false on failure
+ */
+static bool splitHttpFetchBatches(struct HttpFetchBatch **batchesPtr, size_t *countPtr, FETCH_TYPE type) {
+	struct HttpFetchBatch *batches = *batchesPtr;
+	size_t count = *countPtr;
+	size_t newCount = count;
+	for (int i=0; i<count; i++) { if (batches[i].split) { ++newCount; } }
+	if (newCount == count) { return true; }
+
+	struct HttpFetchBatch *newBatches;
+	if ((newBatches = malloc(newCount*sizeof(struct HttpFetchBatch))) == NULL) { perror("malloc failed"); return false; }
+
+	size_t n = 0;
+	size_t firstCount;
+	bool success = true;
+	for (int i=0; i<count; i++) {
+		if (!batches[i].split) { newBatches[n++] = batches[i]; continue; }
+
+		firstCount = batches[i].count/2;
+		if (!initHttpFetchBatch(&newBatches[n], batches[i].ids, firstCount, type, 1, batches[i].txids, batches[i].itemInfo)) { newBatches[n].done = true; success = false; }
+		++n;
+		if (!initHttpFetchBatch(&newBatches[n], batches[i].ids+firstCount, batches[i].count-firstCount, type, 1,
+					batches[i].txids ? batches[i].txids+firstCount : NULL,
+					batches[i].itemInfo ? batches[i].itemInfo+firstCount : NULL)) { newBatches[n].done = true; success = false; }
+		++n;
+		freeHttpFetchBatch(&batches[i]);
+	}
+
+	free(batches);
+	*batchesPtr = newBatches;
+	*countPtr = newCount;
+	return success;
+}
+
+/*
+ * fetches hex data at specified ids over HTTP through given backend, with as many requests in flight as params->fetchConcurrency allows
+ * endpoint may list several equivalent endpoints (whitespace-separated), each batch going to one picked by httpEndpointsPick();
+   if there are others, the batch is hedged to a second one once it has been outstanding longer than usual for its endpoint (or fails),
+   and whichever answers first serves it
+ * ids are sent in batches of the size learned for the endpoint (see struct HttpEndpoints), all at once if nothing is known yet;
+   a batch is split in halves whenever the endpoint finds it too large or it times out (all halves of a round are sent concurrently),
+   and the outcome of each batch feeds back into the endpoint's learned size
+ * results are assembled in order of ids regardless of the order responses arrive in
+ * per-item details are written to itemInfo if not NULL
+ * when fetching by nametag, count is the nth occurrence, and claims claims from it are fetched in the one request (see parseResponseBitDBNode())
+ */
+static CW_STATUS fetchHexDataHTTP(const char **ids, size_t count, FETCH_TYPE type, const char *endpoint, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo,
+				  size_t claims, const struct HttpFetchBackend *backend) {
+	if (count < 1) { return CWG_FETCH_NO; }
+
+	char endpointsBuf[strlen(endpoint)+1];
+	const char *endpoints[HTTP_ENDPOINTS_LIST_MAX];
+	size_t endpointsCount;
+	if ((endpointsCount = httpEndpointsParseList(endpoint, endpointsBuf, endpoints)) < 1) {
+		fprintf(CWG_err_stream, "no HTTP endpoint specified\n");
+		return CWG_FETCH_ERR;
+	}
+
+	CW_STATUS status = CW_OK;
+
+	// nametag fetches aren't batched (count is the nth occurrence); otherwise, start from the smallest size learned of the endpoints
+	struct HttpEndpoints *eps = httpPoolEndpoints((struct HttpPool *)params->httpPool);
+	size_t batchSize = SIZE_MAX;
+	size_t size;
+	if (type != BY_NAMETAG) {
+		for (int i=0; i<endpointsCount; i++) {
+			if ((size = httpEndpointsBatchSize(eps, endpoints[i], params->batchSizesPath)) < batchSize) { batchSize = size; }
+		}
+	}
+	size_t batchesCount = type != BY_NAMETAG ? count/batchSize + (count % batchSize > 0) : 1;
+	struct HttpFetchBatch *batches;
+	if ((batches = malloc(batchesCount*sizeof(struct HttpFetchBatch))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	size_t batchCount;
+	for (int i=0; i<batchesCount; i++) {
+		batchCount = type != BY_NAMETAG && count-i*batchSize > batchSize ? batchSize : count-i*batchSize;
+		if (!initHttpFetchBatch(&batches[i], ids+i*batchSize, batchCount, type, claims,
+					txids ? txids+i*batchSize : NULL, itemInfo ? itemInfo+i*batchSize : NULL)) {
+			for (int j=0; j<=i; j++) { freeHttpFetchBatch(&batches[j]); }
+			free(batches);
+			return CW_SYS_ERR;
+		}
+	}
+
+	struct HttpRequest **reqs = NULL;
+	struct HttpRequest **reqsNew;
+	size_t reqsCount;
+	struct HttpRequest reqSwap;
+	const char *endpointSwap;
+	bool splitting;
+	bool failed;
+	for (;;) {
+		// pick endpoints for and build requests of new batches, splitting up front those larger than the endpoint's size (which may have been learned meanwhile)
+		do {
+			splitting = false;
+			for (int i=0; i<batchesCount; i++) {
+				if (batches[i].done || batches[i].req.url) { continue; }
+				batches[i].endpoint = httpEndpointsPick(eps, endpoints, endpointsCount, NULL);
+				if (type != BY_NAMETAG && batches[i].count > httpEndpointsBatchSize(eps, batches[i].endpoint, NULL)) {
+					batches[i].split = splitting = true;
+					continue;
+				}
+
+				batches[i].hedgeEndpoint = endpointsCount > 1 ? httpEndpointsPick(eps, endpoints, endpointsCount, batches[i].endpoint) : NULL;
+				if (batches[i].hedgeEndpoint && type != BY_NAMETAG && batches[i].count > httpEndpointsBatchSize(eps, batches[i].hedgeEndpoint, NULL)) {
+					batches[i].hedgeEndpoint = NULL;
+				}
+				if (batches[i].hedgeEndpoint) {
+					if ((batches[i].status = backend->build(&batches[i], type, batches[i].hedgeEndpoint)) != CW_OK) { batches[i].done = true; continue; }
+					batches[i].hedge = batches[i].req;
+					initHttpRequest(&batches[i].req);
+				}
+				if ((batches[i].status = backend->build(&batches[i], type, batches[i].endpoint)) != CW_OK) { batches[i].done = true; continue; }
+				batches[i].req.hedgeAfterMs = httpEndpointsHedgeAfter(eps, batches[i].endpoint);
+			}
+			if (splitting && !splitHttpFetchBatches(&batches, &batchesCount, type)) { status = CW_SYS_ERR; goto cleanup; }
+		} while (splitting);
+
+		// gather and send all outstanding requests
+		if ((reqsNew = realloc(reqs, batchesCount*sizeof(struct HttpRequest *))) == NULL) { perror("realloc failed"); status = CW_SYS_ERR; goto cleanup; }
+		reqs = reqsNew;
+		reqsCount = 0;
+		for (int i=0; i<batchesCount; i++) {
+			if (batches[i].done) { continue; }
+			batches[i].req.endpoint = batches[i].endpoint;
+			batches[i].req.hedge = batches[i].hedgeEndpoint ? &batches[i].hedge : NULL;
+			batches[i].hedge.endpoint = batches[i].hedgeEndpoint;
+			batches[i].req.auth = batches[i].hedge.auth = backend->auth;
+			reqs[reqsCount++] = &batches[i].req;
+		}
+		if (reqsCount < 1) { break; }
+		if ((status = httpRequestMulti((struct HttpPool *)params->httpPool, (struct RateLimiter *)params->rateLimiter,
+					       reqs, reqsCount, params->requestLimit, params->fetchConcurrency)) != CW_OK) { goto cleanup; }
+
+		// learn from each endpoint's response (taking the hedge if it served the batch), parse responses,
+		// and mark batches to be split for the next round
+		for (int i=0; i<batchesCount; i++) {
+			if (batches[i].done) { continue; }
+			httpTransferStatsAdd(params->transferStats, &batches[i].req.transfer);
+			if (batches[i].hedgeEndpoint) { httpTransferStatsAdd(params->transferStats, &batches[i].hedge.transfer); }
+			failed = false;
+			if (batches[i].req.elapsedMs > 0) {
+				httpEndpointsRequestOutcome(eps, batches[i].endpoint, batches[i].req.elapsedMs, batches[i].req.status == CWG_FETCH_ERR);
+				failed = batches[i].req.status == CWG_FETCH_ERR;
+			}
+			if (batches[i].hedgeEndpoint && batches[i].hedge.elapsedMs > 0) {
+				httpEndpointsRequestOutcome(eps, batches[i].hedgeEndpoint, batches[i].hedge.elapsedMs, batches[i].hedge.status == CWG_FETCH_ERR);
+				failed = failed || batches[i].hedge.status == CWG_FETCH_ERR;
+				if (batches[i].req.status != CW_OK && batches[i].hedge.status == CW_OK) {
+					reqSwap = batches[i].req; batches[i].req = batches[i].hedge; batches[i].hedge = reqSwap;
+					endpointSwap = batches[i].endpoint; batches[i].endpoint = batches[i].hedgeEndpoint; batches[i].hedgeEndpoint = endpointSwap;
+				}
+			}
+			if (failed) { httpPoolHealthCheck((struct HttpPool *)params->httpPool); }
+
+			if ((batches[i].status = batches[i].req.status) == CW_OK) {
+				batches[i].status = backend->parse(&batches[i], type);
+			}
+			else if (batches[i].req.timedOut && type != BY_NAMETAG && batches[i].count > 1) {
+				batches[i].status = CW_OK;
+				batches[i].split = true;
+			}
+			else if (batches[i].req.status == CWG_FETCH_ERR && ++batches[i].attempts < endpointsCount) {
+				// failed everywhere it was sent, so retry with whichever endpoints are left up
+				batches[i].status = CW_OK;
+				freeHttpRequest(&batches[i].req);
+				freeHttpRequest(&batches[i].hedge);
+				batches[i].hedgeEndpoint = NULL;
+				continue;
+			}
+			if (type != BY_NAMETAG && (batches[i].split || batches[i].status == CW_OK)) {
+				httpEndpointsBatchOutcome(eps, batches[i].endpoint, batches[i].count,
+							  !batches[i].split ? HTTP_BATCH_OK : batches[i].req.timedOut ? HTTP_BATCH_TIMED_OUT : HTTP_BATCH_TOO_LARGE);
+			}
+			batches[i].done = !batches[i].split;
+			freeHttpRequest(&batches[i].req);
+			freeHttpRequest(&batches[i].hedge);
+			batches[i].hedgeEndpoint = NULL;
+		}
+		if (!splitHttpFetchBatches(&batches, &batchesCount, type)) { status = CW_SYS_ERR; goto cleanup; }
+	}
+
+	// assemble results in order
+	char *hexDataPtr = hexDataAll;
+	hexDataAll[0] = 0;
+	for (int i=0; i<batchesCount; i++) {
+		if (batches[i].status > status) { status = batches[i].status; }
+		strcpy(hexDataPtr, batches[i].hexData);
+		hexDataPtr += strlen(hexDataPtr);
+	}
+
+	cleanup:
+		for (int i=0; i<batchesCount; i++) { freeHttpFetchBatch(&batches[i]); }
+		free(batches);
+		if (reqs) { free(reqs); }
+		return status;
 }
 
-#define CURL_GLOBAL_DEFAULT
-static void curl_global_init() { /* dummy */ }
-static void curl_global_cleanup() { /* dummy */ }
+/*
+ * constructs the url of BitDB query for the batch (base64-encoded onto bitdbNode), and sets batch->queryLen
+ */
+static CW_STATUS buildRequestUrlBitDBNode(struct HttpFetchBatch *batch, const char *query, const char *bitdbNode) {
+	batch->queryLen = strlen(query);
 
-#endif
+	char *queryB64;
+	if ((queryB64 = b64_encode((const unsigned char *)query, batch->queryLen)) == NULL) { perror("b64 encode failed"); return CW_SYS_ERR; }
 
-static size_t querySizeExceed;
+	if ((batch->req.url = malloc(strlen(bitdbNode) + strlen(queryB64) + 1 + 1)) == NULL) { perror("malloc failed"); free(queryB64); return CW_SYS_ERR; }
+	strcpy(batch->req.url, bitdbNode);
+	strcat(batch->req.url, "/");
+	strcat(batch->req.url, queryB64);
+	free(queryB64);
 
-/*
- * simply splits fetch by given parameters into two distinct fetches, each with half of query
- * definition below
- */
-static inline CW_STATUS fetchSplitHexData(const char **ids, size_t count, FETCH_TYPE type, const char *bitdbNode, bool bitdbRequestLimit, char **txids, char *hexDataAll, CW_STATUS (*fetcher)(const char **, size_t, FETCH_TYPE, const char *, bool, char **, char *)) {
-	size_t firstCount = count/2;
-	CW_STATUS status1 = fetcher(ids, firstCount, type, bitdbNode, bitdbRequestLimit, txids, hexDataAll);
-	CW_STATUS status2 = fetcher(ids+firstCount, count-firstCount, type, bitdbNode, bitdbRequestLimit, txids, hexDataAll+strlen(hexDataAll));
-	return status1 > status2 ? status1 : status2;
+	return CW_OK;
 }
 
 /*
- * fetches hex data (from BitDB HTTP endpoint) at specified ids and copies (in order) to specified location in memory 
+ * constructs BitDB query url for the batch
  * id type is specified by FETCH_TYPE type
- * when searching for nametag, count references the nth occurrence to get (as only one nametag can be fetched at a time anyway);
-   can be used to skip a nametag claim
- * txids of fetched TXs can be written to txids, or can be set NULL; shouldn't be needed if type is BY_TXID
+ * when searching for nametag, count references the nth occurrence to get (as only one nametag can be fetched at a time anyway),
+   and batch->claims claims are fetched from it; can be used to skip nametag claims
  */
-static CW_STATUS fetchHexDataBitDBNode(const char **ids, size_t count, FETCH_TYPE type, const char *bitdbNode, bool bitdbRequestLimit, char **txids, char *hexDataAll) {
+static CW_STATUS buildRequestBitDBNode(struct HttpFetchBatch *batch, FETCH_TYPE type, const char *bitdbNode) {
+	const char **ids = batch->ids;
+	size_t count = batch->count;
 	if (count < 1) { return CWG_FETCH_NO; }
 
 	size_t nth = 1;
 	// fetching by nametag does not permit querying for more than one at a time, so count is used for if any occurrences should be skipped
-	if (type == BY_NAMETAG) { nth = count; count = 1; } 	
+	if (type == BY_NAMETAG) { nth = count; count = 1; }
 
 	int printed = 0;
 	// construct query
@@ -213,12 +1526,12 @@ static CW_STATUS fetchHexDataBitDBNode(const char **ids, size_t count, FETCH_TYP
 		return CW_SYS_ERR;
 	}
 
-	char specifiersStr[] = ",\"sort\":{\"blk.i\":1,\"tx.h\":1},\"limit\":1,\"skip\":";
-	char specifiers[sizeof(specifiersStr) + 15]; specifiers[0] = 0;
-	if (type == BY_NAMETAG) { snprintf(specifiers, sizeof(specifiers), "%s%zu", specifiersStr, nth-1); }
+	char specifiersStr[] = ",\"sort\":{\"blk.i\":1,\"tx.h\":1},\"limit\":%zu,\"skip\":%zu";
+	char specifiers[sizeof(specifiersStr) + 30]; specifiers[0] = 0;
+	if (type == BY_NAMETAG) { snprintf(specifiers, sizeof(specifiers), specifiersStr, batch->claims, nth-1); }
 
 	char query[BITDB_QUERY_BUF_SZ + strlen(specifiersStr) + strlen(idQuery) + strlen(respHandler) + 1];
-	printed = snprintf(query, sizeof(query), 
+	printed = snprintf(query, sizeof(query),
 		  "{\"v\":%d,\"q\":{\"find\":{\"$or\":[%s]}%s},\"r\":{\"f\":\"[.[]|%s]\"}}",
 	    	  BITDB_API_VER, idQuery, specifiers, respHandler);
 	free(idQuery);
@@ -226,228 +1539,864 @@ static CW_STATUS fetchHexDataBitDBNode(const char **ids, size_t count, FETCH_TYP
 		fprintf(CWG_err_stream, "BITDB_QUERY_BUF_SZ set too small; problem with cashgettools\n");
 		return CW_SYS_ERR;
 	}
-	size_t queryLen = strlen(query);
-	if (querySizeExceed && queryLen >= querySizeExceed) { return fetchSplitHexData(ids, count, type, bitdbNode, bitdbRequestLimit, txids, hexDataAll, &fetchHexDataBitDBNode); }
 
-	char *queryB64;
-	if ((queryB64 = b64_encode((const unsigned char *)query, queryLen)) == NULL) { perror("b64 encode failed"); return CW_SYS_ERR; }
-	char url[strlen(bitdbNode) + strlen(queryB64) + 1 + 1];
+	return buildRequestUrlBitDBNode(batch, query, bitdbNode);
+}
 
-	// construct url from query
-	strcpy(url, bitdbNode);
-	strcat(url, "/");
-	strcat(url, queryB64);
-	free(queryB64);	
+/*
+ * position of a fetched item's hex data (and txid) within the response body, before being copied out in order
+ * source is 0 if found confirmed and 1 if unconfirmed, or -1 if not yet found
+ */
+struct HttpFetchItem {
+	const char *hex;
+	size_t hexLen;
+	const char *txid;
+	size_t txidLen;
+	int source;
+};
+
+/*
+ * copies fetched items (all of which must be found) in order from the response body to batch->hexData, and to batch->txids/batch->itemInfo if not NULL
+ */
+static void httpFetchItemsCopy(struct HttpFetchBatch *batch, struct HttpFetchItem *items, size_t count) {
+	char *hexDataPtr = batch->hexData;
+	size_t hexLen;
+	for (int i=0; i<count; i++) {
+		hexLen = items[i].hexLen < CW_TX_DATA_CHARS ? items[i].hexLen : CW_TX_DATA_CHARS;
+		memcpy(hexDataPtr, items[i].hex, hexLen);
+		hexDataPtr += hexLen;
+		if (batch->txids) {
+			batch->txids[i][0] = 0;
+			strncat(batch->txids[i], items[i].txid, items[i].txidLen < CW_TXID_CHARS ? items[i].txidLen : CW_TXID_CHARS);
+		}
+		if (batch->itemInfo) {
+			batch->itemInfo[i].hexLen = hexLen;
+			batch->itemInfo[i].confirmed = items[i].source == 0;
+		}
+	}
+	*hexDataPtr = 0;
+}
 
-	// initializing variable-length arrays before goto statements
-	const char *hexDataPtrs[count];
-	bool added[count];
+/*
+ * parses BitDB response for the batch, copying hex datas (in order) to batch->hexData
+ * response is scanned in a single pass, matching each result to its id(s) by hash; a confirmed result is preferred over an unconfirmed one
+ * txids of fetched TXs are written to batch->txids if not NULL; shouldn't be needed if type is BY_TXID
+ * hex data lengths and confirmation are written to batch->itemInfo if not NULL
+ * when fetching by nametag, results are instead matched to claims by position within their array, and the nth claim of the nametag
+   overall is the nth confirmed one if there is one, and otherwise the nth unconfirmed (as claims confirmed sort before unconfirmed);
+   claims found are written in order, one without data being written as empty hex data, and those beyond the last found are left
+   with length FETCH_ITEM_LEN_UNKNOWN in batch->itemInfo (which, like batch->txids, is needed to tell them apart if claims > 1)
+ */
+static CW_STATUS parseResponseBitDBNode(struct HttpFetchBatch *batch, FETCH_TYPE type) {
+	size_t count = type == BY_NAMETAG ? batch->claims : batch->count;
 
-	CW_STATUS status;
+	const char *body;
+	size_t bodyLen;
+	if ((body = httpResponseBody(&batch->req.resp, &bodyLen)) == NULL) { return CW_SYS_ERR; }
 
-	// send request
-	FILE *respFp = NULL;
-	if ((status = httpRequest(url, NULL, bitdbRequestLimit, &respFp)) != CW_OK) {
-		if (respFp) { fclose(respFp); }
-		return status;
-	}
-	rewind(respFp);
-	
-	// load response json from file and handle potential errors
-	json_error_t jsonError;
-	json_t *respJson = json_loadf(respFp, 0, &jsonError);
-	if (respJson == NULL) {
-		fseek(respFp, 0, SEEK_END);
-		long respSz = ftell(respFp);
-		fseek(respFp, 0, SEEK_SET);
-		char respMsg[respSz+1];
-		respMsg[respSz > 0 ? fread(respMsg, 1, respSz, respFp) : 0] = 0;
-		if (count > 1 && (strlen(respMsg) < 1 || (strstr(respMsg, "URI") && strstr(respMsg, "414")))) { // catch for Request-URI Too Large or empty response body
-			querySizeExceed = queryLen;
-			status = fetchSplitHexData(ids, count, type, bitdbNode, bitdbRequestLimit, txids, hexDataAll, &fetchHexDataBitDBNode);
-			goto cleanup;
+	// handle non-JSON response
+	struct JsonScan js;
+	jsonScanInit(&js, body, bodyLen);
+	if (!jsonScanPeek(&js, '{')) {
+		const char *respMsg;
+		if ((respMsg = httpResponseStr(&batch->req.resp)) == NULL) { return CW_SYS_ERR; }
+		if (type != BY_NAMETAG && count > 1 && (bodyLen < 1 || (strstr(respMsg, "URI") && strstr(respMsg, "414")))) { // catch for Request-URI Too Large or empty response body
+			batch->split = true;
+			return CW_OK;
 		}
 		else if (strstr(respMsg, "html")) {
 			fprintf(CWG_err_stream, "HTML response error unhandled in cashgettools:\n%s\n", respMsg);
-			status = CWG_FETCH_ERR;
-			goto cleanup;
+			return CWG_FETCH_ERR;
 		}
 		else {
-			fprintf(CWG_err_stream, "jansson failed to parse response from BitDB node: %s\nResponse:\n%s\n", jsonError.text, respMsg);
-			status = CWG_FETCH_ERR;
-			goto cleanup;
+			fprintf(CWG_err_stream, "failed to parse response from BitDB node\nResponse:\n%s\n", respMsg);
+			return CWG_FETCH_ERR;
 		}
 	}
 
-	// parse for hex datas at matching ids within both unconfirmed and confirmed transaction json arrays
-	json_t *jsonArrs[2] = { json_object_get(respJson, "c"), json_object_get(respJson, "u") };
-	size_t index;
-	json_t *dataJson;
-	char *jsonDump;
+	size_t idsCount = type == BY_NAMETAG ? 1 : count;
+	size_t idSlots[JSON_SCAN_ID_SLOTS(idsCount)];
+	size_t idNext[idsCount];
+	struct JsonScanIds idHash;
+	jsonScanIdsInit(&idHash, batch->ids, idsCount, idSlots, idNext);
+
+	struct HttpFetchItem items[count];
+	for (int i=0; i<count; i++) { items[i].source = -1; }
+
+	// scan for hex datas at matching ids within both unconfirmed and confirmed transaction json arrays
+	bool sawArrs[2] = { false, false };
+	const char *key;
+	size_t keyLen;
+	bool more;
+	bool moreTxs;
+	bool moreFields;
+	int a;
+	struct HttpFetchItem res;
 	const char *dataId;
-	const char *dataHex;
-	const char *dataTxid;
-	int dataVout = 0;
-	bool matched;
-	memset(added, 0, count);
-	for (int i=0; i<count; i++) {
-		matched = false;
-		for (int a=0; a<sizeof(jsonArrs)/sizeof(jsonArrs[0]); a++) {
-			if (!jsonArrs[a]) {
-				jsonDump = json_dumps(respJson, 0);
-				fprintf(CWG_err_stream, "BitDB node responded with unexpected JSON format:\n%s\n", jsonDump);
-				free(jsonDump);
-				status = CWG_FETCH_ERR;
-				goto cleanup;
-			}
-			
-			json_array_foreach(jsonArrs[a], index, dataJson) {
-				if ((dataId = json_string_value(json_object_get(dataJson, BITDB_QUERY_ID_TAG))) == NULL ||
-				    (dataHex = json_string_value(json_object_get(dataJson, BITDB_QUERY_DATA_TAG))) == NULL) {
-				    	if (dataId && json_is_null(json_object_get(dataJson, BITDB_QUERY_DATA_TAG))) { continue; }
-				    	jsonDump = json_dumps(jsonArrs[a], 0);
-					fprintf(CWG_err_stream, "BitDB node responded with unexpected JSON format:\n%s\n", jsonDump);
-					free(jsonDump);
-					status = CWG_FETCH_ERR; goto cleanup;
+	size_t dataIdLen;
+	int64_t dataVout;
+	bool dataNull;
+	size_t pos;
+	size_t claimPos[2] = { 0, 0 };
+	jsonScanExpect(&js, '{');
+	while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+		if (JSON_SCAN_IS(key, keyLen, "c")) { a = 0; }
+		else if (JSON_SCAN_IS(key, keyLen, "u")) { a = 1; }
+		else if (jsonScanSkip(&js)) { continue; }
+		else { goto formaterr; }
+
+		sawArrs[a] = true;
+		if (!jsonScanExpect(&js, '[')) { goto formaterr; }
+		while (jsonScanElement(&js, &moreTxs) && moreTxs) {
+			if (!jsonScanExpect(&js, '{')) { goto formaterr; }
+			dataId = NULL;
+			dataIdLen = 0;
+			dataVout = 0;
+			dataNull = false;
+			res.hex = NULL;
+			res.txid = NULL;
+			res.source = a;
+			while (jsonScanMember(&js, &key, &keyLen, &moreFields) && moreFields) {
+				if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_DATA_TAG)) {
+					if (jsonScanNull(&js)) { dataNull = true; }
+					else if (!jsonScanString(&js, &res.hex, &res.hexLen)) { goto formaterr; }
 				}
-				if (type == BY_INTXID) { dataVout = json_integer_value(json_object_get(dataJson, BITDB_QUERY_INFO_TAG)); }
-
-				if (!added[i] && strcmp(ids[i], dataId) == 0 && (type != BY_INTXID || dataVout == CW_REVISION_INPUT_VOUT)) {
-					hexDataPtrs[i] = dataHex;	
-					if (txids) {
-						if (type == BY_TXID) { dataTxid = dataId; }
-						else if ((dataTxid = json_string_value(json_object_get(dataJson, BITDB_QUERY_TXID_TAG))) == NULL) {
-							jsonDump = json_dumps(jsonArrs[a], 0);
-							fprintf(CWG_err_stream, "BitDB node responded with unexpected JSON format:\n%s\n", jsonDump);
-							free(jsonDump);
-							status = CWG_FETCH_ERR; goto cleanup;		
-						}
-						txids[i][0] = 0; strncat(txids[i], dataTxid, CW_TXID_CHARS);
-					}
-					added[i] = true;
-					matched = true;
-					break;
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_ID_TAG)) {
+					if (!jsonScanNull(&js) && !jsonScanString(&js, &dataId, &dataIdLen)) { goto formaterr; }
 				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_TXID_TAG)) {
+					if (!jsonScanNull(&js) && !jsonScanString(&js, &res.txid, &res.txidLen)) { goto formaterr; }
+				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_INFO_TAG)) {
+					if (!jsonScanNull(&js) && !jsonScanInt(&js, &dataVout)) { goto formaterr; }
+				}
+				else if (!jsonScanSkip(&js)) { goto formaterr; }
+			}
+			if (!dataId || (!res.hex && !dataNull)) { goto formaterr; }
+			if (type == BY_NAMETAG) {
+				if (jsonScanIdsFind(&idHash, dataId, dataIdLen) == JSON_SCAN_ID_NONE || (pos = claimPos[a]++) >= count) { continue; }
+				if (batch->txids && !res.txid) { goto formaterr; }
+				if (dataNull) { res.hex = ""; res.hexLen = 0; }
+				if (items[pos].source < 0 || (items[pos].source > 0 && a == 0)) { items[pos] = res; }
+				continue;
+			}
+			if (dataNull || (type == BY_INTXID && dataVout != CW_REVISION_INPUT_VOUT)) { continue; }
+			if (type == BY_TXID) { res.txid = dataId; res.txidLen = dataIdLen; }
+			else if (batch->txids && !res.txid) { goto formaterr; }
+
+			// fill every position at this id, unless already filled by a confirmed result
+			for (pos = jsonScanIdsFind(&idHash, dataId, dataIdLen); pos != JSON_SCAN_ID_NONE; pos = idNext[pos]) {
+				if (items[pos].source < 0 || (items[pos].source > 0 && a == 0)) { items[pos] = res; }
 			}
-			if (matched) { break; } 
 		}
-		if (!matched) { status = CWG_FETCH_NO; goto cleanup; }
+		if (moreTxs) { goto formaterr; }
 	}
-	
-	hexDataAll[0] = 0;
-	for (int i=0; i<count; i++) { strncat(hexDataAll, hexDataPtrs[i], CW_TX_DATA_CHARS); }
+	if (more || !sawArrs[0] || !sawArrs[1]) { goto formaterr; }
+
+	if (type == BY_NAMETAG) {
+		size_t found = 0;
+		while (found < count && items[found].source >= 0) { ++found; }
+		if (found < 1) { return CWG_FETCH_NO; }
+		if (count == 1 && items[0].hexLen < 1) { return CWG_FILE_ERR; }
+		count = found;
+	}
+	for (int i=0; i<count; i++) { if (items[i].source < 0) { return CWG_FETCH_NO; } }
+	httpFetchItemsCopy(batch, items, count);
+	return CW_OK;
+
+	formaterr: {
+		const char *respMsg = httpResponseStr(&batch->req.resp);
+		fprintf(CWG_err_stream, "BitDB node responded with unexpected JSON format:\n%s\n", respMsg ? respMsg : "");
+		return CWG_FETCH_ERR;
+	}
+}
+
+/*
+ * fetches hex data (from BitDB HTTP endpoint) at specified ids and copies (in order) to specified location in memory
+ * id type is specified by FETCH_TYPE type
+ * when searching for nametag, count references the nth occurrence to get (as only one nametag can be fetched at a time anyway);
+   can be used to skip a nametag claim
+ * txids of fetched TXs can be written to txids, or can be set NULL; shouldn't be needed if type is BY_TXID
+ * per-item details can be written to itemInfo, or can be set NULL
+ */
+static CW_STATUS fetchHexDataBitDBNode(const char **ids, size_t count, FETCH_TYPE type, const char *bitdbNode, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	static const struct HttpFetchBackend backend = { &buildRequestBitDBNode, &parseResponseBitDBNode, NULL };
+	return fetchHexDataHTTP(ids, count, type, bitdbNode, params, txids, hexDataAll, itemInfo, 1, &backend);
+}
+
+/*
+ * fetches hex data of the given number of claims of nametag (from the nth claim) from BitDB HTTP endpoint in a single request,
+   copying hex datas (in order) to hexDataAll
+ * txids must have room for claims txids; itemInfo (initialized) must have room for claims items, and is where the caller learns how many
+   claims were found and where each claim's hex data is (claims without cashweb data having zero-length hex data)
+ */
+static CW_STATUS fetchHexDataBitDBNodeClaims(const char *nametag, size_t nth, size_t claims, const char *bitdbNode, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	static const struct HttpFetchBackend backend = { &buildRequestBitDBNode, &parseResponseBitDBNode, NULL };
+	return fetchHexDataHTTP(&nametag, nth, BY_NAMETAG, bitdbNode, params, txids, hexDataAll, itemInfo, claims, &backend);
+}
+
+/*
+ * constructs BitDB query url for walking the chain of up to batch->claims revisions following the batch's one id, as an aggregation
+   with a single $graphLookup over the confirmed collection (as fetchHexDataMongoDBRevisions() does against MongoDB directly);
+   each TX spending an output of the last (with in[0] spending the revision vout) is returned along with its depth in the chain
+ */
+static CW_STATUS buildRequestBitDBNodeRevisions(struct HttpFetchBatch *batch, FETCH_TYPE type, const char *bitdbNode) {
+	if (batch->count != 1 || type != BY_INTXID) {
+		fprintf(CWG_err_stream, "invalid BitDB revisions query; problem with cashgettools\n");
+		return CW_SYS_ERR;
+	}
+
+	char query[BITDB_REVISIONS_QUERY_BUF_SZ];
+	int printed = snprintf(query, sizeof(query),
+		  "{\"v\":%d,\"q\":{\"aggregate\":[{\"$match\":{\"tx.h\":\"%.*s\"}},"
+		  "{\"$graphLookup\":{\"from\":\"%s\",\"startWith\":\"$tx.h\",\"connectFromField\":\"tx.h\",\"connectToField\":\"in.e.h\",\"as\":\"revs\","
+		  "\"maxDepth\":%zu,\"depthField\":\"depth\",\"restrictSearchWithMatch\":{\"in.0.e.i\":%d}}},{\"$project\":{\"revs\":1}}]},"
+		  "\"r\":{\"f\":\"[.[]|.revs[]|{%s:.out[0].h1,%s:.in[0].e.h,%s:.in[0].e.i,%s:.tx.h,%s:.depth}]\"}}",
+		  BITDB_API_VER, CW_TXID_CHARS, batch->ids[0], BITDB_CONFIRMED_COLL, batch->claims-1, CW_REVISION_INPUT_VOUT,
+		  BITDB_QUERY_DATA_TAG, BITDB_QUERY_ID_TAG, BITDB_QUERY_INFO_TAG, BITDB_QUERY_TXID_TAG, BITDB_QUERY_DEPTH_TAG);
+	if (printed >= sizeof(query)) {
+		fprintf(CWG_err_stream, "BITDB_REVISIONS_QUERY_BUF_SZ set too small; problem with cashgettools\n");
+		return CW_SYS_ERR;
+	}
+
+	return buildRequestUrlBitDBNode(batch, query, bitdbNode);
+}
+
+/*
+ * a TX returned by BitDB revisions query, found at depth in the chain and spending prevTxid
+ */
+struct HttpFetchRevision {
+	struct HttpFetchItem item;
+	const char *prevTxid;
+	size_t prevTxidLen;
+	int64_t depth;
+	bool dataNull;
+};
+
+/*
+ * parses BitDB response to revisions query for the batch (see buildRequestBitDBNodeRevisions()), copying hex datas (in order) to batch->hexData
+ * revisions come unordered (and alongside other spends), so the chain is followed depth by depth from the batch's id, picking at each the TX
+   whose in[0] spends the last revision; the walk stops short of a revision that isn't cashweb-formatted, leaving it to be fetched (and found so) on its own
+ * txids/hex data lengths/confirmation of revisions found are written to batch->txids/batch->itemInfo if not NULL, those beyond the last found
+   being left with length FETCH_ITEM_LEN_UNKNOWN in batch->itemInfo
+ * returns CWG_FETCH_NO if no revision follows (in the confirmed collection)
+ */
+static CW_STATUS parseResponseBitDBNodeRevisions(struct HttpFetchBatch *batch, FETCH_TYPE type) {
+	size_t revs = batch->claims;
+	struct HttpFetchItem items[revs];
+
+	const char *body;
+	size_t bodyLen;
+	if ((body = httpResponseBody(&batch->req.resp, &bodyLen)) == NULL) { return CW_SYS_ERR; }
+
+	struct JsonScan js;
+	jsonScanInit(&js, body, bodyLen);
+	if (!jsonScanPeek(&js, '{')) { goto formaterr; }
+
+	CW_STATUS status = CW_OK;
+	struct HttpFetchRevision *found = NULL;
+	struct HttpFetchRevision *foundNew;
+	size_t foundCount = 0;
+	size_t foundCap = 0;
+
+	bool sawArrs[2] = { false, false };
+	const char *key;
+	size_t keyLen;
+	bool more;
+	bool moreTxs;
+	bool moreFields;
+	int a;
+	struct HttpFetchRevision res;
+	int64_t dataVout;
+	jsonScanExpect(&js, '{');
+	while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+		if (JSON_SCAN_IS(key, keyLen, "c")) { a = 0; }
+		else if (JSON_SCAN_IS(key, keyLen, "u")) { a = 1; }
+		else if (jsonScanSkip(&js)) { continue; }
+		else { status = CWG_FETCH_ERR; goto cleanup; }
+
+		sawArrs[a] = true;
+		if (!jsonScanExpect(&js, '[')) { status = CWG_FETCH_ERR; goto cleanup; }
+		while (jsonScanElement(&js, &moreTxs) && moreTxs) {
+			if (!jsonScanExpect(&js, '{')) { status = CWG_FETCH_ERR; goto cleanup; }
+			res.item.hex = NULL;
+			res.item.txid = NULL;
+			res.item.source = a;
+			res.prevTxid = NULL;
+			res.depth = -1;
+			res.dataNull = false;
+			dataVout = 0;
+			while (jsonScanMember(&js, &key, &keyLen, &moreFields) && moreFields) {
+				if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_DATA_TAG)) {
+					if (jsonScanNull(&js)) { res.dataNull = true; }
+					else if (!jsonScanString(&js, &res.item.hex, &res.item.hexLen)) { status = CWG_FETCH_ERR; goto cleanup; }
+				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_ID_TAG)) {
+					if (!jsonScanNull(&js) && !jsonScanString(&js, &res.prevTxid, &res.prevTxidLen)) { status = CWG_FETCH_ERR; goto cleanup; }
+				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_TXID_TAG)) {
+					if (!jsonScanString(&js, &res.item.txid, &res.item.txidLen)) { status = CWG_FETCH_ERR; goto cleanup; }
+				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_INFO_TAG)) {
+					if (!jsonScanNull(&js) && !jsonScanInt(&js, &dataVout)) { status = CWG_FETCH_ERR; goto cleanup; }
+				}
+				else if (JSON_SCAN_IS(key, keyLen, BITDB_QUERY_DEPTH_TAG)) {
+					if (!jsonScanInt(&js, &res.depth)) { status = CWG_FETCH_ERR; goto cleanup; }
+				}
+				else if (!jsonScanSkip(&js)) { status = CWG_FETCH_ERR; goto cleanup; }
+			}
+			if (!res.item.txid || res.depth < 0 || (!res.item.hex && !res.dataNull)) { status = CWG_FETCH_ERR; goto cleanup; }
+			if (!res.prevTxid || dataVout != CW_REVISION_INPUT_VOUT || res.depth >= (int64_t)revs) { continue; }
+
+			if (foundCount >= foundCap) {
+				foundCap = foundCap > 0 ? foundCap*2 : revs;
+				if ((foundNew = realloc(found, foundCap*sizeof(struct HttpFetchRevision))) == NULL) { perror("realloc failed"); status = CW_SYS_ERR; goto cleanup; }
+				found = foundNew;
+			}
+			found[foundCount++] = res;
+		}
+		if (moreTxs) { status = CWG_FETCH_ERR; goto cleanup; }
+	}
+	if (more || !sawArrs[0] || !sawArrs[1]) { status = CWG_FETCH_ERR; goto cleanup; }
+
+	// follow the chain depth by depth, preferring a confirmed result
+	const char *prevTxid = batch->ids[0];
+	size_t prevTxidLen = strlen(prevTxid);
+	struct HttpFetchRevision *rev;
+	size_t n;
+	for (n=0; n<revs; n++) {
+		rev = NULL;
+		for (int i=0; i<foundCount; i++) {
+			if (found[i].depth != (int64_t)n || found[i].prevTxidLen != prevTxidLen || memcmp(found[i].prevTxid, prevTxid, prevTxidLen) != 0) { continue; }
+			if (!rev || (rev->item.source > 0 && found[i].item.source == 0)) { rev = &found[i]; }
+		}
+		if (!rev || rev->dataNull) { break; }
+		items[n] = rev->item;
+		prevTxid = rev->item.txid;
+		prevTxidLen = rev->item.txidLen;
+	}
+	if (n < 1) { status = CWG_FETCH_NO; goto cleanup; }
+	httpFetchItemsCopy(batch, items, n);
 
 	cleanup:
-		json_decref(respJson);	
-		if (respFp) { fclose(respFp); }
-		return status;
+		if (found) { free(found); }
+		if (status != CWG_FETCH_ERR) { return status; }
+
+	formaterr: {
+		const char *respMsg = httpResponseStr(&batch->req.resp);
+		fprintf(CWG_err_stream, "BitDB node responded with unexpected JSON format:\n%s\n", respMsg ? respMsg : "");
+		return CWG_FETCH_ERR;
+	}
 }
 
-static CW_STATUS fetchHexDataREST(const char **ids, size_t count, FETCH_TYPE type, const char *endpoint, bool requestLimit, char **txids, char *hexDataAll) {
-	if (count < 1) { return CWG_FETCH_NO; }
+/*
+ * fetches hex data of up to the given number of successive revisions following txid from BitDB HTTP endpoint in a single request,
+   copying hex datas (in order) to hexDataAll (see parseResponseBitDBNodeRevisions())
+ * txids (if not NULL) must have room for revs txids; itemInfo (initialized) must have room for revs items, and is where the caller learns
+   how many revisions were found
+ * if no confirmed revision follows txid (as when it, or the next revision, is unconfirmed), the next revision is fetched BY_INTXID instead
+ */
+static CW_STATUS fetchHexDataBitDBNodeRevisions(const char *txid, size_t revs, const char *bitdbNode, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	static const struct HttpFetchBackend backend = { &buildRequestBitDBNodeRevisions, &parseResponseBitDBNodeRevisions, NULL };
+	CW_STATUS status = fetchHexDataHTTP(&txid, 1, BY_INTXID, bitdbNode, params, txids, hexDataAll, itemInfo, revs, &backend);
+	if (status == CWG_FETCH_NO) { status = fetchHexDataBitDBNode(&txid, 1, BY_INTXID, bitdbNode, params, txids, hexDataAll, itemInfo); }
+	return status;
+}
+
+/*
+ * constructs REST request (POST of txids) for the batch
+ */
+static CW_STATUS buildRequestREST(struct HttpFetchBatch *batch, FETCH_TYPE type, const char *endpoint) {
 	if (type != BY_TXID) { fprintf(CWG_err_stream, "fetching by REST only supports querying by TXID; bad call\n"); return CW_CALL_NO; }
 
 	json_t *request;
 	json_t *txidsR;
 
 	if ((txidsR = json_array()) == NULL) { perror("json_array() failed"); return CW_SYS_ERR; }
-	for (int i=0; i<count; i++) { json_array_append_new(txidsR, json_string(ids[i])); }
+	for (int i=0; i<batch->count; i++) { json_array_append_new(txidsR, json_string(batch->ids[i])); }
 
 	if ((request = json_object()) == NULL) { perror("json_object() failed"); json_decref(txidsR); return CW_SYS_ERR; }
 	json_object_set(request, "txids", txidsR);
 	json_decref(txidsR);
 	json_object_set_new(request, "verbose", json_true());
 
-	char *postData = json_dumps(request, JSON_COMPACT);
+	batch->req.postData = json_dumps(request, JSON_COMPACT);
 	json_decref(request);
-	if (!postData) { perror("json_dumps() failed"); return CW_SYS_ERR; }
-	size_t postLen = strlen(postData);
-	if (querySizeExceed && postLen >= querySizeExceed) { return fetchSplitHexData(ids, count, type, endpoint, requestLimit, txids, hexDataAll, &fetchHexDataREST); }
+	if (!batch->req.postData) { perror("json_dumps() failed"); return CW_SYS_ERR; }
+	batch->queryLen = strlen(batch->req.postData);
 
-	char url[strlen(endpoint) + strlen(REST_GETTX_URI) + 1]; url[0] = 0;
-	strcat(url, endpoint);
-	strcat(url, REST_GETTX_URI);
+	if ((batch->req.url = malloc(strlen(endpoint) + strlen(REST_GETTX_URI) + 1)) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	strcpy(batch->req.url, endpoint);
+	strcat(batch->req.url, REST_GETTX_URI);
 
-	CW_STATUS status;
+	return CW_OK;
+}
 
-	FILE *respFp = NULL;
-	if ((status = httpRequest(url, postData, requestLimit, &respFp)) != CW_OK) {
-		free(postData);
-		if (respFp) { fclose(respFp); }
-		return status;
-	}
-	free(postData);
-	rewind(respFp);
-
-	json_error_t jsonError;
-	json_t *respJson = json_loadf(respFp, 0, &jsonError);
-	if (respJson == NULL) {
-		fseek(respFp, 0, SEEK_END);
-		long respSz = ftell(respFp);
-		fseek(respFp, 0, SEEK_SET);
-		char respMsg[respSz+1];
-		respMsg[respSz > 0 ? fread(respMsg, 1, respSz, respFp) : 0] = 0;
+/*
+ * parses REST response for the batch, copying hex datas (in order) to batch->hexData
+ * response is scanned in a single pass, pulling only txid, confirmations, and vout[0].scriptPubKey.asm of each TX,
+   and matching each TX to its position(s) by hash
+ */
+static CW_STATUS parseResponseREST(struct HttpFetchBatch *batch, FETCH_TYPE type) {
+	size_t count = batch->count;
+
+	const char *body;
+	size_t bodyLen;
+	if ((body = httpResponseBody(&batch->req.resp, &bodyLen)) == NULL) { return CW_SYS_ERR; }
+
+	struct JsonScan js;
+	jsonScanInit(&js, body, bodyLen);
+	const char *key;
+	size_t keyLen;
+	bool more;
+
+	// handle error object or non-JSON response
+	if (!jsonScanPeek(&js, '[')) {
+		const char *errMsg = NULL;
+		size_t errLen = 0;
+		if (jsonScanExpect(&js, '{')) {
+			while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+				if (JSON_SCAN_IS(key, keyLen, "error") && jsonScanString(&js, &errMsg, &errLen)) { break; }
+				else if (!jsonScanSkip(&js)) { break; }
+			}
+		}
+		if (errMsg) {
+			char err[errLen+1]; err[0] = 0;
+			strncat(err, errMsg, errLen);
+			if (strstr(err, "No such")) { return CWG_FETCH_NO; }
+			else if (strstr(err, "too large") && count > 1) {
+				batch->split = true;
+				return CW_OK;
+			}
+			fprintf(CWG_err_stream, "unhandled error from REST endpoint: %s\n", err);
+			return CWG_FETCH_ERR;
+		}
+
+		const char *respMsg;
+		if ((respMsg = httpResponseStr(&batch->req.resp)) == NULL) { return CW_SYS_ERR; }
 		if (strstr(respMsg, "html")) {
 			fprintf(CWG_err_stream, "HTML response error unhandled in cashgettools:\n%s\n", respMsg);
 		} else {
-			fprintf(CWG_err_stream, "jansson failed to parse response from REST endpoint: %s\nResponse:\n%s\n\n", jsonError.text, respMsg);
+			fprintf(CWG_err_stream, "failed to parse response from REST endpoint\nResponse:\n%s\n\n", respMsg);
 		}
-		fclose(respFp);
 		return CWG_FETCH_ERR;
-	}	
-	fclose(respFp);
+	}
 
-	const char *errMsg;
-	if ((errMsg = json_string_value(json_object_get(respJson, "error")))) {
-		if (strstr(errMsg, "No such")) { status = CWG_FETCH_NO; }
-		else if (strstr(errMsg, "too large")) {
-			querySizeExceed = postLen;			
-			return fetchSplitHexData(ids, count, type, endpoint, requestLimit, txids, hexDataAll, &fetchHexDataREST);
+	size_t idSlots[JSON_SCAN_ID_SLOTS(count)];
+	size_t idNext[count];
+	struct JsonScanIds idHash;
+	jsonScanIdsInit(&idHash, batch->ids, count, idSlots, idNext);
+
+	struct HttpFetchItem items[count];
+	for (int i=0; i<count; i++) { items[i].source = -1; }
+
+	size_t prefixLen = strlen(DATA_STR_PREFIX);
+	size_t found = 0;
+	bool moreTxs;
+	bool moreVouts;
+	bool moreFields;
+	struct HttpFetchItem res;
+	int64_t confirmations;
+	int vouts;
+	size_t pos;
+	jsonScanExpect(&js, '[');
+	while (jsonScanElement(&js, &moreTxs) && moreTxs) {
+		if (!jsonScanExpect(&js, '{')) { goto formaterr; }
+		res.txid = NULL;
+		res.hex = NULL;
+		confirmations = 0;
+		while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+			if (JSON_SCAN_IS(key, keyLen, "txid")) {
+				if (!jsonScanString(&js, &res.txid, &res.txidLen)) { goto formaterr; }
+			}
+			else if (JSON_SCAN_IS(key, keyLen, "confirmations")) {
+				if (!jsonScanInt(&js, &confirmations)) { goto formaterr; }
+			}
+			else if (JSON_SCAN_IS(key, keyLen, "vout")) {
+				// descends into vout[0].scriptPubKey.asm, skipping everything else
+				if (!jsonScanExpect(&js, '[')) { goto formaterr; }
+				for (vouts = 0; jsonScanElement(&js, &moreVouts) && moreVouts; vouts++) {
+					if (vouts > 0 || !jsonScanExpect(&js, '{')) {
+						if (!jsonScanSkip(&js)) { goto formaterr; }
+						continue;
+					}
+					while (jsonScanMember(&js, &key, &keyLen, &moreFields) && moreFields) {
+						if (!JSON_SCAN_IS(key, keyLen, "scriptPubKey")) {
+							if (!jsonScanSkip(&js)) { goto formaterr; }
+							continue;
+						}
+						if (!jsonScanExpect(&js, '{')) { goto formaterr; }
+						while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+							if (JSON_SCAN_IS(key, keyLen, "asm")) {
+								if (!jsonScanString(&js, &res.hex, &res.hexLen)) { goto formaterr; }
+							}
+							else if (!jsonScanSkip(&js)) { goto formaterr; }
+						}
+						if (more) { goto formaterr; }
+					}
+					if (moreFields) { goto formaterr; }
+				}
+				if (moreVouts) { goto formaterr; }
+			}
+			else if (!jsonScanSkip(&js)) { goto formaterr; }
 		}
-		else {
-			fprintf(CWG_err_stream, "unhandled error from REST endpoint: %s\n", errMsg);
-			status = CWG_FETCH_ERR;
+		if (more || !res.txid || !res.hex) { goto formaterr; }
+
+		if ((pos = jsonScanIdsFind(&idHash, res.txid, res.txidLen)) == JSON_SCAN_ID_NONE) { continue; }
+		if (res.hexLen < prefixLen || strncmp(res.hex, DATA_STR_PREFIX, prefixLen) != 0) { return CWG_FILE_ERR; }
+		res.hex += prefixLen;
+		res.hexLen -= prefixLen;
+		res.source = confirmations > 0 ? 0 : 1;
+		for (; pos != JSON_SCAN_ID_NONE; pos = idNext[pos]) {
+			if (items[pos].source < 0) { items[pos] = res; ++found; }
 		}
-		json_decref(respJson);
-		return status;
 	}
+	if (moreTxs) { goto formaterr; }
 
-	hexDataAll[0] = 0;
-	size_t prefixLen = strlen(DATA_STR_PREFIX);
+	if (found < count) {
+		fprintf(CWG_err_stream, "REST endpoint response endpoint only responded with %zu utxos when %zu requested\n", found, count);
+		return CWG_FETCH_ERR;
+	}
+	httpFetchItemsCopy(batch, items, count);
+	return CW_OK;
 
-	const char *txId;
-	const char *txData;
-
-	size_t i;
-	json_t *tx;
-	json_array_foreach(respJson, i, tx) {
-		if ((txId = json_string_value(json_object_get(tx, "txid"))) == NULL ||
-		    (txData = json_string_value(json_object_get(json_object_get(json_array_get(json_object_get(tx, "vout"), 0), "scriptPubKey"), "asm"))) == NULL) {
-			char *dump = json_dumps(respJson, JSON_INDENT(4));
-			fprintf(CWG_err_stream, "unexpectedly formatted response JSON from REST endpoint:\n%s\n\n", dump);
-			free(dump);
-			json_decref(respJson);
-			return CWG_FETCH_ERR;
-		}
-		if (i < count) {
-			if (strncmp(txData, DATA_STR_PREFIX, prefixLen) != 0) {
-				json_decref(respJson);
-				return CWG_FILE_ERR;
+	formaterr: {
+		const char *respMsg = httpResponseStr(&batch->req.resp);
+		fprintf(CWG_err_stream, "unexpectedly formatted response JSON from REST endpoint:\n%s\n\n", respMsg ? respMsg : "");
+		return CWG_FETCH_ERR;
+	}
+}
+
+/*
+ * fetches hex data (from REST endpoint) at specified txids and copies (in order) to specified location in memory
+ * only supports fetching by TXID
+ * per-item details can be written to itemInfo, or can be set NULL
+ */
+static CW_STATUS fetchHexDataREST(const char **ids, size_t count, FETCH_TYPE type, const char *endpoint, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	static const struct HttpFetchBackend backend = { &buildRequestREST, &parseResponseREST, NULL };
+	return fetchHexDataHTTP(ids, count, type, endpoint, params, txids, hexDataAll, itemInfo, 1, &backend);
+}
+
+/*
+ * writes bitcoind JSON-RPC batch of n calls (with ids 0..n-1 in order), methods[i] being the method of each and callParams[i] its JSON params array,
+   to heap-allocated string
+ * returns NULL on failure
+ */
+static char *rpcBatchPostData(const char **methods, const char **callParams, size_t n) {
+	size_t len = 3;
+	for (int i=0; i<n; i++) { len += sizeof(RPC_CALL_FMT) + 20 + strlen(methods[i]) + strlen(callParams[i]); }
+
+	char *postData;
+	if ((postData = malloc(len)) == NULL) { perror("malloc failed"); return NULL; }
+	char *postDataPtr = postData;
+	*postDataPtr++ = '[';
+	for (int i=0; i<n; i++) {
+		if (i > 0) { *postDataPtr++ = ','; }
+		postDataPtr += sprintf(postDataPtr, RPC_CALL_FMT, (size_t)i, methods[i], callParams[i]);
+	}
+	*postDataPtr++ = ']';
+	*postDataPtr = 0;
+	return postData;
+}
+
+/*
+ * scans bitcoind JSON-RPC batch response body for n calls, matching each call's result to its position by id and writing it
+   as a slice of the body to results/resultLens (contents if a string, otherwise the value's raw text; NULL if null or missing),
+   and its error code to errCodes (0 if none)
+ * any error other than RPC_ERR_NO_TX is printed
+ * returns false if the response is malformed
+ */
+static bool rpcScanResults(const char *body, size_t bodyLen, size_t n, const char **results, size_t *resultLens, int64_t *errCodes) {
+	for (int i=0; i<n; i++) {
+		results[i] = NULL;
+		resultLens[i] = 0;
+		errCodes[i] = 0;
+	}
+
+	struct JsonScan js;
+	jsonScanInit(&js, body, bodyLen);
+	const char *key;
+	size_t keyLen;
+	bool moreCalls;
+	bool more;
+	bool moreFields;
+	const char *result;
+	size_t resultLen;
+	const char *errMsg;
+	size_t errMsgLen;
+	int64_t errCode;
+	int64_t id;
+	bool isErr;
+	if (!jsonScanExpect(&js, '[')) { return false; }
+	while (jsonScanElement(&js, &moreCalls) && moreCalls) {
+		if (!jsonScanExpect(&js, '{')) { return false; }
+		result = NULL;
+		resultLen = 0;
+		errMsg = NULL;
+		errMsgLen = 0;
+		errCode = 0;
+		id = -1;
+		isErr = false;
+		while (jsonScanMember(&js, &key, &keyLen, &more) && more) {
+			if (JSON_SCAN_IS(key, keyLen, "result")) {
+				if (jsonScanNull(&js)) { continue; }
+				if (jsonScanPeek(&js, '"')) {
+					if (!jsonScanString(&js, &result, &resultLen)) { return false; }
+					continue;
+				}
+				result = js.p;
+				if (!jsonScanSkip(&js)) { return false; }
+				resultLen = js.p - result;
 			}
-			if (txids) {
-				txids[i][0] = 0;
-				strncat(txids[i], txId, CW_TXID_CHARS);
+			else if (JSON_SCAN_IS(key, keyLen, "error")) {
+				if (jsonScanNull(&js)) { continue; }
+				if (!jsonScanExpect(&js, '{')) { return false; }
+				isErr = true;
+				while (jsonScanMember(&js, &key, &keyLen, &moreFields) && moreFields) {
+					if (JSON_SCAN_IS(key, keyLen, "code")) {
+						if (!jsonScanInt(&js, &errCode)) { return false; }
+					}
+					else if (JSON_SCAN_IS(key, keyLen, "message")) {
+						if (!jsonScanString(&js, &errMsg, &errMsgLen)) { return false; }
+					}
+					else if (!jsonScanSkip(&js)) { return false; }
+				}
+				if (moreFields) { return false; }
+			}
+			else if (JSON_SCAN_IS(key, keyLen, "id")) {
+				if (!jsonScanInt(&js, &id)) { return false; }
 			}
-			strncat(hexDataAll, txData+prefixLen, CW_TX_DATA_CHARS);
-		} else { break; }
+			else if (!jsonScanSkip(&js)) { return false; }
+		}
+		if (more || id < 0 || id >= n) { return false; }
+
+		results[id] = result;
+		resultLens[id] = resultLen;
+		if (isErr) {
+			errCodes[id] = errCode != 0 ? errCode : -1;
+			if (errCode != RPC_ERR_NO_TX) {
+				fprintf(CWG_err_stream, "error %" PRId64 " from RPC endpoint: %.*s\n", errCode, (int)errMsgLen, errMsg ? errMsg : "");
+			}
+		}
 	}
-	json_decref(respJson);	
-	if (i < count-1) {
-		fprintf(CWG_err_stream, "REST endpoint response endpoint only responded with %zu utxos when %zu requested\n", i, count);
+	return !moreCalls;
+}
+
+/*
+ * constructs bitcoind JSON-RPC request for the batch, as a batch of non-verbose getrawtransaction calls (one per txid);
+   if batch->itemInfo is set (i.e. for the cache), they are followed by a getmempoolentry call per txid, so that confirmation is reported
+   without the weight of verbose getrawtransaction
+ */
+static CW_STATUS buildRequestRPC(struct HttpFetchBatch *batch, FETCH_TYPE type, const char *endpoint) {
+	if (type != BY_TXID) { fprintf(CWG_err_stream, "fetching by RPC only supports querying by TXID (unless resolved through local index); bad call\n"); return CW_CALL_NO; }
+
+	size_t count = batch->count;
+	size_t calls = batch->itemInfo ? count*2 : count;
+	char callParamsBuf[calls][sizeof(RPC_GETRAWTX_PARAMS_FMT)+CW_TXID_CHARS];
+	const char *callParams[calls];
+	const char *methods[calls];
+	for (int i=0; i<count; i++) {
+		if (!CW_is_valid_txid(batch->ids[i])) { return CWG_FETCH_NO; }
+		snprintf(callParamsBuf[i], sizeof(callParamsBuf[i]), RPC_GETRAWTX_PARAMS_FMT, batch->ids[i]);
+		callParams[i] = callParamsBuf[i];
+		methods[i] = "getrawtransaction";
+		if (calls > count) {
+			snprintf(callParamsBuf[count+i], sizeof(callParamsBuf[count+i]), RPC_TXID_PARAMS_FMT, batch->ids[i]);
+			callParams[count+i] = callParamsBuf[count+i];
+			methods[count+i] = "getmempoolentry";
+		}
+	}
+	if ((batch->req.postData = rpcBatchPostData(methods, callParams, calls)) == NULL) { return CW_SYS_ERR; }
+	batch->queryLen = strlen(batch->req.postData);
+
+	if ((batch->req.url = strdup(endpoint)) == NULL) { perror("strdup failed"); return CW_SYS_ERR; }
+	return CW_OK;
+}
+
+/*
+ * parses bitcoind JSON-RPC response for the batch, copying hex datas (in order) to batch->hexData
+ * each raw TX is scanned (as hex, in place) for the first push of its first output's OP_RETURN, which is copied out as is
+ * if batch->itemInfo is set, a TX is reported confirmed if its getmempoolentry call found it not in mempool (as getrawtransaction found it, it must be in a block)
+ */
+static CW_STATUS parseResponseRPC(struct HttpFetchBatch *batch, FETCH_TYPE type) {
+	size_t count = batch->count;
+
+	const char *body;
+	size_t bodyLen;
+	if ((body = httpResponseBody(&batch->req.resp, &bodyLen)) == NULL) { return CW_SYS_ERR; }
+	if (bodyLen < 1) {
+		fprintf(CWG_err_stream, "empty response from RPC endpoint %s; check credentials\n", batch->endpoint ? batch->endpoint : "");
 		return CWG_FETCH_ERR;
 	}
 
-	return status;
+	size_t calls = batch->itemInfo ? count*2 : count;
+	const char *results[calls];
+	size_t resultLens[calls];
+	int64_t errCodes[calls];
+	struct HttpFetchItem items[count];
+	if (!rpcScanResults(body, bodyLen, calls, results, resultLens, errCodes)) { goto formaterr; }
+
+	struct TxScan ts;
+	struct TxScanInfo info;
+	const char *push2;
+	size_t push2Len;
+	for (int i=0; i<count; i++) {
+		if (errCodes[i] == RPC_ERR_NO_TX) { return CWG_FETCH_NO; }
+		else if (errCodes[i] != 0) { return CWG_FETCH_ERR; }
+		if (!results[i]) { goto formaterr; }
+
+		txScanInit(&ts, results[i], resultLens[i], true);
+		if (!txScanTx(&ts, &info)) { goto formaterr; }
+		if (!info.out0Script || !txScanOpReturn(info.out0Script, info.out0ScriptLen, true, &items[i].hex, &items[i].hexLen, &push2, &push2Len) ||
+		    !items[i].hex) { return CWG_FILE_ERR; }
+		items[i].txid = batch->ids[i];
+		items[i].txidLen = strlen(batch->ids[i]);
+		items[i].source = calls > count && errCodes[count+i] == RPC_ERR_NO_TX ? 0 : 1;
+	}
+	httpFetchItemsCopy(batch, items, count);
+	return CW_OK;
+
+	formaterr: {
+		const char *respMsg = httpResponseStr(&batch->req.resp);
+		fprintf(CWG_err_stream, "unexpectedly formatted response JSON from RPC endpoint:\n%s\n\n", respMsg ? respMsg : "");
+		return CWG_FETCH_ERR;
+	}
+}
+
+/*
+ * fetches hex data (from bitcoind JSON-RPC endpoint, which must have txindex) at specified txids and copies (in order) to specified location in memory
+ * only supports fetching by TXID
+ * per-item details can be written to itemInfo, or can be set NULL
+ */
+static CW_STATUS fetchHexDataRPC(const char **ids, size_t count, FETCH_TYPE type, const char *endpoint, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	const struct HttpFetchBackend backend = { &buildRequestRPC, &parseResponseRPC, params->rpcAuth };
+	return fetchHexDataHTTP(ids, count, type, endpoint, params, txids, hexDataAll, itemInfo, 1, &backend);
+}
+
+/*
+ * performs batch of n calls to method over bitcoind JSON-RPC (at an endpoint picked from params->rpcEndpoint), callParams[i] being the JSON params array of each
+ * result of each (in order) is written to results/resultLens as with rpcScanResults(), pointing into the response held by req
+   (which the caller must free with freeHttpRequest())
+ * returns CWG_FETCH_ERR if any call fails
+ */
+static CW_STATUS rpcBatch(struct CWG_params *params, const char *method, const char **callParams, size_t n, struct HttpRequest *req, const char **results, size_t *resultLens) {
+	char endpointsBuf[strlen(params->rpcEndpoint)+1];
+	const char *endpoints[HTTP_ENDPOINTS_LIST_MAX];
+	size_t endpointsCount;
+	if ((endpointsCount = httpEndpointsParseList(params->rpcEndpoint, endpointsBuf, endpoints)) < 1) {
+		fprintf(CWG_err_stream, "no RPC endpoint specified\n");
+		return CWG_FETCH_ERR;
+	}
+
+	initHttpRequest(req);
+	req->endpoint = httpEndpointsPick(httpPoolEndpoints((struct HttpPool *)params->httpPool), endpoints, endpointsCount, NULL);
+	req->auth = params->rpcAuth;
+	if ((req->url = strdup(req->endpoint)) == NULL) { perror("strdup failed"); return CW_SYS_ERR; }
+	const char *methods[n];
+	for (int i=0; i<n; i++) { methods[i] = method; }
+	if ((req->postData = rpcBatchPostData(methods, callParams, n)) == NULL) { return CW_SYS_ERR; }
+
+	CW_STATUS status;
+	struct HttpRequest *reqs[1] = { req };
+	status = httpRequestMulti((struct HttpPool *)params->httpPool, (struct RateLimiter *)params->rateLimiter, reqs, 1, false, 1);
+	httpTransferStatsAdd(params->transferStats, &req->transfer);
+	if (status != CW_OK) { return status; }
+	if (req->status != CW_OK) { return CWG_FETCH_ERR; }
+
+	const char *body;
+	size_t bodyLen;
+	if ((body = httpResponseBody(&req->resp, &bodyLen)) == NULL) { return CW_SYS_ERR; }
+	if (bodyLen < 1) {
+		fprintf(CWG_err_stream, "empty response from RPC endpoint %s; check credentials\n", req->endpoint);
+		return CWG_FETCH_ERR;
+	}
+	int64_t errCodes[n];
+	if (!rpcScanResults(body, bodyLen, n, results, resultLens, errCodes)) {
+		const char *respMsg = httpResponseStr(&req->resp);
+		fprintf(CWG_err_stream, "unexpectedly formatted response JSON from RPC endpoint:\n%s\n\n", respMsg ? respMsg : "");
+		return CWG_FETCH_ERR;
+	}
+	for (int i=0; i<n; i++) {
+		if (errCodes[i] != 0 || !results[i]) { return CWG_FETCH_ERR; }
+	}
+	return CW_OK;
+}
+
+/*
+ * builds/updates local index at indexPath from blocks fetched over bitcoind JSON-RPC (params->rpcEndpoint), from where it left off up to the node's tip
+ * blocks are fetched RPC_INDEX_BLOCKS_BATCH at a time, and the index is written out every RPC_INDEX_COMMIT_INTERVAL blocks,
+   so that an interrupted build loses little
+ */
+static CW_STATUS rpcIndexUpdate(const char *indexPath, struct CWG_params *params) {
+	struct IndexBuilder *builder;
+	uint64_t height;
+	CW_STATUS status;
+	if ((status = indexBuilderOpen(indexPath, &builder, &height)) != CW_OK) { return status; }
+
+	struct HttpRequest req;
+	initHttpRequest(&req);
+	const char *results[RPC_INDEX_BLOCKS_BATCH];
+	size_t resultLens[RPC_INDEX_BLOCKS_BATCH];
+	char heightParams[RPC_INDEX_BLOCKS_BATCH][24];
+	char hashParams[RPC_INDEX_BLOCKS_BATCH][sizeof(RPC_GETBLOCK_PARAMS_FMT)+CW_TXID_CHARS];
+	const char *callParams[RPC_INDEX_BLOCKS_BATCH];
+	char *block = NULL;
+	size_t blockSize = 0;
+	size_t blockLen;
+	char *newBlock;
+	struct TxScan ts;
+	uint64_t committedHeight = height;
+	size_t n;
+
+	const char *noParams = "[]";
+	if ((status = rpcBatch(params, "getblockcount", &noParams, 1, &req, results, resultLens)) != CW_OK) { goto cleanup; }
+	uint64_t tip = strtoull(results[0], NULL, 10);
+	freeHttpRequest(&req);
+
+	while (height <= tip) {
+		n = tip-height+1 < RPC_INDEX_BLOCKS_BATCH ? tip-height+1 : RPC_INDEX_BLOCKS_BATCH;
+		for (int i=0; i<n; i++) {
+			snprintf(heightParams[i], sizeof(heightParams[i]), "[%" PRIu64 "]", height+i);
+			callParams[i] = heightParams[i];
+		}
+		if ((status = rpcBatch(params, "getblockhash", callParams, n, &req, results, resultLens)) != CW_OK) { goto cleanup; }
+		for (int i=0; i<n; i++) {
+			if (resultLens[i] != CW_TXID_CHARS) { fprintf(CWG_err_stream, "invalid block hash from RPC endpoint\n"); status = CWG_FETCH_ERR; goto cleanup; }
+			snprintf(hashParams[i], sizeof(hashParams[i]), RPC_GETBLOCK_PARAMS_FMT, (int)resultLens[i], results[i]);
+			callParams[i] = hashParams[i];
+		}
+		freeHttpRequest(&req);
+
+		if ((status = rpcBatch(params, "getblock", callParams, n, &req, results, resultLens)) != CW_OK) { goto cleanup; }
+		for (int i=0; i<n; i++) {
+			// blocks come as hex, and are decoded for hashing their TXs
+			blockLen = resultLens[i]/2;
+			if (blockLen > blockSize) {
+				if ((newBlock = realloc(block, blockLen)) == NULL) { perror("realloc failed"); status = CW_SYS_ERR; goto cleanup; }
+				block = newBlock;
+				blockSize = blockLen;
+			}
+			txScanInit(&ts, results[i], resultLens[i], true);
+			for (size_t b=0; b<blockLen; b++) {
+				if (!txScanByte(&ts, (uint8_t *)&block[b])) { fprintf(CWG_err_stream, "invalid block hex from RPC endpoint\n"); status = CWG_FETCH_ERR; goto cleanup; }
+			}
+			if ((status = indexBuilderAddBlock(builder, height+i, block, blockLen)) != CW_OK) { goto cleanup; }
+		}
+		freeHttpRequest(&req);
+
+		height += n;
+		if (height-committedHeight >= RPC_INDEX_COMMIT_INTERVAL) {
+			if ((status = indexBuilderCommit(builder)) != CW_OK) { goto cleanup; }
+			committedHeight = height;
+		}
+	}
+	if (height > committedHeight || access(indexPath, F_OK) != 0) { status = indexBuilderCommit(builder); }
+
+	cleanup:
+		freeHttpRequest(&req);
+		if (block) { free(block); }
+		indexBuilderFree(builder);
+		return status;
 }
 
 #endif
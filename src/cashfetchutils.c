@@ -1,9 +1,290 @@
 #include "cashfetchutils.h"
 #include "cashfetchhttputils.h"
+#include "cashcacheutils.h"
+#include "cashindexutils.h"
+#include "cashfetcherutils.h"
 #include <mongoc.h>
+#include <time.h>
 
 /* MongoDB constants */
 #define MONGODB_APPNAME "cashgettools"
+#define MONGODB_DB "bitdb"
+#define MONGODB_COLLS { "confirmed", "unconfirmed" }
+#define MONGODB_COLLS_COUNT 2
+
+/*
+ * upper bound (exclusive) of the strings starting with CW_NAMETAG_PREFIX ('~' being 0x7e), for indexing only nametag claims
+ */
+#define MONGODB_NAMETAG_PREFIX_END "\x7f"
+
+/* samples queried when checking query plans, if none given (plans don't depend on whether anything matches) */
+#define MONGODB_SAMPLE_TXID "0000000000000000000000000000000000000000000000000000000000000000"
+#define MONGODB_SAMPLE_NAMETAG CW_NAMETAG_PREFIX"cashweb"
+
+/* server error codes for an index conflicting with an existing one */
+#define MONGODB_INDEX_OPTIONS_CONFLICT 85
+#define MONGODB_INDEX_KEY_SPECS_CONFLICT 86
+
+/*
+ * id of a batch paired with its position in ids, for looking up the positions a result belongs to
+ */
+struct MongoIdIndex {
+	const char *id;
+	size_t index;
+};
+
+static int compareMongoIdIndex(const void *a, const void *b) {
+	return strcmp(((const struct MongoIdIndex *)a)->id, ((const struct MongoIdIndex *)b)->id);
+}
+
+/*
+ * gets string at dotted path (e.g. "out.0.str") within BSON document, writing its length to lenPtr
+ * returns NULL if absent or not a string
+ */
+static const char *mongoResultStr(const bson_t *res, const char *path, uint32_t *lenPtr) {
+	bson_iter_t iter;
+	bson_iter_t target;
+	if (!bson_iter_init(&iter, res) || !bson_iter_find_descendant(&iter, path, &target) || !BSON_ITER_HOLDS_UTF8(&target)) { return NULL; }
+	return bson_iter_utf8(&target, lenPtr);
+}
+
+/*
+ * extracts hex data from a MongoDB result document (populated by BitDB), writing to hexData (must fit CW_TX_DATA_CHARS+1)
+ * the id that the document matched on (tx.h if BY_TXID, in[0].e.h if BY_INTXID) is written to id if not NULL, and its txid to txid if not NULL
+   (both must fit CW_TXID_CHARS+1), even if the document turns out not to be cashweb-formatted (CWG_FILE_ERR)
+ * fields are read straight from the BSON, without conversion of the document
+ * returns CWG_FETCH_NO if document doesn't qualify (i.e. BY_INTXID where in[0] doesn't spend the revision vout)
+ */
+static CW_STATUS mongoResultToHexData(const bson_t *res, FETCH_TYPE type, char *hexData, char *id, char *txid) {
+	uint32_t idLen = 0;
+	uint32_t txidLen = 0;
+	uint32_t strLen = 0;
+	const char *idStr = NULL;
+	const char *txidStr = mongoResultStr(res, "tx.h", &txidLen);
+	if (type == BY_INTXID) {
+		bson_iter_t iter;
+		bson_iter_t target;
+		int64_t vout = -1;
+		if (bson_iter_init(&iter, res) && bson_iter_find_descendant(&iter, "in.0.e.i", &target)) { vout = bson_iter_as_int64(&target); }
+		idStr = mongoResultStr(res, "in.0.e.h", &idLen);
+		if (idStr && vout != CW_REVISION_INPUT_VOUT) { return CWG_FETCH_NO; }
+	}
+	else if (type == BY_TXID) { idStr = txidStr; idLen = txidLen; }
+
+	const char *str = mongoResultStr(res, "out.0.str", &strLen);
+	if (!str || (id && !idStr) || (txid && !txidStr)) {
+		char *resStr = bson_as_relaxed_extended_json(res, NULL);
+		fprintf(CWG_err_stream, "invalid response from MongoDB:\n%s\n", resStr ? resStr : "");
+		bson_free(resStr);
+		return CWG_FETCH_ERR;
+	}
+	if (id) { id[0] = 0; strncat(id, idStr, idLen < CW_TXID_CHARS ? idLen : CW_TXID_CHARS); }
+	if (txid) { txid[0] = 0; strncat(txid, txidStr, txidLen < CW_TXID_CHARS ? txidLen : CW_TXID_CHARS); }
+
+	size_t hexPrefixLen = strlen(DATA_STR_PREFIX);
+	if (strLen < hexPrefixLen || strncmp(str, DATA_STR_PREFIX, hexPrefixLen) != 0) { return CWG_FILE_ERR; }
+
+	// hex data runs up to the first space (if any further pushes follow)
+	size_t hexLen = strLen-hexPrefixLen;
+	const char *token;
+	if ((token = memchr(str+hexPrefixLen, ' ', hexLen))) { hexLen = token-(str+hexPrefixLen); }
+	if (hexLen > CW_TX_DATA_CHARS) { hexLen = CW_TX_DATA_CHARS; }
+	memcpy(hexData, str+hexPrefixLen, hexLen);
+	hexData[hexLen] = 0;
+
+	return CW_OK;
+}
+
+/*
+ * key matched on by a batch query of given type (BY_TXID or BY_INTXID)
+ */
+static inline const char *mongoBatchIdKey(FETCH_TYPE type) {
+	return type == BY_TXID ? "tx.h" : "in.e.h";
+}
+
+/*
+ * builds options (projection) of a batch query of given type (BY_TXID or BY_INTXID)
+ * must be freed with bson_destroy()
+ */
+static inline bson_t *mongoBatchOpts(FETCH_TYPE type) {
+	if (type == BY_TXID) { return BCON_NEW("projection", "{", "out.str", BCON_BOOL(true), "tx.h", BCON_BOOL(true), "_id", BCON_BOOL(false), "}"); }
+	return BCON_NEW("projection", "{", "out.str", BCON_BOOL(true), "in.e", BCON_BOOL(true), "tx.h", BCON_BOOL(true), "_id", BCON_BOOL(false), "}");
+}
+
+/*
+ * builds options (projection, sort, and skip to the claim) of a query for the given number of claims of a nametag from the nth
+ * must be freed with bson_destroy()
+ */
+static inline bson_t *mongoNametagOpts(size_t nth, size_t claims) {
+	return BCON_NEW("projection", "{", "out.str", BCON_BOOL(true), "tx.h", BCON_BOOL(true), "_id", BCON_BOOL(false), "}",
+			"sort", "{", "blk.i", BCON_INT32(1), "tx.h", BCON_INT32(1), "}",
+			"limit", BCON_INT64(claims),
+			"skip", BCON_INT64(nth-1));
+}
+
+/*
+ * fetches hex data (from MongoDB populated by BitDB) of the given number of claims of nametag from the nth, with one query per collection;
+   the nth claim overall is the nth confirmed if there is one, and otherwise the nth unconfirmed (as confirmed claims sort first),
+   so unconfirmed collection is only queried for claims beyond those found confirmed
+ * claims found are copied in order to hexDataAll, a claim that isn't cashweb-formatted being copied as zero-length hex data;
+   those beyond the last found are left with length FETCH_ITEM_LEN_UNKNOWN in itemInfo (which is needed to tell them apart if claims > 1)
+ * if only one claim is fetched, returns CWG_FILE_ERR if it isn't cashweb-formatted
+ * txids of fetched TXs can be written to txids, or can be set NULL
+ */
+static CW_STATUS fetchHexDataMongoDBNametag(const char *nametag, size_t nth, size_t claims, mongoc_collection_t **colls, size_t collsCount, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	CW_STATUS status = CW_OK;
+
+	hexDataAll[0] = 0;
+	char (*hexDatas)[CW_TX_DATA_CHARS+1] = malloc(claims*sizeof(hexDatas[0]));
+	bool *confirmed = malloc(claims*sizeof(bool));
+	if (!hexDatas || !confirmed) {
+		perror("malloc failed");
+		if (hexDatas) { free(hexDatas); }
+		if (confirmed) { free(confirmed); }
+		return CW_SYS_ERR;
+	}
+	bson_t *query = BCON_NEW("out.s2", nametag);
+	bson_t *opts = mongoNametagOpts(nth, claims);
+
+	mongoc_cursor_t *cursor;
+	bson_error_t error;
+	const bson_t *res;
+	CW_STATUS resStatus;
+	size_t found = 0;
+	for (int c=0; c<collsCount && found < claims; c++) {
+		cursor = mongoc_collection_find_with_opts(colls[c], query, opts, NULL);
+		for (size_t pos=0; pos<claims && mongoc_cursor_next(cursor, &res); pos++) {
+			if (pos < found) { continue; } // already found confirmed
+			if ((resStatus = mongoResultToHexData(res, BY_NAMETAG, hexDatas[pos], NULL, txids ? txids[pos] : NULL)) == CWG_FILE_ERR) { hexDatas[pos][0] = 0; }
+			else if (resStatus != CW_OK) { status = resStatus; break; }
+			confirmed[pos] = c == 0;
+			found = pos+1;
+		}
+		if (mongoc_cursor_error(cursor, &error)) {
+			fprintf(CWG_err_stream, "ERROR: MongoDB query failed\nMessage: %s\n", error.message);
+			status = CWG_FETCH_ERR;
+		}
+		mongoc_cursor_destroy(cursor);
+		if (status != CW_OK) { goto cleanup; }
+	}
+	if (found < 1) { status = CWG_FETCH_NO; goto cleanup; }
+	if (claims == 1 && !hexDatas[0][0]) { status = CWG_FILE_ERR; goto cleanup; }
+
+	char *hexDataPtr = hexDataAll;
+	for (int i=0; i<found; i++) {
+		strcpy(hexDataPtr, hexDatas[i]);
+		if (itemInfo) {
+			itemInfo[i].hexLen = strlen(hexDataPtr);
+			itemInfo[i].confirmed = confirmed[i];
+		}
+		hexDataPtr += strlen(hexDataPtr);
+	}
+
+	cleanup:
+		bson_destroy(query);
+		bson_destroy(opts);
+		free(hexDatas);
+		free(confirmed);
+		return status;
+}
+
+/*
+ * fetches hex data (from MongoDB populated by BitDB) at specified ids (TXIDs or spent TXIDs), with one $in query per collection;
+   unconfirmed collection is only queried for ids not found confirmed
+ * results are matched back to (possibly repeated) ids and copied in order to hexDataAll
+ * txids of fetched TXs can be written to txids, or can be set NULL
+ */
+static CW_STATUS fetchHexDataMongoDBBatch(const char **ids, size_t count, FETCH_TYPE type, mongoc_collection_t **colls, size_t collsCount, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	CW_STATUS status = CW_OK;
+
+	hexDataAll[0] = 0;
+	if (type != BY_TXID && type != BY_INTXID) {
+		fprintf(CWG_err_stream, "invalid FETCH_TYPE; problem with cashgettools\n");
+		return CW_SYS_ERR;
+	}
+	const char *idKey = mongoBatchIdKey(type);
+	bson_t *opts = mongoBatchOpts(type);
+
+	char (*hexDatas)[CW_TX_DATA_CHARS+1] = malloc(count*sizeof(hexDatas[0]));
+	struct MongoIdIndex *lookup = malloc(count*sizeof(struct MongoIdIndex));
+	bool *found = calloc(count, sizeof(bool));
+	if (!hexDatas || !lookup || !found) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+
+	for (int i=0; i<count; i++) { lookup[i].id = ids[i]; lookup[i].index = i; }
+	qsort(lookup, count, sizeof(struct MongoIdIndex), &compareMongoIdIndex);
+
+	mongoc_cursor_t *cursor;
+	bson_error_t error;
+	const bson_t *res;
+	bson_t *query;
+	bson_t queryIn;
+	bson_t queryInArr;
+	char keyBuf[16];
+	const char *key;
+	char hexData[CW_TX_DATA_CHARS+1];
+	char resId[CW_TXID_CHARS+1];
+	char resTxid[CW_TXID_CHARS+1];
+	struct MongoIdIndex *match;
+	struct MongoIdIndex resLookup;
+	CW_STATUS resStatus;
+	size_t missing = count;
+	for (int c=0; c<collsCount && missing > 0; c++) {
+		// query for only those ids still missing
+		query = bson_new();
+		BSON_APPEND_DOCUMENT_BEGIN(query, idKey, &queryIn);
+		BSON_APPEND_ARRAY_BEGIN(&queryIn, "$in", &queryInArr);
+		for (uint32_t i=0, n=0; i<count; i++) {
+			if (found[lookup[i].index] || (i > 0 && strcmp(lookup[i].id, lookup[i-1].id) == 0)) { continue; }
+			bson_uint32_to_string(n++, &key, keyBuf, sizeof(keyBuf));
+			bson_append_utf8(&queryInArr, key, -1, lookup[i].id, -1);
+		}
+		bson_append_array_end(&queryIn, &queryInArr);
+		bson_append_document_end(query, &queryIn);
+
+		cursor = mongoc_collection_find_with_opts(colls[c], query, opts, NULL);
+		while (mongoc_cursor_next(cursor, &res)) {
+			if ((resStatus = mongoResultToHexData(res, type, hexData, resId, txids ? resTxid : NULL)) == CWG_FETCH_NO) { continue; }
+			else if (resStatus != CW_OK) { status = resStatus; break; }
+
+			// fill every position at this id not yet found
+			resLookup.id = resId;
+			if ((match = bsearch(&resLookup, lookup, count, sizeof(struct MongoIdIndex), &compareMongoIdIndex)) == NULL) { continue; }
+			while (match > lookup && strcmp((match-1)->id, resId) == 0) { --match; }
+			for (; match < lookup+count && strcmp(match->id, resId) == 0; match++) {
+				if (found[match->index]) { continue; }
+				strcpy(hexDatas[match->index], hexData);
+				if (txids) { strcpy(txids[match->index], resTxid); }
+				if (itemInfo) {
+					itemInfo[match->index].hexLen = strlen(hexData);
+					itemInfo[match->index].confirmed = c == 0;
+				}
+				found[match->index] = true;
+				--missing;
+			}
+		}
+		if (mongoc_cursor_error(cursor, &error)) {
+			fprintf(CWG_err_stream, "ERROR: MongoDB query failed\nMessage: %s\n", error.message);
+			status = CWG_FETCH_ERR;
+		}
+		mongoc_cursor_destroy(cursor);
+		bson_destroy(query);
+		if (status != CW_OK) { goto cleanup; }
+	}
+	if (missing > 0) { status = CWG_FETCH_NO; goto cleanup; }
+
+	char *hexDataPtr = hexDataAll;
+	for (int i=0; i<count; i++) {
+		strcpy(hexDataPtr, hexDatas[i]);
+		hexDataPtr += strlen(hexDataPtr);
+	}
+
+	cleanup:
+		bson_destroy(opts);
+		if (hexDatas) { free(hexDatas); }
+		if (lookup) { free(lookup); }
+		if (found) { free(found); }
+		return status;
+}
 
 /*
  * fetches hex data (from MongoDB populated by BitDB) at specified ids and copies (in order) to specified location in memory 
@@ -11,192 +292,499 @@
  * when searching for nametag, count references the nth occurrence to get (as only one nametag can be fetched at a time anyway);
    can be used to skip a nametag claim
  * txids of fetched TXs can be written to txids, or can be set NULL; shouldn't be needed if type is BY_TXID
+ * per-item details can be written to itemInfo, or can be set NULL
  */
-static CW_STATUS fetchHexDataMongoDB(const char **ids, size_t count, FETCH_TYPE type, mongoc_client_t *mongodbCli, char **txids, char *hexDataAll) {
+static CW_STATUS fetchHexDataMongoDB(const char **ids, size_t count, FETCH_TYPE type, mongoc_client_t *mongodbCli, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
 	if (count < 1) { return CWG_FETCH_NO; }
 
-	size_t nth = 1;
-	if (type == BY_NAMETAG) { nth = count; count = 1; }
+	const char *collNames[] = MONGODB_COLLS;
+	mongoc_collection_t *colls[MONGODB_COLLS_COUNT];
+	size_t collsCount = MONGODB_COLLS_COUNT;
+	for (int c=0; c<collsCount; c++) { colls[c] = mongoc_client_get_collection(mongodbCli, MONGODB_DB, collNames[c]); }
+
+	CW_STATUS status;
+	if (type == BY_NAMETAG) { status = fetchHexDataMongoDBNametag(ids[0], count, 1, colls, collsCount, txids, hexDataAll, itemInfo); }
+	else { status = fetchHexDataMongoDBBatch(ids, count, type, colls, collsCount, txids, hexDataAll, itemInfo); }
+
+	for (int c=0; c<collsCount; c++) { mongoc_collection_destroy(colls[c]); }
+	return status;
+}
+
+/*
+ * fetches hex data (from MongoDB populated by BitDB) of the given number of claims of nametag from the nth (see fetchHexDataMongoDBNametag())
+ */
+static CW_STATUS fetchHexDataMongoDBClaims(const char *nametag, size_t nth, size_t claims, mongoc_client_t *mongodbCli, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (claims < 1) { return CWG_FETCH_NO; }
 
+	const char *collNames[] = MONGODB_COLLS;
+	mongoc_collection_t *colls[MONGODB_COLLS_COUNT];
+	size_t collsCount = MONGODB_COLLS_COUNT;
+	for (int c=0; c<collsCount; c++) { colls[c] = mongoc_client_get_collection(mongodbCli, MONGODB_DB, collNames[c]); }
+
+	CW_STATUS status = fetchHexDataMongoDBNametag(nametag, nth, claims, colls, collsCount, txids, hexDataAll, itemInfo);
+
+	for (int c=0; c<collsCount; c++) { mongoc_collection_destroy(colls[c]); }
+	return status;
+}
+
+/*
+ * walks (in MongoDB populated by BitDB) the chain of up to revs revisions following txid with a single $graphLookup over the confirmed collection,
+   which follows each TX to those spending its outputs (by the in.e.h index); the revision at each depth is then picked out as the one whose
+   in[0] spends the revision vout of the last
+ * revisions found are copied in order to hexDataAll, with txids written to txids (if not NULL) and hex data lengths to itemInfo;
+   the walk stops short of a revision that isn't cashweb-formatted, leaving it to be fetched (and found so) on its own
+ * if no confirmed revision follows txid (as when it, or the next revision, is unconfirmed), the next revision is fetched BY_INTXID instead
+ */
+static CW_STATUS fetchHexDataMongoDBRevisions(const char *txid, size_t revs, mongoc_client_t *mongodbCli, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
 	CW_STATUS status = CW_OK;
-	
+
 	hexDataAll[0] = 0;
-	mongoc_collection_t *colls[2] = { mongoc_client_get_collection(mongodbCli, "bitdb", "confirmed"), 
-					  mongoc_client_get_collection(mongodbCli, "bitdb", "unconfirmed") };
-	bson_t *query = NULL;
-	bson_t *opts = NULL;
+	const char *collNames[] = MONGODB_COLLS;
+	mongoc_collection_t *coll = mongoc_client_get_collection(mongodbCli, MONGODB_DB, collNames[0]);
+	bson_t *pipeline = BCON_NEW("pipeline", "[",
+				    "{", "$match", "{", "tx.h", BCON_UTF8(txid), "}", "}",
+				    "{", "$graphLookup", "{",
+				    	"from", BCON_UTF8(collNames[0]),
+				    	"startWith", BCON_UTF8("$tx.h"),
+				    	"connectFromField", BCON_UTF8("tx.h"),
+				    	"connectToField", BCON_UTF8("in.e.h"),
+				    	"as", BCON_UTF8("revs"),
+				    	"maxDepth", BCON_INT64(revs-1),
+				    	"depthField", BCON_UTF8("depth"),
+				    	"restrictSearchWithMatch", "{", "in.0.e.i", BCON_INT32(CW_REVISION_INPUT_VOUT), "}",
+				    "}", "}",
+				    "{", "$project", "{", "_id", BCON_BOOL(false), "revs.out.str", BCON_BOOL(true), "revs.in.e", BCON_BOOL(true),
+				    			  "revs.tx.h", BCON_BOOL(true), "revs.depth", BCON_BOOL(true), "}", "}",
+				    "]");
+
+	mongoc_cursor_t *cursor = mongoc_collection_aggregate(coll, MONGOC_QUERY_NONE, pipeline, NULL, NULL);
+	bson_error_t error;
+	const bson_t *res;
+	bson_iter_t revsArr;
+	bson_iter_t revsIter;
+	bson_iter_t depthIter;
+	uint32_t revLen;
+	const uint8_t *revData;
+	bson_t rev;
+	char prevTxid[CW_TXID_CHARS+1]; prevTxid[0] = 0;
+	strncat(prevTxid, txid, CW_TXID_CHARS);
+	char revId[CW_TXID_CHARS+1];
+	char revTxid[CW_TXID_CHARS+1];
+	char *hexDataPtr = hexDataAll;
+	CW_STATUS revStatus;
+	bool matched;
+	size_t n = 0;
+	if (mongoc_cursor_next(cursor, &res) && bson_iter_init_find(&revsArr, res, "revs") && BSON_ITER_HOLDS_ARRAY(&revsArr)) {
+		// revisions come unordered (and alongside other spends), so the chain is followed depth by depth
+		for (n=0; n<revs; n++) {
+			matched = false;
+			if (!bson_iter_recurse(&revsArr, &revsIter)) { break; }
+			while (!matched && bson_iter_next(&revsIter)) {
+				if (!BSON_ITER_HOLDS_DOCUMENT(&revsIter)) { continue; }
+				bson_iter_document(&revsIter, &revLen, &revData);
+				if (!bson_init_static(&rev, revData, revLen)) { continue; }
+				if (!bson_iter_init_find(&depthIter, &rev, "depth") || bson_iter_as_int64(&depthIter) != (int64_t)n) { continue; }
+
+				revId[0] = 0;
+				if ((revStatus = mongoResultToHexData(&rev, BY_INTXID, hexDataPtr, revId, revTxid)) == CWG_FETCH_NO || strcmp(revId, prevTxid) != 0) { continue; }
+				if (revStatus != CW_OK) { break; }
+				matched = true;
+			}
+			if (!matched) { break; }
+
+			itemInfo[n].hexLen = strlen(hexDataPtr);
+			itemInfo[n].confirmed = true;
+			hexDataPtr += itemInfo[n].hexLen;
+			if (txids) { strcpy(txids[n], revTxid); }
+			strcpy(prevTxid, revTxid);
+		}
+	}
+	*hexDataPtr = 0;
+	if (mongoc_cursor_error(cursor, &error)) {
+		fprintf(CWG_err_stream, "ERROR: MongoDB query failed\nMessage: %s\n", error.message);
+		status = CWG_FETCH_ERR;
+	}
+	mongoc_cursor_destroy(cursor);
+	bson_destroy(pipeline);
+	mongoc_collection_destroy(coll);
+
+	if (status == CW_OK && n < 1) { status = fetchHexDataMongoDB(&txid, 1, BY_INTXID, mongodbCli, txids, hexDataAll, itemInfo); }
+	return status;
+}
+
+/*
+ * parses given MongoDB URI, applying over it the pool/read preference/timeout settings in params (if not NULL), and writes it to uriPtr
+ * must be freed with mongoc_uri_destroy()
+ */
+static CW_STATUS mongoUriNew(const char *mongodbAddr, struct CWG_params *params, mongoc_uri_t **uriPtr) {
+	bson_error_t error;
+	mongoc_uri_t *uri;
+	if (!(uri = mongoc_uri_new_with_error(mongodbAddr, &error))) {
+		fprintf(CWG_err_stream, "ERROR: cashgettools failed to parse provided MongoDB URI: %s\nMessage: %s\n", mongodbAddr, error.message);
+		return CW_CALL_NO;
+	}
+	if (!params) { *uriPtr = uri; return CW_OK; }
+
+	if ((params->mongodbPoolMaxSize > 0 && !mongoc_uri_set_option_as_int32(uri, MONGOC_URI_MAXPOOLSIZE, params->mongodbPoolMaxSize)) ||
+	    (params->mongodbSocketTimeoutMS > 0 && !mongoc_uri_set_option_as_int32(uri, MONGOC_URI_SOCKETTIMEOUTMS, params->mongodbSocketTimeoutMS)) ||
+	    (params->mongodbServerSelectionTimeoutMS > 0 && !mongoc_uri_set_option_as_int32(uri, MONGOC_URI_SERVERSELECTIONTIMEOUTMS, params->mongodbServerSelectionTimeoutMS))) {
+		fprintf(CWG_err_stream, "ERROR: cashgettools failed to set MongoDB pool size/timeouts; check values\n");
+		mongoc_uri_destroy(uri);
+		return CW_CALL_NO;
+	}
+
+	if (params->mongodbReadPref) {
+		const char *modeNames[] = { "primary", "primaryPreferred", "secondary", "secondaryPreferred", "nearest" };
+		const mongoc_read_mode_t modes[] = { MONGOC_READ_PRIMARY, MONGOC_READ_PRIMARY_PREFERRED, MONGOC_READ_SECONDARY, MONGOC_READ_SECONDARY_PREFERRED, MONGOC_READ_NEAREST };
+		int m;
+		for (m=0; m<sizeof(modes)/sizeof(modes[0]) && strcmp(params->mongodbReadPref, modeNames[m]) != 0; m++);
+		if (m >= sizeof(modes)/sizeof(modes[0])) {
+			fprintf(CWG_err_stream, "ERROR: invalid MongoDB read preference %s (must be primary, primaryPreferred, secondary, secondaryPreferred, or nearest)\n", params->mongodbReadPref);
+			mongoc_uri_destroy(uri);
+			return CW_CALL_NO;
+		}
+		mongoc_read_prefs_t *readPrefs = mongoc_read_prefs_new(modes[m]);
+		mongoc_uri_set_read_prefs_t(uri, readPrefs);
+		mongoc_read_prefs_destroy(readPrefs);
+	}
+
+	*uriPtr = uri;
+	return CW_OK;
+}
+
+/*
+ * creates mongoc client (and initializes mongoc environment) for given MongoDB URI, with the settings in params (if not NULL) applied,
+   writing it to cliPtr
+ * on failure, the environment is cleaned up again
+ */
+static CW_STATUS mongoClientNew(const char *mongodbAddr, struct CWG_params *params, mongoc_client_t **cliPtr) {
+	mongoc_init();
+	CW_STATUS status;
+	mongoc_uri_t *uri;
+	if ((status = mongoUriNew(mongodbAddr, params, &uri)) != CW_OK) {
+		mongoc_cleanup();
+		return status;
+	}
+	*cliPtr = mongoc_client_new_from_uri(uri);
+	mongoc_uri_destroy(uri);
+	if (!*cliPtr) {
+		fprintf(CWG_err_stream, "ERROR: cashgettools failed to establish client with MongoDB\n");
+		mongoc_cleanup();
+		return CWG_FETCH_ERR;
+	}
+	mongoc_client_set_error_api(*cliPtr, MONGOC_ERROR_API_VERSION_2);
+	mongoc_client_set_appname(*cliPtr, MONGODB_APPNAME);
+	return CW_OK;
+}
+
+/*
+ * takes a client from the pool in params, blocking until one is free if the pool is exhausted;
+   the wait is tallied to params->mongodbPoolStats (if set)
+ */
+static mongoc_client_t *mongoPoolPop(struct CWG_params *params) {
+	mongoc_client_pool_t *pool = (mongoc_client_pool_t *)params->mongodbCliPool;
+	struct CWG_mongo_pool_stats *stats = params->mongodbPoolStats;
+	if (!stats) { return mongoc_client_pool_pop(pool); }
+
+	__atomic_add_fetch(&stats->pops, 1, __ATOMIC_RELAXED);
+	mongoc_client_t *mongodbCli;
+	if ((mongodbCli = mongoc_client_pool_try_pop(pool))) { return mongodbCli; }
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	mongodbCli = mongoc_client_pool_pop(pool);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	uint64_t waitMicros = (end.tv_sec-start.tv_sec)*1000000 + (end.tv_nsec-start.tv_nsec)/1000;
+
+	__atomic_add_fetch(&stats->waits, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->waitMicros, waitMicros, __ATOMIC_RELAXED);
+	uint64_t maxWaitMicros = __atomic_load_n(&stats->maxWaitMicros, __ATOMIC_RELAXED);
+	while (waitMicros > maxWaitMicros &&
+	       !__atomic_compare_exchange_n(&stats->maxWaitMicros, &maxWaitMicros, waitMicros, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return mongodbCli;
+}
+
+/*
+ * builds key pattern and options (name, and partial filter if any) of the index serving queries of given type:
+   tx.h for BY_TXID, in.e.h for BY_INTXID, and out.s2/blk.i/tx.h (in the query's sort order) for BY_NAMETAG,
+   the latter only over nametag claims so that it stays small
+ * both must be freed with bson_destroy()
+ */
+static void mongoIndexModel(FETCH_TYPE type, bson_t **keysPtr, bson_t **optsPtr) {
 	switch (type) {
 		case BY_TXID:
-			opts = BCON_NEW("projection", "{", "out", BCON_BOOL(true), "_id", BCON_BOOL(false), "}");
+			*keysPtr = BCON_NEW("tx.h", BCON_INT32(1));
+			*optsPtr = BCON_NEW("name", BCON_UTF8("cashweb_tx_h"));
 			break;
 		case BY_INTXID:
-			opts = BCON_NEW("projection", "{", "out", BCON_BOOL(true), "in", BCON_BOOL(true), "tx", BCON_BOOL(true), "_id", BCON_BOOL(false), "}");
-			break;
-		case BY_NAMETAG:
-			opts = BCON_NEW("projection", "{", "out", BCON_BOOL(true), "tx", BCON_BOOL(true), "_id", BCON_BOOL(false), "}",
-					"sort", "{", "blk.i", BCON_INT32(1), "tx.h", BCON_INT32(1), "}",
-					"limit", BCON_INT64(1),
-					"skip", BCON_INT64(nth-1));
+			*keysPtr = BCON_NEW("in.e.h", BCON_INT32(1));
+			*optsPtr = BCON_NEW("name", BCON_UTF8("cashweb_in_e_h"));
 			break;
 		default:
-			fprintf(CWG_err_stream, "invalid FETCH_TYPE; problem with cashgettools\n");
-			goto cleanup;
-	}	
+			*keysPtr = BCON_NEW("out.s2", BCON_INT32(1), "blk.i", BCON_INT32(1), "tx.h", BCON_INT32(1));
+			*optsPtr = BCON_NEW("name", BCON_UTF8("cashweb_nametag"),
+					    "partialFilterExpression", "{", "out.s2", "{", "$gte", BCON_UTF8(CW_NAMETAG_PREFIX), "$lt", BCON_UTF8(MONGODB_NAMETAG_PREFIX_END), "}", "}");
+	}
+}
 
-	mongoc_cursor_t *cursor;
-	bson_error_t error;
-	const bson_t *res;
-	char *resStr;
-	json_t *resJson;
-	char  *jsonDump;
-	json_error_t jsonError;
-	char hexData[CW_TX_DATA_CHARS+1];
-	char *token;
+/*
+ * builds a query of given type for a single id, as made by fetchHexDataMongoDB(), writing filter to queryPtr and options to optsPtr
+ * both must be freed with bson_destroy()
+ */
+static void mongoSampleQuery(FETCH_TYPE type, const char *id, bson_t **queryPtr, bson_t **optsPtr) {
+	if (type == BY_NAMETAG) {
+		*queryPtr = BCON_NEW("out.s2", BCON_UTF8(id));
+		*optsPtr = mongoNametagOpts(1, 1);
+		return;
+	}
+	*queryPtr = BCON_NEW(mongoBatchIdKey(type), "{", "$in", "[", BCON_UTF8(id), "]", "}");
+	*optsPtr = mongoBatchOpts(type);
+}
+
+/*
+ * what a query plan (or any part of it) was found to do
+ */
+struct MongoPlan {
+	bool collScan;
+	bool sort;
+	char indexName[64];
+};
+
+/*
+ * walks (recursively) the stages of a query plan from explain, noting collection scans, in-memory sorts, and the index scanned (if any)
+ */
+static void mongoPlanScan(bson_iter_t *iter, struct MongoPlan *plan) {
+	bson_iter_t child;
 	const char *str;
-	const char *txid;
-	const char *inTxid;
-	int vout;
-	size_t hexPrefixLen = strlen(DATA_STR_PREFIX);
-	bool matched;
-	for (int i=0; i<count; i++) { 
-		matched = false;
-		switch (type) {
-			case BY_TXID:
-				query = BCON_NEW("tx.h", ids[i]);
-				break;
-			case BY_INTXID:
-				query = BCON_NEW("in.e.h", ids[i]);
-				break;
-			case BY_NAMETAG:
-				query = BCON_NEW("out.s2", ids[i]);
-				break;
+	while (bson_iter_next(iter)) {
+		if (BSON_ITER_HOLDS_UTF8(iter)) {
+			str = bson_iter_utf8(iter, NULL);
+			if (strcmp(bson_iter_key(iter), "stage") == 0) {
+				if (strcmp(str, "COLLSCAN") == 0) { plan->collScan = true; }
+				else if (strcmp(str, "SORT") == 0) { plan->sort = true; }
+			}
+			else if (strcmp(bson_iter_key(iter), "indexName") == 0 && !plan->indexName[0]) {
+				snprintf(plan->indexName, sizeof(plan->indexName), "%s", str);
+			}
 		}
-		for (int c=0; c<sizeof(colls)/sizeof(colls[0]); c++) {
-			cursor = mongoc_collection_find_with_opts(colls[c], query, opts, NULL);
-			while (mongoc_cursor_next(cursor, &res)) { 
-				resStr = bson_as_relaxed_extended_json(res, NULL);
-				resJson = json_loads(resStr, JSON_ALLOW_NUL, &jsonError);
-				bson_free(resStr);
-				if (resJson == NULL) {
-					fprintf(CWG_err_stream, "jansson error in parsing result from MongoDB query: %s\nResponse:\n%s\n", jsonError.text, resStr);
-					status = CW_SYS_ERR;
-					break;
-				}
+		else if ((BSON_ITER_HOLDS_DOCUMENT(iter) || BSON_ITER_HOLDS_ARRAY(iter)) && bson_iter_recurse(iter, &child)) { mongoPlanScan(&child, plan); }
+	}
+}
 
-				if (type == BY_INTXID) {
-					// gets json array at key 'out' -> object at array index 0 -> object at key 'e' -> object at key 'i' (.in[0].e.i)
-					vout = json_integer_value(json_object_get(json_object_get(json_array_get(json_object_get(resJson, "in"), 0), "e"), "i"));
-					inTxid = json_string_value(json_object_get(json_object_get(json_array_get(json_object_get(resJson, "in"), 0), "e"), "h"));
-					if (!inTxid) {
-						jsonDump = json_dumps(resJson, 0);
-						json_decref(resJson);
-						fprintf(CWG_err_stream, "invalid response from MongoDB:\n%s\n", jsonDump);
-						free(jsonDump);
-						status = CWG_FETCH_ERR;
-						break;
-					}
-					if (vout != CW_REVISION_INPUT_VOUT || strcmp(inTxid, ids[i]) != 0) { json_decref(resJson); continue; }
+/*
+ * checks with explain that each query cashgettools makes on each collection is served by an index (without an in-memory sort),
+   querying by sampleTxid/sampleNametag (or placeholders if NULL); warns to CWG_err_stream of any that isn't
+ * if runs > 0, each query is also run that many times, and its plan, keys/documents examined, and average latency are reported to reportStream
+ * returns CWG_MONGO_INDEX_NO if any query isn't served by an index
+ */
+static CW_STATUS mongoCheckIndexesCli(mongoc_client_t *mongodbCli, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream) {
+	const char *collNames[] = MONGODB_COLLS;
+	const FETCH_TYPE types[] = { BY_TXID, BY_INTXID, BY_NAMETAG };
+	const char *typeNames[] = { "TXID", "revision", "nametag" };
+	const char *samples[] = { sampleTxid ? sampleTxid : MONGODB_SAMPLE_TXID, sampleTxid ? sampleTxid : MONGODB_SAMPLE_TXID,
+				  sampleNametag ? sampleNametag : MONGODB_SAMPLE_NAMETAG };
+
+	CW_STATUS status = CW_OK;
+	mongoc_collection_t *coll;
+	bson_t *query;
+	bson_t *opts;
+	bson_t *cmd;
+	bson_t cmdFind;
+	bson_t reply;
+	bson_error_t error;
+	bson_iter_t iter;
+	bson_iter_t plan;
+	struct MongoPlan found;
+	int64_t keysExamined;
+	int64_t docsExamined;
+	mongoc_cursor_t *cursor;
+	const bson_t *res;
+	struct timespec start;
+	struct timespec end;
+	double elapsedMs;
+	for (int c=0; c<MONGODB_COLLS_COUNT && status != CWG_FETCH_ERR; c++) {
+		coll = mongoc_client_get_collection(mongodbCli, MONGODB_DB, collNames[c]);
+		for (int t=0; t<sizeof(types)/sizeof(types[0]); t++) {
+			mongoSampleQuery(types[t], samples[t], &query, &opts);
+
+			// a find command (with the query's options as its own fields) wrapped in explain
+			cmd = bson_new();
+			BSON_APPEND_DOCUMENT_BEGIN(cmd, "explain", &cmdFind);
+			BSON_APPEND_UTF8(&cmdFind, "find", collNames[c]);
+			BSON_APPEND_DOCUMENT(&cmdFind, "filter", query);
+			bson_concat(&cmdFind, opts);
+			bson_append_document_end(cmd, &cmdFind);
+			BSON_APPEND_UTF8(cmd, "verbosity", runs > 0 ? "executionStats" : "queryPlanner");
+			if (!mongoc_collection_command_simple(coll, cmd, NULL, &reply, &error)) {
+				fprintf(CWG_err_stream, "ERROR: MongoDB explain failed\nMessage: %s\n", error.message);
+				status = CWG_FETCH_ERR;
+			}
+			else {
+				memset(&found, 0, sizeof(found));
+				if (bson_iter_init(&iter, &reply) && bson_iter_find_descendant(&iter, "queryPlanner.winningPlan", &plan) && bson_iter_recurse(&plan, &iter)) {
+					mongoPlanScan(&iter, &found);
 				}
+				if (found.collScan || (found.sort && types[t] == BY_NAMETAG)) {
+					fprintf(CWG_err_stream, "WARNING: MongoDB queries by %s on %s.%s %s; create indexes with cashweb-mongo-index\n",
+						typeNames[t], MONGODB_DB, collNames[c], found.collScan ? "scan the whole collection" : "sort claims in memory");
+					status = CWG_MONGO_INDEX_NO;
+				}
+
+				if (runs > 0 && reportStream) {
+					keysExamined = docsExamined = -1;
+					if (bson_iter_init(&iter, &reply) && bson_iter_find_descendant(&iter, "executionStats.totalKeysExamined", &plan)) { keysExamined = bson_iter_as_int64(&plan); }
+					if (bson_iter_init(&iter, &reply) && bson_iter_find_descendant(&iter, "executionStats.totalDocsExamined", &plan)) { docsExamined = bson_iter_as_int64(&plan); }
 
-				// gets json array at key 'out' -> object at array index 0 -> object at key 'str' (.out[0].str)
-				str = json_string_value(json_object_get(json_array_get(json_object_get(resJson, "out"), 0), "str"));	
-				if (!str) {
-					jsonDump = json_dumps(resJson, 0);
-					json_decref(resJson);
-					fprintf(CWG_err_stream, "invalid response from MongoDB:\n%s\n", jsonDump);
-					free(jsonDump);
-					status = CWG_FETCH_ERR;
-					break;
-				} 
-				if (strncmp(str, DATA_STR_PREFIX, hexPrefixLen) != 0) { status = CWG_FILE_ERR; json_decref(resJson); break; }
-
-				hexData[0] = 0; strncat(hexData, str+hexPrefixLen, CW_TX_DATA_CHARS);
-				if ((token = strchr(hexData, ' '))) { *token = 0; }
-
-				strncat(hexDataAll, hexData, CW_TX_DATA_CHARS);
-				if (txids) {
-					if (type == BY_TXID) { txid = ids[i]; }
-					else { txid = json_string_value(json_object_get(json_object_get(resJson, "tx"), "h")); }	
-					if (!txid) {
-						jsonDump = json_dumps(resJson, 0);
-						json_decref(resJson);
-						fprintf(CWG_err_stream, "invalid response from MongoDB:\n%s\n", jsonDump);
-						free(jsonDump);
-						status = CWG_FETCH_ERR;
-						break;
+					clock_gettime(CLOCK_MONOTONIC, &start);
+					for (int r=0; r<runs; r++) {
+						cursor = mongoc_collection_find_with_opts(coll, query, opts, NULL);
+						while (mongoc_cursor_next(cursor, &res));
+						if (mongoc_cursor_error(cursor, &error)) { fprintf(CWG_err_stream, "ERROR: MongoDB query failed\nMessage: %s\n", error.message); }
+						mongoc_cursor_destroy(cursor);
 					}
-					txids[i][0] = 0; strncat(txids[i], txid, CW_TXID_CHARS);
+					clock_gettime(CLOCK_MONOTONIC, &end);
+					elapsedMs = ((end.tv_sec-start.tv_sec)*1000.0 + (end.tv_nsec-start.tv_nsec)/1000000.0)/runs;
+
+					fprintf(reportStream, "%s.%-12s by %-9s %-9s %-24s %8"PRId64" keys %8"PRId64" docs %10.3f ms\n",
+						MONGODB_DB, collNames[c], typeNames[t],
+						found.collScan ? "COLLSCAN" : found.indexName[0] ? "IXSCAN" : "none",
+						found.indexName[0] ? found.indexName : "-",
+						keysExamined, docsExamined, elapsedMs);
 				}
-				json_decref(resJson);
-				matched = true;
-				break;
 			}
-			if (mongoc_cursor_error(cursor, &error)) {
-				fprintf(CWG_err_stream, "ERROR: MongoDB query failed\nMessage: %s\n", error.message);
-				status = CWG_FETCH_ERR;
-			} 
-			mongoc_cursor_destroy(cursor);
-			if (status != CW_OK) { break; }
+			bson_destroy(&reply);
+			bson_destroy(cmd);
+			bson_destroy(query);
+			bson_destroy(opts);
+			if (status == CWG_FETCH_ERR) { break; }
 		}
-		bson_destroy(query);
-		if (!matched) { status = status == CW_OK ? CWG_FETCH_NO : status; break; }
+		mongoc_collection_destroy(coll);
 	}
 
-	cleanup:
-		if (opts) { bson_destroy(opts); }
-		for (int c=0; c<sizeof(colls)/sizeof(colls[0]); c++) { mongoc_collection_destroy(colls[c]); }
-		return status;
+	return status;
 }
 
 /*
  * fetched hex data(s) at specified id(s) of specified type; fetch source is determined by params
  * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * per-item details are written to itemInfo if not NULL
  */
-CW_STATUS fetchHexData(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll) {
-	if (params->mongodbCli) { return fetchHexDataMongoDB(ids, count, type, (mongoc_client_t *)params->mongodbCli, txids, hexDataAll); }
-	else if (params->bitdbNode) { return fetchHexDataBitDBNode(ids, count, type, params->bitdbNode, params->requestLimit, txids, hexDataAll); }
-	else if (params->restEndpoint) { return fetchHexDataREST(ids, count, type, params->restEndpoint, params->requestLimit, txids, hexDataAll); }
+static CW_STATUS fetchHexDataSource(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (params->fetcher) { return fetchHexDataFetcher(ids, count, type, params, txids, hexDataAll, itemInfo); }
+	else if (params->mongodbCli) { return fetchHexDataMongoDB(ids, count, type, (mongoc_client_t *)params->mongodbCli, txids, hexDataAll, itemInfo); }
+	else if (params->bitdbNode) { return fetchHexDataBitDBNode(ids, count, type, params->bitdbNode, params, txids, hexDataAll, itemInfo); }
+	else if (params->restEndpoint) { return fetchHexDataREST(ids, count, type, params->restEndpoint, params, txids, hexDataAll, itemInfo); }
+	else if (params->rpcEndpoint) { return fetchHexDataRPC(ids, count, type, params->rpcEndpoint, params, txids, hexDataAll, itemInfo); }
+	else if (params->index) { return CWG_FETCH_NO; } // the index alone, which has already been searched
 	else {
 		fprintf(CWG_err_stream, "ERROR: neither MongoDB nor BitDB HTTP endpoint address is set in cashgettools implementation\n");
 		return CW_CALL_NO;
 	}
 }
 
+/*
+ * fetched hex data(s) at specified id(s) of specified type, bypassing the local index; TXID fetches go through the cache if one is set in params
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * per-item details are written to itemInfo if not NULL
+ */
+static CW_STATUS fetchHexDataUnindexed(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (params->cache && type == BY_TXID) {
+		if (txids) { for (int i=0; i<count; i++) { txids[i][0] = 0; strncat(txids[i], ids[i], CW_TXID_CHARS); } }
+		return fetchHexDataCached(ids, count, params, hexDataAll, itemInfo, &fetchHexDataSource);
+	}
+	return fetchHexDataSource(ids, count, type, params, txids, hexDataAll, itemInfo);
+}
+
+/*
+ * fetched hex data(s) at specified id(s) of specified type; answered from the local index if one is set in params (and holds the TXs),
+   and otherwise through the cache (for TXID fetches) and then the fetch source
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ */
+CW_STATUS fetchHexData(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll) {
+	return fetchHexDataItems(ids, count, type, params, txids, hexDataAll, NULL);
+}
+
+/*
+ * as fetchHexData(), with per-item details written to itemInfo if not NULL
+ */
+CW_STATUS fetchHexDataItems(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (itemInfo) { for (int i=0; i<(type == BY_NAMETAG ? 1 : count); i++) { initFetchItemInfo(&itemInfo[i]); } }
+	if (params->index) { return fetchHexDataIndexed(ids, count, type, params, txids, hexDataAll, itemInfo, &fetchHexDataUnindexed); }
+	return fetchHexDataUnindexed(ids, count, type, params, txids, hexDataAll, itemInfo);
+}
+
+/*
+ * fetches hex data of the given number of claims of nametag from the nth claim, in one query/request if fetching straight from MongoDB or BitDB;
+   otherwise (through the local index or a user fetcher, or from a source that can't look up nametags), only the nth claim is fetched
+ * claims found are written in order to txids/hexDataAll, with the length of each claim's hex data written to itemInfo
+ */
+CW_STATUS fetchHexDataClaims(const char *nametag, size_t nth, size_t claims, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	for (int i=0; i<claims; i++) { initFetchItemInfo(&itemInfo[i]); }
+	if (claims < 1) { return CWG_FETCH_NO; }
+	if (!params->index && !params->fetcher) {
+		if (params->mongodbCli) { return fetchHexDataMongoDBClaims(nametag, nth, claims, (mongoc_client_t *)params->mongodbCli, txids, hexDataAll, itemInfo); }
+		else if (params->bitdbNode) { return fetchHexDataBitDBNodeClaims(nametag, nth, claims, params->bitdbNode, params, txids, hexDataAll, itemInfo); }
+	}
+
+	// otherwise just the nth claim, leaving the caller to come back for the rest if needed
+	CW_STATUS status;
+	txids[0][0] = 0;
+	if ((status = fetchHexData(&nametag, nth, BY_NAMETAG, params, txids, hexDataAll)) == CWG_FILE_ERR) { hexDataAll[0] = 0; status = CW_OK; }
+	if (status == CW_OK) { itemInfo[0].hexLen = strlen(hexDataAll); }
+	return status;
+}
+
+/*
+ * fetches hex data of up to the given number of successive revisions following txid, in one query/request if fetching straight from MongoDB or BitDB;
+   otherwise a revision at a time, as far as revs through the local index (where that is local), and only the next from any other source
+ * revisions found are written in order to txids/hexDataAll, with the length of each revision's hex data written to itemInfo
+ */
+CW_STATUS fetchHexDataRevisions(const char *txid, size_t revs, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	for (int i=0; i<revs; i++) { initFetchItemInfo(&itemInfo[i]); }
+	if (revs < 1) { return CWG_FETCH_NO; }
+	if (!params->index && !params->fetcher) {
+		if (params->mongodbCli) { return fetchHexDataMongoDBRevisions(txid, revs, (mongoc_client_t *)params->mongodbCli, txids, hexDataAll, itemInfo); }
+		else if (params->bitdbNode) { return fetchHexDataBitDBNodeRevisions(txid, revs, params->bitdbNode, params, txids, hexDataAll, itemInfo); }
+	}
+
+	CW_STATUS status = CW_OK;
+	const char *prevTxid = txid;
+	char *hexDataPtr = hexDataAll;
+	size_t n;
+	for (n=0; n<(params->index ? revs : 1); n++) {
+		if ((status = fetchHexData(&prevTxid, 1, BY_INTXID, params, txids+n, hexDataPtr)) != CW_OK) { break; }
+		itemInfo[n].hexLen = strlen(hexDataPtr);
+		hexDataPtr += itemInfo[n].hexLen;
+		prevTxid = txids[n];
+	}
+	*hexDataPtr = 0;
+
+	// a failure further along is left to be found again when fetching from the last revision found
+	return n > 0 ? CW_OK : status;
+}
+
 /*
  * initializes for fetcher depending on params
  * should only be called from public functions that will get
  */
 CW_STATUS initFetcher(struct CWG_params *params) {
-	if (params->mongodb || params->mongodbCli || params->mongodbCliPool) {
+	if (params->fetcher) { return initFetcherUser(params); }
+	else if (params->mongodb || params->mongodbCli || params->mongodbCliPool) {
 		if (params->mongodbCliPool) {
-			params->mongodbCli = mongoc_client_pool_pop((mongoc_client_pool_t *)params->mongodbCliPool);
+			params->mongodbCli = mongoPoolPop(params);
 		}
 		else if (!params->mongodbCli) { 
-			mongoc_init();
-			bson_error_t error;	
-			mongoc_uri_t *uri;
-			if (!(uri = mongoc_uri_new_with_error(params->mongodb, &error))) {
-				fprintf(CWG_err_stream, "ERROR: cashgettools failed to parse provided MongoDB URI: %s\nMessage: %s\n", params->mongodb, error.message);
-				mongoc_cleanup();
-				return CW_CALL_NO;
-			}
-			params->mongodbCli = (void *)mongoc_client_new_from_uri(uri);	
-			mongoc_uri_destroy(uri);	
-			if (!params->mongodbCli) {
-				fprintf(CWG_err_stream, "ERROR: cashgettools failed to establish client with MongoDB\n");
-				mongoc_cleanup();
-				return CWG_FETCH_ERR;
-			}
-			mongoc_client_set_error_api((mongoc_client_t *)params->mongodbCli, MONGOC_ERROR_API_VERSION_2);
-			mongoc_client_set_appname((mongoc_client_t *)params->mongodbCli, MONGODB_APPNAME);
+			CW_STATUS status;
+			if ((status = mongoClientNew(params->mongodb, params, (mongoc_client_t **)&params->mongodbCli)) != CW_OK) { return status; }
 		}	
 	} 
-	else if (params->bitdbNode || params->restEndpoint) {
-		curl_global_init(CURL_GLOBAL_DEFAULT);
+	else if (params->bitdbNode || params->restEndpoint || params->rpcEndpoint) {
+		if (!params->httpPool) { curl_global_init(CURL_GLOBAL_DEFAULT); }
 		if (params->requestLimit) { srandom(time(NULL)); }
 	}	
-	else {
-		fprintf(CWG_err_stream, "ERROR: cashgettools requires either MongoDB or BitDB Node address to be specified\n");
+	else if (!params->index) {
+		fprintf(CWG_err_stream, "ERROR: cashgettools requires either a fetcher, MongoDB, a local index, or an HTTP endpoint (BitDB, REST, or RPC) to be specified\n");
 		return CW_CALL_NO;
 	}
 
@@ -208,7 +796,8 @@ CW_STATUS initFetcher(struct CWG_params *params) {
  * should only be called from public functions that have called initFetcher()
  */
 void cleanupFetcher(struct CWG_params *params) {
-	if (params->mongodbCli) {
+	if (params->fetcher) { cleanupFetcherUser(params); }
+	else if (params->mongodbCli) {
 		if (params->mongodbCliPool) {
 			mongoc_client_pool_push((mongoc_client_pool_t *)params->mongodbCliPool, (mongoc_client_t *)params->mongodbCli);
 		}
@@ -218,7 +807,7 @@ void cleanupFetcher(struct CWG_params *params) {
 			mongoc_cleanup();
 		}
 	}
-	else if (params->bitdbNode) { curl_global_cleanup(); }
+	else if ((params->bitdbNode || params->restEndpoint || params->rpcEndpoint) && !params->httpPool) { curl_global_cleanup(); }
 }
 
 /*
@@ -229,12 +818,11 @@ void cleanupFetcher(struct CWG_params *params) {
 CW_STATUS initMongoPool(const char *mongodbAddr, struct CWG_params *params) {
 	mongoc_init();
 
-	bson_error_t error;  
-	mongoc_uri_t *uri = mongoc_uri_new_with_error(mongodbAddr, &error);
-	if (!uri) {
-		fprintf(CWG_err_stream, "ERROR: cashgettools failed to parse provided MongoDB URI: %s\nMessage: %s\n", params->mongodb, error.message);
+	CW_STATUS status;
+	mongoc_uri_t *uri;
+	if ((status = mongoUriNew(mongodbAddr, params, &uri)) != CW_OK) {
 		mongoc_cleanup();
-		return CW_CALL_NO;
+		return status;
 	}
 
 	params->mongodbCliPool = (void *)mongoc_client_pool_new(uri);
@@ -247,6 +835,13 @@ CW_STATUS initMongoPool(const char *mongodbAddr, struct CWG_params *params) {
 	mongoc_client_pool_set_error_api((mongoc_client_pool_t *)params->mongodbCliPool, MONGOC_ERROR_API_VERSION_2);
 	mongoc_client_pool_set_appname((mongoc_client_pool_t *)params->mongodbCliPool, MONGODB_APPNAME);
 
+	// only warns, as queries are still answered (if slowly) without the indexes
+	if (params->mongodbIndexCheck) {
+		mongoc_client_t *mongodbCli = mongoc_client_pool_pop((mongoc_client_pool_t *)params->mongodbCliPool);
+		mongoCheckIndexesCli(mongodbCli, NULL, NULL, 0, NULL);
+		mongoc_client_pool_push((mongoc_client_pool_t *)params->mongodbCliPool, mongodbCli);
+	}
+
 	return CW_OK;
 }
 
@@ -259,3 +854,111 @@ void cleanupMongoPool(struct CWG_params *params) {
 	params->mongodbCliPool = NULL;
 	mongoc_cleanup();
 }
+
+/*
+ * creates (where not already present) the indexes on BitDB's collections that cashgettools' MongoDB queries rely on,
+   reporting each to reportStream (if not NULL)
+ */
+CW_STATUS createMongoIndexes(const char *mongodbAddr, FILE *reportStream) {
+	mongoc_client_t *mongodbCli;
+	CW_STATUS status;
+	if ((status = mongoClientNew(mongodbAddr, NULL, &mongodbCli)) != CW_OK) { return status; }
+
+	const char *collNames[] = MONGODB_COLLS;
+	const FETCH_TYPE types[] = { BY_TXID, BY_INTXID, BY_NAMETAG };
+	mongoc_collection_t *coll;
+	bson_t *keys;
+	bson_t *opts;
+	bson_t *cmd;
+	bson_t cmdIndexes;
+	bson_t cmdIndex;
+	bson_t reply;
+	bson_error_t error;
+	bson_iter_t iter;
+	bson_iter_t iterAfter;
+	const char *name;
+	bool created;
+	for (int c=0; c<MONGODB_COLLS_COUNT && status == CW_OK; c++) {
+		coll = mongoc_client_get_collection(mongodbCli, MONGODB_DB, collNames[c]);
+		for (int t=0; t<sizeof(types)/sizeof(types[0]); t++) {
+			mongoIndexModel(types[t], &keys, &opts);
+			name = bson_iter_init_find(&iter, opts, "name") ? bson_iter_utf8(&iter, NULL) : "";
+
+			cmd = bson_new();
+			BSON_APPEND_UTF8(cmd, "createIndexes", collNames[c]);
+			BSON_APPEND_ARRAY_BEGIN(cmd, "indexes", &cmdIndexes);
+			BSON_APPEND_DOCUMENT_BEGIN(&cmdIndexes, "0", &cmdIndex);
+			BSON_APPEND_DOCUMENT(&cmdIndex, "key", keys);
+			bson_concat(&cmdIndex, opts);
+			bson_append_document_end(&cmdIndexes, &cmdIndex);
+			bson_append_array_end(cmd, &cmdIndexes);
+
+			// an equivalent index under another name (as BitDB may have made itself) conflicts, but serves as well
+			if (mongoc_collection_command_simple(coll, cmd, NULL, &reply, &error)) {
+				created = !(bson_iter_init_find(&iter, &reply, "numIndexesBefore") && bson_iter_init_find(&iterAfter, &reply, "numIndexesAfter") &&
+					    bson_iter_as_int64(&iter) == bson_iter_as_int64(&iterAfter));
+				if (reportStream) { fprintf(reportStream, "%s.%s: %s %s\n", MONGODB_DB, collNames[c], name, created ? "created" : "already present"); }
+			}
+			else if (error.code == MONGODB_INDEX_OPTIONS_CONFLICT || error.code == MONGODB_INDEX_KEY_SPECS_CONFLICT) {
+				if (reportStream) { fprintf(reportStream, "%s.%s: %s already present (as another index)\n", MONGODB_DB, collNames[c], name); }
+			}
+			else {
+				fprintf(CWG_err_stream, "ERROR: MongoDB failed to create index %s on %s.%s\nMessage: %s\n", name, MONGODB_DB, collNames[c], error.message);
+				status = CWG_FETCH_ERR;
+			}
+
+			bson_destroy(&reply);
+			bson_destroy(cmd);
+			bson_destroy(keys);
+			bson_destroy(opts);
+			if (status != CW_OK) { break; }
+		}
+		mongoc_collection_destroy(coll);
+	}
+
+	mongoc_client_destroy(mongodbCli);
+	mongoc_cleanup();
+	return status;
+}
+
+/*
+ * checks that cashgettools' MongoDB queries are served by indexes, querying by sampleTxid/sampleNametag (or placeholders if NULL);
+   each query's plan, keys/documents examined, and latency averaged over given number of runs are reported to reportStream (if not NULL)
+ * returns CWG_MONGO_INDEX_NO if any query isn't served by an index
+ */
+CW_STATUS checkMongoIndexes(const char *mongodbAddr, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream) {
+	mongoc_client_t *mongodbCli;
+	CW_STATUS status;
+	if ((status = mongoClientNew(mongodbAddr, NULL, &mongodbCli)) != CW_OK) { return status; }
+
+	status = mongoCheckIndexesCli(mongodbCli, sampleTxid, sampleNametag, reportStream ? (runs > 0 ? runs : 1) : 0, reportStream);
+
+	mongoc_client_destroy(mongodbCli);
+	mongoc_cleanup();
+	return status;
+}
+
+/*
+ * initializes curl environment and HTTP connection pool for keeping connections warm across gets/threads
+ * will set params->httpPool on success
+ * must call CWG_cleanup_http_pool later on
+ */
+CW_STATUS initHttpPool(struct CWG_params *params) {
+	return httpPoolNew((struct HttpPool **)&params->httpPool);
+}
+
+/*
+ * cleans up HTTP connection pool (stored in params) and curl environment;
+ * params->httpPool will be set NULL
+ */
+void cleanupHttpPool(struct CWG_params *params) {
+	if (params->httpPool) { httpPoolDestroy((struct HttpPool *)params->httpPool); }
+	params->httpPool = NULL;
+}
+
+/*
+ * builds/updates local index at indexPath from blocks fetched over params->rpcEndpoint
+ */
+CW_STATUS updateIndexRPC(const char *indexPath, struct CWG_params *params) {
+	return rpcIndexUpdate(indexPath, params);
+}
@@ -9,17 +9,66 @@
 
 /* Fetch typing */
 typedef enum FetchType {
-        BY_TXID,
-        BY_INTXID,
-        BY_NAMETAG
+        BY_TXID = CWG_FETCH_BY_TXID,
+        BY_INTXID = CWG_FETCH_BY_INTXID,
+        BY_NAMETAG = CWG_FETCH_BY_NAMETAG
 } FETCH_TYPE;
 
+/*
+ * per-item details that a fetch source may report alongside hex data
+ * hexLen: length of the item's hex data within hexDataAll (FETCH_ITEM_LEN_UNKNOWN if not reported)
+ * confirmed: whether the TX was found confirmed, rather than only in mempool
+ */
+#define FETCH_ITEM_LEN_UNKNOWN SIZE_MAX
+struct FetchItemInfo {
+	size_t hexLen;
+	bool confirmed;
+};
+
+/*
+ * initializes struct FetchItemInfo
+ */
+static inline void initFetchItemInfo(struct FetchItemInfo *info) {
+	info->hexLen = FETCH_ITEM_LEN_UNKNOWN;
+	info->confirmed = false;
+}
+
 /*
  * fetched hex data(s) at specified id(s) of specified type; fetch source is determined by implementation
  * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
  */
 CW_STATUS fetchHexData(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll);
 
+/*
+ * as fetchHexData(), with the length of each TX's hex data and whether it is confirmed written to itemInfo if not NULL
+   (which must have room for count, or 1 if BY_NAMETAG), as far as the fetch source reports them
+ */
+CW_STATUS fetchHexDataItems(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo);
+
+/*
+ * fetches hex data of the given number of claims of nametag (prefix included) from the nth claim, ordered as with fetching BY_NAMETAG,
+   in one round trip where the fetch source allows (one query per MongoDB collection, or one BitDB request); otherwise, only the nth claim
+   is fetched, so fewer claims may be found than there are
+ * claims found are written in order, txids to txids (which must have room for claims) and hex datas to hexDataAll
+   (which must have room for claims*CW_TX_DATA_CHARS+1), with the length of each claim's hex data written to itemInfo (which must have room for claims)
+ * a claim that isn't cashweb-formatted is written as zero-length hex data, and claims beyond the last found are left with length FETCH_ITEM_LEN_UNKNOWN
+ * returns CWG_FETCH_NO if no claim is found
+ */
+CW_STATUS fetchHexDataClaims(const char *nametag, size_t nth, size_t claims, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo);
+
+/*
+ * fetches hex data of up to the given number of successive revisions following txid (the TX spending its revision vout, then the TX spending
+   that one's, and so on), following the chain at the fetch source where it can (in one query to MongoDB); through the local index, the chain is
+   followed a fetch at a time (each answered locally where the index holds the TXs), and from other sources, only the next revision is fetched
+ * revisions found are written in order, txids to txids (which must have room for revs) and hex datas to hexDataAll
+   (which must have room for revs*CW_TX_DATA_CHARS+1), with the length of each revision's hex data written to itemInfo (which must have room for revs);
+   those beyond the last found are left with length FETCH_ITEM_LEN_UNKNOWN
+ * the chain may be cut short of what exists (e.g. where a revision isn't cashweb-formatted, or is unconfirmed), so the caller should
+   come back for more from the last revision found
+ * returns CWG_FETCH_NO if no revision follows txid
+ */
+CW_STATUS fetchHexDataRevisions(const char *txid, size_t revs, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo);
+
 /*
  * initializes for fetcher depending on implementation
  * should only be called from public functions that will get
@@ -44,4 +93,34 @@ CW_STATUS initMongoPool(const char *mongodbAddr, struct CWG_params *params);
  */
 void cleanupMongoPool(struct CWG_params *params);
 
+/*
+ * creates indexes on BitDB's MongoDB collections that cashgettools' queries rely on if implementation supports MongoDB;
+   otherwise, will return CW_CALL_NO
+ */
+CW_STATUS createMongoIndexes(const char *mongodbAddr, FILE *reportStream);
+
+/*
+ * checks that cashgettools' MongoDB queries are served by indexes if implementation supports MongoDB;
+   otherwise, will return CW_CALL_NO
+ */
+CW_STATUS checkMongoIndexes(const char *mongodbAddr, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream);
+
+/*
+ * initializes HTTP connection pool (used for keeping connections alive across gets and threads) if implementation supports it;
+   otherwise, will return CW_CALL_NO
+ */
+CW_STATUS initHttpPool(struct CWG_params *params);
+
+/*
+ * cleans up HTTP connection pool if implementation supports it;
+   otherwise, does nothing
+ */
+void cleanupHttpPool(struct CWG_params *params);
+
+/*
+ * builds/updates local index at indexPath from blocks fetched over params->rpcEndpoint if implementation supports it;
+   otherwise, will return CW_CALL_NO
+ */
+CW_STATUS updateIndexRPC(const char *indexPath, struct CWG_params *params);
+
 #endif
@@ -1,31 +1,118 @@
 #include "cashfetchutils.h"
 #include "cashfetchhttputils.h"
+#include "cashcacheutils.h"
+#include "cashindexutils.h"
+#include "cashfetcherutils.h"
 #include "cashwebutils.h"
 
 /*
  * fetched hex data(s) at specified id(s) of specified type; fetch source is determined by params
  * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * per-item details are written to itemInfo if not NULL
  */
-CW_STATUS fetchHexData(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll) {
-	if (params->bitdbNode) { return fetchHexDataBitDBNode(ids, count, type, params->bitdbNode, params->requestLimit, txids, hexDataAll); }
-	else if (params->restEndpoint) { return fetchHexDataREST(ids, count, type, params->restEndpoint, params->requestLimit, txids, hexDataAll); }
+static CW_STATUS fetchHexDataSource(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (params->fetcher) { return fetchHexDataFetcher(ids, count, type, params, txids, hexDataAll, itemInfo); }
+	else if (params->bitdbNode) { return fetchHexDataBitDBNode(ids, count, type, params->bitdbNode, params, txids, hexDataAll, itemInfo); }
+	else if (params->restEndpoint) { return fetchHexDataREST(ids, count, type, params->restEndpoint, params, txids, hexDataAll, itemInfo); }
+	else if (params->rpcEndpoint) { return fetchHexDataRPC(ids, count, type, params->rpcEndpoint, params, txids, hexDataAll, itemInfo); }
+	else if (params->index) { return CWG_FETCH_NO; } // the index alone, which has already been searched
 	else {
 		fprintf(CWG_err_stream, "ERROR: BitDB HTTP endpoint address is set in cashgettools implementation\n");
 		return CW_CALL_NO;
 	}
 }
 
+/*
+ * fetched hex data(s) at specified id(s) of specified type, bypassing the local index; TXID fetches go through the cache if one is set in params
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * per-item details are written to itemInfo if not NULL
+ */
+static CW_STATUS fetchHexDataUnindexed(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (params->cache && type == BY_TXID) {
+		if (txids) { for (int i=0; i<count; i++) { txids[i][0] = 0; strncat(txids[i], ids[i], CW_TXID_CHARS); } }
+		return fetchHexDataCached(ids, count, params, hexDataAll, itemInfo, &fetchHexDataSource);
+	}
+	return fetchHexDataSource(ids, count, type, params, txids, hexDataAll, itemInfo);
+}
+
+/*
+ * fetched hex data(s) at specified id(s) of specified type; answered from the local index if one is set in params (and holds the TXs),
+   and otherwise through the cache (for TXID fetches) and then the fetch source
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ */
+CW_STATUS fetchHexData(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll) {
+	return fetchHexDataItems(ids, count, type, params, txids, hexDataAll, NULL);
+}
+
+/*
+ * as fetchHexData(), with per-item details written to itemInfo if not NULL
+ */
+CW_STATUS fetchHexDataItems(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (itemInfo) { for (int i=0; i<(type == BY_NAMETAG ? 1 : count); i++) { initFetchItemInfo(&itemInfo[i]); } }
+	if (params->index) { return fetchHexDataIndexed(ids, count, type, params, txids, hexDataAll, itemInfo, &fetchHexDataUnindexed); }
+	return fetchHexDataUnindexed(ids, count, type, params, txids, hexDataAll, itemInfo);
+}
+
+/*
+ * fetches hex data of the given number of claims of nametag from the nth claim, in one query/request if fetching straight from BitDB;
+   otherwise (through the local index or a user fetcher, or from a source that can't look up nametags), only the nth claim is fetched
+ * claims found are written in order to txids/hexDataAll, with the length of each claim's hex data written to itemInfo
+ */
+CW_STATUS fetchHexDataClaims(const char *nametag, size_t nth, size_t claims, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	for (int i=0; i<claims; i++) { initFetchItemInfo(&itemInfo[i]); }
+	if (claims < 1) { return CWG_FETCH_NO; }
+	if (!params->index && !params->fetcher) {
+		if (params->bitdbNode) { return fetchHexDataBitDBNodeClaims(nametag, nth, claims, params->bitdbNode, params, txids, hexDataAll, itemInfo); }
+	}
+
+	// otherwise just the nth claim, leaving the caller to come back for the rest if needed
+	CW_STATUS status;
+	txids[0][0] = 0;
+	if ((status = fetchHexData(&nametag, nth, BY_NAMETAG, params, txids, hexDataAll)) == CWG_FILE_ERR) { hexDataAll[0] = 0; status = CW_OK; }
+	if (status == CW_OK) { itemInfo[0].hexLen = strlen(hexDataAll); }
+	return status;
+}
+
+/*
+ * fetches hex data of up to the given number of successive revisions following txid, in one request if fetching straight from BitDB;
+   otherwise a revision at a time, as far as revs through the local index (where that is local), and only the next from any other source
+ * revisions found are written in order to txids/hexDataAll, with the length of each revision's hex data written to itemInfo
+ */
+CW_STATUS fetchHexDataRevisions(const char *txid, size_t revs, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	for (int i=0; i<revs; i++) { initFetchItemInfo(&itemInfo[i]); }
+	if (revs < 1) { return CWG_FETCH_NO; }
+	if (!params->index && !params->fetcher && params->bitdbNode) {
+		return fetchHexDataBitDBNodeRevisions(txid, revs, params->bitdbNode, params, txids, hexDataAll, itemInfo);
+	}
+
+	CW_STATUS status = CW_OK;
+	const char *prevTxid = txid;
+	char *hexDataPtr = hexDataAll;
+	size_t n;
+	for (n=0; n<(params->index ? revs : 1); n++) {
+		if ((status = fetchHexData(&prevTxid, 1, BY_INTXID, params, txids+n, hexDataPtr)) != CW_OK) { break; }
+		itemInfo[n].hexLen = strlen(hexDataPtr);
+		hexDataPtr += itemInfo[n].hexLen;
+		prevTxid = txids[n];
+	}
+	*hexDataPtr = 0;
+
+	// a failure further along is left to be found again when fetching from the last revision found
+	return n > 0 ? CW_OK : status;
+}
+
 /*
  * initializes for fetcher depending on params
  * should only be called from public functions that will get
  */
 CW_STATUS initFetcher(struct CWG_params *params) {
-	if (params->bitdbNode || params->restEndpoint) {
-		curl_global_init(CURL_GLOBAL_DEFAULT);
+	if (params->fetcher) { return initFetcherUser(params); }
+	else if (params->bitdbNode || params->restEndpoint || params->rpcEndpoint) {
+		if (!params->httpPool) { curl_global_init(CURL_GLOBAL_DEFAULT); }
 		if (params->requestLimit) { srandom(time(NULL)); }
 	}	
-	else {
-		fprintf(CWG_err_stream, "ERROR: cashgettools requires an HTTP endpoint to be specified (either BitDB or REST)\n");
+	else if (!params->index) {
+		fprintf(CWG_err_stream, "ERROR: cashgettools requires either a fetcher, a local index, or an HTTP endpoint (BitDB, REST, or RPC) to be specified\n");
 		return CW_CALL_NO;
 	}
 
@@ -37,7 +124,8 @@ CW_STATUS initFetcher(struct CWG_params *params) {
  * should only be called from public functions that have called initFetcher()
  */
 void cleanupFetcher(struct CWG_params *params) {
-	if (params->bitdbNode) { curl_global_cleanup(); }
+	if (params->fetcher) { cleanupFetcherUser(params); }
+	else if ((params->bitdbNode || params->restEndpoint || params->rpcEndpoint) && !params->httpPool) { curl_global_cleanup(); }
 }
 
 /*
@@ -56,3 +144,47 @@ CW_STATUS initMongoPool(const char *mongodbAddr, struct CWG_params *params) {
 void cleanupMongoPool(struct CWG_params *params) {
 	// does nothing
 }
+
+/*
+ * creates (where not already present) the indexes on BitDB's collections that cashgettools' MongoDB queries rely on,
+   reporting each to reportStream (if not NULL)
+ */
+CW_STATUS createMongoIndexes(const char *mongodbAddr, FILE *reportStream) {
+	fprintf(CWG_err_stream, "ERROR: cashgettools is built without MongoDB support\n");
+	return CW_CALL_NO;
+}
+
+/*
+ * checks that cashgettools' MongoDB queries are served by indexes, querying by sampleTxid/sampleNametag (or placeholders if NULL);
+   each query's plan, keys/documents examined, and latency averaged over given number of runs are reported to reportStream (if not NULL)
+ * returns CWG_MONGO_INDEX_NO if any query isn't served by an index
+ */
+CW_STATUS checkMongoIndexes(const char *mongodbAddr, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream) {
+	fprintf(CWG_err_stream, "ERROR: cashgettools is built without MongoDB support\n");
+	return CW_CALL_NO;
+}
+
+/*
+ * initializes curl environment and HTTP connection pool for keeping connections warm across gets/threads
+ * will set params->httpPool on success
+ * must call CWG_cleanup_http_pool later on
+ */
+CW_STATUS initHttpPool(struct CWG_params *params) {
+	return httpPoolNew((struct HttpPool **)&params->httpPool);
+}
+
+/*
+ * cleans up HTTP connection pool (stored in params) and curl environment;
+ * params->httpPool will be set NULL
+ */
+void cleanupHttpPool(struct CWG_params *params) {
+	if (params->httpPool) { httpPoolDestroy((struct HttpPool *)params->httpPool); }
+	params->httpPool = NULL;
+}
+
+/*
+ * builds/updates local index at indexPath from blocks fetched over params->rpcEndpoint
+ */
+CW_STATUS updateIndexRPC(const char *indexPath, struct CWG_params *params) {
+	return rpcIndexUpdate(indexPath, params);
+}
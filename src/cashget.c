@@ -9,14 +9,27 @@
 	" Flag    | Use\n"\
 	"---------|-------------------------------------------------------------------------------------------------------------------------\n"\
 	"[none]   | get file at valid CashWeb ID <toget> and write to stdout\n"\
-	"-b <ARG> | specify BitDB HTTP endpoint URL for querying (default is "BITDB_DEFAULT")\n"\
-	"-r <ARG> | specify REST HTTP endpoint URL for querying\n"\
+	"-b <ARG> | specify BitDB HTTP endpoint URL for querying (default is "BITDB_DEFAULT"); may be a whitespace-separated list of equivalent URLs\n"\
+	"-r <ARG> | specify REST HTTP endpoint URL for querying; may be a whitespace-separated list of equivalent URLs\n"\
+	"-R <ARG> | specify bitcoind JSON-RPC URL for querying (node must have txindex); may be a whitespace-separated list of equivalent URLs\n"\
+	"-A <ARG> | specify credentials for bitcoind JSON-RPC as <user>:<password>\n"\
 	"-m <ARG> | specify MongoDB URI for querying\n"\
 	"-l       | query MongoDB running locally (equivalent to -m "MONGODB_LOCAL_ADDR")\n"\
 	"-d <ARG> | specify location of valid cashwebtools data directory (default is install directory)\n"\
+	"-L <ARG> | limit HTTP requests to <rate>[:<burst>] per second per endpoint (queued when over)\n"\
+	"-I <ARG> | specify local index file (built/updated by cashindex) or bundle (exported by -E) to get from without querying; TXs it lacks are queried as usual\n"\
+	"-U       | build/update local index specified by -I from blocks fetched over bitcoind JSON-RPC (-R), then exit; <toget> is not needed\n"\
+	"-E <ARG> | export everything needed to get <toget> (its whole directory tree, if a directory) to bundle file at location <ARG>, then exit\n"\
+	"-C <ARG> | specify directory for on-disk TXID cache, so that fetched data (and learned endpoint batch sizes) are kept locally for later gets\n"\
+	"-W <ARG> | record every fetch made (and how long it took) to fetch record file at location <ARG> (appended to, if it exists)\n"\
+	"-Y <ARG> | replay fetches from fetch record file at location <ARG> (recorded by -W) instead of querying; unrecorded fetches fail\n"\
+	"-K <ARG> | delay each replayed fetch by <ARG> ms (default is the latency recorded for it)\n"\
+	"-S       | report HTTP transfer stats (requests, bytes on the wire vs. decoded) to stderr when done\n"\
 	"-J       | convert valid CashWeb directory index locally stored at location <toget> to readable JSON format and write to stdout\n"\
 	"-D       | get CashWeb directory index at valid CashWeb ID <toget>, convert to readable JSON format, and write to stdout\n"\
-	"-i       | get info on CashWeb file or nametag by appropriate CashWeb ID <toget>\n"
+	"-i       | get info on CashWeb file or nametag by appropriate CashWeb ID <toget>\n"\
+	"-M       | get manifest of CashWeb file at TXID <toget> without getting its data: its exact size, and the TXID and byte count of each leaf TX\n"\
+	"-o <ARG> | get only bytes of file at TXID <toget> from offset as <offset>[:<length>], fetching only the TXs covering them (default is through end)\n"
 
 #define BITDB_DEFAULT "https://bitdb.bitcoin.com/q"
 #define MONGODB_LOCAL_ADDR "mongodb://localhost:27017"
@@ -26,11 +39,28 @@ int main(int argc, char **argv) {
 	init_CWG_params(&params, NULL, BITDB_DEFAULT, NULL, NULL);
 
 	bool getInfo = false;
+	bool getManifest = false;
+	bool getRange = false;
+	size_t rangeOffset = 0;
+	size_t rangeLength = SIZE_MAX;
+	char *rangeLengthStr;
 	bool getDirIndex = false;
 	bool getDirIndexLocal = false;
+	char *cacheDir = NULL;
+	char *indexPath = NULL;
+	bool updateIndex = false;
+	char *exportPath = NULL;
+	char *recordPath = NULL;
+	char *replayPath = NULL;
+	int replayLatencyMs = CWG_REPLAY_LATENCY_RECORDED;
+	double rateLimit = 0;
+	double rateBurst = 0;
+	char *rateBurstStr;
+	struct CWG_transfer_stats transferStats;
+	init_CWG_transfer_stats(&transferStats);
 
 	int c;
-	while ((c = getopt(argc, argv, ":hb:r:m:ldJDi")) != -1) {
+	while ((c = getopt(argc, argv, ":hb:r:R:A:m:ldL:I:UE:C:W:Y:K:SJDiMo:")) != -1) {
 		switch (c) {			
 			case 'h':
 				fprintf(stderr, HELP_STR, argv[0]);
@@ -42,6 +72,13 @@ int main(int argc, char **argv) {
 				params.bitdbNode = NULL;
 				params.restEndpoint = optarg;
 				break;
+			case 'R':
+				params.bitdbNode = NULL;
+				params.rpcEndpoint = optarg;
+				break;
+			case 'A':
+				params.rpcAuth = optarg;
+				break;
 			case 'm':
 				params.mongodb = optarg;
 				break;
@@ -51,6 +88,34 @@ int main(int argc, char **argv) {
 			case 'd':
 				params.datadir = optarg;
 				break;
+			case 'L':
+				rateLimit = strtod(optarg, &rateBurstStr);
+				rateBurst = *rateBurstStr == ':' ? strtod(rateBurstStr+1, NULL) : 0;
+				break;
+			case 'I':
+				indexPath = optarg;
+				break;
+			case 'U':
+				updateIndex = true;
+				break;
+			case 'E':
+				exportPath = optarg;
+				break;
+			case 'C':
+				cacheDir = optarg;
+				break;
+			case 'W':
+				recordPath = optarg;
+				break;
+			case 'Y':
+				replayPath = optarg;
+				break;
+			case 'K':
+				replayLatencyMs = atoi(optarg);
+				break;
+			case 'S':
+				params.transferStats = &transferStats;
+				break;
 			case 'J':
 				getDirIndexLocal = true;
 				break;
@@ -60,6 +125,14 @@ int main(int argc, char **argv) {
 			case 'i':
 				getInfo = true;	
 				break;	
+			case 'M':
+				getManifest = true;
+				break;
+			case 'o':
+				getRange = true;
+				rangeOffset = strtoull(optarg, &rangeLengthStr, 10);
+				rangeLength = *rangeLengthStr == ':' ? strtoull(rangeLengthStr+1, NULL, 10) : SIZE_MAX;
+				break;
 			case ':':
 				fprintf(stderr, "Option -%c requires an argument.\n", optopt);
 				exit(1);
@@ -76,6 +149,19 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if (updateIndex) {
+		if (!indexPath) {
+			fprintf(stderr, "Updating index requires its location to be specified with -I.\n");
+			exit(1);
+		}
+		CW_STATUS status = CWG_update_index(indexPath, &params);
+		if (status != CW_OK) {
+			fprintf(stderr, "\nIndex update failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
+			exit(1);
+		}
+		return 0;
+	}
+
 	if (argc <= optind) {
 		fprintf(stderr, USAGE_STR"\n-h for help\n", argv[0]);
 		exit(1);
@@ -83,9 +169,55 @@ int main(int argc, char **argv) {
 
 	char *toget = argv[optind];	
 
+	// keeps connections warm across the many fetches of a single get
+	if (!params.mongodb) { CWG_init_http_pool(&params); }
+	if (!params.mongodb && rateLimit > 0 && CWG_init_rate_limiter(rateLimit, rateBurst, &params) != CW_OK) { fprintf(stderr, "WARNING: failed to initialize rate limiter; continuing without\n"); }
+	if (cacheDir && CWG_init_cache(cacheDir, CWG_CACHE_MAX_BYTES_DEFAULT, &params) != CW_OK) { fprintf(stderr, "WARNING: failed to open cache at %s; continuing without\n", cacheDir); }
+	if (indexPath && CWG_init_index(indexPath, &params) != CW_OK) { fprintf(stderr, "WARNING: failed to open index at %s; continuing without\n", indexPath); }
+	char batchSizesPath[cacheDir ? strlen(cacheDir)+sizeof(CWG_BATCH_SIZES_FILENAME)+1 : 1];
+	if (cacheDir) {
+		snprintf(batchSizesPath, sizeof(batchSizesPath), "%s/%s", cacheDir, CWG_BATCH_SIZES_FILENAME);
+		params.batchSizesPath = batchSizesPath;
+	}
+	if (replayPath && CWG_init_fetch_replay(replayPath, replayLatencyMs, &params) != CW_OK) {
+		fprintf(stderr, "Failed to load fetch record at %s.\n", replayPath);
+		exit(1);
+	}
+	if (recordPath && CWG_init_fetch_recorder(recordPath, &params) != CW_OK) {
+		fprintf(stderr, "Failed to open fetch record at %s.\n", recordPath);
+		exit(1);
+	}
+
 	int getFd = STDOUT_FILENO;
 	FILE *dirStream = NULL;
 	CW_STATUS status;
+	if (exportPath) {
+		status = CWG_export_bundle(toget, &params, exportPath);
+		goto end;
+	}
+	if (getManifest) {
+		if (!CW_is_valid_txid(toget)) {
+			fprintf(stderr, "Manifest can only be gotten by TXID.\n");
+			exit(1);
+		}
+		struct CWG_file_manifest manifest;
+		init_CWG_file_manifest(&manifest);
+		if ((status = CWG_get_file_manifest(toget, &params, &manifest)) == CW_OK) {
+			printf("Chain Length: %d\nTree Depth: %d\nSize: %zu bytes in %zu leaves\n\n",
+				manifest.metadata.length, manifest.metadata.depth, manifest.size, manifest.count);
+			for (size_t i=0; i<manifest.count; i++) { printf("%s %zu\n", manifest.txids[i], manifest.sizes[i]); }
+		}
+		destroy_CWG_file_manifest(&manifest);
+		goto end;
+	}
+	if (getRange) {
+		if (!CW_is_valid_txid(toget)) {
+			fprintf(stderr, "Range can only be gotten by TXID.\n");
+			exit(1);
+		}
+		status = CWG_get_range(toget, rangeOffset, rangeLength, &params, getFd);
+		goto end;
+	}
 	if (getInfo) {
 		const char *name;
 		int rev;
@@ -155,6 +287,16 @@ int main(int argc, char **argv) {
 	if (dirStream) { fclose(dirStream); }
 
 	end:
+		CWG_cleanup_fetch_recorder(&params);
+		CWG_cleanup_fetch_replay(&params);
+		CWG_cleanup_http_pool(&params);
+		CWG_cleanup_rate_limiter(&params);
+		CWG_cleanup_cache(&params);
+		CWG_cleanup_index(&params);
+		if (params.transferStats) {
+			fprintf(stderr, "HTTP transfer: %zu requests, %zu bytes on the wire, %zu bytes decoded\n",
+				transferStats.requests, transferStats.wireBytes, transferStats.decodedBytes);
+		}
 		if (status != CW_OK) { 
 			fprintf(stderr, "\nGet failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
 			exit(1);
@@ -8,13 +8,112 @@
 FILE *CWG_err_stream = NULL;
 
 #include "cashfetchutils.h"
+#include "cashcacheutils.h"
+#include "cashratelimitutils.h"
+#include "cashindexutils.h"
+#include "cashreplayutils.h"
 
 /* general constants */
 #define LINE_BUF 150
+#define NAMETAG_CLAIMS_BATCH 8
+#define REV_LOOKAHEAD 32
+#define TREE_PREFETCH_WINDOW 32
+#define WRITER_QUEUE_BYTES (1024*1024)
+#define MANIFEST_ALLOC_MIN 16
+#define SINK_ALLOC_MIN 4096
+
+/*
+ * revisions of a nametag's script fetched ahead (by fetchHexDataRevisions()), so that most CW_OP_NEXTREV can be executed without fetching
+ * from is the txid the revisions were walked from, and the count revisions following it are held in order, their hex datas being
+   at hexOffsets within hexDataAll
+ */
+struct CWG_rev_lookahead {
+	char from[CW_TXID_CHARS+1];
+	char txids[REV_LOOKAHEAD][CW_TXID_CHARS+1];
+	char hexDataAll[REV_LOOKAHEAD*CW_TX_DATA_CHARS+1];
+	size_t hexOffsets[REV_LOOKAHEAD];
+	struct FetchItemInfo itemInfo[REV_LOOKAHEAD];
+	size_t count;
+};
+
+/*
+ * stage for writing a file's bytes to sink; if threaded, bytes are queued (up to WRITER_QUEUE_BYTES, in a ring buffer) and written
+   from a thread of their own, so that a slow reader of sink doesn't hold up fetching; otherwise, they are written directly
+ * status is the first failure of the writing thread, after which everything queued is dropped
+ * only the file's bytes from start up to end are written, the rest being dropped; pos is the offset in the file of the next byte handed to it
+ */
+struct CWG_writer {
+	struct CWG_sink *sink;
+	bool threaded;
+	size_t pos;
+	size_t start;
+	size_t end;
+	char *queue;
+	size_t head;
+	size_t used;
+	bool done;
+	CW_STATUS status;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+};
+
+/*
+ * fetch of a chain's next link, made from a thread of its own while the current link is expanded/written
+ */
+struct CWG_link_fetch {
+	struct CWG_params *params;
+	char txid[CW_TXID_CHARS+1];
+	char *hexData;
+	CW_STATUS status;
+	pthread_t thread;
+};
+
+/*
+ * a single level of a file tree being streamed; holds the hex data fetched for the level that isn't yet consumed
+   (from pos up to len), which is at most a window of TXs plus a partial txid carried over from the data before
+ * nextTx is the index within the level of the next TX to be fetched, and none are fetched from endTx on;
+   skip is the number of hex chars to drop from the start of what is fetched (or, at level 0, fed) next
+ */
+struct CWG_tree_level {
+	char *hexData;
+	size_t pos;
+	size_t len;
+	size_t nextTx;
+	size_t endTx;
+	size_t skip;
+};
+
+/*
+ * a file being walked for its manifest rather than written; its leaves are added to manifest (with their TXIDs/sizes, if leaves is set),
+   and the last is kept in lastLeaf
+ */
+struct CWG_manifest_walk {
+	struct CWG_file_manifest *manifest;
+	bool leaves;
+	char lastLeaf[CW_TXID_CHARS+1];
+};
+
+/*
+ * state for streaming a file tree depth-first: each level's hex data is the concatenation of the data of its TXs (in order),
+   read as the txids of the next level's TXs; level 0 is fed the root data (of each chain link, if a chained tree), and
+   the next level is fetched from the txids read off the one before at most TREE_PREFETCH_WINDOW at a time, so memory stays bounded
+   by the tree's depth rather than the file's size, and leaves (at level md->depth) are written out as soon as each window of them arrives
+ * if walk is set, leaves are added to its manifest instead, without being fetched
+ */
+struct CWG_tree_stream {
+	struct CWG_tree_level *levels;
+	int depth;
+	bool leavesWritten;
+	struct CWG_params *params;
+	struct CWG_writer *writer;
+	struct CWG_manifest_walk *walk;
+};
 
 /*
  * struct for information to carry around during script execution
  * if counter is set, nothing will actually be fetched
+ * revLookahead is shared by all revisions of the script
  */
 struct CWG_script_pack {
 	List *scriptStreams;
@@ -24,6 +123,7 @@ struct CWG_script_pack {
 	int atRev;
 	int maxRev;
 	struct CWG_nametag_counter *infoCounter;
+	struct CWG_rev_lookahead *revLookahead;
 };
 
 /*
@@ -76,9 +176,62 @@ static void protocolCheck(uint16_t pVer);
 static CW_STATUS cwTypeToMimeStr(CW_TYPE type, struct CWG_params *cgp);
 
 /*
- * translates given hex string to byte data and writes to file descriptor
+ * ensures the buffer of given memory sink has room for n more bytes, growing it by doubling
+ */
+static CW_STATUS sinkReserve(struct CWG_sink *sink, size_t n);
+
+/*
+ * writes up to n bytes of buf to sink, returning the number written, or -1 on failure (with errno set only for CWG_SINK_FD)
+ */
+static ssize_t sinkWriteSome(struct CWG_sink *sink, const char *buf, size_t n);
+
+/*
+ * writes all n bytes of buf to sink
+ */
+static CW_STATUS sinkWrite(struct CWG_sink *sink, const char *buf, size_t n);
+
+/*
+ * writes rest of stream to sink
+ */
+static CW_STATUS copyStreamToSink(struct CWG_sink *sink, FILE *stream);
+
+/*
+ * translates given hex string to byte data and writes to sink; a memory sink has it translated straight into its buffer
+ */
+static CW_STATUS writeHexDataStr(const char *hexDataStr, int suffixLen, struct CWG_sink *sink);
+
+/*
+ * initializes struct CWG_writer for writing to sink, starting its thread if threaded (never for a memory sink, whose writes don't block)
+ */
+static CW_STATUS init_CWG_writer(struct CWG_writer *writer, struct CWG_sink *sink, bool threaded);
+
+/*
+ * writes out everything queued to given struct CWG_writer and stops its thread (if threaded), freeing its data
+ * returns the first failure to write, if any
+ */
+static CW_STATUS finish_CWG_writer(struct CWG_writer *writer);
+
+/*
+ * translates given hex string (excluding suffixLen chars at end) to byte data and writes it through given writer;
+   if threaded, it is queued, waiting for room in the queue as needed
+ */
+static CW_STATUS writerWriteHexDataStr(struct CWG_writer *writer, const char *hexDataStr, int suffixLen);
+
+/*
+ * thread routine for writing out what is queued to given struct CWG_writer until it is finished
+ */
+static void *writerWorker(void *arg);
+
+/*
+ * thread routine for fetching a chain's next link as given by struct CWG_link_fetch
  */
-static CW_STATUS writeHexDataStr(const char *hexDataStr, int suffixLen, int fd);
+static void *linkFetchWorker(void *arg);
+
+/*
+ * whether fetches may be made with params from more than one thread at once (i.e. not through a mongo client,
+   which can't be shared between threads, even if taken from a pool for the get, or a user-supplied fetcher that allows only one fetch at a time)
+ */
+static inline bool fetchesConcurrent(struct CWG_params *params);
 
 /*
  * resolves file metadata from given hex data string according to protocol format,
@@ -87,23 +240,84 @@ static CW_STATUS writeHexDataStr(const char *hexDataStr, int suffixLen, int fd);
 static CW_STATUS hexResolveMetadata(const char *hexData, struct CW_file_metadata *md);
 
 /*
- * recursively traverse file tree from root hexdata
- * partialTxids Lists are for keeping track of partials in chained tree (between linked root hexdatas)
- * stops at depth specified in md
+ * initializes struct CWG_tree_stream for streaming file tree of given depth through writer
+ */
+static CW_STATUS init_CWG_tree_stream(struct CWG_tree_stream *ts, int depth, struct CWG_params *params, struct CWG_writer *writer);
+
+/*
+ * frees heap-allocated data pointed to by given struct CWG_tree_stream
+ */
+static void destroy_CWG_tree_stream(struct CWG_tree_stream *ts);
+
+/*
+ * feeds given root hex data (excluding suffixLen chars at end) to level 0 of tree stream, and streams everything it completes
+   down to the leaves; any partial txid left over is carried to the next feed (i.e. the next link of a chained tree)
+ */
+static CW_STATUS treeStreamFeed(struct CWG_tree_stream *ts, const char *hexData, int suffixLen);
+
+/*
+ * fetches the next window of TXs at given level of tree stream, reading their txids off the level before (refilling it in turn, as needed);
+   if the level is the leaves, they are written out
+ * the number of TXs fetched is written to fetched; none are if the levels before have run dry of what has been fed
+ */
+static CW_STATUS treeStreamRefill(struct CWG_tree_stream *ts, int level, size_t *fetched);
+
+/*
+ * sets up tree stream to fetch only the TXs covering the range of the file its writer writes (from writer->start up to writer->end):
+   as cashsendtools lays out trees, every TX of a level but the last is full, so each level's range follows from that of the level after it
+ */
+static void treeStreamSeek(struct CWG_tree_stream *ts);
+
+/*
+ * whether every leaf of the tree stream's range has been written
  */
-static CW_STATUS traverseFileTree(const char *treeHexData, List *partialTxids[], int suffixLen, int depth,
-			    	  struct CWG_params *params, struct CW_file_metadata *md, int fd);
+static inline bool treeStreamDone(struct CWG_tree_stream *ts);
 
 /*
- * traverse file chain from starting hexdata
+ * traverse file chain from starting hexdata (at txid)
  * stops at length specified in md
+ * where fetches may be made concurrently, each link's successor is fetched while the link is expanded/written
+ * if walk is set, the file's leaves are added to its manifest rather than written (and txid must be set)
  */
-static CW_STATUS traverseFileChain(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, int fd);
+static CW_STATUS traverseFileChain(const char *txid, const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md,
+				  struct CWG_writer *writer, struct CWG_manifest_walk *walk);
 
 /*
- * wrapper for determining whether to traverse file as chain or tree
+ * wrapper for determining whether to traverse file as chain or tree; a file of more than one TX is written out through a threaded writer
+ * only length bytes from offset are written (SIZE_MAX for through the end); for a tree, only the TXs covering them are fetched
  */
-static inline CW_STATUS traverseFile(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, int fd);
+static inline CW_STATUS traverseFile(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, size_t offset, size_t length, struct CWG_sink *sink);
+
+/*
+ * adds leaf of given txid and byte count to manifest (its TXID/size recorded only if leaves is set)
+ * returns false on failure
+ */
+static bool manifestAddLeaf(struct CWG_file_manifest *manifest, bool leaves, const char *txid, size_t size);
+
+/*
+ * walks file from starting hexdata (at txid) for its manifest, as with traverseFile but without fetching any leaves other than the last
+   (for its size); writes metadata, size, and count of leaves to manifest, as well as their TXIDs/sizes if leaves is set
+ */
+static CW_STATUS walkFileManifest(const char *txid, const char *hexDataStart, struct CW_file_metadata *md, struct CWG_params *params,
+				  struct CWG_file_manifest *manifest, bool leaves);
+
+/*
+ * writes length bytes from offset of file (SIZE_MAX for through the end) from its manifest (walked with leaves), fetching only the leaves
+   covering them, TREE_PREFETCH_WINDOW at a time; each leaf's bytes lead its hex data, followed by the suffix of a chain link (if it is one)
+ */
+static CW_STATUS writeManifestRange(struct CWG_file_manifest *manifest, struct CWG_params *params, size_t offset, size_t length, struct CWG_sink *sink);
+
+/*
+ * reads bytes from up to to of given level of file tree (level 0 being rootHex, the root data) into hexData, fetching the TXs holding them
+   (and those leading to them); meant for a txid's worth or so, as what is fetched is held on the stack
+ */
+static CW_STATUS treeLevelReadHex(const char *rootHex, int level, size_t from, size_t to, struct CWG_params *params, char *hexData);
+
+/*
+ * resolves exact byte size of file from starting hexdata (at txid) and writes it to size;
+   a tree's is found from the TXs along its last branch alone, but a chained file must be walked as with walkFileManifest
+ */
+static CW_STATUS resolveFileSize(const char *txid, const char *hexDataStart, struct CW_file_metadata *md, struct CWG_params *params, size_t *size);
 
 /*
  * frees all heap allocations and closes file descriptors for List of file descriptors
@@ -111,29 +325,29 @@ static inline CW_STATUS traverseFile(const char *hexDataStart, struct CWG_params
 static inline void freeFdStack(List *fdStack);
 
 /*
- * writes path link (for directory index) to descriptor fd;
+ * writes path link (for directory index) to sink;
    intended exclusively for use in scripting, expected prior to writing directory index
  */
-static inline CW_STATUS writePathLink(const char *pathR, const char *linkR, int fd);
+static inline CW_STATUS writePathLink(const char *pathR, const char *linkR, struct CWG_sink *sink);
 
 /*
  * execute necessary action for given CW_OPCODE c
- * may involve pushing/popping stack (including fdStack), reading from specified scriptStream, and/or writing to fd
+ * may involve pushing/popping stack (including fdStack), reading from specified scriptStream, and/or writing to sink
  * fdStack is for storing open file descriptors used for storage during script execution
  */
-static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, List *fdStack, struct CWG_script_pack *sp, struct CWG_params *params, int fd);
+static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, List *fdStack, struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
- * executes cashweb script from scriptStream, writing anything specified by script to file descriptor fd
+ * executes cashweb script from scriptStream, writing anything specified by script to sink
  * revTxid may be set NULL in given struct CWS_script_pack if reading from existing script streams for revisioning
  */
-static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *params, int fd);
+static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * starting point for executing the beginning of a cashweb script (not on a per-revision basis);
  * contains some stuff that needs to avoid the recursiveness of execScript()
  */
-static CW_STATUS execScriptStart(struct CWG_script_pack *sp, struct CWG_params *params, int fd);
+static CW_STATUS execScriptStart(struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * fetches/traverses script data at nametag and writes to stream
@@ -142,22 +356,23 @@ static CW_STATUS execScriptStart(struct CWG_script_pack *sp, struct CWG_params *
 static CW_STATUS getScriptByNametag(const char *name, struct CWG_params *params, char **txidPtr, FILE *stream);
 
 /*
- * fetches/traverses script data at tx with given input txid (and vout CW_REVISION_INPUT_VOUT) and writes to stream
+ * fetches/traverses script data of the revision following revTxid (the tx spending its vout CW_REVISION_INPUT_VOUT) and writes to stream;
+   revisions are walked REV_LOOKAHEAD at a time (or up to sp->maxRev) into sp->revLookahead, and only fetched when not already there
  * writes txid of of script to txid
  */
-static CW_STATUS getScriptByInTxid(const char *inTxid, struct CWG_params *params, char **txidPtr, FILE *stream);
+static CW_STATUS getScriptByRevision(const char *revTxid, struct CWG_script_pack *sp, struct CWG_params *params, char **txidPtr, FILE *stream);
 
 /*
  * fetched/traverses file at specified path of given directory index stream dirFp, writing file to specified file descriptor
  * fetchedNames will track origin nametag(s) for chained script/directory nametag references; should be set NULL on initial call
  * responsible for calling foundHandler if present in params; will be set to NULL upon call
  */
-static CW_STATUS getFileByPath(FILE *dirFp, const char *path, List *fetchedNames, struct CWG_params *params, int fd);
+static CW_STATUS getFileByPath(FILE *dirFp, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * convenience wrapper function for getByGetterPath when getting for path at nametag revision
  */
-static inline CW_STATUS getFileByNametagPath(const char *name, int revision, const char *path, List *fetchedNames, struct CWG_params *params, int fd);
+static inline CW_STATUS getFileByNametagPath(const char *name, int revision, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * fetches/traverses file at given nametag (according to script at nametag) and writes to specified file descriptor;
@@ -166,12 +381,12 @@ static inline CW_STATUS getFileByNametagPath(const char *name, int revision, con
  * fetchedNames will track origin nametag(s) for chained script/directory nametag references; should be set NULL on initial call
  * responsible for calling foundHandler if present in params; will be set to NULL upon call
  */
-static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedNames, struct CWG_params *params, struct CWG_nametag_counter *counter, int fd);
+static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedNames, struct CWG_params *params, struct CWG_nametag_counter *counter, struct CWG_sink *sink);
 
 /*
  * convenience wrapper function for getByGetterPath when getting for path at txid
  */
-static inline CW_STATUS getFileByTxidPath(const char *txid, const char *path, List *fetchedNames, struct CWG_params *params, int fd);
+static inline CW_STATUS getFileByTxidPath(const char *txid, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * fetches/traverses file at given txid and writes to specified file descriptor;
@@ -180,28 +395,37 @@ static inline CW_STATUS getFileByTxidPath(const char *txid, const char *path, Li
  * fetchedNames will track origin nametag(s) for chained script/directory nametag references; should be set NULL on initial call
  * responsible for calling foundHandler if present in params; will be set to NULL upon call
  */
-static CW_STATUS getFileByTxid(const char *txid, List *fetchedNames, struct CWG_params *params, struct CWG_file_info *counter, int fd);
+static CW_STATUS getFileByTxid(const char *txid, List *fetchedNames, struct CWG_params *params, struct CWG_file_info *counter, struct CWG_sink *sink);
+
+/*
+ * fetches/traverses length bytes from offset of file at given txid and writes them to specified file descriptor, after resolving its size
+   (saved to params->saveFileSize if set); returns CWG_RANGE_NO if offset is past the end of the file
+ * the size isn't resolved if the whole file is asked for (offset 0 through the end) and params->saveFileSize isn't set; a chained file is
+   walked for its manifest instead, and the range's leaves fetched from that rather than walking the chain a second time
+ * responsible for calling foundHandler if present in params; will be set to NULL upon call
+ */
+static CW_STATUS getFileRangeByTxid(const char *txid, size_t offset, size_t length, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * convenience wrapper function for getByGetterPath when getting for path at cashweb id
  */
-static inline CW_STATUS getFileByIdPath(const char *id, const char *path, List *fetchedNames, struct CWG_params *params, int fd);
+static inline CW_STATUS getFileByIdPath(const char *id, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * wrapper function for either getting by txid or by nametag, dependent on prefix (or lack thereof) of provided ID
  * fetchedNames will track origin nametag(s) for chained script/directory nametag references; should be set NULL on initial call
  * responsible for calling foundHandler if present in params; will be set to NULL upon call
  */
-static CW_STATUS getFileById(const char *id, List *fetchedNames, struct CWG_params *params, int fd);
+static CW_STATUS getFileById(const char *id, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink);
 
 /*
  * struct CWG_getter stores a send function pointer and its arguments; strictly for internal use by cashsendtools
  * really only exists to avoid some repetitive code
  */
 struct CWG_getter {
-	CW_STATUS (*byId) (const char *, List *, struct CWG_params *, int);
-	CW_STATUS (*byTxid) (const char *, List *, struct CWG_params *, struct CWG_file_info *, int);
-	CW_STATUS (*byName) (const char *, int, List *, struct CWG_params *, struct CWG_nametag_counter *, int);
+	CW_STATUS (*byId) (const char *, List *, struct CWG_params *, struct CWG_sink *);
+	CW_STATUS (*byTxid) (const char *, List *, struct CWG_params *, struct CWG_file_info *, struct CWG_sink *);
+	CW_STATUS (*byName) (const char *, int, List *, struct CWG_params *, struct CWG_nametag_counter *, struct CWG_sink *);
 	const char *id;
 	const char *name;
 	int revision;
@@ -227,13 +451,44 @@ static inline void init_CWG_getter_for_name(struct CWG_getter *cgg, const char *
 /*
  * convenience function for getting as per contents of given struct CWG_getter, regardless of whether by name or id
  */
-static inline CW_STATUS getByGetter(struct CWG_getter *getter, int fd);
+static inline CW_STATUS getByGetter(struct CWG_getter *getter, struct CWG_sink *sink);
 
 /*
- * fetches/traverses directory by given struct CWG_getter, and then file at given path, writing file to specified file descriptor
+ * fetches/traverses directory by given struct CWG_getter, and then file at given path, writing file to specified sink
  * if path is NULL, this function is equivalent to getByGetter
  */
-static CW_STATUS getByGetterPath(struct CWG_getter *getter, const char *path, int fd);
+static CW_STATUS getByGetterPath(struct CWG_getter *getter, const char *path, struct CWG_sink *sink);
+
+/*
+ * struct BundleRecorder wraps the params fetched through for exporting a bundle, recording each fetch to the bundle being built;
+   used as the ctx of a struct CWG_fetcher
+ */
+struct BundleRecorder {
+	struct CWG_params source;
+	struct IndexBuilder *builder;
+	pthread_mutex_t lock;
+};
+
+/*
+ * fetch_batch function of a struct CWG_fetcher with struct BundleRecorder as ctx; fetches through its source params,
+   and records the fetched TX (and the input TXID/nametag it was fetched by, if so) to its bundle
+ * a nametag claim that isn't cashweb-formatted is recorded too (with a null txid), so that the claims after it keep their positions
+ * the fetcher must be set with maxBatch of 1, so that each fetch is of a single TX
+ */
+static CW_STATUS bundleRecorderFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items);
+
+/*
+ * init/cleanup functions of a struct CWG_fetcher with struct BundleRecorder as ctx; init/cleanup its source params
+ */
+static CW_STATUS bundleRecorderInit(void *ctx);
+static void bundleRecorderCleanup(void *ctx);
+
+/*
+ * gets file at given id by given recording params (as set up by CWG_export_bundle), and if it is a directory index,
+   does the same for every file it references, recursively
+ * ids already gotten are tracked in exported (as allocated strings), to be skipped
+ */
+static CW_STATUS exportBundleId(const char *id, struct CWG_params *recParams, List *exported);
 
 /* ------------------------------------- PUBLIC ------------------------------------- */
 
@@ -241,13 +496,31 @@ void init_CWG_params(struct CWG_params *cgp, const char *mongodb, const char *bi
 	cgp->mongodb = mongodb;
 	cgp->mongodbCli = NULL;
 	cgp->mongodbCliPool = NULL;
+	cgp->mongodbIndexCheck = false;
+	cgp->mongodbPoolMaxSize = 0;
+	cgp->mongodbReadPref = NULL;
+	cgp->mongodbSocketTimeoutMS = 0;
+	cgp->mongodbServerSelectionTimeoutMS = 0;
+	cgp->mongodbPoolStats = NULL;
 	cgp->bitdbNode = bitdbNode;
 	cgp->restEndpoint = restEndpoint;
+	cgp->rpcEndpoint = NULL;
+	cgp->rpcAuth = NULL;
+	cgp->fetcher = NULL;
 	cgp->requestLimit = true;
+	cgp->httpPool = NULL;
+	cgp->fetchConcurrency = CWG_FETCH_CONCURRENCY_DEFAULT;
+	cgp->batchSizesPath = NULL;
+	cgp->rateLimiter = NULL;
+	cgp->transferStats = NULL;
+	cgp->cache = NULL;
+	cgp->cacheUnconfirmedTTL = CWG_CACHE_UNCONFIRMED_TTL_DEFAULT;
+	cgp->index = NULL;
 	cgp->dirPath = NULL;
 	cgp->forceDir = false;
 	cgp->saveMimeStr = saveMimeStr;
 	if (cgp->saveMimeStr) { memset(*cgp->saveMimeStr, 0, sizeof(*cgp->saveMimeStr)); }
+	cgp->saveFileSize = NULL;
 	cgp->foundHandler = NULL;
 	cgp->foundHandleData = NULL;
 	cgp->foundSuppressErr = -1;
@@ -258,12 +531,30 @@ void copy_CWG_params(struct CWG_params *dest, struct CWG_params *source) {
 	dest->mongodb = source->mongodb;
 	dest->mongodbCli = source->mongodbCli;
 	dest->mongodbCliPool = source->mongodbCliPool;
+	dest->mongodbIndexCheck = source->mongodbIndexCheck;
+	dest->mongodbPoolMaxSize = source->mongodbPoolMaxSize;
+	dest->mongodbReadPref = source->mongodbReadPref;
+	dest->mongodbSocketTimeoutMS = source->mongodbSocketTimeoutMS;
+	dest->mongodbServerSelectionTimeoutMS = source->mongodbServerSelectionTimeoutMS;
+	dest->mongodbPoolStats = source->mongodbPoolStats;
 	dest->bitdbNode = source->bitdbNode;
 	dest->restEndpoint = source->restEndpoint;
+	dest->rpcEndpoint = source->rpcEndpoint;
+	dest->rpcAuth = source->rpcAuth;
+	dest->fetcher = source->fetcher;
 	dest->requestLimit = source->requestLimit;
+	dest->httpPool = source->httpPool;
+	dest->fetchConcurrency = source->fetchConcurrency;
+	dest->batchSizesPath = source->batchSizesPath;
+	dest->rateLimiter = source->rateLimiter;
+	dest->transferStats = source->transferStats;
+	dest->cache = source->cache;
+	dest->cacheUnconfirmedTTL = source->cacheUnconfirmedTTL;
+	dest->index = source->index;
 	dest->dirPath = source->dirPath;
 	dest->forceDir = source->forceDir;
 	dest->saveMimeStr = source->saveMimeStr;
+	dest->saveFileSize = source->saveFileSize;
 	dest->foundHandler = source->foundHandler;
 	dest->foundHandleData = source->foundHandleData;
 	dest->foundSuppressErr = source->foundSuppressErr;
@@ -271,11 +562,17 @@ void copy_CWG_params(struct CWG_params *dest, struct CWG_params *source) {
 }
 
 CW_STATUS CWG_get_by_id(const char *id, struct CWG_params *params, int fd) {
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fd);
+	return CWG_get_by_id_to_sink(id, params, &sink);
+}
+
+CW_STATUS CWG_get_by_id_to_sink(const char *id, struct CWG_params *params, struct CWG_sink *sink) {
 	CW_STATUS status;
 	if ((status = initFetcher(params)) != CW_OK) { return status; } 
 
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
-	if ((status = getFileByIdPath(id, params->dirPath, NULL, params, fd)) == CW_CALL_NO) {
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
+	if ((status = getFileByIdPath(id, params->dirPath, NULL, params, sink)) == CW_CALL_NO) {
 		fprintf(CWG_err_stream, "CWG_get_by_id provided with invalid identifier: %s\n", id);
 		status = CWG_CALL_ID_NO;
 	}
@@ -286,11 +583,17 @@ CW_STATUS CWG_get_by_id(const char *id, struct CWG_params *params, int fd) {
 }
 
 CW_STATUS CWG_get_by_txid(const char *txid, struct CWG_params *params, int fd) {
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fd);
+	return CWG_get_by_txid_to_sink(txid, params, &sink);
+}
+
+CW_STATUS CWG_get_by_txid_to_sink(const char *txid, struct CWG_params *params, struct CWG_sink *sink) {
 	CW_STATUS status;
 	if ((status = initFetcher(params)) != CW_OK) { return status; } 	
 
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
-	status = getFileByTxidPath(txid, params->dirPath, NULL, params, fd);
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
+	status = getFileByTxidPath(txid, params->dirPath, NULL, params, sink);
 	params->foundHandler = savePtr;
 	
 	cleanupFetcher(params);
@@ -298,28 +601,54 @@ CW_STATUS CWG_get_by_txid(const char *txid, struct CWG_params *params, int fd) {
 }
 
 CW_STATUS CWG_get_by_name(const char *name, int revision, struct CWG_params *params, int fd) {
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fd);
+	return CWG_get_by_name_to_sink(name, revision, params, &sink);
+}
+
+CW_STATUS CWG_get_by_name_to_sink(const char *name, int revision, struct CWG_params *params, struct CWG_sink *sink) {
 	CW_STATUS status;
 	if ((status = initFetcher(params)) != CW_OK) { return status; } 
 
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
-	status = getFileByNametagPath(name, revision, params->dirPath, NULL, params, fd);
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
+	status = getFileByNametagPath(name, revision, params->dirPath, NULL, params, sink);
 	params->foundHandler = savePtr;
 	
 	cleanupFetcher(params);
 	return status;
 }
 
+CW_STATUS CWG_get_range(const char *txid, size_t offset, size_t length, struct CWG_params *params, int fd) {
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fd);
+	return CWG_get_range_to_sink(txid, offset, length, params, &sink);
+}
+
+CW_STATUS CWG_get_range_to_sink(const char *txid, size_t offset, size_t length, struct CWG_params *params, struct CWG_sink *sink) {
+	CW_STATUS status;
+	if ((status = initFetcher(params)) != CW_OK) { return status; }
+
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
+	status = getFileRangeByTxid(txid, offset, length, params, sink);
+	params->foundHandler = savePtr;
+
+	cleanupFetcher(params);
+	return status;
+}
+
 CW_STATUS CWG_get_file_info(const char *txid, struct CWG_params *params, struct CWG_file_info *info) {
 	CW_STATUS status;
 	if ((status = initFetcher(params)) != CW_OK) { return status; }
 
 	int devnull = open("/dev/null", O_WRONLY);
 	if (devnull < 0) { perror("open() /dev/null failed"); cleanupFetcher(params); return CW_SYS_ERR; }
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, devnull);
 
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
 	char (*saveStrPtr)[CWG_MIMESTR_BUF] = params->saveMimeStr;
 	params->saveMimeStr = &info->mimetype;
-	status = getFileByTxid(txid, NULL, params, info, devnull);
+	status = getFileByTxid(txid, NULL, params, info, &sink);
 	params->saveMimeStr = saveStrPtr;
 	params->foundHandler = savePtr;
 
@@ -328,18 +657,36 @@ CW_STATUS CWG_get_file_info(const char *txid, struct CWG_params *params, struct
 	return status;
 }
 
+CW_STATUS CWG_get_file_manifest(const char *txid, struct CWG_params *params, struct CWG_file_manifest *manifest) {
+	CW_STATUS status;
+	if ((status = initFetcher(params)) != CW_OK) { return status; }
+
+	char hexDataStart[CW_TX_DATA_CHARS+1];
+	struct CW_file_metadata md;
+	if ((status = fetchHexData((const char **)&txid, 1, BY_TXID, params, NULL, hexDataStart)) == CW_OK &&
+	    (status = hexResolveMetadata(hexDataStart, &md)) == CW_OK) {
+		protocolCheck(md.pVer);
+		if ((status = walkFileManifest(txid, hexDataStart, &md, params, manifest, true)) != CW_OK) { destroy_CWG_file_manifest(manifest); }
+	}
+
+	cleanupFetcher(params);
+	return status;
+}
+
 CW_STATUS CWG_get_nametag_info(const char *name, int revision, struct CWG_params *params, struct CWG_nametag_info *info) {
 	CW_STATUS status;
 	if ((status = initFetcher(params)) != CW_OK) { return status; }
 
 	int devnull = open("/dev/null", O_WRONLY);
 	if (devnull < 0) { perror("open() /dev/null failed"); cleanupFetcher(params); return CW_SYS_ERR; }
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, devnull);
 
 	struct CWG_nametag_counter counter;
 	init_CWG_nametag_counter(&counter);
 
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
-	if ((status = getFileByNametag(name, revision, NULL, params, &counter, devnull)) != CW_OK) { goto cleanup; }
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
+	if ((status = getFileByNametag(name, revision, NULL, params, &counter, &sink)) != CW_OK) { goto cleanup; }
 	params->foundHandler = savePtr;
 
 	if (!counter_copy_CWG_nametag_info(info, &counter)) { destroy_CWG_nametag_info(info); status = CW_SYS_ERR; goto cleanup; }
@@ -511,6 +858,122 @@ void CWG_cleanup_mongo_pool(struct CWG_params *params) {
 	return cleanupMongoPool(params);	
 }
 
+CW_STATUS CWG_create_mongo_indexes(const char *mongodbAddr, FILE *reportStream) {
+	return createMongoIndexes(mongodbAddr, reportStream);
+}
+
+CW_STATUS CWG_check_mongo_indexes(const char *mongodbAddr, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream) {
+	return checkMongoIndexes(mongodbAddr, sampleTxid, sampleNametag, runs, reportStream);
+}
+
+CW_STATUS CWG_init_http_pool(struct CWG_params *params) {
+	return initHttpPool(params);
+}
+
+void CWG_cleanup_http_pool(struct CWG_params *params) {
+	cleanupHttpPool(params);
+}
+
+CW_STATUS CWG_init_rate_limiter(double rate, double burst, struct CWG_params *params) {
+	return initRateLimiter(rate, burst, params);
+}
+
+CW_STATUS CWG_set_rate_limit(const char *endpoint, double rate, double burst, struct CWG_params *params) {
+	return setRateLimit(endpoint, rate, burst, params);
+}
+
+void CWG_cleanup_rate_limiter(struct CWG_params *params) {
+	cleanupRateLimiter(params);
+}
+
+CW_STATUS CWG_init_cache(const char *cacheDir, size_t maxBytes, struct CWG_params *params) {
+	return initCache(cacheDir, maxBytes, params);
+}
+
+void CWG_cleanup_cache(struct CWG_params *params) {
+	cleanupCache(params);
+}
+
+CW_STATUS CWG_init_index(const char *indexPath, struct CWG_params *params) {
+	return initIndex(indexPath, params);
+}
+
+void CWG_cleanup_index(struct CWG_params *params) {
+	cleanupIndex(params);
+}
+
+CW_STATUS CWG_update_index(const char *indexPath, struct CWG_params *params) {
+	if (!params->rpcEndpoint) {
+		fprintf(CWG_err_stream, "cashgettools: updating index requires an RPC endpoint to be specified\n");
+		return CW_CALL_NO;
+	}
+
+	CW_STATUS status;
+	if ((status = initFetcher(params)) != CW_OK) { return status; }
+	status = updateIndexRPC(indexPath, params);
+	cleanupFetcher(params);
+	return status;
+}
+
+CW_STATUS CWG_update_index_from_blocks(const char *indexPath, const char *blocksDir) {
+	return indexUpdateFromBlockFiles(indexPath, blocksDir);
+}
+
+CW_STATUS CWG_export_bundle(const char *id, struct CWG_params *params, const char *bundlePath) {
+	struct BundleRecorder recorder;
+	copy_CWG_params(&recorder.source, params);
+
+	uint64_t height;
+	CW_STATUS status;
+	if ((status = indexBuilderOpen(bundlePath, &recorder.builder, &height)) != CW_OK) { return status; }
+	if (pthread_mutex_init(&recorder.lock, NULL) != 0) { perror("pthread_mutex_init() failed"); indexBuilderFree(recorder.builder); return CW_SYS_ERR; }
+
+	// every fetch must reach the recorder, so none may be answered by the cache/index in between;
+	// a mongo client can't be shared between threads (and the source params hold just the one), so fetches are only made concurrently over HTTP
+	struct CWG_fetcher fetcher = {
+		.fetch_batch = &bundleRecorderFetch,
+		.init = &bundleRecorderInit,
+		.cleanup = &bundleRecorderCleanup,
+		.ctx = &recorder,
+		.capabilities = CWG_FETCHER_CAN_ALL,
+		.maxBatch = 1,
+		.concurrency = params->mongodb || params->mongodbCli || params->mongodbCliPool ? 1 : params->fetchConcurrency
+	};
+	struct CWG_params recParams;
+	copy_CWG_params(&recParams, params);
+	recParams.fetcher = &fetcher;
+	recParams.cache = NULL;
+	recParams.index = NULL;
+	recParams.dirPath = NULL;
+	recParams.forceDir = false;
+	recParams.foundHandler = NULL;
+
+	List exported;
+	initList(&exported);
+	if ((status = exportBundleId(id, &recParams, &exported)) == CW_OK) { status = indexBuilderCommit(recorder.builder); }
+	removeAllNodes(&exported, true);
+
+	pthread_mutex_destroy(&recorder.lock);
+	indexBuilderFree(recorder.builder);
+	return status;
+}
+
+CW_STATUS CWG_init_fetch_recorder(const char *recordPath, struct CWG_params *params) {
+	return initFetchRecorder(recordPath, params);
+}
+
+void CWG_cleanup_fetch_recorder(struct CWG_params *params) {
+	cleanupFetchRecorder(params);
+}
+
+CW_STATUS CWG_init_fetch_replay(const char *recordPath, int latencyMs, struct CWG_params *params) {
+	return initFetchReplay(recordPath, latencyMs, params);
+}
+
+void CWG_cleanup_fetch_replay(struct CWG_params *params) {
+	cleanupFetchReplay(params);
+}
+
 const char *CWG_errno_to_msg(CW_STATUS errNo) {
 	switch (errNo) {
 		case CW_DATADIR_NO:
@@ -533,8 +996,12 @@ const char *CWG_errno_to_msg(CW_STATUS errNo) {
 			return "Requested file contains a circular reference (invalid scripting or directory structure)";
 		case CWG_FETCH_ERR:
 			return "There was an unexpected error in querying the blockchain";
+		case CWG_MONGO_INDEX_NO:
+			return "MongoDB queries aren't served by indexes; create them with cashweb-mongo-index";
 		case CWG_WRITE_ERR:
 			return "There was an unexpected error in writing the file";
+		case CWG_RANGE_NO:
+			return "Requested range begins past the end of the file";
 		case CWG_FILE_LEN_ERR:
 		case CWG_FILE_DEPTH_ERR:
 		case CWG_FILE_ERR:
@@ -559,6 +1026,7 @@ static inline void init_CWG_script_pack(struct CWG_script_pack *sp, List *script
 	sp->atRev = 0;
 	sp->maxRev = maxRev;
 	sp->infoCounter = NULL;
+	sp->revLookahead = NULL;
 }
 
 static inline void copy_inc_CWG_script_pack(struct CWG_script_pack *dest, struct CWG_script_pack *source) {
@@ -569,6 +1037,7 @@ static inline void copy_inc_CWG_script_pack(struct CWG_script_pack *dest, struct
 	dest->atRev = source->atRev+1;
 	dest->maxRev = source->maxRev;
 	dest->infoCounter = source->infoCounter;
+	dest->revLookahead = source->revLookahead;
 }
 
 static inline void init_CWG_nametag_counter(struct CWG_nametag_counter *cnc) {
@@ -689,23 +1158,215 @@ static CW_STATUS cwTypeToMimeStr(CW_TYPE cwType, struct CWG_params *cgp) {
 		return status;
 }
 
-static CW_STATUS writeHexDataStr(const char *hexDataStr, int suffixLen, int fd) {
-	char fileByteData[strlen(hexDataStr)/2];
+static CW_STATUS sinkReserve(struct CWG_sink *sink, size_t n) {
+	if (sink->size-sink->len >= n) { return CW_OK; }
+
+	size_t size = sink->size ? sink->size : SINK_ALLOC_MIN;
+	while (size-sink->len < n) { size *= 2; }
+	char *data = realloc(sink->data, size);
+	if (!data) { perror("realloc failed"); return CW_SYS_ERR; }
+	sink->data = data;
+	sink->size = size;
+	return CW_OK;
+}
+
+static ssize_t sinkWriteSome(struct CWG_sink *sink, const char *buf, size_t n) {
+	switch (sink->type) {
+		case CWG_SINK_MEMORY:
+			if (sinkReserve(sink, n) != CW_OK) { return -1; }
+			memcpy(sink->data+sink->len, buf, n);
+			sink->len += n;
+			return n;
+		case CWG_SINK_CALLBACK:
+			return sink->write(buf, n, sink->writeData);
+		default:
+			return write(sink->fd, buf, n);
+	}
+}
+
+static CW_STATUS sinkWrite(struct CWG_sink *sink, const char *buf, size_t n) {
+	ssize_t w;
+	while (n > 0) {
+		if ((w = sinkWriteSome(sink, buf, n)) <= 0) {
+			if (w < 0 && sink->type == CWG_SINK_FD) {
+				if (errno == EINTR) { continue; }
+				perror("write() failed");
+			}
+			return CWG_WRITE_ERR;
+		}
+		buf += w;
+		n -= w;
+	}
+	return CW_OK;
+}
+
+static CW_STATUS copyStreamToSink(struct CWG_sink *sink, FILE *stream) {
+	CW_STATUS status;
+	char buf[FILE_DATA_BUF];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), stream)) > 0) {
+		if ((status = sinkWrite(sink, buf, n)) != CW_OK) { return status; }
+	}
+	if (ferror(stream)) { perror("fread() failed"); return CW_SYS_ERR; }
+	return CW_OK;
+}
+
+static CW_STATUS writeHexDataStr(const char *hexDataStr, int suffixLen, struct CWG_sink *sink) {
+	size_t hexLen = strlen(hexDataStr);
+	if (sink->type == CWG_SINK_MEMORY) {
+		if (sinkReserve(sink, hexLen/2) != CW_OK) { return CW_SYS_ERR; }
+		int bytesWritten;
+		if ((bytesWritten = hexStrToByteArr(hexDataStr, suffixLen, sink->data+sink->len)) < 0) { return CWG_FILE_ERR; }
+		sink->len += bytesWritten;
+		return CW_OK;
+	}
+
+	char fileByteData[hexLen/2];
 	int bytesToWrite;
 
 	if ((bytesToWrite = hexStrToByteArr(hexDataStr, suffixLen, fileByteData)) < 0) {
 		return CWG_FILE_ERR;
 	}	
 
-	ssize_t n;
-	if ((n = write(fd, fileByteData, (size_t)bytesToWrite)) < bytesToWrite) {
-		if (n < 0) { perror("write() failed"); }
-		return CWG_WRITE_ERR;
+	return sinkWrite(sink, fileByteData, (size_t)bytesToWrite);
+}
+
+static CW_STATUS init_CWG_writer(struct CWG_writer *writer, struct CWG_sink *sink, bool threaded) {
+	writer->sink = sink;
+	writer->threaded = threaded && sink->type != CWG_SINK_MEMORY;
+	writer->pos = 0;
+	writer->start = 0;
+	writer->end = SIZE_MAX;
+	writer->queue = NULL;
+	writer->head = 0;
+	writer->used = 0;
+	writer->done = false;
+	writer->status = CW_OK;
+	if (!writer->threaded) { return CW_OK; }
+
+	if ((writer->queue = malloc(WRITER_QUEUE_BYTES)) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	if (pthread_mutex_init(&writer->lock, NULL) != 0) { perror("pthread_mutex_init() failed"); free(writer->queue); return CW_SYS_ERR; }
+	if (pthread_cond_init(&writer->cond, NULL) != 0) {
+		perror("pthread_cond_init() failed");
+		pthread_mutex_destroy(&writer->lock);
+		free(writer->queue);
+		return CW_SYS_ERR;
+	}
+	if (pthread_create(&writer->thread, NULL, &writerWorker, writer) != 0) {
+		perror("pthread_create() failed");
+		pthread_cond_destroy(&writer->cond);
+		pthread_mutex_destroy(&writer->lock);
+		free(writer->queue);
+		return CW_SYS_ERR;
 	}
-	
 	return CW_OK;
 }
 
+static CW_STATUS finish_CWG_writer(struct CWG_writer *writer) {
+	if (!writer->threaded) { return writer->status; }
+
+	pthread_mutex_lock(&writer->lock);
+	writer->done = true;
+	pthread_cond_broadcast(&writer->cond);
+	pthread_mutex_unlock(&writer->lock);
+	pthread_join(writer->thread, NULL);
+
+	pthread_cond_destroy(&writer->cond);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer->queue);
+	writer->queue = NULL;
+	return writer->status;
+}
+
+static CW_STATUS writerWriteHexDataStr(struct CWG_writer *writer, const char *hexDataStr, int suffixLen) {
+	size_t hexLen = strlen(hexDataStr);
+	if (hexLen < suffixLen) { return CWG_FILE_ERR; }
+
+	// narrows the bytes written to those within the writer's range
+	size_t at = writer->pos;
+	size_t byteLen = (hexLen-suffixLen)/2;
+	size_t from = at > writer->start ? at : writer->start;
+	size_t to = at+byteLen < writer->end ? at+byteLen : writer->end;
+	writer->pos += byteLen;
+	if (to <= from) { return CW_OK; }
+	hexDataStr += HEX_CHARS((from-at));
+	suffixLen += HEX_CHARS((at+byteLen-to));
+
+	if (!writer->threaded) { return writeHexDataStr(hexDataStr, suffixLen, writer->sink); }
+
+	char fileByteData[strlen(hexDataStr)/2];
+	int bytesToWrite;
+	if ((bytesToWrite = hexStrToByteArr(hexDataStr, suffixLen, fileByteData)) < 0) { return CWG_FILE_ERR; }
+
+	CW_STATUS status;
+	size_t written = 0;
+	size_t tail;
+	size_t n;
+	pthread_mutex_lock(&writer->lock);
+	while (written < bytesToWrite && writer->status == CW_OK) {
+		if (writer->used == WRITER_QUEUE_BYTES) { pthread_cond_wait(&writer->cond, &writer->lock); continue; }
+
+		// fills the free space up to the end of the ring buffer, then from its start
+		tail = (writer->head+writer->used) % WRITER_QUEUE_BYTES;
+		n = tail >= writer->head ? WRITER_QUEUE_BYTES-tail : writer->head-tail;
+		if (n > bytesToWrite-written) { n = bytesToWrite-written; }
+		memcpy(writer->queue+tail, fileByteData+written, n);
+		writer->used += n;
+		written += n;
+		pthread_cond_broadcast(&writer->cond);
+	}
+	status = writer->status;
+	pthread_mutex_unlock(&writer->lock);
+	return status;
+}
+
+static void *writerWorker(void *arg) {
+	struct CWG_writer *writer = (struct CWG_writer *)arg;
+
+	size_t n;
+	ssize_t wrote;
+	pthread_mutex_lock(&writer->lock);
+	while (true) {
+		if (!writer->used) {
+			if (writer->done) { break; }
+			pthread_cond_wait(&writer->cond, &writer->lock);
+			continue;
+		}
+
+		// what is queued isn't overwritten until freed below, so it can be written without holding the lock
+		n = writer->head+writer->used > WRITER_QUEUE_BYTES ? WRITER_QUEUE_BYTES-writer->head : writer->used;
+		pthread_mutex_unlock(&writer->lock);
+		wrote = sinkWriteSome(writer->sink, writer->queue+writer->head, n);
+		pthread_mutex_lock(&writer->lock);
+		if (wrote <= 0) {
+			if (wrote < 0 && writer->sink->type == CWG_SINK_FD) {
+				if (errno == EINTR) { continue; }
+				perror("write() failed");
+			}
+			writer->status = CWG_WRITE_ERR;
+			writer->used = 0;
+			pthread_cond_broadcast(&writer->cond);
+			break;
+		}
+		writer->head = (writer->head+wrote) % WRITER_QUEUE_BYTES;
+		writer->used -= wrote;
+		pthread_cond_broadcast(&writer->cond);
+	}
+	pthread_mutex_unlock(&writer->lock);
+	return NULL;
+}
+
+static void *linkFetchWorker(void *arg) {
+	struct CWG_link_fetch *lf = (struct CWG_link_fetch *)arg;
+	char *txidPtr = lf->txid;
+	lf->status = fetchHexData((const char **)&txidPtr, 1, BY_TXID, lf->params, NULL, lf->hexData);
+	return NULL;
+}
+
+static inline bool fetchesConcurrent(struct CWG_params *params) {
+	return params->fetcher ? params->fetcher->concurrency > 1 : !(params->mongodb || params->mongodbCli || params->mongodbCliPool);
+}
+
 static CW_STATUS hexResolveMetadata(const char *hexData, struct CW_file_metadata *md) {
 	int hexDataLen = strlen(hexData);
 	if (hexDataLen < CW_METADATA_CHARS) { return CWG_METADATA_NO; }
@@ -733,101 +1394,150 @@ static CW_STATUS hexResolveMetadata(const char *hexData, struct CW_file_metadata
 	return CW_OK;
 }
 
-static CW_STATUS traverseFileTree(const char *treeHexData, List *partialTxids[], int suffixLen, int depth,
-			    	  struct CWG_params *params, struct CW_file_metadata *md, int fd) {
-	char *partialTxid;
-	size_t partialTxidFill = partialTxids != NULL && (partialTxid = popFront(partialTxids[0])) != NULL ?
-			      	 CW_TXID_CHARS-strlen(partialTxid) : 0;	
-	
-	size_t numChars = strlen(treeHexData+partialTxidFill)-suffixLen;
-	size_t txidsCount = numChars/CW_TXID_CHARS + (partialTxidFill ? 1 : 0);
-	if (!txidsCount && depth) { return CWG_FILE_ERR; }
+static CW_STATUS init_CWG_tree_stream(struct CWG_tree_stream *ts, int depth, struct CWG_params *params, struct CWG_writer *writer) {
+	ts->depth = depth;
+	ts->leavesWritten = false;
+	ts->params = params;
+	ts->writer = writer;
+	ts->walk = NULL;
+	if ((ts->levels = calloc(depth+1, sizeof(struct CWG_tree_level))) == NULL) { perror("calloc failed"); return CW_SYS_ERR; }
+	for (int i=0; i<=depth; i++) { ts->levels[i].endTx = SIZE_MAX; }
+
+	// level 0 holds a single TX's data at a time; the others, a window of TXs
+	size_t size;
+	for (int i=0; i<=depth; i++) {
+		size = CW_TXID_CHARS + (i > 0 ? TREE_PREFETCH_WINDOW : 1)*CW_TX_DATA_CHARS + 1;
+		if ((ts->levels[i].hexData = malloc(size)) == NULL) { perror("malloc failed"); destroy_CWG_tree_stream(ts); return CW_SYS_ERR; }
+	}
+	return CW_OK;
+}
 
-	CW_STATUS status = CW_OK;
+static void destroy_CWG_tree_stream(struct CWG_tree_stream *ts) {
+	for (int i=0; i<=ts->depth; i++) { if (ts->levels[i].hexData) { free(ts->levels[i].hexData); } }
+	free(ts->levels);
+	ts->levels = NULL;
+}
+
+static CW_STATUS treeStreamFeed(struct CWG_tree_stream *ts, const char *hexData, int suffixLen) {
+	size_t hexLen = strlen(hexData);
+	if (hexLen < suffixLen || hexLen-suffixLen > CW_TX_DATA_CHARS) { return CWG_FILE_ERR; }
+
+	// the levels are run dry after each feed, so only a partial txid is left at level 0
+	struct CWG_tree_level *root = &ts->levels[0];
+	memmove(root->hexData, root->hexData+root->pos, root->len-root->pos);
+	root->len -= root->pos;
+	root->pos = 0;
+	size_t drop = root->skip < hexLen-suffixLen ? root->skip : hexLen-suffixLen;
+	if (root->len + hexLen-suffixLen-drop > CW_TXID_CHARS + CW_TX_DATA_CHARS) { return CWG_FILE_ERR; }
+	root->skip -= drop;
+	memcpy(root->hexData+root->len, hexData+drop, hexLen-suffixLen-drop);
+	root->len += hexLen-suffixLen-drop;
+
+	size_t fetched;
+	CW_STATUS status;
+	while ((status = treeStreamRefill(ts, ts->depth, &fetched)) == CW_OK && fetched > 0);
+
+	// once a range's TXs at level 1 are all fetched, level 0 is no longer drained, so the leaves must be done by then (unless the tree is malformed)
+	if (status == CW_OK && ts->depth > 1 && ts->levels[1].nextTx >= ts->levels[1].endTx && !treeStreamDone(ts)) { status = CWG_FILE_ERR; }
+	return status;
+}
 
-	char *txids[txidsCount ? txidsCount : 1];
-	for (int i=0; i<txidsCount; i++) {
-		if (status == CW_SYS_ERR) { txids[i] = NULL; } 
-		else if ((txids[i] = malloc(CW_TXID_CHARS+1)) == NULL) { perror("malloc failed"); status  = CW_SYS_ERR; }
+static CW_STATUS treeStreamRefill(struct CWG_tree_stream *ts, int level, size_t *fetched) {
+	*fetched = 0;
+	struct CWG_tree_level *prev = &ts->levels[level-1];
+	struct CWG_tree_level *cur = &ts->levels[level];
+
+	char txidsBuf[TREE_PREFETCH_WINDOW][CW_TXID_CHARS+1];
+	char *txids[TREE_PREFETCH_WINDOW];
+	size_t count = 0;
+	size_t maxCount = cur->endTx-cur->nextTx < TREE_PREFETCH_WINDOW ? cur->endTx-cur->nextTx : TREE_PREFETCH_WINDOW;
+	size_t prevFetched;
+	CW_STATUS status;
+	while (count < maxCount) {
+		if (prev->len-prev->pos >= CW_TXID_CHARS) {
+			memcpy(txidsBuf[count], prev->hexData+prev->pos, CW_TXID_CHARS);
+			txidsBuf[count][CW_TXID_CHARS] = 0;
+			txids[count] = txidsBuf[count];
+			prev->pos += CW_TXID_CHARS;
+			++count;
+			continue;
+		}
+		if (level-1 == 0) { break; }
+		if ((status = treeStreamRefill(ts, level-1, &prevFetched)) != CW_OK) { return status; }
+		if (!prevFetched) { break; }
 	}
-	if (status != CW_OK) { goto cleanup; }
+	if (!count) { return CW_OK; }
 
-	if (partialTxidFill && txidsCount) {
-		strcpy(txids[0], partialTxid);
-		strncat(txids[0], treeHexData, partialTxidFill);
-		free(partialTxid);
+	if (level == ts->depth && ts->walk) {
+		for (size_t i=0; i<count; i++) {
+			if (!manifestAddLeaf(ts->walk->manifest, ts->walk->leaves, txids[i], CW_TX_DATA_BYTES)) { return CW_SYS_ERR; }
+		}
+		strcpy(ts->walk->lastLeaf, txids[count-1]);
+		ts->leavesWritten = true;
+		*fetched = count;
+		return CW_OK;
 	}
-	const char *txidPtr = treeHexData+partialTxidFill;
-	size_t sTxidsCount = (partialTxidFill ? 1 : 0);
-	if (txidsCount < sTxidsCount) { status = CWG_FILE_ERR; goto cleanup; }
-	for (int i=sTxidsCount; i<txidsCount; i++) {
-		strncpy(txids[i], txidPtr, CW_TXID_CHARS);
-		txids[i][CW_TXID_CHARS] = 0;
-		txidPtr += CW_TXID_CHARS;
+
+	memmove(cur->hexData, cur->hexData+cur->pos, cur->len-cur->pos);
+	cur->len -= cur->pos;
+	cur->pos = 0;
+	if ((status = fetchHexData((const char **)txids, count, BY_TXID, ts->params, NULL, cur->hexData+cur->len)) != CW_OK) {
+		return status == CWG_FETCH_NO ? CWG_FILE_DEPTH_ERR : status;
 	}
-	char *partialTxidN = malloc(CW_TXID_CHARS+1);
-	if (!partialTxidN) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
-	partialTxidN[0] = 0; strncat(partialTxidN, txidPtr, numChars-(txidPtr-(treeHexData+partialTxidFill)));
-
-	if (!txidsCount) {
-		if (!addFront(partialTxids[0], partialTxidN)) {
-			perror("mylist addFront() failed");
-			free(partialTxidN);
-			status = CW_SYS_ERR;
-		}
-		goto cleanup;
+	cur->len += strlen(cur->hexData+cur->len);
+	if (cur->skip) { cur->pos = cur->skip < cur->len ? cur->skip : cur->len; cur->skip = 0; }
+	cur->nextTx += count;
+	*fetched = count;
+
+	if (level == ts->depth) {
+		status = writerWriteHexDataStr(ts->writer, cur->hexData, 0);
+		cur->len = 0;
+		ts->leavesWritten = true;
 	}
+	return status;
+}
 
-	// frees the tree hex data if in recursive call
-	if (depth > 0) { free((char *)treeHexData); }
-
-	char *hexDataAll = malloc(CW_TX_DATA_CHARS*txidsCount + 1);
-	if (hexDataAll == NULL) { perror("malloc failed"); status =  CW_SYS_ERR; goto cleanup; }
-	if ((status = fetchHexData((const char **)txids, txidsCount, BY_TXID, params, NULL, hexDataAll)) == CW_OK) { 
-		if (partialTxids != NULL) {
-			if (!addFront(partialTxids[1], partialTxidN)) {
-				perror("mylist addFront() failed");
-				free(partialTxidN);
-				free(hexDataAll);
-				status = CW_SYS_ERR;
-				goto cleanup;
-			}
-		} else { free(partialTxidN); } 
-
-		if (depth+1 < md->depth) {
-			status = traverseFileTree(hexDataAll, partialTxids, 0, depth+1, params, md, fd);
-		} else {
-			status = writeHexDataStr(hexDataAll, 0, fd);
-			free(hexDataAll);
-			if (status != CW_OK) { goto cleanup; }
-
-			if (partialTxids != NULL) {
-				reverseList(partialTxids[1]);
-				List *temp = partialTxids[0];
-				partialTxids[0] = partialTxids[1];
-				partialTxids[1] = temp;
-			}
-		}
-	} else if (status == CWG_FETCH_NO) { status = CWG_FILE_DEPTH_ERR; }
+static void treeStreamSeek(struct CWG_tree_stream *ts) {
+	size_t start = ts->writer->start;
+	size_t end = ts->writer->end;
+	struct CWG_tree_level *level;
+	for (int i=ts->depth; i>0; i--) {
+		level = &ts->levels[i];
+		level->nextTx = start/CW_TX_DATA_BYTES;
+		level->endTx = end == SIZE_MAX ? SIZE_MAX : end/CW_TX_DATA_BYTES + (end % CW_TX_DATA_BYTES > 0);
+
+		// the leaves are narrowed to the range by the writer, so it need only know where they start
+		if (i == ts->depth) { ts->writer->pos = level->nextTx*CW_TX_DATA_BYTES; }
+		else { level->skip = HEX_CHARS((start - level->nextTx*CW_TX_DATA_BYTES)); }
+
+		start = level->nextTx*CW_TXID_BYTES;
+		end = end == SIZE_MAX ? SIZE_MAX : level->endTx*CW_TXID_BYTES;
+	}
+	ts->levels[0].skip = HEX_CHARS(start);
+}
 
-	cleanup:
-		for (int i=0; i<txidsCount; i++) { if (txids[i]) { free(txids[i]); } }
-		return status;
+static inline bool treeStreamDone(struct CWG_tree_stream *ts) {
+	return ts->levels[ts->depth].nextTx >= ts->levels[ts->depth].endTx;
 }
 
-static CW_STATUS traverseFileChain(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, int fd) {
+static CW_STATUS traverseFileChain(const char *txid, const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md,
+				  struct CWG_writer *writer, struct CWG_manifest_walk *walk) {
 	char hexData[CW_TX_DATA_CHARS+1];
 	strcpy(hexData, hexDataStart);
-	char *hexDataNext = malloc(CW_TX_DATA_CHARS+1);
-	if (hexDataNext == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
-	char *txidNext = malloc(CW_TXID_CHARS+1);
-	if (txidNext == NULL) { perror("malloc failed"); free(hexDataNext); return CW_SYS_ERR; }
-
-	List partialTxidsO; List partialTxidsN;
-	List *partialTxids[2] = { &partialTxidsO, &partialTxidsN };
-	initList(partialTxids[0]); initList(partialTxids[1]);
+	char linkTxid[CW_TXID_CHARS+1]; linkTxid[0] = 0;
+	if (txid) { strncat(linkTxid, txid, CW_TXID_CHARS); }
+	struct CWG_link_fetch next;
+	next.params = params;
+	if ((next.hexData = malloc(CW_TX_DATA_CHARS+1)) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
 
+	struct CWG_tree_stream ts;
 	CW_STATUS status;
+	if (md->depth > 0 && (status = init_CWG_tree_stream(&ts, md->depth, params, writer)) != CW_OK) { free(next.hexData); return status; }
+	if (md->depth > 0) { ts.walk = walk; }
+	if (md->depth > 0 && writer) { treeStreamSeek(&ts); }
+
+	bool pipelined = fetchesConcurrent(params);
+	bool fetching;
 	int suffixLen;
 	bool end = false;
 	for (int i=0; i <= md->length; i++) {
@@ -844,35 +1554,228 @@ static CW_STATUS traverseFileChain(const char *hexDataStart, struct CWG_params *
 		}
 	
 		if (strlen(hexData) < suffixLen) { status = CWG_FILE_ERR; goto cleanup; }
+
+		// the next link is fetched while this one is expanded/written, as neither depends on the other
+		fetching = false;
 		if (!end) {
-			strncpy(txidNext, hexData+(strlen(hexData) - suffixLen), CW_TXID_CHARS);
-			txidNext[CW_TXID_CHARS] = 0;
-			if ((status = fetchHexData((const char **)&txidNext, 1, BY_TXID, params, NULL, hexDataNext)) == CWG_FETCH_NO) {
-				status = CWG_FILE_LEN_ERR;	
-				goto cleanup;
-			} else if (status != CW_OK) { goto cleanup; }
+			strncpy(next.txid, hexData+(strlen(hexData) - suffixLen), CW_TXID_CHARS);
+			next.txid[CW_TXID_CHARS] = 0;
+			if (pipelined && pthread_create(&next.thread, NULL, &linkFetchWorker, &next) == 0) { fetching = true; }
+			else { linkFetchWorker(&next); }
 		}
 
-		if (!md->depth) {
-			if ((status = writeHexDataStr(hexData, suffixLen, fd)) != CW_OK) { goto cleanup; }
-		} else {
-			if ((status = traverseFileTree(hexData, partialTxids, suffixLen, 0, params, md, fd)) != CW_OK) {
+		if (md->depth) { status = treeStreamFeed(&ts, hexData, suffixLen); }
+		else if (walk) { status = manifestAddLeaf(walk->manifest, walk->leaves, linkTxid, (strlen(hexData)-suffixLen)/2) ? CW_OK : CW_SYS_ERR; }
+		else { status = writerWriteHexDataStr(writer, hexData, suffixLen); }
+		if (fetching) { pthread_join(next.thread, NULL); }
+		if (status != CW_OK) { goto cleanup; }
+
+		// the links after the range being written needn't be walked
+		if (writer && (md->depth > 0 ? treeStreamDone(&ts) : writer->pos >= writer->end)) { break; }
+
+		if (!end) {
+			if (next.status == CWG_FETCH_NO) {
+				status = CWG_FILE_LEN_ERR;	
 				goto cleanup;
-			}
-		} 
-		memcpy(hexData, hexDataNext, sizeof(hexData));
+			} else if ((status = next.status) != CW_OK) { goto cleanup; }
+		}
+		memcpy(hexData, next.hexData, sizeof(hexData));
+		strcpy(linkTxid, next.txid);
 	}
+	if (md->depth > 0 && !ts.leavesWritten) { status = CWG_FILE_ERR; }
 	
 	cleanup:
-		removeAllNodes(partialTxids[0], true); removeAllNodes(partialTxids[1], true);
-		free(txidNext);
-		free(hexDataNext);
+		if (md->depth > 0) { destroy_CWG_tree_stream(&ts); }
+		free(next.hexData);
 		return status;
 }
 
-static inline CW_STATUS traverseFile(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, int fd) {
-	return md->length > 0 || md->depth == 0 ? traverseFileChain(hexDataStart, params, md, fd)
-						: traverseFileTree(hexDataStart, NULL, CW_METADATA_CHARS, 0, params, md, fd);
+static inline CW_STATUS traverseFile(const char *hexDataStart, struct CWG_params *params, struct CW_file_metadata *md, size_t offset, size_t length, struct CWG_sink *sink) {
+	struct CWG_writer writer;
+	CW_STATUS status;
+	if ((status = init_CWG_writer(&writer, sink, md->length > 0 || md->depth > 0)) != CW_OK) { return status; }
+	writer.start = offset;
+	writer.end = length < SIZE_MAX-offset ? offset+length : SIZE_MAX;
+
+	if (md->length > 0 || md->depth == 0) { status = traverseFileChain(NULL, hexDataStart, params, md, &writer, NULL); }
+	else {
+		struct CWG_tree_stream ts;
+		if ((status = init_CWG_tree_stream(&ts, md->depth, params, &writer)) == CW_OK) {
+			treeStreamSeek(&ts);
+			if ((status = treeStreamFeed(&ts, hexDataStart, CW_METADATA_CHARS)) == CW_OK && !ts.leavesWritten) { status = CWG_FILE_ERR; }
+			destroy_CWG_tree_stream(&ts);
+		}
+	}
+
+	CW_STATUS writeStatus = finish_CWG_writer(&writer);
+	return status != CW_OK ? status : writeStatus;
+}
+
+static bool manifestAddLeaf(struct CWG_file_manifest *manifest, bool leaves, const char *txid, size_t size) {
+	// grows by doubling, so space is only added when count reaches a power of two
+	if (leaves && (!manifest->count || (manifest->count >= MANIFEST_ALLOC_MIN && (manifest->count & (manifest->count-1)) == 0))) {
+		size_t alloc = manifest->count ? manifest->count*2 : MANIFEST_ALLOC_MIN;
+		char (*txids)[CW_TXID_CHARS+1];
+		size_t *sizes;
+		if ((txids = realloc(manifest->txids, alloc*sizeof(*txids))) == NULL) { perror("realloc failed"); return false; }
+		manifest->txids = txids;
+		if ((sizes = realloc(manifest->sizes, alloc*sizeof(*sizes))) == NULL) { perror("realloc failed"); return false; }
+		manifest->sizes = sizes;
+	}
+
+	if (leaves) {
+		strcpy(manifest->txids[manifest->count], txid);
+		manifest->sizes[manifest->count] = size;
+	}
+	++manifest->count;
+	manifest->size += size;
+	return true;
+}
+
+static CW_STATUS walkFileManifest(const char *txid, const char *hexDataStart, struct CW_file_metadata *md, struct CWG_params *params,
+				  struct CWG_file_manifest *manifest, bool leaves) {
+	struct CWG_manifest_walk walk;
+	walk.manifest = manifest;
+	walk.leaves = leaves;
+	walk.lastLeaf[0] = 0;
+	copy_CW_file_metadata(&manifest->metadata, md);
+	manifest->count = 0;
+	manifest->size = 0;
+
+	CW_STATUS status;
+	if (md->length > 0 || md->depth == 0) { status = traverseFileChain(txid, hexDataStart, params, md, NULL, &walk); }
+	else {
+		struct CWG_tree_stream ts;
+		if ((status = init_CWG_tree_stream(&ts, md->depth, params, NULL)) != CW_OK) { return status; }
+		ts.walk = &walk;
+		if ((status = treeStreamFeed(&ts, hexDataStart, CW_METADATA_CHARS)) == CW_OK && !ts.leavesWritten) { status = CWG_FILE_ERR; }
+		destroy_CWG_tree_stream(&ts);
+	}
+	if (status != CW_OK || md->depth == 0) { return status; }
+
+	// the leaves of a tree are full but for the last, so only it need be fetched for the file's size
+	char hexData[CW_TX_DATA_CHARS+1];
+	const char *lastLeaf = walk.lastLeaf;
+	if ((status = fetchHexData(&lastLeaf, 1, BY_TXID, params, NULL, hexData)) != CW_OK) { return status == CWG_FETCH_NO ? CWG_FILE_DEPTH_ERR : status; }
+	size_t lastSize = strlen(hexData)/2;
+	manifest->size = manifest->size - CW_TX_DATA_BYTES + lastSize;
+	if (leaves) { manifest->sizes[manifest->count-1] = lastSize; }
+	return CW_OK;
+}
+
+static CW_STATUS writeManifestRange(struct CWG_file_manifest *manifest, struct CWG_params *params, size_t offset, size_t length, struct CWG_sink *sink) {
+	struct CWG_writer writer;
+	CW_STATUS status;
+	if ((status = init_CWG_writer(&writer, sink, manifest->count > 1)) != CW_OK) { return status; }
+	writer.start = offset;
+	writer.end = length < SIZE_MAX-offset ? offset+length : SIZE_MAX;
+
+	// a chained tree's leaves are those of the tree, while a plain chain's are its links
+	struct CW_file_metadata *md = &manifest->metadata;
+	bool links = md->depth == 0;
+
+	size_t first = 0;
+	while (first < manifest->count && writer.pos+manifest->sizes[first] <= offset) { writer.pos += manifest->sizes[first++]; }
+
+	char *hexDataAll;
+	if ((hexDataAll = malloc(TREE_PREFETCH_WINDOW*CW_TX_DATA_CHARS+1)) == NULL) { perror("malloc failed"); finish_CWG_writer(&writer); return CW_SYS_ERR; }
+	const char *txids[TREE_PREFETCH_WINDOW];
+	char leafHex[CW_TX_DATA_CHARS+1];
+	const char *hexDataPtr;
+	size_t leafLen;
+	int suffixLen;
+	size_t count;
+	for (size_t i=first; i<manifest->count && writer.pos < writer.end; i+=count) {
+		count = manifest->count-i < TREE_PREFETCH_WINDOW ? manifest->count-i : TREE_PREFETCH_WINDOW;
+		for (int j=0; j<count; j++) { txids[j] = manifest->txids[i+j]; }
+		if ((status = fetchHexData(txids, count, BY_TXID, params, NULL, hexDataAll)) != CW_OK) {
+			if (status == CWG_FETCH_NO) { status = links ? CWG_FILE_LEN_ERR : CWG_FILE_DEPTH_ERR; }
+			break;
+		}
+
+		hexDataPtr = hexDataAll;
+		for (int j=0; j<count && status == CW_OK; j++) {
+			suffixLen = 0;
+			if (links && i+j == 0) { suffixLen = CW_METADATA_CHARS + CW_TXID_CHARS; }
+			else if (links && i+j < md->length) { suffixLen = CW_TXID_CHARS; }
+			leafLen = HEX_CHARS(manifest->sizes[i+j]) + suffixLen;
+			if (strlen(hexDataPtr) < leafLen) { status = CWG_FILE_ERR; break; }
+			memcpy(leafHex, hexDataPtr, leafLen);
+			leafHex[leafLen] = 0;
+			hexDataPtr += leafLen;
+			status = writerWriteHexDataStr(&writer, leafHex, suffixLen);
+		}
+		if (status != CW_OK) { break; }
+	}
+	free(hexDataAll);
+
+	CW_STATUS writeStatus = finish_CWG_writer(&writer);
+	return status != CW_OK ? status : writeStatus;
+}
+
+static CW_STATUS treeLevelReadHex(const char *rootHex, int level, size_t from, size_t to, struct CWG_params *params, char *hexData) {
+	if (level == 0) {
+		if (HEX_CHARS(to) > strlen(rootHex)) { return CWG_FILE_ERR; }
+		memcpy(hexData, rootHex+HEX_CHARS(from), HEX_CHARS((to-from)));
+		hexData[HEX_CHARS((to-from))] = 0;
+		return CW_OK;
+	}
+
+	// the level's TXs are full but for the last, so those holding the range are known by its offsets alone
+	size_t first = from/CW_TX_DATA_BYTES;
+	size_t count = (to-1)/CW_TX_DATA_BYTES - first + 1;
+	char txidsHex[count*CW_TXID_CHARS+1];
+	CW_STATUS status;
+	if ((status = treeLevelReadHex(rootHex, level-1, first*CW_TXID_BYTES, (first+count)*CW_TXID_BYTES, params, txidsHex)) != CW_OK) { return status; }
+
+	char txidsBuf[count][CW_TXID_CHARS+1];
+	char *txids[count];
+	for (size_t i=0; i<count; i++) {
+		memcpy(txidsBuf[i], txidsHex+i*CW_TXID_CHARS, CW_TXID_CHARS);
+		txidsBuf[i][CW_TXID_CHARS] = 0;
+		txids[i] = txidsBuf[i];
+	}
+	char txsHex[count*CW_TX_DATA_CHARS+1];
+	if ((status = fetchHexData((const char **)txids, count, BY_TXID, params, NULL, txsHex)) != CW_OK) {
+		return status == CWG_FETCH_NO ? CWG_FILE_DEPTH_ERR : status;
+	}
+	if (strlen(txsHex) < HEX_CHARS((to - first*CW_TX_DATA_BYTES))) { return CWG_FILE_ERR; }
+
+	memcpy(hexData, txsHex+HEX_CHARS((from - first*CW_TX_DATA_BYTES)), HEX_CHARS((to-from)));
+	hexData[HEX_CHARS((to-from))] = 0;
+	return CW_OK;
+}
+
+static CW_STATUS resolveFileSize(const char *txid, const char *hexDataStart, struct CW_file_metadata *md, struct CWG_params *params, size_t *size) {
+	CW_STATUS status;
+	if (md->length > 0 || md->depth == 0) {
+		struct CWG_file_manifest manifest;
+		init_CWG_file_manifest(&manifest);
+		if ((status = walkFileManifest(txid, hexDataStart, md, params, &manifest, false)) == CW_OK) { *size = manifest.size; }
+		return status;
+	}
+
+	size_t rootLen = strlen(hexDataStart) - CW_METADATA_CHARS;
+	char rootHex[rootLen+1];
+	memcpy(rootHex, hexDataStart, rootLen);
+	rootHex[rootLen] = 0;
+
+	// each level holds as many TXs as the level before holds txids, all full but the last, whose txid is the last of the level before
+	size_t levelSize = rootLen/2;
+	char lastTxid[CW_TXID_CHARS+1];
+	const char *lastTxidPtr = lastTxid;
+	char lastHexData[CW_TX_DATA_CHARS+1];
+	for (int i=1; i<=md->depth; i++) {
+		if (levelSize < CW_TXID_BYTES || levelSize % CW_TXID_BYTES) { return CWG_FILE_ERR; }
+		if ((status = treeLevelReadHex(rootHex, i-1, levelSize-CW_TXID_BYTES, levelSize, params, lastTxid)) != CW_OK) { return status; }
+		if ((status = fetchHexData(&lastTxidPtr, 1, BY_TXID, params, NULL, lastHexData)) != CW_OK) {
+			return status == CWG_FETCH_NO ? CWG_FILE_DEPTH_ERR : status;
+		}
+		levelSize = (levelSize/CW_TXID_BYTES - 1)*CW_TX_DATA_BYTES + strlen(lastHexData)/2;
+	}
+
+	*size = levelSize;
+	return CW_OK;
 }
 
 static inline void freeFdStack(List *fdStack) {
@@ -885,27 +1788,26 @@ static inline void freeFdStack(List *fdStack) {
 	}
 }
 
-static inline CW_STATUS writePathLink(const char *pathR, const char *linkR, int fd) {
+static inline CW_STATUS writePathLink(const char *pathR, const char *linkR, struct CWG_sink *sink) {
 	const char *path = pathR[0] == '/' ? pathR+1 : pathR;
 	const char *link = linkR[0] == '/' ? linkR+1 : linkR;
 	size_t pathLen = strlen(path);
 	size_t linkLen = strlen(link);
 
-	ssize_t n;
-	if ((n = write(fd, "/", 1)) < 1 ||
-	    (n = write(fd, path, pathLen)) < pathLen ||
-	    (n = write(fd, "\n", 1)) < 1 ||
-	    (n = write(fd, "./", 2)) < 2 ||
-	    (n = write(fd, link, linkLen)) < linkLen ||
-	    (n = write(fd, "\n", 1)) < 1) {
-		if (n < 0) { perror("write() failed"); }
-		return CWG_WRITE_ERR;
+	CW_STATUS status;
+	if ((status = sinkWrite(sink, "/", 1)) != CW_OK ||
+	    (status = sinkWrite(sink, path, pathLen)) != CW_OK ||
+	    (status = sinkWrite(sink, "\n", 1)) != CW_OK ||
+	    (status = sinkWrite(sink, "./", 2)) != CW_OK ||
+	    (status = sinkWrite(sink, link, linkLen)) != CW_OK ||
+	    (status = sinkWrite(sink, "\n", 1)) != CW_OK) {
+		return status;
 	}
 
 	return CW_OK;
 }
 
-static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, List *fdStack, struct CWG_script_pack *sp, struct CWG_params *params, int fd) {
+static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, List *fdStack, struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink) {
 	switch (c) {
 		case CW_OP_TERM:
 			return CWG_SCRIPT_NO;
@@ -923,7 +1825,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 				char nextRevTxid[CW_TXID_CHARS+1]; char *nextRevTxidPtr = nextRevTxid;
 
 				CW_STATUS status;
-				if ((status = getScriptByInTxid(sp->revTxid, params, &nextRevTxidPtr, nextScriptStream)) != CW_OK) {
+				if ((status = getScriptByRevision(sp->revTxid, sp, params, &nextRevTxidPtr, nextScriptStream)) != CW_OK) {
 					fclose(nextScriptStream);
 					if (status == CWG_FETCH_NO) { return CWG_SCRIPT_REV_NO; }
 					return status;
@@ -936,7 +1838,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 				if (sp->infoCounter) { sp->infoCounter->revision = spN.atRev; }
 			}
 
-			CW_STATUS status = execScript(&spN, params, fd);
+			CW_STATUS status = execScript(&spN, params, sink);
 
 			if (nextScriptStream) { fclose(nextScriptStream); }
 			return status;
@@ -966,7 +1868,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 				if (!addFront(&sp->infoCounter->txidRefs, txid)) { perror("mylist addFront() failed"); free(txid); return CW_SYS_ERR; }
 				return CW_OK;
 			}
-			CW_STATUS status = getFileByTxid(txid, sp->fetchedNames, params, NULL, fd);
+			CW_STATUS status = getFileByTxid(txid, sp->fetchedNames, params, NULL, sink);
 
 			free(txid);
 			if (status == CWG_FETCH_NO) { return CWG_SCRIPT_ERR; }
@@ -984,7 +1886,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 				if (!addFront(&sp->infoCounter->nameRefs, name)) { perror("mylist addFront() failed"); free(name); return CW_SYS_ERR; }
 				return CW_OK;
 			}
-			CW_STATUS status = getFileByNametag(name, CW_REV_LATEST, sp->fetchedNames, params, NULL, fd);
+			CW_STATUS status = getFileByNametag(name, CW_REV_LATEST, sp->fetchedNames, params, NULL, sink);
 
 			free(name);
 			if (status == CWG_FETCH_NO || status == CW_CALL_NO) { return CWG_SCRIPT_ERR; }
@@ -1040,7 +1942,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 			init_CWG_script_pack(&spD, &scriptStreams, sp->fetchedNames, NULL, sp->atRev-1);
 			spD.infoCounter = sp->infoCounter;
 
-			status = execScriptStart(&spD, params, fd);
+			status = execScriptStart(&spD, params, sink);
 
 			n = sp->scriptStreams->head;
 			while (n) {
@@ -1115,9 +2017,11 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 			}
 
 			CW_STATUS status;		
-			void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
+			void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
 			params->foundHandler = NULL;
-			status = execScriptCode(writeOp, scriptStream, stack, fdStack, sp, params, tfd);
+			struct CWG_sink tsink;
+			init_CWG_sink_fd(&tsink, tfd);
+			status = execScriptCode(writeOp, scriptStream, stack, fdStack, sp, params, &tsink);
 			params->foundHandler = savePtr;
 			if (status != CW_OK)  { close(tfd); return status; }	
 
@@ -1222,20 +2126,16 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 			size_t toWrite = (size_t)some;
 			if (toWrite == 0 && !writeAll) { return CWG_SCRIPT_ERR; }
 
-			if (params->foundHandler != NULL) { params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL; }
+			if (params->foundHandler != NULL) { params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL; }
 
 			char buf[FILE_DATA_BUF];
 			size_t maxWriteChunk = toWrite < sizeof(buf) && !writeAll ? toWrite : sizeof(buf);
 			size_t writeChunk = toWrite < maxWriteChunk && !writeAll ? toWrite : maxWriteChunk;
 			ssize_t r;
-			ssize_t w;
 			while ((toWrite > 0 || writeAll) && (r = read(tfd, buf, writeChunk)) > 0) {
-				if ((w = write(fd, buf, r)) < r) {
-					if (w < 0) { perror("write() failed"); }
-					return CWG_WRITE_ERR;
-				}
+				if ((status = sinkWrite(sink, buf, r)) != CW_OK) { return status; }
 				if (!writeAll) {
-					toWrite -= w;
+					toWrite -= r;
 					writeChunk = toWrite < maxWriteChunk ? toWrite : maxWriteChunk;
 				}
 			}
@@ -1266,7 +2166,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 
 			CW_STATUS status = CW_OK;
 
-			if (!params->foundHandler) { status = writePathLink(pathS, linkS, fd); }
+			if (!params->foundHandler) { status = writePathLink(pathS, linkS, sink); }
 
 			free(linkS);
 			free(pathS);	
@@ -1313,7 +2213,7 @@ static CW_STATUS execScriptCode(CW_OPCODE c, FILE *scriptStream, List *stack, Li
 	}
 }
 
-static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *params, int fd) {
+static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink) {
 	FILE *scriptStream;
 	if (sp->revTxid) {
 		if ((scriptStream = peekFront(sp->scriptStreams)) == NULL) {
@@ -1340,11 +2240,11 @@ static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *param
 	while ((c = getc(scriptStream)) != EOF) {
 		code = (CW_OPCODE)c;
 		// if script is invalid, will attempt to replace with next revision; if it isn't there, will return CWG_SCRIPT_ERR
-		if ((status = execScriptCode(code, scriptStream, &stack, &fdStack, sp, params, fd)) == CWG_SCRIPT_ERR) {
+		if ((status = execScriptCode(code, scriptStream, &stack, &fdStack, sp, params, sink)) == CWG_SCRIPT_ERR) {
 			removeAllNodes(&stack, true);
 			freeFdStack(&fdStack);
 			
-			if ((status = execScriptCode(CW_OP_NEXTREV, scriptStream, &stack, &fdStack, sp, params, fd)) == CWG_SCRIPT_REV_NO || status == CWG_SCRIPT_ERR) {
+			if ((status = execScriptCode(CW_OP_NEXTREV, scriptStream, &stack, &fdStack, sp, params, sink)) == CWG_SCRIPT_REV_NO || status == CWG_SCRIPT_ERR) {
 				status = CWG_SCRIPT_RETRY_ERR;
 			}
 			goto cleanup;
@@ -1371,23 +2271,50 @@ static CW_STATUS execScript(struct CWG_script_pack *sp, struct CWG_params *param
 		return status;
 }
 
-static inline CW_STATUS execScriptStart(struct CWG_script_pack *sp, struct CWG_params *params, int fd) {
+static inline CW_STATUS execScriptStart(struct CWG_script_pack *sp, struct CWG_params *params, struct CWG_sink *sink) {
 	CW_STATUS status;
-	if ((status = execScript(sp, params, fd)) == CWG_SCRIPT_NO) { status = CW_OK; }
+	if ((status = execScript(sp, params, sink)) == CWG_SCRIPT_NO) { status = CW_OK; }
 	return status;
 }
 
-static CW_STATUS getScriptByInTxid(const char *inTxid, struct CWG_params *params, char **txidPtr, FILE *stream) {
+static CW_STATUS getScriptByRevision(const char *revTxid, struct CWG_script_pack *sp, struct CWG_params *params, char **txidPtr, FILE *stream) {
 	CW_STATUS status;
 
 	char hexDataStart[CW_TX_DATA_CHARS+1];
 	struct CW_file_metadata md;
 
-	if ((status = fetchHexData((const char **)&inTxid, 1, BY_INTXID, params, txidPtr, hexDataStart)) != CW_OK) { return status; }
+	// find the revision following revTxid among those fetched ahead, or else walk ahead from revTxid
+	struct CWG_rev_lookahead *la = sp->revLookahead;
+	size_t rev;
+	for (rev=0; rev<la->count; rev++) {
+		if (strcmp(rev > 0 ? la->txids[rev-1] : la->from, revTxid) == 0) { break; }
+	}
+	if (rev >= la->count) {
+		size_t revs = sp->maxRev >= 0 && sp->maxRev-sp->atRev < REV_LOOKAHEAD ? sp->maxRev-sp->atRev : REV_LOOKAHEAD;
+		char *txids[REV_LOOKAHEAD];
+		for (int i=0; i<REV_LOOKAHEAD; i++) { txids[i] = la->txids[i]; }
+
+		la->count = 0;
+		la->from[0] = 0;
+		strncat(la->from, revTxid, CW_TXID_CHARS);
+		if ((status = fetchHexDataRevisions(la->from, revs, params, txids, la->hexDataAll, la->itemInfo)) != CW_OK) { return status; }
+		for (size_t offset=0; la->count<revs && la->itemInfo[la->count].hexLen != FETCH_ITEM_LEN_UNKNOWN; la->count++) {
+			la->hexOffsets[la->count] = offset;
+			offset += la->itemInfo[la->count].hexLen;
+		}
+		rev = 0;
+	}
+
+	memcpy(hexDataStart, la->hexDataAll+la->hexOffsets[rev], la->itemInfo[rev].hexLen);
+	hexDataStart[la->itemInfo[rev].hexLen] = 0;
+	if (txidPtr) { strcpy(txidPtr[0], la->txids[rev]); }
+
 	if ((status = hexResolveMetadata(hexDataStart, &md)) != CW_OK) { return status; }
 	protocolCheck(md.pVer);
 
-	return traverseFile(hexDataStart, params, &md, fileno(stream));
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fileno(stream));
+	return traverseFile(hexDataStart, params, &md, 0, SIZE_MAX, &sink);
 }
 
 static CW_STATUS getScriptByNametag(const char *name, struct CWG_params *params, char **txidPtr, FILE *stream) {
@@ -1404,33 +2331,53 @@ static CW_STATUS getScriptByNametag(const char *name, struct CWG_params *params,
 	char nametag[strlen(CW_NAMETAG_PREFIX) + strlen(name) + 1]; nametag[0] = 0;
 	strcat(nametag, CW_NAMETAG_PREFIX);
 	strcat(nametag, name);
-	char *nametagPtr = nametag;
 
 	// gets the nths occurrence of nametag; skips any claim that is invalid cashweb file (NOT invalid script) to avoid mistaken claims
-	int nth = 1;
+	// claims are fetched NAMETAG_CLAIMS_BATCH at a time, and more are only fetched if all of those are skipped
+	char txidsBuf[NAMETAG_CLAIMS_BATCH][CW_TXID_CHARS+1];
+	char *txids[NAMETAG_CLAIMS_BATCH];
+	for (int i=0; i<NAMETAG_CLAIMS_BATCH; i++) { txids[i] = txidsBuf[i]; }
+	struct FetchItemInfo itemInfo[NAMETAG_CLAIMS_BATCH];
+	char hexDataAll[NAMETAG_CLAIMS_BATCH*CW_TX_DATA_CHARS+1];
+	const char *hexDataPtr;
+	size_t nth = 1;
+	size_t claim;
+	struct CWG_sink sink;
+	init_CWG_sink_fd(&sink, fileno(stream));
 	do {
-		if ((status = fetchHexData((const char **)&nametagPtr, nth++, BY_NAMETAG, params, txidPtr, hexDataStart)) != CW_OK) { continue; }
-		if ((status = hexResolveMetadata(hexDataStart, &md)) != CW_OK) { continue; }
-		protocolCheck(md.pVer);
-		status = traverseFile(hexDataStart, params, &md, fileno(stream));
+		if ((status = fetchHexDataClaims(nametag, nth, NAMETAG_CLAIMS_BATCH, params, txids, hexDataAll, itemInfo)) != CW_OK) { break; }
+		hexDataPtr = hexDataAll;
+		status = CWG_FILE_ERR;
+		for (claim=0; claim<NAMETAG_CLAIMS_BATCH && itemInfo[claim].hexLen != FETCH_ITEM_LEN_UNKNOWN && (status == CWG_FILE_ERR || status == CWG_METADATA_NO); claim++) {
+			memcpy(hexDataStart, hexDataPtr, itemInfo[claim].hexLen);
+			hexDataStart[itemInfo[claim].hexLen] = 0;
+			hexDataPtr += itemInfo[claim].hexLen;
+			if (txidPtr) { strcpy(txidPtr[0], txids[claim]); }
+
+			if (itemInfo[claim].hexLen < 1) { continue; } // claim isn't cashweb-formatted
+			if ((status = hexResolveMetadata(hexDataStart, &md)) != CW_OK) { continue; }
+			protocolCheck(md.pVer);
+			status = traverseFile(hexDataStart, params, &md, 0, SIZE_MAX, &sink);
+		}
+		nth += claim;
 	} while (status == CWG_FILE_ERR || status == CWG_METADATA_NO);
 
 	return status;
 }
 
-static CW_STATUS getFileByPath(FILE *dirFp, const char *path, List *fetchedNames, struct CWG_params *params, int fd) {
+static CW_STATUS getFileByPath(FILE *dirFp, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink) {
 	CW_STATUS status;	
 
 	char *pathId = NULL;
 	char *subPath = NULL;
 	if ((status = CWG_dirindex_path_to_identifier(dirFp, path, &subPath, &pathId)) != CW_OK) { goto foundhandler; }	
 
-	if ((status = getFileByIdPath(pathId, subPath, fetchedNames, params, fd)) == CW_CALL_NO || status == CWG_FETCH_NO) { status = CWG_IS_DIR_NO; }
+	if ((status = getFileByIdPath(pathId, subPath, fetchedNames, params, sink)) == CW_CALL_NO || status == CWG_FETCH_NO) { status = CWG_IS_DIR_NO; }
 
 	foundhandler:
 	if (params->foundHandler != NULL) {
 		if (status == params->foundSuppressErr) { status = CW_OK; }
-		params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL;
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
 	}
 
 	if (subPath) { free(subPath); }
@@ -1438,17 +2385,18 @@ static CW_STATUS getFileByPath(FILE *dirFp, const char *path, List *fetchedNames
 	return status;	
 }
 
-static inline CW_STATUS getFileByNametagPath(const char *name, int revision, const char *path, List *fetchedNames, struct CWG_params *params, int fd) {	
+static inline CW_STATUS getFileByNametagPath(const char *name, int revision, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink) {	
 	struct CWG_getter getter;
 	init_CWG_getter_for_name(&getter, name, revision, fetchedNames, params);
-	return getByGetterPath(&getter, path, fd);
+	return getByGetterPath(&getter, path, sink);
 }
 
-static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedNames, struct CWG_params *params, struct CWG_nametag_counter *counter, int fd) {	
+static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedNames, struct CWG_params *params, struct CWG_nametag_counter *counter, struct CWG_sink *sink) {	
 	CW_STATUS status;	
 
 	char revTxid[CW_TXID_CHARS+1]; char *revTxidPtr = revTxid;
 	FILE *scriptStream = NULL;
+	struct CWG_rev_lookahead *revLookahead = NULL;
 
 	List scriptStreams;
 	initList(&scriptStreams);
@@ -1470,12 +2418,20 @@ static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedN
 	rewind(scriptStream);	
 	if (!addFront(&scriptStreams, scriptStream)) { perror("mylist addFront() failed"); status = CW_SYS_ERR; goto foundhandler; }
 
+	if ((revLookahead = malloc(sizeof(struct CWG_rev_lookahead))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto foundhandler; }
+	revLookahead->count = 0;
+
 	struct CWG_script_pack sp;
 	init_CWG_script_pack(&sp, &scriptStreams, fetchedNames ? fetchedNames : &fetchedNamesN, revTxid, revision);
 	sp.infoCounter = counter;
+	sp.revLookahead = revLookahead;
 	if (!addFront(sp.fetchedNames, (char *)name)) { perror("mylist addFront() failed"); status = CW_SYS_ERR; goto foundhandler; }
 	
-	status = execScriptStart(&sp, params, fd);	
+	// a script may write any number of files, so the size of the first is no use as the size of what's written
+	size_t *saveFileSize = params->saveFileSize;
+	params->saveFileSize = NULL;
+	status = execScriptStart(&sp, params, sink);	
+	params->saveFileSize = saveFileSize;
 
 	// this should have been set NULL if anything was written from script execution; if not, it's deemed a bad script
 	if (status == CW_OK && params->foundHandler != NULL) { status = CWG_SCRIPT_ERR; }
@@ -1483,22 +2439,23 @@ static CW_STATUS getFileByNametag(const char *name, int revision, List *fetchedN
 	foundhandler:
 	if (params->foundHandler != NULL) {
 		if (status == params->foundSuppressErr) { status = CW_OK; }
-		params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL;
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
 	}
 
 	removeAllNodes(&fetchedNamesN, false);
 	removeAllNodes(&scriptStreams, false);
 	if (scriptStream) { fclose(scriptStream); }
+	if (revLookahead) { free(revLookahead); }
 	return status;
 }
 
-static inline CW_STATUS getFileByTxidPath(const char *txid, const char *path, List *fetchedNames, struct CWG_params *params, int fd) {
+static inline CW_STATUS getFileByTxidPath(const char *txid, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink) {
 	struct CWG_getter getter;
 	init_CWG_getter_for_txid(&getter, txid, fetchedNames, params);
-	return getByGetterPath(&getter, path, fd);
+	return getByGetterPath(&getter, path, sink);
 }
 
-static CW_STATUS getFileByTxid(const char *txid, List *fetchedNames, struct CWG_params *params, struct CWG_file_info *counter, int fd) {
+static CW_STATUS getFileByTxid(const char *txid, List *fetchedNames, struct CWG_params *params, struct CWG_file_info *counter, struct CWG_sink *sink) {
 	CW_STATUS status;
 
 	char hexDataStart[CW_TX_DATA_CHARS+1];
@@ -1514,25 +2471,70 @@ static CW_STATUS getFileByTxid(const char *txid, List *fetchedNames, struct CWG_
 
 	if (params->forceDir && md.type != CW_T_DIR) { status = CWG_IS_DIR_NO; goto foundhandler; }
 
+	if (params->saveFileSize && !counter) {
+		if ((status = resolveFileSize(txid, hexDataStart, &md, params, params->saveFileSize)) != CW_OK) { goto foundhandler; }
+	}
+
 	foundhandler:
 	if (params->foundHandler != NULL) {
 		if (status == params->foundSuppressErr) { status = CW_OK; }
-		params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL;
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
 	}
 	if (status != CW_OK) { return status; }
 
 	if (counter) { copy_CW_file_metadata(&counter->metadata, &md); return CW_OK; }
 
-	return traverseFile(hexDataStart, params, &md, fd);
+	return traverseFile(hexDataStart, params, &md, 0, SIZE_MAX, sink);
+}
+
+static CW_STATUS getFileRangeByTxid(const char *txid, size_t offset, size_t length, struct CWG_params *params, struct CWG_sink *sink) {
+	CW_STATUS status;
+
+	char hexDataStart[CW_TX_DATA_CHARS+1];
+	struct CW_file_metadata md;
+	size_t size = SIZE_MAX;
+	struct CWG_file_manifest manifest;
+	init_CWG_file_manifest(&manifest);
+
+	if ((status = fetchHexData((const char **)&txid, 1, BY_TXID, params, NULL, hexDataStart)) != CW_OK) { goto foundhandler; }
+	if ((status = hexResolveMetadata(hexDataStart, &md)) != CW_OK) { goto foundhandler; }
+	protocolCheck(md.pVer);	
+
+	if (params->saveMimeStr && (*params->saveMimeStr)[0] == 0) {
+		if ((status = cwTypeToMimeStr(md.type, params)) != CW_OK) { goto foundhandler; }
+	}	
+
+	// a chained file can only be sized by walking it, so the leaves found on the way are kept to write the range from
+	if (offset == 0 && length == SIZE_MAX && !params->saveFileSize) { size = SIZE_MAX; }
+	else if (md.length > 0) {
+		if ((status = walkFileManifest(txid, hexDataStart, &md, params, &manifest, true)) != CW_OK) { goto foundhandler; }
+		size = manifest.size;
+	}
+	else if ((status = resolveFileSize(txid, hexDataStart, &md, params, &size)) != CW_OK) { goto foundhandler; }
+	if (params->saveFileSize) { *params->saveFileSize = size; }
+	if (offset > 0 && offset >= size) { status = CWG_RANGE_NO; }
+
+	foundhandler:
+	if (params->foundHandler != NULL) {
+		if (status == params->foundSuppressErr) { status = CW_OK; }
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
+	}
+	if (status != CW_OK || !length || offset >= size) { destroy_CWG_file_manifest(&manifest); return status; }
+	if (length > size-offset) { length = size-offset; }
+
+	if (manifest.count > 0) { status = writeManifestRange(&manifest, params, offset, length, sink); }
+	else { status = traverseFile(hexDataStart, params, &md, offset, length, sink); }
+	destroy_CWG_file_manifest(&manifest);
+	return status;
 }
 
-static inline CW_STATUS getFileByIdPath(const char *id, const char *path, List *fetchedNames, struct CWG_params *params, int fd) {
+static inline CW_STATUS getFileByIdPath(const char *id, const char *path, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink) {
 	struct CWG_getter getter;
 	init_CWG_getter_for_id(&getter, id, fetchedNames, params);
-	return getByGetterPath(&getter, path, fd);
+	return getByGetterPath(&getter, path, sink);
 }
 
-static CW_STATUS getFileById(const char *id, List *fetchedNames, struct CWG_params *params, int fd) {
+static CW_STATUS getFileById(const char *id, List *fetchedNames, struct CWG_params *params, struct CWG_sink *sink) {
 	char idEnc[CW_NAMETAG_ID_MAX_LEN+1];
 	const char *path;
 	const char *name;
@@ -1540,15 +2542,15 @@ static CW_STATUS getFileById(const char *id, List *fetchedNames, struct CWG_para
 
 	CW_STATUS status;
 
-	if (CW_is_valid_path_id(id, idEnc, &path)) { status = getFileByIdPath(idEnc, path, fetchedNames, params, fd); }
-	else if (CW_is_valid_nametag_id(id, &rev, &name)) { status = getFileByNametag(name, rev, fetchedNames, params, NULL, fd); }	
-	else if (CW_is_valid_txid(id)) { status = getFileByTxid(id, fetchedNames, params, NULL, fd); }
+	if (CW_is_valid_path_id(id, idEnc, &path)) { status = getFileByIdPath(idEnc, path, fetchedNames, params, sink); }
+	else if (CW_is_valid_nametag_id(id, &rev, &name)) { status = getFileByNametag(name, rev, fetchedNames, params, NULL, sink); }	
+	else if (CW_is_valid_txid(id)) { status = getFileByTxid(id, fetchedNames, params, NULL, sink); }
 	else { status = CW_CALL_NO; goto foundhandler; }
 
 	foundhandler:
 	if (params->foundHandler != NULL) {
 		if (status == params->foundSuppressErr) { status = CW_OK; }
-		params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL;
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
 	}
 
 	return status;
@@ -1587,18 +2589,18 @@ static inline void init_CWG_getter_for_name(struct CWG_getter *cgg, const char *
 	cgg->params = params;
 }
 
-static inline CW_STATUS getByGetter(struct CWG_getter *getter, int fd) {
-	if (getter->byTxid) { return getter->byTxid(getter->id, getter->fetchedNames, getter->params, NULL, fd); }
-	else if (getter->byName) { return getter->byName(getter->name, getter->revision, getter->fetchedNames, getter->params, NULL, fd); }
-	else { return getter->byId(getter->id, getter->fetchedNames, getter->params, fd); }
+static inline CW_STATUS getByGetter(struct CWG_getter *getter, struct CWG_sink *sink) {
+	if (getter->byTxid) { return getter->byTxid(getter->id, getter->fetchedNames, getter->params, NULL, sink); }
+	else if (getter->byName) { return getter->byName(getter->name, getter->revision, getter->fetchedNames, getter->params, NULL, sink); }
+	else { return getter->byId(getter->id, getter->fetchedNames, getter->params, sink); }
 }
 
-static CW_STATUS getByGetterPath(struct CWG_getter *getter, const char *path, int fd) {
+static CW_STATUS getByGetterPath(struct CWG_getter *getter, const char *path, struct CWG_sink *sink) {
 	CW_STATUS status;
 	struct CWG_params *params = getter->params;
 
 	if (path == NULL) {
-		status = getByGetter(getter, fd);
+		status = getByGetter(getter, sink);
 		return status;
 	}	
 
@@ -1607,34 +2609,118 @@ static CW_STATUS getByGetterPath(struct CWG_getter *getter, const char *path, in
 
 	bool saveBool = params->forceDir;
 	params->forceDir = true;
-	void (*savePtr) (CW_STATUS, void *, int) = params->foundHandler;
+	void (*savePtr) (CW_STATUS, void *, struct CWG_sink *) = params->foundHandler;
 	params->foundHandler = NULL;
-	status = getByGetter(getter, fileno(dirFp));
+	struct CWG_sink dirSink;
+	init_CWG_sink_fd(&dirSink, fileno(dirFp));
+	status = getByGetter(getter, &dirSink);
 	params->foundHandler = savePtr;
 	params->forceDir = saveBool;
 
 	if (status != CW_OK) {
 		fclose(dirFp);
-		if (status == params->foundSuppressErr) { status = getByGetterPath(getter, NULL, fd); }
+		if (status == params->foundSuppressErr) { status = getByGetterPath(getter, NULL, sink); }
 		goto foundhandler;
 	}
 
 	rewind(dirFp);	
-	if (params->forceDir || ((status = getFileByPath(dirFp, path, getter->fetchedNames, params, fd)) == CWG_IN_DIR_NO && (path[0] == 0 || strcmp(path, "/") == 0))) {
+	if (params->forceDir || ((status = getFileByPath(dirFp, path, getter->fetchedNames, params, sink)) == CWG_IN_DIR_NO && (path[0] == 0 || strcmp(path, "/") == 0))) {
 		rewind(dirFp);	
-		int copyStatus;
-		if ((copyStatus = copyStreamDataFildes(fd, dirFp)) != COPY_OK) {
-			if (copyStatus == COPY_WRITE_ERR) { status = CWG_WRITE_ERR; }
-			else { status = CW_SYS_ERR; }
-		} else { status = CW_OK; }
+		status = copyStreamToSink(sink, dirFp);
 	}	
 	fclose(dirFp);	
 
 	foundhandler:
 	if (params->foundHandler != NULL) {
 		if (status == params->foundSuppressErr) { status = CW_OK; }
-		params->foundHandler(status, params->foundHandleData, fd); params->foundHandler = NULL;
+		params->foundHandler(status, params->foundHandleData, sink); params->foundHandler = NULL;
 	}
 	
 	return status;
 }
+
+static CW_STATUS bundleRecorderFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items) {
+	struct BundleRecorder *recorder = (struct BundleRecorder *)ctx;
+
+	char txid[CW_TXID_CHARS+1];
+	char *txidPtr = txid;
+	CW_STATUS status;
+	if ((status = fetchHexData(ids, count, (FETCH_TYPE)type, &recorder->source, &txidPtr, hexDataAll)) == CWG_FILE_ERR && type == BY_NAMETAG) {
+		static const unsigned char nullTxid[CW_TXID_BYTES];
+		pthread_mutex_lock(&recorder->lock);
+		bool recorded = indexBuilderAddNametag(recorder->builder, ids[0], strlen(ids[0]), count, nullTxid);
+		pthread_mutex_unlock(&recorder->lock);
+		if (!recorded) { perror("recording fetch to bundle failed"); return CW_SYS_ERR; }
+	}
+	if (status != CW_OK) { return status; }
+	if (txids) { strcpy(txids[0], txid); }
+
+	size_t dataLen = strlen(hexDataAll)/2;
+	unsigned char *data;
+	if ((data = malloc(dataLen ? dataLen : 1)) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	hexStrToByteArr(hexDataAll, 0, (char *)data);
+	unsigned char txidBytes[CW_TXID_BYTES];
+	hexStrToByteArr(txid, 0, (char *)txidBytes);
+	unsigned char inTxidBytes[CW_TXID_BYTES];
+
+	bool recorded;
+	pthread_mutex_lock(&recorder->lock);
+	recorded = indexBuilderAddTx(recorder->builder, txidBytes, data, dataLen);
+	if (recorded && type == BY_INTXID) {
+		hexStrToByteArr(ids[0], 0, (char *)inTxidBytes);
+		recorded = indexBuilderAddSpend(recorder->builder, inTxidBytes, CW_REVISION_INPUT_VOUT, txidBytes);
+	}
+	// a nametag fetch is of its nth claim, so the claim is recorded as nth in order
+	else if (recorded && type == BY_NAMETAG) { recorded = indexBuilderAddNametag(recorder->builder, ids[0], strlen(ids[0]), count, txidBytes); }
+	pthread_mutex_unlock(&recorder->lock);
+
+	free(data);
+	if (!recorded) { perror("recording fetch to bundle failed"); return CW_SYS_ERR; }
+	return CW_OK;
+}
+
+static CW_STATUS bundleRecorderInit(void *ctx) {
+	return initFetcher(&((struct BundleRecorder *)ctx)->source);
+}
+
+static void bundleRecorderCleanup(void *ctx) {
+	cleanupFetcher(&((struct BundleRecorder *)ctx)->source);
+}
+
+static CW_STATUS exportBundleId(const char *id, struct CWG_params *recParams, List *exported) {
+	if (findNode(exported, id, (int (*)(const void *, const void *))&strcmp)) { return CW_OK; }
+	char *idCopy;
+	if ((idCopy = strdup(id)) == NULL) { perror("strdup failed"); return CW_SYS_ERR; }
+	if (!addFront(exported, idCopy)) { perror("mylist addFront() failed"); free(idCopy); return CW_SYS_ERR; }
+
+	FILE *fileFp = NULL;
+	FILE *jsonFp = NULL;
+	json_t *indexJson = NULL;
+	CW_STATUS status;
+	if ((fileFp = tmpfile()) == NULL || (jsonFp = tmpfile()) == NULL) { perror("tmpfile() failed"); status = CW_SYS_ERR; goto cleanup; }
+	if ((status = CWG_get_by_id(id, recParams, fileno(fileFp))) != CW_OK) { goto cleanup; }
+
+	// files that don't parse as directory indexes are done with
+	rewind(fileFp);
+	if (CWG_dirindex_raw_to_json(fileFp, jsonFp) != CW_OK) { goto cleanup; }
+	rewind(jsonFp);
+	json_error_t jsonError;
+	if ((indexJson = json_loadf(jsonFp, 0, &jsonError)) == NULL) {
+		fprintf(CWG_err_stream, "json_loadf() failed on directory index: %s\n", jsonError.text);
+		status = CW_SYS_ERR;
+		goto cleanup;
+	}
+
+	const char *path;
+	json_t *pathId;
+	json_object_foreach(indexJson, path, pathId) {
+		if (!CW_is_valid_cashweb_id(json_string_value(pathId))) { continue; }
+		if ((status = exportBundleId(json_string_value(pathId), recParams, exported)) != CW_OK) { goto cleanup; }
+	}
+
+	cleanup:
+		if (indexJson) { json_decref(indexJson); }
+		if (jsonFp) { fclose(jsonFp); }
+		if (fileFp) { fclose(fileFp); }
+		return status;
+}
@@ -1,6 +1,7 @@
 #ifndef __CASHGETTOOLS_H__
 #define __CASHGETTOOLS_H__
 
+#include <sys/types.h>
 #include "cashwebuni.h"
 
 /* cashgettools status codes */
@@ -19,10 +20,30 @@
 #define CWG_FILE_ERR CW_SYS_ERR+13
 #define CWG_FILE_LEN_ERR CW_SYS_ERR+14
 #define CWG_FILE_DEPTH_ERR CW_SYS_ERR+15
+#define CWG_MONGO_INDEX_NO CW_SYS_ERR+16
+#define CWG_RANGE_NO CW_SYS_ERR+17
 
 /* required array size if passing saveMimeStr in params */
 #define CWG_MIMESTR_BUF 256
 
+/* default for fetchConcurrency in params */
+#define CWG_FETCH_CONCURRENCY_DEFAULT 8
+
+/* defaults for TXID cache */
+#define CWG_CACHE_MAX_BYTES_DEFAULT (256*1024*1024)
+#define CWG_CACHE_UNCONFIRMED_TTL_DEFAULT 60
+
+/* latency for CWG_init_fetch_replay to replay each fetch with the latency recorded for it */
+#define CWG_REPLAY_LATENCY_RECORDED -1
+
+/* types of struct CWG_sink */
+#define CWG_SINK_FD 0
+#define CWG_SINK_MEMORY 1
+#define CWG_SINK_CALLBACK 2
+
+/* conventional name for batchSizesPath file when kept alongside the TXID cache */
+#define CWG_BATCH_SIZES_FILENAME "cwbatch.sizes"
+
 /* can be set to redirect cashgettools error logging; defaults to stderr */
 extern FILE *CWG_err_stream;
 
@@ -41,6 +62,204 @@ static inline void init_CWG_file_info(struct CWG_file_info *cfi) {
         cfi->mimetype[0] = 0;
 }
 
+/*
+ * struct for where the bytes of a file gotten are written, as given to the CWG_get_*_to_sink functions
+ * always initialize with one of the init_CWG_sink_* functions, and destroy afterward
+ * type: CWG_SINK_FD, CWG_SINK_MEMORY, or CWG_SINK_CALLBACK, as set by the function it was initialized with
+ * fd: for CWG_SINK_FD, the file descriptor written to; it is recommended that it be set blocking (~O_NONBLOCK)
+ * data: for CWG_SINK_MEMORY, heap-allocated buffer the bytes are written into (NULL until any are), grown as needed;
+ 	 bytes are decoded straight into it, without an intermediate copy or any syscall. May be taken over (and freed) by caller,
+ 	 setting it NULL, rather than being freed by destroy_CWG_sink()
+ * len: for CWG_SINK_MEMORY, the number of bytes written to data
+ * size: for CWG_SINK_MEMORY, the number of bytes allocated for data
+ * write: for CWG_SINK_CALLBACK, function called with each run of bytes of the file in order, their count, and writeData;
+ 	  returns the number of bytes taken (at least 1; it is called again with the rest), or <0 to fail the get with CWG_WRITE_ERR.
+ 	  It may block to hold up the get (for backpressure), but note that a file of more than one TX is written from a thread of its own,
+ 	  so it is called from that thread, and fetching goes on until the bytes waiting on it fill a queue of 1 MiB
+ * writeData: for CWG_SINK_CALLBACK, data pointer to pass to write()
+ */
+struct CWG_sink {
+	int type;
+	int fd;
+	char *data;
+	size_t len;
+	size_t size;
+	ssize_t (*write) (const char *, size_t, void *);
+	void *writeData;
+};
+
+/*
+ * initializes struct CWG_sink for writing to file descriptor fd
+ */
+static inline void init_CWG_sink_fd(struct CWG_sink *sink, int fd) {
+	sink->type = CWG_SINK_FD;
+	sink->fd = fd;
+	sink->data = NULL;
+	sink->len = 0;
+	sink->size = 0;
+	sink->write = NULL;
+	sink->writeData = NULL;
+}
+
+/*
+ * initializes struct CWG_sink for writing to a growable memory buffer
+ */
+static inline void init_CWG_sink_memory(struct CWG_sink *sink) {
+	init_CWG_sink_fd(sink, -1);
+	sink->type = CWG_SINK_MEMORY;
+}
+
+/*
+ * initializes struct CWG_sink for writing through callback write(), passed writeData
+ */
+static inline void init_CWG_sink_callback(struct CWG_sink *sink, ssize_t (*write) (const char *, size_t, void *), void *writeData) {
+	init_CWG_sink_fd(sink, -1);
+	sink->type = CWG_SINK_CALLBACK;
+	sink->write = write;
+	sink->writeData = writeData;
+}
+
+/*
+ * frees heap-allocated data pointed to by given struct CWG_sink (the buffer of a memory sink)
+ */
+static inline void destroy_CWG_sink(struct CWG_sink *sink) {
+	if (sink->data) { free(sink->data); }
+	sink->data = NULL;
+	sink->len = 0;
+	sink->size = 0;
+}
+
+/*
+ * struct for carrying the layout of file at specific txid, as resolved without fetching its data; pointers are heap-allocated
+ * always make sure to initialize on use and destroy afterward
+ * metadata: the file's metadata
+ * txids: the TXIDs of the file's leaves (the TXs holding its data, i.e. its chain links if a plain chain), in order
+ * sizes: the byte count of each leaf's data, in order
+ * count: the number of leaves
+ * size: the exact byte size of the file
+ */
+struct CWG_file_manifest {
+	struct CW_file_metadata metadata;
+	char (*txids)[CW_TXID_CHARS+1];
+	size_t *sizes;
+	size_t count;
+	size_t size;
+};
+
+/*
+ * initializes struct CWG_file_manifest
+ */
+static inline void init_CWG_file_manifest(struct CWG_file_manifest *cfm) {
+	cfm->txids = NULL;
+	cfm->sizes = NULL;
+	cfm->count = 0;
+	cfm->size = 0;
+}
+
+/*
+ * frees heap-allocated data pointed to by given struct CWG_file_manifest
+ */
+static inline void destroy_CWG_file_manifest(struct CWG_file_manifest *cfm) {
+	if (cfm->txids) { free(cfm->txids); }
+	if (cfm->sizes) { free(cfm->sizes); }
+	init_CWG_file_manifest(cfm);
+}
+
+/*
+ * tallies of data transferred over HTTP (BitDB/REST) on behalf of gets
+ * requests: number of requests sent (including retries, hedges, and abandoned requests)
+ * wireBytes: bytes received over the connection (headers, plus body as encoded by the server, e.g. gzip-compressed)
+ * decodedBytes: bytes of response body after decompression
+ */
+struct CWG_transfer_stats {
+	size_t requests;
+	size_t wireBytes;
+	size_t decodedBytes;
+};
+
+/*
+ * initializes struct CWG_transfer_stats
+ */
+static inline void init_CWG_transfer_stats(struct CWG_transfer_stats *cts) {
+	cts->requests = 0;
+	cts->wireBytes = 0;
+	cts->decodedBytes = 0;
+}
+
+/*
+ * tallies of taking MongoDB clients from the pool (mongodbCliPool) on behalf of gets
+ * pops: number of clients taken
+ * waits: number of those for which the pool was exhausted, so had to wait for another get to return a client
+ * waitMicros: total microseconds spent waiting
+ * maxWaitMicros: longest single wait, in microseconds
+ */
+struct CWG_mongo_pool_stats {
+	size_t pops;
+	size_t waits;
+	uint64_t waitMicros;
+	uint64_t maxWaitMicros;
+};
+
+/*
+ * initializes struct CWG_mongo_pool_stats
+ */
+static inline void init_CWG_mongo_pool_stats(struct CWG_mongo_pool_stats *cmps) {
+	cmps->pops = 0;
+	cmps->waits = 0;
+	cmps->waitMicros = 0;
+	cmps->maxWaitMicros = 0;
+}
+
+/* query types passed to a user-supplied fetcher, and capability flags for each */
+#define CWG_FETCH_BY_TXID 0
+#define CWG_FETCH_BY_INTXID 1
+#define CWG_FETCH_BY_NAMETAG 2
+#define CWG_FETCHER_CAN(type) (1u << (type))
+#define CWG_FETCHER_CAN_ALL (CWG_FETCHER_CAN(CWG_FETCH_BY_TXID) | CWG_FETCHER_CAN(CWG_FETCH_BY_INTXID) | CWG_FETCHER_CAN(CWG_FETCH_BY_NAMETAG))
+
+/*
+ * details of a single TX that a user-supplied fetcher may report alongside its hex data (see struct CWG_fetcher)
+ * hexLen: Length of the TX's hex data within hexDataAll; CWG_FETCH_ITEM_LEN_UNKNOWN if not reported
+ * confirmed: Whether the TX is confirmed (rather than only in mempool)
+ */
+#define CWG_FETCH_ITEM_LEN_UNKNOWN SIZE_MAX
+struct CWG_fetch_item {
+	size_t hexLen;
+	bool confirmed;
+};
+
+/*
+ * user-supplied source of TX data, to be set as fetcher in params in place of the built-in sources (e.g. an in-house index, cache, or mock)
+ * fetch_batch: Fetches the data (hex, as pushed after OP_RETURN) of the TXs at ids (count of them) of given type, called with ctx;
+ 		must write all hex data (in order, null-terminated) to hexDataAll, which holds count*CW_TX_DATA_CHARS+1 chars,
+		and the TXIDs of the TXs (in order) to txids if not NULL, each of which holds CW_TXID_CHARS+1 chars.
+		If items is not NULL (as when a cache is set), it holds a struct CWG_fetch_item per TX (in order), each initialized to
+		CWG_FETCH_ITEM_LEN_UNKNOWN and unconfirmed, to which the length of each TX's hex data and whether it is confirmed should be written.
+		By CWG_FETCH_BY_TXID, ids are TXIDs; by CWG_FETCH_BY_INTXID, ids are TXIDs whose output CW_REVISION_INPUT_VOUT is spent by the TX to fetch;
+		by CWG_FETCH_BY_NAMETAG, ids[0] is a nametag (prefixed with CW_NAMETAG_PREFIX) and count is which claim of it to fetch (1 being the first,
+		in order of confirmation), so only one TX is fetched.
+		Must return CW_OK on success, CWG_FETCH_NO if any TX isn't found, CWG_FILE_ERR if any TX is found but isn't cashweb-formatted,
+		CWG_FETCH_ERR on failure of the source, or CW_SYS_ERR on system failure
+ * init: Optionally called with ctx before each get, failing the get if it doesn't return CW_OK; may be NULL
+ * cleanup: Optionally called with ctx after each get whose init succeeded; may be NULL
+ * ctx: Data pointer to pass to the above
+ * capabilities: Flags (CWG_FETCHER_CAN) of the query types fetch_batch supports; others fail with CW_CALL_NO,
+ 		 unless index is set in params (see below), in which case they are resolved to TXIDs through it
+ * maxBatch: Most ids to pass to fetch_batch at once (larger fetches are split); 0 for no limit
+ * concurrency: Most fetch_batch calls to have in flight at once (from separate threads) when a fetch is split; 0 or 1 for one at a time
+ * TXs whose items aren't written are taken as unconfirmed, so are kept in cache (if set) only for params cacheUnconfirmedTTL;
+   where lengths aren't written for a call of more than one TX, each TX's data can't be told apart, so none of them are cached
+ */
+struct CWG_fetcher {
+	CW_STATUS (*fetch_batch) (void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items);
+	CW_STATUS (*init) (void *ctx);
+	void (*cleanup) (void *ctx);
+	void *ctx;
+	unsigned int capabilities;
+	size_t maxBatch;
+	size_t concurrency;
+};
+
 /*
  * struct for carrying info on a nametag when analyzing; pointers must be exclusively heap-allocated
  * always make sure to initialize on use and destroy afterward
@@ -94,8 +313,46 @@ static inline void destroy_CWG_nametag_info(struct CWG_nametag_info *cni) {
  * mongodbCliPool: Optionally initialize/set mongoc client pool yourself, for use in multi-threaded scenarios; if so, must handle cleanup of mongoc pool/environment;
 		   must be cast from type mongoc_client_pool_t * (as such, MongoC library must be included/linked in user project if user-managed);
  * 		   may utilize CWG_init_mongo_pool and CWG_cleanup_mongo_pool when not user-managed (recommended)
- * bitdbNode: BitDB Node HTTP endpoint address; only specify if not using the former
+ * mongodbIndexCheck: Specify whether CWG_init_mongo_pool checks that the MongoDB queries made are served by indexes,
+ 		      warning (to CWG_err_stream) of any that aren't (see CWG_check_mongo_indexes)
+ * mongodbPoolMaxSize: Maximum number of clients in the pool made by CWG_init_mongo_pool, beyond which gets wait for a client to be returned;
+ 		       0 for the URI's maxPoolSize (or mongoc's default of 100)
+ * mongodbReadPref: Read preference for MongoDB queries ("primary", "primaryPreferred", "secondary", "secondaryPreferred", or "nearest"),
+ 		    e.g. to spread reads over a replica set's secondaries; NULL for the URI's readPreference (or primary)
+ * mongodbSocketTimeoutMS: Milliseconds after which a MongoDB query fails if the server doesn't respond; 0 for the URI's socketTimeoutMS (or mongoc's default)
+ * mongodbServerSelectionTimeoutMS: Milliseconds after which a MongoDB query fails if no suitable server is available;
+ 				    0 for the URI's serverSelectionTimeoutMS (or mongoc's default)
+ * mongodbPoolStats: Optionally point to struct CWG_mongo_pool_stats (initialized) to be added to with each client taken from mongodbCliPool;
+ 		     updated atomically, so may be shared between threads (but not between processes)
+ * bitdbNode: BitDB Node HTTP endpoint address; only specify if not using the former.
+ 	      May list several equivalent addresses separated by whitespace, in which case requests are spread over them by latency,
+	      hedged to another when slow, and failed over when one is down
+ * restEndpoint: REST HTTP endpoint address (TXID queries only); only specify if not using the former. May list several, as with bitdbNode
+ * rpcEndpoint: bitcoind JSON-RPC address (e.g. http://127.0.0.1:8332; node must run with txindex); only specify if not using the former.
+ 		TXID queries only, unless index is set; may list several, as with bitdbNode
+ * rpcAuth: Credentials for rpcEndpoint, as "<user>:<password>"
+ * fetcher: Optionally point to user-supplied struct CWG_fetcher to fetch through instead of any of the former (takes precedence if set)
  * requestLimit: Specify whether or not http endpoint has request limit 
+ * httpPool: Optionally initialize HTTP connection pool with CWG_init_http_pool, so that connections/DNS/TLS sessions are reused
+ 	     across gets and threads for the lifetime of the pool; must handle cleanup with CWG_cleanup_http_pool
+ * fetchConcurrency: Maximum number of HTTP requests to have in flight at once when a fetch is split across several requests
+ 		     (defaults to CWG_FETCH_CONCURRENCY_DEFAULT)
+ * batchSizesPath: Optionally specify file at which the batch sizes learned for each HTTP endpoint are saved/loaded, so that they carry over between runs;
+ 		   sizes are otherwise learned afresh for the lifetime of httpPool (or of the process, if no pool)
+ * rateLimiter: Optionally create token-bucket rate limiter with CWG_init_rate_limiter, so that HTTP requests are paced per endpoint
+ 		(across this process and any forked from it afterward) rather than tripping the endpoint's limits;
+		must handle cleanup with CWG_cleanup_rate_limiter. 429/Retry-After responses are honored (by waiting and retrying) either way
+ * transferStats: Optionally point to struct CWG_transfer_stats (initialized) to be added to with what each HTTP request transfers;
+ 		  updated atomically, so may be shared between threads (but not between processes)
+ * cache: Optionally open on-disk TXID cache with CWG_init_cache, so that data fetched by TXID is kept locally and shared between processes;
+ 	  must handle cleanup with CWG_cleanup_cache
+ * cacheUnconfirmedTTL: Seconds for which data of unconfirmed TXs is kept in cache (confirmed is kept until evicted); 0 to not cache unconfirmed
+ 			(defaults to CWG_CACHE_UNCONFIRMED_TTL_DEFAULT). Over rpcEndpoint, confirmation is learned from a getmempoolentry call
+ 			made alongside each getrawtransaction (a small response, but one more call per TX), only while the cache is set
+ * index: Optionally open local index with CWG_init_index (built/updated with CWG_update_index or CWG_update_index_from_blocks),
+ 	  so that TXs are served from it without querying, and queries by nametag/revision are resolved locally to TXIDs;
+	  only TXs confirmed as of the index's last update are found, and others fall through to whichever of the former is set (if any).
+	  Allows nametag/revision queries over rpcEndpoint/restEndpoint; must handle cleanup with CWG_cleanup_index
  * dirPath: Forces requested file to be treated as directory index (checked for validity) and gets at path dirPath;
  	    May be useful if getting by means other than cashweb path ID
  * forceDir: Forces requested file to be treated as directory index;
@@ -104,7 +361,11 @@ static inline void destroy_CWG_nametag_info(struct CWG_nametag_info *cni) {
  * saveMimeStr: Optionally interpret/save file's mimetype string to this memory location;
  		pass pointer to char array of length CWG_MIMESTR_BUF (this #define is available in header).
 		Will result as string of length 0 if file is of type CW_T_FILE, CW_T_DIR, or otherwise invalid value
- * foundHandler: Function to call when file is found, before writing
+ * saveFileSize: Optionally save the exact byte size of the file gotten to this location before it is written (and before foundHandler is called);
+ 		 a tree's size is resolved from the TXs along its last branch alone, but a chained file's links are then fetched twice (unless cached).
+		 Left untouched when getting by nametag, as its script may write any number of files
+ * foundHandler: Function to call when file is found, before writing; passed the status, foundHandleData,
+ 		 and the sink being written to (wrapping the given file descriptor when getting to one)
  * foundHandleData: Data pointer to pass to foundHandler()
  * foundSuppressErr: Specify an error code to suppress if file is found; <0 for none
  * datadir: specify data directory path for cashwebtools;
@@ -114,13 +375,31 @@ struct CWG_params {
 	const char *mongodb;
 	void *mongodbCli;
 	void *mongodbCliPool;
+	bool mongodbIndexCheck;
+	unsigned int mongodbPoolMaxSize;
+	const char *mongodbReadPref;
+	int mongodbSocketTimeoutMS;
+	int mongodbServerSelectionTimeoutMS;
+	struct CWG_mongo_pool_stats *mongodbPoolStats;
 	const char *bitdbNode;
 	const char *restEndpoint;
+	const char *rpcEndpoint;
+	const char *rpcAuth;
+	const struct CWG_fetcher *fetcher;
 	bool requestLimit;
+	void *httpPool;
+	size_t fetchConcurrency;
+	const char *batchSizesPath;
+	void *rateLimiter;
+	struct CWG_transfer_stats *transferStats;
+	void *cache;
+	unsigned int cacheUnconfirmedTTL;
+	void *index;
 	char *dirPath;
 	bool forceDir;
 	char (*saveMimeStr)[CWG_MIMESTR_BUF];
-	void (*foundHandler) (CW_STATUS, void *, int);
+	size_t *saveFileSize;
+	void (*foundHandler) (CW_STATUS, void *, struct CWG_sink *);
 	void *foundHandleData;
 	CW_STATUS foundSuppressErr;
 	const char *datadir;
@@ -151,6 +430,11 @@ void copy_CWG_params(struct CWG_params *dest, struct CWG_params *source);
  */
 CW_STATUS CWG_get_by_id(const char *id, struct CWG_params *params, int fd);
 
+/*
+ * as with CWG_get_by_id, but writes to given struct CWG_sink
+ */
+CW_STATUS CWG_get_by_id_to_sink(const char *id, struct CWG_params *params, struct CWG_sink *sink);
+
 /*
  * gets the file at the specified txid and writes to given file descriptor
  * queries at specified BitDB-populated MongoDB or BitDB HTTP endpoint
@@ -159,6 +443,11 @@ CW_STATUS CWG_get_by_id(const char *id, struct CWG_params *params, int fd);
  */
 CW_STATUS CWG_get_by_txid(const char *txid, struct CWG_params *params, int fd);
 
+/*
+ * as with CWG_get_by_txid, but writes to given struct CWG_sink
+ */
+CW_STATUS CWG_get_by_txid_to_sink(const char *txid, struct CWG_params *params, struct CWG_sink *sink);
+
 /*
  * gets the file at the specified nametag and writes to given file descriptor
  * specify revision for versioning; CW_REV_LATEST for latest revision
@@ -168,12 +457,44 @@ CW_STATUS CWG_get_by_txid(const char *txid, struct CWG_params *params, int fd);
  */
 CW_STATUS CWG_get_by_name(const char *name, int revision, struct CWG_params *params, int fd);
 
+/*
+ * as with CWG_get_by_name, but writes to given struct CWG_sink
+ */
+CW_STATUS CWG_get_by_name_to_sink(const char *name, int revision, struct CWG_params *params, struct CWG_sink *sink);
+
+/*
+ * gets length bytes of the file at the specified txid from offset (SIZE_MAX for through the end) and writes them to given file descriptor
+ * only the leaf TXs covering the range are fetched, and the interior tree TXs leading to them (as cashsendtools lays out trees, every TX
+   of a level but the last is full, so where each lies is known); a chain's links before the range must still be walked
+ * the file's size is resolved first (as with saveFileSize in params, which it is saved to if set); if offset is past the end of the file,
+   CWG_RANGE_NO is returned (and passed to foundHandler), and a range running past the end is cut short at it
+ * the size isn't resolved for the whole file (offset 0, length SIZE_MAX) unless saveFileSize is set; a chained file's links are walked
+   once for its size, and only those holding the range are then fetched again
+ * params->dirPath is ignored
+ * it recommended that fd be set blocking (~O_NONBLOCK)
+ */
+CW_STATUS CWG_get_range(const char *txid, size_t offset, size_t length, struct CWG_params *params, int fd);
+
+/*
+ * as with CWG_get_range, but writes to given struct CWG_sink
+ */
+CW_STATUS CWG_get_range_to_sink(const char *txid, size_t offset, size_t length, struct CWG_params *params, struct CWG_sink *sink);
+
 /*
  * gets file info by txid and writes to given struct CWG_file_info
  * if info->mimetype results in empty string, file has no specified mimetype (most likely CW_T_FILE or CW_T_DIR); may be treated as binary data
  */
 CW_STATUS CWG_get_file_info(const char *txid, struct CWG_params *params, struct CWG_file_info *info);
 
+/*
+ * gets the manifest of file at txid and writes to given struct CWG_file_manifest: its leaves' TXIDs and byte counts, and its exact size
+ * only the file's chain links and interior tree TXs are fetched, along with its last leaf (to learn its size; the others are full,
+   as cashsendtools lays them out), so a tree's data is never downloaded; a plain chain's links are its leaves, so must all be fetched
+ * a file at a given txid never changes, so its manifest may be cached indefinitely
+ * always cleanup afterward with destroy_CWG_file_manifest() for freeing struct data
+ */
+CW_STATUS CWG_get_file_manifest(const char *txid, struct CWG_params *params, struct CWG_file_manifest *manifest);
+
 /*
  * gets nametag info by name/revision and writes to given struct CWG_nametag_info
  * always cleanup afterward with destroy_CWG_nametag_info() for freeing struct data
@@ -198,6 +519,7 @@ CW_STATUS CWG_dirindex_raw_to_json(FILE *indexFp, FILE *indexJsonFp);
 /*
  * initializes MongoDB pool (used for thread-safety) if project is configured to support MongoDB;
    otherwise, will return CW_CALL_NO
+ * the pool is made with the size, read preference, and timeouts set in params (see struct CWG_params), so these should be set beforehand
  */
 CW_STATUS CWG_init_mongo_pool(const char *mongodbAddr, struct CWG_params *params);
 
@@ -207,6 +529,130 @@ CW_STATUS CWG_init_mongo_pool(const char *mongodbAddr, struct CWG_params *params
  */
 void CWG_cleanup_mongo_pool(struct CWG_params *params);
 
+/*
+ * creates (where not already present) the indexes on the BitDB collections (confirmed/unconfirmed) at MongoDB URI mongodbAddr
+   that cashgettools' queries rely on: tx.h, in.e.h, and out.s2/blk.i/tx.h for nametag claims (partial to values starting with CW_NAMETAG_PREFIX);
+   without them, queries scan the whole collection
+ * each index created (or found present) is reported to reportStream, if not NULL
+ * returns CW_CALL_NO if project isn't configured to support MongoDB
+ */
+CW_STATUS CWG_create_mongo_indexes(const char *mongodbAddr, FILE *reportStream);
+
+/*
+ * checks (with explain) that each of cashgettools' queries on the BitDB collections at MongoDB URI mongodbAddr is served by an index,
+   querying by sampleTxid/sampleNametag (nametag prefixed with CW_NAMETAG_PREFIX), or placeholders if NULL; warns (to CWG_err_stream) of any that isn't
+ * if reportStream isn't NULL, each query is run given number of times, and its plan, keys/documents examined, and average latency are reported to it
+ * returns CWG_MONGO_INDEX_NO if any query isn't served by an index, or CW_CALL_NO if project isn't configured to support MongoDB
+ */
+CW_STATUS CWG_check_mongo_indexes(const char *mongodbAddr, const char *sampleTxid, const char *sampleNametag, int runs, FILE *reportStream);
+
+/*
+ * initializes HTTP connection pool (for reusing connections to BitDB/REST endpoints across gets and threads) and saves to params;
+   if built for emscripten, will return CW_CALL_NO (pooling is left to the browser)
+ * it is the user's responsibility to call CWG_cleanup_http_pool when finished
+ */
+CW_STATUS CWG_init_http_pool(struct CWG_params *params);
+
+/*
+ * cleans up HTTP connection pool saved in params, if present
+ */
+void CWG_cleanup_http_pool(struct CWG_params *params);
+
+/*
+ * creates token-bucket rate limiter for HTTP endpoints and saves to params; each endpoint is allowed rate requests per second,
+   in bursts of up to burst requests (a rate of 0 means unlimited, other than honoring 429/Retry-After)
+ * requests over the limit are queued until allowed, rather than failed
+ * the limiter's budget is shared by threads and any processes forked after this call
+ * it is the user's responsibility to call CWG_cleanup_rate_limiter when finished
+ */
+CW_STATUS CWG_init_rate_limiter(double rate, double burst, struct CWG_params *params);
+
+/*
+ * sets rate/burst specifically for given endpoint (as in bitdbNode/restEndpoint) in rate limiter saved in params
+ * returns CW_CALL_NO if there is no rate limiter, or the endpoint can't be tracked
+ */
+CW_STATUS CWG_set_rate_limit(const char *endpoint, double rate, double burst, struct CWG_params *params);
+
+/*
+ * releases rate limiter saved in params, if present
+ */
+void CWG_cleanup_rate_limiter(struct CWG_params *params);
+
+/*
+ * opens on-disk TXID cache in directory cacheDir (created if absent) and saves to params;
+   the data log is kept within roughly maxBytes (CWG_CACHE_MAX_BYTES_DEFAULT is a sensible choice), evicting oldest entries first
+ * the cache may be safely shared by concurrent processes and threads, including those forked after this call
+ * it is the user's responsibility to call CWG_cleanup_cache when finished
+ */
+CW_STATUS CWG_init_cache(const char *cacheDir, size_t maxBytes, struct CWG_params *params);
+
+/*
+ * closes TXID cache saved in params, if present (cache files remain on disk)
+ */
+void CWG_cleanup_cache(struct CWG_params *params);
+
+/*
+ * opens local index file at indexPath (memory-mapped read-only) and saves to params
+ * the index may be safely shared by concurrent processes and threads
+ * it is the user's responsibility to call CWG_cleanup_index when finished
+ */
+CW_STATUS CWG_init_index(const char *indexPath, struct CWG_params *params);
+
+/*
+ * closes local index saved in params, if present
+ */
+void CWG_cleanup_index(struct CWG_params *params);
+
+/*
+ * builds local index file at indexPath (or brings it up to date, if it exists) from blocks fetched over params->rpcEndpoint,
+   up to the node's current tip; the file is replaced whole, so may be updated while in use (open handles see the old until reopened)
+ * chain reorganizations are not detected, so if one may have touched indexed blocks, the index should be rebuilt
+ */
+CW_STATUS CWG_update_index(const char *indexPath, struct CWG_params *params);
+
+/*
+ * builds local index file at indexPath (or brings it up to date, if it exists) offline, by reading the block files (blk*.dat)
+   in a node's blocks directory blocksDir, up to the tip of the longest chain found in them; otherwise as with CWG_update_index
+ */
+CW_STATUS CWG_update_index_from_blocks(const char *indexPath, const char *blocksDir);
+
+/*
+ * exports everything needed to get the file at given cashweb id to a bundle file at bundlePath (merged into it, if it exists),
+   fetched by given params: the file's TXs, any nametag claims/revisions and scripts resolved on the way and, if it is a directory,
+   the same for every file it references, recursively
+ * a bundle is in the same format as a local index, so is opened with CWG_init_index to get the id exactly as otherwise,
+   without querying any other source (only what was reachable as of the export is held)
+ */
+CW_STATUS CWG_export_bundle(const char *id, struct CWG_params *params, const char *bundlePath);
+
+/*
+ * starts recording every fetch made by gets with params to a fetch record file at recordPath (appended to, if it exists):
+   each TX fetched, by what id, with what result and how long the fetch (of the batch it was in) took, so that the gets can be replayed by CWG_init_fetch_replay
+ * sets params->fetcher to a recorder fetching through params as they were, in the same batches; the fetch source is set up once here
+   (rather than per get), so that only fetching is timed; cache/index are moved under it, so that what they answer is recorded too;
+   the recorder may be shared between threads
+ * it is the user's responsibility to call CWG_cleanup_fetch_recorder when finished, before cleaning up anything else in params
+ */
+CW_STATUS CWG_init_fetch_recorder(const char *recordPath, struct CWG_params *params);
+
+/*
+ * stops recording fetches with params, restoring them as they were before CWG_init_fetch_recorder
+ */
+void CWG_cleanup_fetch_recorder(struct CWG_params *params);
+
+/*
+ * loads fetch record file at recordPath (made with CWG_init_fetch_recorder) and sets params->fetcher to answer from it alone,
+   so that the recorded gets may be repeated deterministically without any fetch source; fetches not in the record fail with CWG_FETCH_NO
+ * each fetch is delayed by latencyMs milliseconds (0 for none), or by the latency recorded for it if CWG_REPLAY_LATENCY_RECORDED
+ * it is the user's responsibility to call CWG_cleanup_fetch_replay when finished
+ */
+CW_STATUS CWG_init_fetch_replay(const char *recordPath, int latencyMs, struct CWG_params *params);
+
+/*
+ * frees fetch record loaded into params by CWG_init_fetch_replay, if present
+ */
+void CWG_cleanup_fetch_replay(struct CWG_params *params);
+
 /*
  * returns generic error message by error code
  */
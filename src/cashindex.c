@@ -0,0 +1,86 @@
+#include <cashgettools.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#define USAGE_STR "usage: %s [FLAGS] <index>\n"
+#define HELP_STR \
+	USAGE_STR\
+	"\n"\
+	" Flag    | Use\n"\
+	"---------|-------------------------------------------------------------------------------------------------------------------------\n"\
+	"[none]   | build local CashWeb index at <index> (or bring it up to date) from the block files of a node run with default settings\n"\
+	"-B <ARG> | specify node's blocks directory, containing the blk*.dat files to index offline (default is "BLOCKS_DIR_DEFAULT")\n"\
+	"-R <ARG> | index blocks fetched over bitcoind JSON-RPC at URL instead of reading block files\n"\
+	"-A <ARG> | specify credentials for bitcoind JSON-RPC as <user>:<password>\n"\
+	"\n"\
+	"The index can then be used for getting with cashget/cashserver flag -I.\n"
+
+#define BLOCKS_DIR_DEFAULT "~/.bitcoin/blocks"
+
+int main(int argc, char **argv) {
+	struct CWG_params params;
+	init_CWG_params(&params, NULL, NULL, NULL, NULL);
+
+	char *blocksDir = NULL;
+
+	int c;
+	while ((c = getopt(argc, argv, ":hB:R:A:")) != -1) {
+		switch (c) {
+			case 'h':
+				fprintf(stderr, HELP_STR, argv[0]);
+				exit(0);
+			case 'B':
+				blocksDir = optarg;
+				break;
+			case 'R':
+				params.rpcEndpoint = optarg;
+				break;
+			case 'A':
+				params.rpcAuth = optarg;
+				break;
+			case ':':
+				fprintf(stderr, "Option -%c requires an argument.\n", optopt);
+				exit(1);
+			case '?':
+				if (isprint(optopt)) {
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				} else {
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				}
+				exit(1);
+			default:
+				fprintf(stderr, "getopt() unknown error\n");
+				exit(1);
+		}
+	}
+
+	if (argc <= optind) {
+		fprintf(stderr, USAGE_STR"\n-h for help\n", argv[0]);
+		exit(1);
+	}
+	if (blocksDir && params.rpcEndpoint) {
+		fprintf(stderr, "Specify only one of -B or -R.\n");
+		exit(1);
+	}
+
+	char *indexPath = argv[optind];
+
+	CW_STATUS status;
+	if (params.rpcEndpoint) { status = CWG_update_index(indexPath, &params); }
+	else {
+		// expands the default's ~, as it isn't passed through a shell
+		const char *home = getenv("HOME");
+		char blocksDirDefault[(home ? strlen(home) : 0) + sizeof(BLOCKS_DIR_DEFAULT)];
+		if (!blocksDir) {
+			snprintf(blocksDirDefault, sizeof(blocksDirDefault), "%s%s", home ? home : "", BLOCKS_DIR_DEFAULT+1);
+			blocksDir = blocksDirDefault;
+		}
+		status = CWG_update_index_from_blocks(indexPath, blocksDir);
+	}
+
+	if (status != CW_OK) {
+		fprintf(stderr, "\nIndexing failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
+		exit(1);
+	}
+	return 0;
+}
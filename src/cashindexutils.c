@@ -0,0 +1,776 @@
+#include "cashindexutils.h"
+#include "cashtxscanutils.h"
+#include "cashwebutils.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* index file constants */
+#define INDEX_MAGIC "CWINDEX3"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_TMP_SUFFIX ".tmp"
+#define INDEX_RECORDS_START 1024
+
+/* block file constants */
+#define BLOCK_FILE_FMT "%s/blk%05d.dat"
+#define BLOCK_FILE_RECORD_HEADER_SZ 8
+#define BLOCK_HEADER_SZ 80
+#define BLOCK_COMMIT_INTERVAL 10000
+#define BLOCK_HEIGHT_UNKNOWN -1
+#define BLOCK_HEIGHT_ORPHAN INT64_MIN
+#define BLOCK_MAGIC_LEN 4
+
+/* the message start (magic) of each network, as it begins every record in the block files */
+static const unsigned char blockMagics[][BLOCK_MAGIC_LEN] = {
+	{ 0xe3, 0xe1, 0xf3, 0xe8 }, // mainnet
+	{ 0xf4, 0xe5, 0xf3, 0xf4 }, // testnet3
+	{ 0xe2, 0xb7, 0xda, 0xaf }, // testnet4/chipnet
+	{ 0xc3, 0xaf, 0xe1, 0xa2 }, // scalenet
+	{ 0xda, 0xb5, 0xbf, 0xfa }  // regtest
+};
+
+/*
+ * the index is a single file: header, followed by sorted arrays of TX, spend, and nametag records,
+   all of fixed size and made of byte arrays (integers big-endian), so that memcmp orders them and the file can be searched in place,
+   and finally the data of the TXs
+ * height is that of the next block to be indexed (i.e. blocks below it have been)
+ * only TXs whose first output is OP_RETURN are indexed (txids in display byte order, as with hex strings):
+   tx: the TX's data (first push of its OP_RETURN, as raw bytes) by offset/length within the data, for fetching BY_TXID
+   spend: the outpoint spent by the TX's first input, for fetching BY_INTXID
+   nametag: the TX's nametag (second push of its OP_RETURN, if prefixed as one) by SHA-256 digest, in order of height and then txid
+   (as BitDB sorts claims), for fetching BY_NAMETAG; the nametag itself is kept in the data (by offset/length), to be checked on lookup;
+   a claim with a null txid stands for one that isn't cashweb-formatted (as recorded to a bundle, where the claim's TX isn't known)
+ */
+struct IndexHeader {
+	char magic[INDEX_MAGIC_LEN];
+	uint64_t height;
+	uint64_t txsCount;
+	uint64_t spendsCount;
+	uint64_t nametagsCount;
+	uint64_t dataSize;
+};
+
+struct IndexTx {
+	unsigned char txid[CW_TXID_BYTES];
+	unsigned char dataOffset[8];
+	unsigned char dataLen[4];
+};
+
+#define INDEX_SPEND_KEY_SZ (CW_TXID_BYTES+4)
+struct IndexSpend {
+	unsigned char prevTxid[CW_TXID_BYTES];
+	unsigned char prevVout[4];
+	unsigned char txid[CW_TXID_BYTES];
+};
+
+#define INDEX_NAME_DIGEST_SZ 32
+#define INDEX_NAMETAG_KEY_SZ (INDEX_NAME_DIGEST_SZ+4+CW_TXID_BYTES)
+struct IndexNametag {
+	unsigned char nameDigest[INDEX_NAME_DIGEST_SZ];
+	unsigned char height[4];
+	unsigned char txid[CW_TXID_BYTES];
+	unsigned char nameOffset[8];
+	unsigned char nameLen[2];
+};
+
+/*
+ * per-process handle on an opened index; the mapping is read-only, so may be shared between threads freely
+ */
+struct Index {
+	void *map;
+	size_t mapSize;
+	const struct IndexHeader *header;
+	const struct IndexTx *txs;
+	const struct IndexSpend *spends;
+	const struct IndexNametag *nametags;
+	const unsigned char *data;
+};
+
+struct IndexBuilder {
+	char *path;
+	uint64_t height;
+	struct IndexTx *txs;
+	size_t txsCount;
+	size_t txsSize;
+	struct IndexSpend *spends;
+	size_t spendsCount;
+	size_t spendsSize;
+	struct IndexNametag *nametags;
+	size_t nametagsCount;
+	size_t nametagsSize;
+	unsigned char *data;
+	size_t dataSize;
+	size_t dataCapacity;
+};
+
+/*
+ * a block found in block files, as located in the first pass over them
+ */
+struct BlockFileEntry {
+	unsigned char hash[CW_TXID_BYTES];
+	unsigned char prevHash[CW_TXID_BYTES];
+	int file;
+	size_t offset;
+	size_t len;
+	int64_t height;
+};
+
+/*
+ * maps index file at path, checking that it is well-formed
+ */
+static CW_STATUS indexMap(const char *path, struct Index *index);
+
+/*
+ * writes data of the TXs at given txids (as hex) to hexDataAll, in order, with the length of each written to itemInfo if not NULL
+ * returns false if any aren't found
+ */
+static bool indexFindTxs(const struct Index *index, const char **txids, size_t count, char *hexDataAll, struct FetchItemInfo *itemInfo);
+
+/*
+ * finds the record of the TX at given txid (as bytes)
+ * returns NULL if not found
+ */
+static const struct IndexTx *indexFindTx(const struct Index *index, const unsigned char *txid);
+
+/*
+ * finds the txid (as bytes) of the TX spending given outpoint
+ * returns false if not found
+ */
+static bool indexFindSpend(const struct Index *index, const unsigned char *prevTxid, uint32_t prevVout, unsigned char *txid);
+
+/*
+ * finds the txid (as bytes) of the nth (from 1) claim of given nametag, checking that the claim's nametag matches it in full
+ * returns false if not found
+ */
+static bool indexFindNametag(const struct Index *index, const char *nametag, size_t nameLen, size_t nth, unsigned char *txid);
+
+/*
+ * hashes nametag (as found in a claim's OP_RETURN) to its SHA-256 digest (INDEX_NAME_DIGEST_SZ bytes), by which claims are keyed
+ */
+static void indexNameDigest(const char *nametag, size_t nameLen, unsigned char *digest);
+
+/*
+ * appends len bytes of data to the data of the index being built, writing where it begins to offsetPtr
+ * returns false on failure
+ */
+static bool indexBuilderAppendData(struct IndexBuilder *builder, const void *data, size_t len, uint64_t *offsetPtr);
+
+/*
+ * grows array of records at *recordsPtr (of given record size) to fit one more, if needed
+ * returns false on failure
+ */
+static bool indexRecordsGrow(void **recordsPtr, size_t recordSz, size_t count, size_t *sizePtr);
+
+/*
+ * drops adjacent duplicates (by given comparison) from sorted array of records
+ * returns new count
+ */
+static size_t indexRecordsDedupe(void *records, size_t recordSz, size_t count, int (*compare)(const void *, const void *));
+
+/*
+ * locates the blocks in the block files within blocksDir and orders those of the best chain by height,
+   writing the entries to entriesPtr (must be freed) and the entry index of each height to chainPtr (must be freed)
+ */
+static CW_STATUS blockFilesScan(const char *blocksDir, struct BlockFileEntry **entriesPtr, size_t **chainPtr, size_t *chainLenPtr);
+
+/*
+ * writes n-byte big-endian integer to bytes
+ */
+static inline void indexPutUint(uint64_t val, int n, unsigned char *bytes) {
+	for (int i=0; i<n; i++) { bytes[i] = (unsigned char)(val >> 8*(n-1-i)); }
+}
+
+/*
+ * reads n-byte big-endian integer from bytes
+ */
+static inline uint64_t indexGetUint(const unsigned char *bytes, int n) {
+	uint64_t val = 0;
+	for (int i=0; i<n; i++) { val = (val << 8) | bytes[i]; }
+	return val;
+}
+
+static int compareIndexTxs(const void *a, const void *b) {
+	return memcmp(a, b, CW_TXID_BYTES);
+}
+
+static int compareIndexSpends(const void *a, const void *b) {
+	return memcmp(a, b, sizeof(struct IndexSpend));
+}
+
+static int compareIndexNametags(const void *a, const void *b) {
+	return memcmp(a, b, INDEX_NAMETAG_KEY_SZ);
+}
+
+static int compareBlockFileEntries(const void *a, const void *b) {
+	return memcmp(a, b, CW_TXID_BYTES);
+}
+
+/* ------------------------------------- PUBLIC ------------------------------------- */
+
+CW_STATUS initIndex(const char *indexPath, struct CWG_params *params) {
+	struct Index *index;
+	if ((index = malloc(sizeof(struct Index))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+
+	CW_STATUS status;
+	if ((status = indexMap(indexPath, index)) != CW_OK) { free(index); return status; }
+
+	params->index = index;
+	return CW_OK;
+}
+
+void cleanupIndex(struct CWG_params *params) {
+	struct Index *index = (struct Index *)params->index;
+	if (!index) { return; }
+
+	munmap(index->map, index->mapSize);
+	free(index);
+	params->index = NULL;
+}
+
+CW_STATUS fetchHexDataIndexed(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo,
+			      CW_STATUS (*fetcher)(const char **, size_t, FETCH_TYPE, struct CWG_params *, char **, char *, struct FetchItemInfo *)) {
+	if (count < 1) { return CWG_FETCH_NO; }
+	struct Index *index = (struct Index *)params->index;
+	if (type == BY_TXID) {
+		if (!indexFindTxs(index, ids, count, hexDataAll, itemInfo)) { return fetcher(ids, count, type, params, txids, hexDataAll, itemInfo); }
+		if (txids) { for (int i=0; i<count; i++) { txids[i][0] = 0; strncat(txids[i], ids[i], CW_TXID_CHARS); } }
+		return CW_OK;
+	}
+
+	// a nametag fetch is of its nth claim, so resolves to a single TX
+	size_t resolvedCount = type == BY_NAMETAG ? 1 : count;
+	char (*resolved)[CW_TXID_CHARS+1];
+	const char **resolvedPtrs;
+	if ((resolved = malloc(resolvedCount*sizeof(resolved[0]))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	if ((resolvedPtrs = malloc(resolvedCount*sizeof(resolvedPtrs[0]))) == NULL) { perror("malloc failed"); free(resolved); return CW_SYS_ERR; }
+
+	CW_STATUS status = CW_OK;
+	static const unsigned char nullTxid[CW_TXID_BYTES];
+	unsigned char txid[CW_TXID_BYTES];
+	unsigned char inTxid[CW_TXID_BYTES];
+	for (int i=0; i<resolvedCount; i++) {
+		if (type == BY_NAMETAG) {
+			if (!indexFindNametag(index, ids[0], strlen(ids[0]), count, txid)) { status = CWG_FETCH_NO; goto cleanup; }
+			if (memcmp(txid, nullTxid, CW_TXID_BYTES) == 0) { status = CWG_FILE_ERR; goto cleanup; }
+		}
+		else {
+			if (!CW_is_valid_txid(ids[i])) { status = CWG_FETCH_NO; goto cleanup; }
+			hexStrToByteArr(ids[i], 0, (char *)inTxid);
+			if (!indexFindSpend(index, inTxid, CW_REVISION_INPUT_VOUT, txid)) { status = CWG_FETCH_NO; goto cleanup; }
+		}
+		byteArrToHexStr((const char *)txid, CW_TXID_BYTES, resolved[i]);
+		resolvedPtrs[i] = resolved[i];
+	}
+
+	if (!indexFindTxs(index, resolvedPtrs, resolvedCount, hexDataAll, itemInfo) &&
+	    (status = fetcher(resolvedPtrs, resolvedCount, BY_TXID, params, NULL, hexDataAll, itemInfo)) != CW_OK) { goto cleanup; }
+	if (txids) {
+		for (int i=0; i<resolvedCount; i++) { strcpy(txids[i], resolved[i]); }
+	}
+
+	cleanup:
+		free(resolvedPtrs);
+		free(resolved);
+		return status;
+}
+
+CW_STATUS indexBuilderOpen(const char *indexPath, struct IndexBuilder **builderPtr, uint64_t *heightPtr) {
+	struct IndexBuilder *builder;
+	if ((builder = calloc(1, sizeof(struct IndexBuilder))) == NULL) { perror("calloc failed"); return CW_SYS_ERR; }
+	if ((builder->path = strdup(indexPath)) == NULL) { perror("strdup failed"); free(builder); return CW_SYS_ERR; }
+
+	// carry over what the index already holds, if anything
+	struct Index index;
+	CW_STATUS status = CW_OK;
+	if (access(indexPath, F_OK) == 0) {
+		if ((status = indexMap(indexPath, &index)) != CW_OK) { goto cleanup; }
+		builder->height = index.header->height;
+		builder->txsCount = builder->txsSize = index.header->txsCount;
+		builder->spendsCount = builder->spendsSize = index.header->spendsCount;
+		builder->nametagsCount = builder->nametagsSize = index.header->nametagsCount;
+		builder->dataSize = builder->dataCapacity = index.header->dataSize;
+		builder->txs = malloc((builder->txsSize ? builder->txsSize : 1)*sizeof(struct IndexTx));
+		builder->spends = malloc((builder->spendsSize ? builder->spendsSize : 1)*sizeof(struct IndexSpend));
+		builder->nametags = malloc((builder->nametagsSize ? builder->nametagsSize : 1)*sizeof(struct IndexNametag));
+		builder->data = malloc(builder->dataCapacity ? builder->dataCapacity : 1);
+		if (builder->txs && builder->spends && builder->nametags && builder->data) {
+			memcpy(builder->txs, index.txs, builder->txsCount*sizeof(struct IndexTx));
+			memcpy(builder->spends, index.spends, builder->spendsCount*sizeof(struct IndexSpend));
+			memcpy(builder->nametags, index.nametags, builder->nametagsCount*sizeof(struct IndexNametag));
+			memcpy(builder->data, index.data, builder->dataSize);
+		}
+		else { perror("malloc failed"); status = CW_SYS_ERR; }
+		munmap(index.map, index.mapSize);
+	}
+
+	cleanup:
+		if (status != CW_OK) { indexBuilderFree(builder); return status; }
+		*builderPtr = builder;
+		*heightPtr = builder->height;
+		return CW_OK;
+}
+
+CW_STATUS indexBuilderAddBlock(struct IndexBuilder *builder, uint64_t height, const char *block, size_t len) {
+	struct TxScan ts;
+	txScanInit(&ts, block, len, false);
+
+	uint64_t txCount;
+	if (!txScanSkip(&ts, BLOCK_HEADER_SZ, NULL) || !txScanVarInt(&ts, &txCount)) { goto formaterr; }
+
+	struct TxScanInfo info;
+	const char *push1;
+	const char *push2;
+	size_t push1Len;
+	size_t push2Len;
+	unsigned char txid[CW_TXID_BYTES];
+	unsigned char prevTxid[CW_TXID_BYTES];
+	for (uint64_t i=0; i<txCount; i++) {
+		if (!txScanTx(&ts, &info)) { goto formaterr; }
+		if (!info.out0Script || !txScanOpReturn(info.out0Script, info.out0ScriptLen, false, &push1, &push1Len, &push2, &push2Len)) { continue; }
+
+		txScanTxid(info.start, info.len, txid);
+
+		// anything longer can't be cashweb data (and wouldn't fit where fetched data is written)
+		if (push1 && push1Len <= CW_TX_DATA_BYTES && !indexBuilderAddTx(builder, txid, (const unsigned char *)push1, push1Len)) { return CW_SYS_ERR; }
+		if (info.in0Txid) {
+			txScanTxidBytes(info.in0Txid, false, prevTxid);
+			if (!indexBuilderAddSpend(builder, prevTxid, info.in0Vout, txid)) { return CW_SYS_ERR; }
+		}
+		if (push2 && push2Len > CW_NAMETAG_PREFIX_LEN && strncmp(push2, CW_NAMETAG_PREFIX, CW_NAMETAG_PREFIX_LEN) == 0 &&
+		    !indexBuilderAddNametag(builder, push2, push2Len, height, txid)) { return CW_SYS_ERR; }
+	}
+
+	builder->height = height+1;
+	return CW_OK;
+
+	formaterr:
+		fprintf(CWG_err_stream, "cashgettools: malformed block at height %" PRIu64 " while indexing\n", height);
+		return CWG_FETCH_ERR;
+}
+
+bool indexBuilderAddTx(struct IndexBuilder *builder, const unsigned char *txid, const unsigned char *data, size_t len) {
+	uint64_t dataOffset;
+	if (!indexRecordsGrow((void **)&builder->txs, sizeof(struct IndexTx), builder->txsCount, &builder->txsSize) ||
+	    !indexBuilderAppendData(builder, data, len, &dataOffset)) { return false; }
+
+	struct IndexTx *tx = &builder->txs[builder->txsCount++];
+	memcpy(tx->txid, txid, CW_TXID_BYTES);
+	indexPutUint(dataOffset, 8, tx->dataOffset);
+	indexPutUint(len, 4, tx->dataLen);
+	return true;
+}
+
+bool indexBuilderAddSpend(struct IndexBuilder *builder, const unsigned char *prevTxid, uint32_t prevVout, const unsigned char *txid) {
+	if (!indexRecordsGrow((void **)&builder->spends, sizeof(struct IndexSpend), builder->spendsCount, &builder->spendsSize)) { return false; }
+
+	struct IndexSpend *spend = &builder->spends[builder->spendsCount++];
+	memcpy(spend->prevTxid, prevTxid, CW_TXID_BYTES);
+	indexPutUint(prevVout, 4, spend->prevVout);
+	memcpy(spend->txid, txid, CW_TXID_BYTES);
+	return true;
+}
+
+bool indexBuilderAddNametag(struct IndexBuilder *builder, const char *nametag, size_t nameLen, uint64_t order, const unsigned char *txid) {
+	// a nametag is pushed in a single OP_RETURN, so couldn't be longer
+	if (nameLen > UINT16_MAX) { return true; }
+	uint64_t nameOffset;
+	if (!indexRecordsGrow((void **)&builder->nametags, sizeof(struct IndexNametag), builder->nametagsCount, &builder->nametagsSize) ||
+	    !indexBuilderAppendData(builder, nametag, nameLen, &nameOffset)) { return false; }
+
+	struct IndexNametag *record = &builder->nametags[builder->nametagsCount++];
+	indexNameDigest(nametag, nameLen, record->nameDigest);
+	indexPutUint(order, 4, record->height);
+	memcpy(record->txid, txid, CW_TXID_BYTES);
+	indexPutUint(nameOffset, 8, record->nameOffset);
+	indexPutUint(nameLen, 2, record->nameLen);
+	return true;
+}
+
+CW_STATUS indexBuilderCommit(struct IndexBuilder *builder) {
+	qsort(builder->txs, builder->txsCount, sizeof(struct IndexTx), &compareIndexTxs);
+	qsort(builder->spends, builder->spendsCount, sizeof(struct IndexSpend), &compareIndexSpends);
+	qsort(builder->nametags, builder->nametagsCount, sizeof(struct IndexNametag), &compareIndexNametags);
+	// records added more than once (as when recording fetches) are kept once; the data of a dropped TX/nametag is left unreferenced
+	builder->txsCount = indexRecordsDedupe(builder->txs, sizeof(struct IndexTx), builder->txsCount, &compareIndexTxs);
+	builder->spendsCount = indexRecordsDedupe(builder->spends, sizeof(struct IndexSpend), builder->spendsCount, &compareIndexSpends);
+	builder->nametagsCount = indexRecordsDedupe(builder->nametags, sizeof(struct IndexNametag), builder->nametagsCount, &compareIndexNametags);
+
+	struct IndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, INDEX_MAGIC_LEN);
+	header.height = builder->height;
+	header.txsCount = builder->txsCount;
+	header.spendsCount = builder->spendsCount;
+	header.nametagsCount = builder->nametagsCount;
+	header.dataSize = builder->dataSize;
+
+	// written to a temporary file and renamed over the old, so readers only ever see a whole index
+	char tmpPath[strlen(builder->path) + sizeof(INDEX_TMP_SUFFIX)];
+	sprintf(tmpPath, "%s%s", builder->path, INDEX_TMP_SUFFIX);
+	FILE *fp;
+	if ((fp = fopen(tmpPath, "wb")) == NULL) {
+		fprintf(CWG_err_stream, "cashgettools: failed to write index at %s: %s\n", tmpPath, strerror(errno));
+		return CW_SYS_ERR;
+	}
+	bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		       fwrite(builder->txs, sizeof(struct IndexTx), builder->txsCount, fp) == builder->txsCount &&
+		       fwrite(builder->spends, sizeof(struct IndexSpend), builder->spendsCount, fp) == builder->spendsCount &&
+		       fwrite(builder->nametags, sizeof(struct IndexNametag), builder->nametagsCount, fp) == builder->nametagsCount &&
+		       fwrite(builder->data, 1, builder->dataSize, fp) == builder->dataSize;
+	success = fclose(fp) == 0 && success;
+	if (!success || rename(tmpPath, builder->path) != 0) {
+		fprintf(CWG_err_stream, "cashgettools: failed to write index at %s: %s\n", builder->path, strerror(errno));
+		unlink(tmpPath);
+		return CW_SYS_ERR;
+	}
+	return CW_OK;
+}
+
+void indexBuilderFree(struct IndexBuilder *builder) {
+	if (builder->txs) { free(builder->txs); }
+	if (builder->spends) { free(builder->spends); }
+	if (builder->nametags) { free(builder->nametags); }
+	if (builder->data) { free(builder->data); }
+	free(builder->path);
+	free(builder);
+}
+
+CW_STATUS indexUpdateFromBlockFiles(const char *indexPath, const char *blocksDir) {
+	struct IndexBuilder *builder;
+	uint64_t height;
+	CW_STATUS status;
+	if ((status = indexBuilderOpen(indexPath, &builder, &height)) != CW_OK) { return status; }
+
+	struct BlockFileEntry *entries = NULL;
+	size_t *chain = NULL;
+	size_t chainLen;
+	char *map = NULL;
+	size_t mapSize = 0;
+	int mapFile = -1;
+	uint64_t committedHeight = height;
+	char path[strlen(blocksDir)+sizeof(BLOCK_FILE_FMT)+16];
+	if ((status = blockFilesScan(blocksDir, &entries, &chain, &chainLen)) != CW_OK) { goto cleanup; }
+
+	struct BlockFileEntry *entry;
+	int fd;
+	struct stat st;
+	for (; height < chainLen; height++) {
+		entry = &entries[chain[height]];
+		// blocks of the chain mostly run in file order, so a file is mapped once for many
+		if (entry->file != mapFile) {
+			if (map) { munmap(map, mapSize); map = NULL; }
+			snprintf(path, sizeof(path), BLOCK_FILE_FMT, blocksDir, entry->file);
+			if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+				fprintf(CWG_err_stream, "cashgettools: failed to open block file %s: %s\n", path, strerror(errno));
+				if (fd >= 0) { close(fd); }
+				status = CW_SYS_ERR;
+				goto cleanup;
+			}
+			mapSize = st.st_size;
+			map = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (map == MAP_FAILED) { perror("mmap() failed"); map = NULL; status = CW_SYS_ERR; goto cleanup; }
+			mapFile = entry->file;
+		}
+		if ((status = indexBuilderAddBlock(builder, height, map+entry->offset, entry->len)) != CW_OK) { goto cleanup; }
+
+		if (height+1-committedHeight >= BLOCK_COMMIT_INTERVAL) {
+			if ((status = indexBuilderCommit(builder)) != CW_OK) { goto cleanup; }
+			committedHeight = height+1;
+		}
+	}
+	if (height > committedHeight || access(indexPath, F_OK) != 0) { status = indexBuilderCommit(builder); }
+
+	cleanup:
+		if (map) { munmap(map, mapSize); }
+		if (entries) { free(entries); }
+		if (chain) { free(chain); }
+		indexBuilderFree(builder);
+		return status;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static CW_STATUS indexMap(const char *path, struct Index *index) {
+	int fd;
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		fprintf(CWG_err_stream, "cashgettools: failed to open index at %s: %s\n", path, strerror(errno));
+		return CW_SYS_ERR;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) { perror("fstat() failed"); close(fd); return CW_SYS_ERR; }
+	if (st.st_size < sizeof(struct IndexHeader)) { close(fd); goto formaterr; }
+
+	index->mapSize = st.st_size;
+	if ((index->map = mmap(NULL, index->mapSize, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) { perror("mmap() failed"); close(fd); return CW_SYS_ERR; }
+	close(fd);
+
+	index->header = (const struct IndexHeader *)index->map;
+	if (memcmp(index->header->magic, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0 ||
+	    index->header->txsCount > index->mapSize/sizeof(struct IndexTx) ||
+	    index->header->spendsCount > index->mapSize/sizeof(struct IndexSpend) ||
+	    index->header->nametagsCount > index->mapSize/sizeof(struct IndexNametag) ||
+	    index->header->dataSize > index->mapSize ||
+	    sizeof(struct IndexHeader) + index->header->txsCount*sizeof(struct IndexTx) + index->header->spendsCount*sizeof(struct IndexSpend) +
+	    index->header->nametagsCount*sizeof(struct IndexNametag) + index->header->dataSize != index->mapSize) {
+		munmap(index->map, index->mapSize);
+		goto formaterr;
+	}
+	index->txs = (const struct IndexTx *)((const char *)index->map + sizeof(struct IndexHeader));
+	index->spends = (const struct IndexSpend *)(index->txs + index->header->txsCount);
+	index->nametags = (const struct IndexNametag *)(index->spends + index->header->spendsCount);
+	index->data = (const unsigned char *)(index->nametags + index->header->nametagsCount);
+	return CW_OK;
+
+	formaterr:
+		fprintf(CWG_err_stream, "cashgettools: index at %s is invalid or corrupt (or of an older format, in which case it must be rebuilt)\n", path);
+		return CWG_FILE_ERR;
+}
+
+static bool indexFindTxs(const struct Index *index, const char **txids, size_t count, char *hexDataAll, struct FetchItemInfo *itemInfo) {
+	if (index->header->txsCount < 1) { return false; }
+
+	unsigned char txid[CW_TXID_BYTES];
+	const struct IndexTx *tx;
+	uint64_t dataOffset;
+	uint64_t dataLen;
+	char *hexDataPtr = hexDataAll;
+	for (int i=0; i<count; i++) {
+		if (!CW_is_valid_txid(txids[i])) { return false; }
+		hexStrToByteArr(txids[i], 0, (char *)txid);
+		if ((tx = indexFindTx(index, txid)) == NULL) { return false; }
+
+		dataOffset = indexGetUint(tx->dataOffset, 8);
+		dataLen = indexGetUint(tx->dataLen, 4);
+		// an index may have been built elsewhere, so data that couldn't have come from cashweb (or fit in hexDataAll) is taken as corrupt
+		if (dataLen > CW_TX_DATA_BYTES || dataOffset > index->header->dataSize || dataLen > index->header->dataSize-dataOffset) { return false; }
+		byteArrToHexStr((const char *)index->data+dataOffset, dataLen, hexDataPtr);
+		hexDataPtr += HEX_CHARS(dataLen);
+		if (itemInfo) { itemInfo[i].hexLen = HEX_CHARS(dataLen); itemInfo[i].confirmed = true; }
+	}
+	*hexDataPtr = 0;
+	return true;
+}
+
+static const struct IndexTx *indexFindTx(const struct Index *index, const unsigned char *txid) {
+	size_t lo = 0;
+	size_t hi = index->header->txsCount;
+	size_t mid;
+	int cmp;
+	while (lo < hi) {
+		mid = lo + (hi-lo)/2;
+		if ((cmp = memcmp(index->txs[mid].txid, txid, CW_TXID_BYTES)) == 0) { return &index->txs[mid]; }
+		if (cmp < 0) { lo = mid+1; }
+		else { hi = mid; }
+	}
+	return NULL;
+}
+
+static bool indexFindSpend(const struct Index *index, const unsigned char *prevTxid, uint32_t prevVout, unsigned char *txid) {
+	unsigned char key[INDEX_SPEND_KEY_SZ];
+	memcpy(key, prevTxid, CW_TXID_BYTES);
+	indexPutUint(prevVout, 4, key+CW_TXID_BYTES);
+
+	size_t lo = 0;
+	size_t hi = index->header->spendsCount;
+	size_t mid;
+	int cmp;
+	while (lo < hi) {
+		mid = lo + (hi-lo)/2;
+		if ((cmp = memcmp(&index->spends[mid], key, INDEX_SPEND_KEY_SZ)) == 0) {
+			memcpy(txid, index->spends[mid].txid, CW_TXID_BYTES);
+			return true;
+		}
+		if (cmp < 0) { lo = mid+1; }
+		else { hi = mid; }
+	}
+	return false;
+}
+
+static bool indexFindNametag(const struct Index *index, const char *nametag, size_t nameLen, size_t nth, unsigned char *txid) {
+	unsigned char digest[INDEX_NAME_DIGEST_SZ];
+	indexNameDigest(nametag, nameLen, digest);
+
+	// lower bound of the nametag's run of claims
+	size_t lo = 0;
+	size_t hi = index->header->nametagsCount;
+	size_t mid;
+	while (lo < hi) {
+		mid = lo + (hi-lo)/2;
+		if (memcmp(index->nametags[mid].nameDigest, digest, sizeof(digest)) < 0) { lo = mid+1; }
+		else { hi = mid; }
+	}
+	if (nth < 1 || lo+nth-1 >= index->header->nametagsCount || memcmp(index->nametags[lo+nth-1].nameDigest, digest, sizeof(digest)) != 0) { return false; }
+
+	// an index may have been built elsewhere, so the claim's nametag is checked in full rather than trusting the digest
+	const struct IndexNametag *claim = &index->nametags[lo+nth-1];
+	uint64_t nameOffset = indexGetUint(claim->nameOffset, 8);
+	if (indexGetUint(claim->nameLen, 2) != nameLen || nameOffset > index->header->dataSize || nameLen > index->header->dataSize-nameOffset ||
+	    memcmp(index->data+nameOffset, nametag, nameLen) != 0) { return false; }
+
+	memcpy(txid, claim->txid, CW_TXID_BYTES);
+	return true;
+}
+
+static void indexNameDigest(const char *nametag, size_t nameLen, unsigned char *digest) {
+	struct TxSha256 sha;
+	txSha256Init(&sha);
+	txSha256Update(&sha, (const uint8_t *)nametag, nameLen);
+	txSha256Final(&sha, digest);
+}
+
+static bool indexBuilderAppendData(struct IndexBuilder *builder, const void *data, size_t len, uint64_t *offsetPtr) {
+	if (builder->dataSize+len > builder->dataCapacity) {
+		size_t capacity = builder->dataCapacity ? builder->dataCapacity*2 : INDEX_RECORDS_START*CW_TX_DATA_BYTES;
+		if (capacity < builder->dataSize+len) { capacity = builder->dataSize+len; }
+		unsigned char *newData;
+		if ((newData = realloc(builder->data, capacity)) == NULL) { perror("realloc failed"); return false; }
+		builder->data = newData;
+		builder->dataCapacity = capacity;
+	}
+
+	memcpy(builder->data+builder->dataSize, data, len);
+	*offsetPtr = builder->dataSize;
+	builder->dataSize += len;
+	return true;
+}
+
+static bool indexRecordsGrow(void **recordsPtr, size_t recordSz, size_t count, size_t *sizePtr) {
+	if (count < *sizePtr) { return true; }
+
+	size_t size = *sizePtr ? *sizePtr*2 : INDEX_RECORDS_START;
+	void *newRecords;
+	if ((newRecords = realloc(*recordsPtr, size*recordSz)) == NULL) { perror("realloc failed"); return false; }
+	*recordsPtr = newRecords;
+	*sizePtr = size;
+	return true;
+}
+
+static size_t indexRecordsDedupe(void *records, size_t recordSz, size_t count, int (*compare)(const void *, const void *)) {
+	if (count < 1) { return 0; }
+
+	char *recordsBytes = (char *)records;
+	size_t kept = 1;
+	for (size_t i=1; i<count; i++) {
+		if (compare(recordsBytes+(kept-1)*recordSz, recordsBytes+i*recordSz) == 0) { continue; }
+		if (kept != i) { memcpy(recordsBytes+kept*recordSz, recordsBytes+i*recordSz, recordSz); }
+		++kept;
+	}
+	return kept;
+}
+
+static CW_STATUS blockFilesScan(const char *blocksDir, struct BlockFileEntry **entriesPtr, size_t **chainPtr, size_t *chainLenPtr) {
+	struct BlockFileEntry *entries = NULL;
+	size_t entriesCount = 0;
+	size_t entriesSize = 0;
+	size_t *chain = NULL;
+	CW_STATUS status = CW_OK;
+
+	// first pass locates every block record, noting its hash and that of its parent
+	char path[strlen(blocksDir)+sizeof(BLOCK_FILE_FMT)+16];
+	FILE *fp;
+	unsigned char recordHeader[BLOCK_FILE_RECORD_HEADER_SZ];
+	unsigned char blockHeader[BLOCK_HEADER_SZ];
+	static const unsigned char zeroMagic[BLOCK_MAGIC_LEN];
+	const unsigned char *magic = NULL;
+	size_t offset;
+	size_t len;
+	int file;
+	for (file = 0; ; file++) {
+		snprintf(path, sizeof(path), BLOCK_FILE_FMT, blocksDir, file);
+		if ((fp = fopen(path, "rb")) == NULL) { break; }
+
+		offset = 0;
+		// files are preallocated, so records end at zeroed space (or a record cut off by shutdown)
+		while (fread(recordHeader, 1, sizeof(recordHeader), fp) == sizeof(recordHeader)) {
+			if (memcmp(recordHeader, zeroMagic, BLOCK_MAGIC_LEN) == 0) { break; }
+			// the network is taken from the first record, and a record of any other is taken as garbage, ending the file
+			if (!magic) {
+				for (int i=0; i<sizeof(blockMagics)/sizeof(blockMagics[0]); i++) {
+					if (memcmp(recordHeader, blockMagics[i], BLOCK_MAGIC_LEN) == 0) { magic = blockMagics[i]; break; }
+				}
+				if (!magic) {
+					fprintf(CWG_err_stream, "cashgettools: %s doesn't begin with the magic of a known network; not a block file?\n", path);
+					status = CW_CALL_NO;
+					fclose(fp);
+					goto cleanup;
+				}
+			}
+			if (memcmp(recordHeader, magic, BLOCK_MAGIC_LEN) != 0) {
+				fprintf(CWG_err_stream, "cashgettools: unexpected magic in %s at offset %zu; skipping the rest of the file\n", path, offset);
+				break;
+			}
+			len = (size_t)recordHeader[4] | (size_t)recordHeader[5] << 8 | (size_t)recordHeader[6] << 16 | (size_t)recordHeader[7] << 24;
+			offset += sizeof(recordHeader);
+			if (len < sizeof(blockHeader) || fread(blockHeader, 1, sizeof(blockHeader), fp) != sizeof(blockHeader)) { break; }
+
+			if (!indexRecordsGrow((void **)&entries, sizeof(struct BlockFileEntry), entriesCount, &entriesSize)) { status = CW_SYS_ERR; fclose(fp); goto cleanup; }
+			struct BlockFileEntry *entry = &entries[entriesCount++];
+			txScanTxid((const char *)blockHeader, sizeof(blockHeader), entry->hash);
+			txScanTxidBytes((const char *)blockHeader+4, false, entry->prevHash);
+			entry->file = file;
+			entry->offset = offset;
+			entry->len = len;
+			entry->height = BLOCK_HEIGHT_UNKNOWN;
+
+			offset += len;
+			if (fseek(fp, offset, SEEK_SET) != 0) { break; }
+		}
+		fclose(fp);
+	}
+	if (file < 1) {
+		fprintf(CWG_err_stream, "cashgettools: no block files found in %s\n", blocksDir);
+		return CW_CALL_NO;
+	}
+	if (entriesCount < 1) { status = CWG_FETCH_NO; goto cleanup; }
+
+	// blocks are stored in the order they arrived, so heights are worked out by following each block back to one of known height
+	// (or to the genesis block, or to a block whose parent is missing, making the run orphaned), then setting them on the way forward
+	qsort(entries, entriesCount, sizeof(struct BlockFileEntry), &compareBlockFileEntries);
+	size_t *stack;
+	if ((stack = malloc(entriesCount*sizeof(size_t))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+	static const unsigned char nullHash[CW_TXID_BYTES];
+	struct BlockFileEntry *entry;
+	struct BlockFileEntry *parent;
+	size_t stackLen;
+	int64_t height;
+	for (size_t i=0; i<entriesCount; i++) {
+		stackLen = 0;
+		height = BLOCK_HEIGHT_ORPHAN;
+		for (entry = &entries[i]; entry->height == BLOCK_HEIGHT_UNKNOWN; entry = parent) {
+			stack[stackLen++] = entry-entries;
+			if (memcmp(entry->prevHash, nullHash, CW_TXID_BYTES) == 0) { height = -1; break; }
+			if ((parent = bsearch(entry->prevHash, entries, entriesCount, sizeof(struct BlockFileEntry), &compareBlockFileEntries)) == NULL) { break; }
+		}
+		if (entry->height != BLOCK_HEIGHT_UNKNOWN) { height = entry->height; }
+
+		while (stackLen > 0) { entries[stack[--stackLen]].height = height == BLOCK_HEIGHT_ORPHAN ? BLOCK_HEIGHT_ORPHAN : ++height; }
+	}
+	free(stack);
+
+	size_t tip = 0;
+	for (size_t i=0; i<entriesCount; i++) {
+		if (entries[i].height > entries[tip].height) { tip = i; }
+	}
+	if (entries[tip].height < 0) { status = CWG_FETCH_NO; goto cleanup; }
+
+	// the best chain is taken as the longest, and walked back from its tip
+	size_t chainLen = entries[tip].height+1;
+	if ((chain = malloc(chainLen*sizeof(size_t))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+	entry = &entries[tip];
+	for (int64_t h=chainLen-1; h >= 0; h--) {
+		chain[h] = entry-entries;
+		if (h > 0) { entry = bsearch(entry->prevHash, entries, entriesCount, sizeof(struct BlockFileEntry), &compareBlockFileEntries); }
+	}
+
+	*entriesPtr = entries;
+	*chainPtr = chain;
+	*chainLenPtr = chainLen;
+	return CW_OK;
+
+	cleanup:
+		if (status == CWG_FETCH_NO) { fprintf(CWG_err_stream, "cashgettools: no chain of blocks found in %s\n", blocksDir); }
+		if (entries) { free(entries); }
+		return status;
+}
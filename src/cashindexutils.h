@@ -0,0 +1,85 @@
+#ifndef __CASHINDEXUTILS_H__
+#define __CASHINDEXUTILS_H__
+
+#include "cashfetchutils.h"
+
+/*
+ * handle on an index being built/updated; records are gathered in memory and written out whole by indexBuilderCommit()
+ */
+struct IndexBuilder;
+
+/*
+ * opens (read-only, memory-mapped) the local index at indexPath, so that fetches are answered locally where it holds the TXs
+   (with fetches by INTXID/nametag resolved to TXIDs through it); the index may be shared by any number of processes/threads at once
+ * will set params->index on success
+ */
+CW_STATUS initIndex(const char *indexPath, struct CWG_params *params);
+
+/*
+ * closes the index stored in params;
+ * params->index will be set NULL
+ */
+void cleanupIndex(struct CWG_params *params);
+
+/*
+ * fetches hex data at specified ids of given type (as with fetchHexData()) from the index (params->index), resolving ids of type
+   BY_INTXID or BY_NAMETAG to TXIDs through it; TXs whose data the index doesn't hold are fetched through given fetcher by TXID
+ * only TXs confirmed as of the index's last update can be found by BY_INTXID/BY_NAMETAG
+ * writes txids (in order) to provided pointer (if not NULL), and writes all hex data (in order) to hexDataAll
+ * per-item details are written to itemInfo if not NULL (TXs answered by the index being confirmed)
+ */
+CW_STATUS fetchHexDataIndexed(const char **ids, size_t count, FETCH_TYPE type, struct CWG_params *params, char **txids, char *hexDataAll, struct FetchItemInfo *itemInfo,
+			      CW_STATUS (*fetcher)(const char **, size_t, FETCH_TYPE, struct CWG_params *, char **, char *, struct FetchItemInfo *));
+
+/*
+ * starts an update of the index at indexPath, loading whatever it already holds (if it exists);
+   the height of the next block to be added is written to heightPtr
+ * must be freed with indexBuilderFree()
+ */
+CW_STATUS indexBuilderOpen(const char *indexPath, struct IndexBuilder **builderPtr, uint64_t *heightPtr);
+
+/*
+ * adds the cashweb TXs of the given serialized (raw, not hex) block at given height to the index being built;
+   blocks must be added in order of height
+ */
+CW_STATUS indexBuilderAddBlock(struct IndexBuilder *builder, uint64_t height, const char *block, size_t len);
+
+/*
+ * adds record of a TX's data (raw bytes) to the index being built, as with indexBuilderAddBlock() but for records known otherwise
+   (e.g. recorded from fetches); txids are as bytes in display order
+ * returns false on failure
+ */
+bool indexBuilderAddTx(struct IndexBuilder *builder, const unsigned char *txid, const unsigned char *data, size_t len);
+
+/*
+ * adds record of the TX at txid spending given outpoint to the index being built
+ * returns false on failure
+ */
+bool indexBuilderAddSpend(struct IndexBuilder *builder, const unsigned char *prevTxid, uint32_t prevVout, const unsigned char *txid);
+
+/*
+ * adds record of the TX at txid claiming given nametag (prefix included) to the index being built;
+   claims of a nametag are ordered by order (the height of the block, when indexing blocks), and are looked up by position in that order,
+   so every claim must be added; a claim that isn't cashweb-formatted may be added with a null txid (all zeros), to be fetched as CWG_FILE_ERR
+ * returns false on failure
+ */
+bool indexBuilderAddNametag(struct IndexBuilder *builder, const char *nametag, size_t nameLen, uint64_t order, const unsigned char *txid);
+
+/*
+ * writes out the index being built in place of the old one (which any open handles continue to see until reopened)
+ */
+CW_STATUS indexBuilderCommit(struct IndexBuilder *builder);
+
+/*
+ * frees index builder (without committing)
+ */
+void indexBuilderFree(struct IndexBuilder *builder);
+
+/*
+ * builds/updates the index at indexPath from the block files (blk*.dat) of a node's blocks directory, from where it left off
+   up to the tip of the best (longest) chain found in them
+ * the files are only read, so the node may keep running, but blocks it hasn't yet flushed to disk are left for the next update
+ */
+CW_STATUS indexUpdateFromBlockFiles(const char *indexPath, const char *blocksDir);
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef __CASHJSONSCANUTILS_H__
+#define __CASHJSONSCANUTILS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * minimal streaming scanner over JSON text in memory, for pulling a handful of fields out of large responses
+   without building a DOM or allocating
+ * strings are handed back as slices of the source text (between the quotes, escapes left as-is);
+   this is intended for the hex/txid/name strings of fetch responses, which don't contain escapes
+ * every function returns false on malformed/unexpected input, leaving the scanner at the point of failure
+ */
+struct JsonScan {
+	const char *p;
+	const char *end;
+};
+
+/* compares a scanned key/string slice to a string literal */
+#define JSON_SCAN_IS(str, len, lit) ((len) == sizeof(lit)-1 && memcmp((str), (lit), sizeof(lit)-1) == 0)
+
+/*
+ * initializes scanner over len bytes at data
+ */
+static inline void jsonScanInit(struct JsonScan *js, const char *data, size_t len) {
+	js->p = data;
+	js->end = data+len;
+}
+
+/*
+ * skips whitespace
+ * returns false if end of input is reached
+ */
+static inline bool jsonScanWs(struct JsonScan *js) {
+	while (js->p < js->end && (*js->p == ' ' || *js->p == '\n' || *js->p == '\r' || *js->p == '\t')) { ++js->p; }
+	return js->p < js->end;
+}
+
+/*
+ * checks if next non-whitespace character is c, without consuming it
+ */
+static inline bool jsonScanPeek(struct JsonScan *js, char c) {
+	return jsonScanWs(js) && *js->p == c;
+}
+
+/*
+ * consumes next non-whitespace character if it is c
+ */
+static inline bool jsonScanExpect(struct JsonScan *js, char c) {
+	if (!jsonScanPeek(js, c)) { return false; }
+	++js->p;
+	return true;
+}
+
+/*
+ * consumes literal null if next
+ */
+static inline bool jsonScanNull(struct JsonScan *js) {
+	if (!jsonScanWs(js) || js->end-js->p < 4 || memcmp(js->p, "null", 4) != 0) { return false; }
+	js->p += 4;
+	return true;
+}
+
+/*
+ * consumes string, writing start of its contents to strPtr and length to lenPtr
+ */
+static inline bool jsonScanString(struct JsonScan *js, const char **strPtr, size_t *lenPtr) {
+	if (!jsonScanExpect(js, '"')) { return false; }
+	const char *start = js->p;
+	while (js->p < js->end && *js->p != '"') { js->p += *js->p == '\\' ? 2 : 1; }
+	if (js->p >= js->end) { return false; }
+	*strPtr = start;
+	*lenPtr = js->p - start;
+	++js->p;
+	return true;
+}
+
+/*
+ * consumes number, writing its integer part to valPtr (fraction/exponent are consumed but ignored)
+ */
+static inline bool jsonScanInt(struct JsonScan *js, int64_t *valPtr) {
+	if (!jsonScanWs(js)) { return false; }
+	bool neg = *js->p == '-';
+	if (neg) { ++js->p; }
+	if (js->p >= js->end || *js->p < '0' || *js->p > '9') { return false; }
+	int64_t val = 0;
+	while (js->p < js->end && *js->p >= '0' && *js->p <= '9') { val = val*10 + (*js->p++ - '0'); }
+	while (js->p < js->end && (*js->p == '.' || *js->p == 'e' || *js->p == 'E' || *js->p == '+' || *js->p == '-' || (*js->p >= '0' && *js->p <= '9'))) { ++js->p; }
+	*valPtr = neg ? -val : val;
+	return true;
+}
+
+/*
+ * consumes any single value (string, number, literal, or entire object/array)
+ */
+static bool jsonScanSkip(struct JsonScan *js) {
+	const char *str;
+	size_t len;
+	size_t depth = 0;
+	do {
+		if (!jsonScanWs(js)) { return false; }
+		switch (*js->p) {
+			case '"':
+				if (!jsonScanString(js, &str, &len)) { return false; }
+				break;
+			case '{':
+			case '[':
+				++depth; ++js->p;
+				break;
+			case '}':
+			case ']':
+				if (depth < 1) { return false; }
+				--depth; ++js->p;
+				break;
+			default:
+				// number, literal, or separator within a container
+				if (depth < 1 && (*js->p == ',' || *js->p == ':')) { return false; }
+				++js->p;
+				while (js->p < js->end && !strchr(",:]}\"{[ \n\r\t", *js->p)) { ++js->p; }
+		}
+	} while (depth > 0);
+	return true;
+}
+
+/*
+ * advances to next member of an object whose opening brace has been consumed, consuming its key and colon;
+   key is written to keyPtr/keyLenPtr, or morePtr is set false (and closing brace consumed) if there are no more members
+ */
+static inline bool jsonScanMember(struct JsonScan *js, const char **keyPtr, size_t *keyLenPtr, bool *morePtr) {
+	if (jsonScanExpect(js, '}')) { *morePtr = false; return true; }
+	jsonScanExpect(js, ',');
+	if (!jsonScanString(js, keyPtr, keyLenPtr) || !jsonScanExpect(js, ':')) { return false; }
+	*morePtr = true;
+	return true;
+}
+
+/*
+ * advances to next element of an array whose opening bracket has been consumed,
+   or sets morePtr false (and consumes closing bracket) if there are no more elements
+ */
+static inline bool jsonScanElement(struct JsonScan *js, bool *morePtr) {
+	if (jsonScanExpect(js, ']')) { *morePtr = false; return true; }
+	jsonScanExpect(js, ',');
+	*morePtr = jsonScanWs(js);
+	return *morePtr;
+}
+
+/*
+ * open-addressed hash of ids to their positions (ids may repeat, in which case positions are chained in order)
+ * slots/next must each be able to hold JSON_SCAN_ID_SLOTS(count)/count entries respectively
+ */
+#define JSON_SCAN_ID_SLOTS(count) (2*(count)+1)
+#define JSON_SCAN_ID_NONE SIZE_MAX
+
+struct JsonScanIds {
+	const char **ids;
+	size_t count;
+	size_t *slots;
+	size_t slotsCount;
+	size_t *next;
+};
+
+static inline uint64_t jsonScanHash(const char *str, size_t len) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i=0; i<len; i++) { hash = (hash ^ (unsigned char)str[i]) * 1099511628211ULL; }
+	return hash;
+}
+
+/*
+ * builds hash of given ids into provided memory
+ */
+static void jsonScanIdsInit(struct JsonScanIds *h, const char **ids, size_t count, size_t *slots, size_t *next) {
+	h->ids = ids;
+	h->count = count;
+	h->slots = slots;
+	h->slotsCount = JSON_SCAN_ID_SLOTS(count);
+	h->next = next;
+	for (size_t s=0; s<h->slotsCount; s++) { slots[s] = JSON_SCAN_ID_NONE; }
+
+	size_t s;
+	size_t last;
+	for (size_t i=0; i<count; i++) {
+		next[i] = JSON_SCAN_ID_NONE;
+		for (s = jsonScanHash(ids[i], strlen(ids[i])) % h->slotsCount; slots[s] != JSON_SCAN_ID_NONE; s = (s+1) % h->slotsCount) {
+			if (strcmp(ids[slots[s]], ids[i]) == 0) { break; }
+		}
+		if (slots[s] == JSON_SCAN_ID_NONE) { slots[s] = i; continue; }
+		for (last = slots[s]; next[last] != JSON_SCAN_ID_NONE; last = next[last]);
+		next[last] = i;
+	}
+}
+
+/*
+ * looks up first position of id given as slice (further positions follow through h->next)
+ * returns JSON_SCAN_ID_NONE if not found
+ */
+static size_t jsonScanIdsFind(struct JsonScanIds *h, const char *id, size_t len) {
+	for (size_t s = jsonScanHash(id, len) % h->slotsCount; h->slots[s] != JSON_SCAN_ID_NONE; s = (s+1) % h->slotsCount) {
+		if (strlen(h->ids[h->slots[s]]) == len && memcmp(h->ids[h->slots[s]], id, len) == 0) { return h->slots[s]; }
+	}
+	return JSON_SCAN_ID_NONE;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include <cashgettools.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+#define USAGE_STR "usage: %s [FLAGS] <toget>...\n"
+#define HELP_STR \
+	USAGE_STR\
+	"\n"\
+	" Flag    | Use\n"\
+	"---------|-------------------------------------------------------------------------------------------------------------------------\n"\
+	"[none]   | get the CashWeb IDs <toget> round-robin from threads sharing a MongoDB client pool (as cashgettools users in multi-threaded\n"\
+	"         | scenarios do), for a fixed duration, and report throughput, latency, and waits on the pool\n"\
+	"-m <ARG> | specify MongoDB URI, e.g. of a local replica set as mongodb://localhost:27017,localhost:27018/?replicaSet=rs0 (default is "MONGODB_LOCAL_ADDR")\n"\
+	"-P <ARG> | specify maximum size of MongoDB client pool (default is the URI's maxPoolSize, or 100)\n"\
+	"-M <ARG> | specify MongoDB read preference, e.g. secondaryPreferred or nearest (default is the URI's, or primary)\n"\
+	"-T <ARG> | specify MongoDB socket and server selection timeouts in ms as <socket>[:<selection>] (default is the URI's, or mongoc's)\n"\
+	"-j <ARG> | specify number of threads getting (default is "THREADS_DEFAULT_STR")\n"\
+	"-s <ARG> | specify duration in seconds (default is "SECONDS_DEFAULT_STR")\n"
+
+#define MONGODB_LOCAL_ADDR "mongodb://localhost:27017"
+#define THREADS_DEFAULT 16
+#define THREADS_DEFAULT_STR "16"
+#define SECONDS_DEFAULT 10
+#define SECONDS_DEFAULT_STR "10"
+
+/*
+ * state of a benchmark, shared between its threads
+ */
+struct Bench {
+	struct CWG_params *params;
+	char **ids;
+	size_t idsCount;
+	struct timespec deadline;
+	int nullFd;
+};
+
+/*
+ * tallies of a single thread's gets; latencies (in ms) of each get are kept for percentiles
+ */
+struct BenchThread {
+	struct Bench *bench;
+	size_t offset;
+	size_t gets;
+	size_t failures;
+	double *latencies;
+	size_t latenciesSize;
+};
+
+static inline double elapsedMs(struct timespec *start, struct timespec *end) {
+	return (end->tv_sec-start->tv_sec)*1000.0 + (end->tv_nsec-start->tv_nsec)/1000000.0;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+/*
+ * thread routine for getting ids round-robin (from the thread's offset) until the deadline
+ */
+static void *benchWorker(void *arg) {
+	struct BenchThread *thread = (struct BenchThread *)arg;
+	struct Bench *bench = thread->bench;
+
+	// a get sets the client it takes from the pool in its params, so each thread needs its own
+	struct CWG_params params;
+	copy_CWG_params(&params, bench->params);
+
+	struct timespec start;
+	struct timespec end;
+	double *latencies;
+	for (size_t i=thread->offset; ; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (start.tv_sec > bench->deadline.tv_sec || (start.tv_sec == bench->deadline.tv_sec && start.tv_nsec >= bench->deadline.tv_nsec)) { break; }
+
+		if (CWG_get_by_id(bench->ids[i % bench->idsCount], &params, bench->nullFd) != CW_OK) { ++thread->failures; }
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		if (thread->gets >= thread->latenciesSize) {
+			if ((latencies = realloc(thread->latencies, (thread->latenciesSize*2+64)*sizeof(double))) == NULL) { perror("realloc failed"); break; }
+			thread->latencies = latencies;
+			thread->latenciesSize = thread->latenciesSize*2+64;
+		}
+		thread->latencies[thread->gets++] = elapsedMs(&start, &end);
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	struct CWG_params params;
+	init_CWG_params(&params, NULL, NULL, NULL, NULL);
+
+	char *mongodb = MONGODB_LOCAL_ADDR;
+	char *selectionTimeoutStr;
+	int threadsCount = THREADS_DEFAULT;
+	int seconds = SECONDS_DEFAULT;
+
+	int c;
+	while ((c = getopt(argc, argv, ":hm:P:M:T:j:s:")) != -1) {
+		switch (c) {
+			case 'h':
+				fprintf(stderr, HELP_STR, argv[0]);
+				exit(0);
+			case 'm':
+				mongodb = optarg;
+				break;
+			case 'P':
+				params.mongodbPoolMaxSize = atoi(optarg);
+				break;
+			case 'M':
+				params.mongodbReadPref = optarg;
+				break;
+			case 'T':
+				params.mongodbSocketTimeoutMS = strtol(optarg, &selectionTimeoutStr, 10);
+				params.mongodbServerSelectionTimeoutMS = *selectionTimeoutStr == ':' ? atoi(selectionTimeoutStr+1) : 0;
+				break;
+			case 'j':
+				threadsCount = atoi(optarg);
+				break;
+			case 's':
+				seconds = atoi(optarg);
+				break;
+			case ':':
+				fprintf(stderr, "Option -%c requires an argument.\n", optopt);
+				exit(1);
+			case '?':
+				if (isprint(optopt)) {
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				} else {
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				}
+				exit(1);
+			default:
+				fprintf(stderr, "getopt() unknown error\n");
+				exit(1);
+		}
+	}
+
+	if (argc <= optind) {
+		fprintf(stderr, USAGE_STR"\n-h for help\n", argv[0]);
+		exit(1);
+	}
+	if (threadsCount < 1 || seconds < 1) {
+		fprintf(stderr, "Number of threads and duration must be at least 1.\n");
+		exit(1);
+	}
+
+	struct CWG_mongo_pool_stats poolStats;
+	init_CWG_mongo_pool_stats(&poolStats);
+	params.mongodbPoolStats = &poolStats;
+	CW_STATUS status;
+	if ((status = CWG_init_mongo_pool(mongodb, &params)) != CW_OK) {
+		fprintf(stderr, "\nInitializing MongoDB pool failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
+		exit(1);
+	}
+
+	struct Bench bench;
+	bench.params = &params;
+	bench.ids = argv+optind;
+	bench.idsCount = argc-optind;
+	if ((bench.nullFd = open("/dev/null", O_WRONLY)) < 0) { perror("open() failed"); exit(1); }
+
+	struct BenchThread threads[threadsCount];
+	pthread_t tids[threadsCount];
+	memset(threads, 0, sizeof(threads));
+	int started = 0;
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bench.deadline = start;
+	bench.deadline.tv_sec += seconds;
+	for (; started < threadsCount; started++) {
+		threads[started].bench = &bench;
+		threads[started].offset = started;
+		if (pthread_create(&tids[started], NULL, &benchWorker, &threads[started]) != 0) { perror("pthread_create() failed"); break; }
+	}
+	for (int i=0; i<started; i++) { pthread_join(tids[i], NULL); }
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	close(bench.nullFd);
+	CWG_cleanup_mongo_pool(&params);
+
+	size_t gets = 0;
+	size_t failures = 0;
+	for (int i=0; i<started; i++) { gets += threads[i].gets; failures += threads[i].failures; }
+	double *latencies = malloc((gets ? gets : 1)*sizeof(double));
+	if (!latencies) { perror("malloc failed"); exit(1); }
+	size_t n = 0;
+	for (int i=0; i<started; i++) {
+		memcpy(latencies+n, threads[i].latencies, threads[i].gets*sizeof(double));
+		n += threads[i].gets;
+		free(threads[i].latencies);
+	}
+	qsort(latencies, gets, sizeof(double), &compareDoubles);
+
+	double totalMs = elapsedMs(&start, &end);
+	printf("%d threads, %.1f s: %zu gets (%zu failed), %.1f gets/s\n", started, totalMs/1000, gets, failures, gets/(totalMs/1000));
+	if (gets > 0) {
+		printf("latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			latencies[gets/2], latencies[gets*9/10], latencies[gets*99/100], latencies[gets-1]);
+	}
+	printf("pool: waited for %zu of %zu clients, %.3f ms total, %.3f ms avg wait, longest %.3f ms\n",
+		poolStats.waits, poolStats.pops, poolStats.waitMicros/1000.0, poolStats.waits ? poolStats.waitMicros/1000.0/poolStats.waits : 0, poolStats.maxWaitMicros/1000.0);
+	free(latencies);
+
+	return failures > 0 ? 1 : 0;
+}
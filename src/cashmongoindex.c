@@ -0,0 +1,95 @@
+#include <cashgettools.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#define USAGE_STR "usage: %s [FLAGS]\n"
+#define HELP_STR \
+	USAGE_STR\
+	"\n"\
+	" Flag    | Use\n"\
+	"---------|-------------------------------------------------------------------------------------------------------------------------\n"\
+	"[none]   | create the indexes CashWeb queries rely on in the BitDB-populated MongoDB running locally, then check and report on each query\n"\
+	"-m <ARG> | specify MongoDB URI (default is "MONGODB_LOCAL_ADDR")\n"\
+	"-c       | only check and report on each query (plan, keys/documents examined, latency), without creating indexes\n"\
+	"-t <ARG> | specify TXID to query by when checking (default is a placeholder; plans are the same either way, but latency is more telling)\n"\
+	"-n <ARG> | specify name to query by when checking (default is a placeholder)\n"\
+	"-r <ARG> | specify number of runs of each query to average latency over (default is "RUNS_DEFAULT_STR")\n"\
+	"\n"\
+	"cashserver checks (with a warning) that these indexes are in place on startup.\n"
+
+#define MONGODB_LOCAL_ADDR "mongodb://localhost:27017"
+#define RUNS_DEFAULT 10
+#define RUNS_DEFAULT_STR "10"
+
+int main(int argc, char **argv) {
+	char *mongodb = MONGODB_LOCAL_ADDR;
+	bool checkOnly = false;
+	char *sampleTxid = NULL;
+	char *sampleName = NULL;
+	int runs = RUNS_DEFAULT;
+
+	int c;
+	while ((c = getopt(argc, argv, ":hm:ct:n:r:")) != -1) {
+		switch (c) {
+			case 'h':
+				fprintf(stderr, HELP_STR, argv[0]);
+				exit(0);
+			case 'm':
+				mongodb = optarg;
+				break;
+			case 'c':
+				checkOnly = true;
+				break;
+			case 't':
+				sampleTxid = optarg;
+				break;
+			case 'n':
+				sampleName = optarg;
+				break;
+			case 'r':
+				runs = atoi(optarg);
+				break;
+			case ':':
+				fprintf(stderr, "Option -%c requires an argument.\n", optopt);
+				exit(1);
+			case '?':
+				if (isprint(optopt)) {
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				} else {
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				}
+				exit(1);
+			default:
+				fprintf(stderr, "getopt() unknown error\n");
+				exit(1);
+		}
+	}
+
+	if (sampleTxid && !CW_is_valid_txid(sampleTxid)) {
+		fprintf(stderr, "Invalid TXID specified.\n");
+		exit(1);
+	}
+	if (sampleName && !CW_is_valid_name(sampleName)) {
+		fprintf(stderr, "Invalid name specified.\n");
+		exit(1);
+	}
+	if (runs < 1) {
+		fprintf(stderr, "Number of runs must be at least 1.\n");
+		exit(1);
+	}
+	char sampleNametag[sampleName ? strlen(CW_NAMETAG_PREFIX)+strlen(sampleName)+1 : 1];
+	if (sampleName) { snprintf(sampleNametag, sizeof(sampleNametag), "%s%s", CW_NAMETAG_PREFIX, sampleName); }
+
+	CW_STATUS status;
+	if (!checkOnly && (status = CWG_create_mongo_indexes(mongodb, stdout)) != CW_OK) {
+		fprintf(stderr, "\nCreating indexes failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
+		exit(1);
+	}
+
+	if (!checkOnly) { printf("\n"); }
+	if ((status = CWG_check_mongo_indexes(mongodb, sampleTxid, sampleName ? sampleNametag : NULL, runs, stdout)) != CW_OK) {
+		fprintf(stderr, "\nCheck failed, error code %d: %s.\n", status, CWG_errno_to_msg(status));
+		exit(1);
+	}
+	return 0;
+}
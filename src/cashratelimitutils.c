@@ -0,0 +1,181 @@
+#include "cashratelimitutils.h"
+#include "cashwebutils.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+/* rate limiter constants */
+#define RATE_LIMIT_ENDPOINTS_MAX 16
+#define RATE_LIMIT_ENDPOINT_MAX_LEN 255
+
+/*
+ * bucket for a single endpoint; times are monotonic milliseconds, which agree between processes on the same machine
+ */
+struct RateLimitBucket {
+	char endpoint[RATE_LIMIT_ENDPOINT_MAX_LEN+1];
+	double rate;
+	double burst;
+	double tokens;
+	double refilledAt;
+	double blockedUntil;
+};
+
+/*
+ * the whole limiter lives in a single anonymous shared mapping, so forked children share its buckets;
+   lock is process-shared and robust, so a child dying while holding it doesn't wedge the others
+ * pid is that of the process which created it (and so may destroy lock)
+ */
+struct RateLimiter {
+	pthread_mutex_t lock;
+	pid_t pid;
+	double rate;
+	double burst;
+	struct RateLimitBucket buckets[RATE_LIMIT_ENDPOINTS_MAX];
+	size_t bucketsCount;
+};
+
+/*
+ * gets monotonic time in milliseconds
+ */
+static double rateLimitNowMs();
+
+/*
+ * locks limiter, recovering the lock if its holder died
+ */
+static void rateLimiterLock(struct RateLimiter *limiter);
+
+/*
+ * finds bucket for endpoint, adding it (full, with limiter's defaults) if absent; lock must be held
+ * returns NULL if endpoint is too long or table is full, in which case the endpoint goes unlimited
+ */
+static struct RateLimitBucket *rateLimiterBucket(struct RateLimiter *limiter, const char *endpoint);
+
+/*
+ * gets burst to be used with rate, given requested burst
+ */
+static inline double rateLimitBurst(double rate, double burst) {
+	double min = rate > 1 ? rate : 1;
+	return burst > min ? burst : min;
+}
+
+/* ------------------------------------- PUBLIC ------------------------------------- */
+
+CW_STATUS initRateLimiter(double rate, double burst, struct CWG_params *params) {
+	struct RateLimiter *limiter;
+	if ((limiter = mmap(NULL, sizeof(struct RateLimiter), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+		perror("mmap() failed for rate limiter");
+		return CW_SYS_ERR;
+	}
+
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	if (pthread_mutex_init(&limiter->lock, &attr) != 0) {
+		perror("pthread_mutex_init() failed for rate limiter");
+		pthread_mutexattr_destroy(&attr);
+		munmap(limiter, sizeof(struct RateLimiter));
+		return CW_SYS_ERR;
+	}
+	pthread_mutexattr_destroy(&attr);
+
+	limiter->pid = getpid();
+	limiter->rate = rate > 0 ? rate : 0;
+	limiter->burst = rateLimitBurst(limiter->rate, burst);
+	limiter->bucketsCount = 0;
+
+	params->rateLimiter = limiter;
+	return CW_OK;
+}
+
+CW_STATUS setRateLimit(const char *endpoint, double rate, double burst, struct CWG_params *params) {
+	struct RateLimiter *limiter = (struct RateLimiter *)params->rateLimiter;
+	if (!limiter) { return CW_CALL_NO; }
+
+	rateLimiterLock(limiter);
+	struct RateLimitBucket *bucket;
+	if ((bucket = rateLimiterBucket(limiter, endpoint))) {
+		bucket->rate = rate > 0 ? rate : 0;
+		bucket->burst = rateLimitBurst(bucket->rate, burst);
+		bucket->tokens = bucket->burst;
+	}
+	pthread_mutex_unlock(&limiter->lock);
+
+	if (!bucket) { fprintf(CWG_err_stream, "cashgettools: unable to rate limit endpoint %s (too long, or too many endpoints)\n", endpoint); return CW_CALL_NO; }
+	return CW_OK;
+}
+
+void cleanupRateLimiter(struct CWG_params *params) {
+	struct RateLimiter *limiter = (struct RateLimiter *)params->rateLimiter;
+	if (!limiter) { return; }
+
+	if (limiter->pid == getpid()) { pthread_mutex_destroy(&limiter->lock); }
+	munmap(limiter, sizeof(struct RateLimiter));
+	params->rateLimiter = NULL;
+}
+
+long rateLimiterAcquire(struct RateLimiter *limiter, const char *endpoint) {
+	if (!limiter || !endpoint) { return 0; }
+
+	long waitMs = 0;
+	double now = rateLimitNowMs();
+	rateLimiterLock(limiter);
+	struct RateLimitBucket *bucket;
+	if ((bucket = rateLimiterBucket(limiter, endpoint))) {
+		if (now < bucket->blockedUntil) { waitMs = (long)(bucket->blockedUntil - now) + 1; }
+		else if (bucket->rate > 0) {
+			bucket->tokens += (now - bucket->refilledAt)*bucket->rate/1000;
+			if (bucket->tokens > bucket->burst) { bucket->tokens = bucket->burst; }
+			bucket->refilledAt = now;
+			if (bucket->tokens >= 1) { bucket->tokens -= 1; }
+			else { waitMs = (long)((1 - bucket->tokens)*1000/bucket->rate) + 1; }
+		}
+	}
+	pthread_mutex_unlock(&limiter->lock);
+	return waitMs;
+}
+
+void rateLimiterBackoff(struct RateLimiter *limiter, const char *endpoint, long ms) {
+	if (!limiter || !endpoint) { return; }
+
+	double until = rateLimitNowMs() + ms;
+	rateLimiterLock(limiter);
+	struct RateLimitBucket *bucket;
+	if ((bucket = rateLimiterBucket(limiter, endpoint))) {
+		if (until > bucket->blockedUntil) { bucket->blockedUntil = until; }
+		// resume at the endpoint's pace rather than with a burst
+		bucket->tokens = 0;
+		bucket->refilledAt = bucket->blockedUntil;
+	}
+	pthread_mutex_unlock(&limiter->lock);
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static double rateLimitNowMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000.0 + ts.tv_nsec/1000000.0;
+}
+
+static void rateLimiterLock(struct RateLimiter *limiter) {
+	if (pthread_mutex_lock(&limiter->lock) == EOWNERDEAD) { pthread_mutex_consistent(&limiter->lock); }
+}
+
+static struct RateLimitBucket *rateLimiterBucket(struct RateLimiter *limiter, const char *endpoint) {
+	if (strlen(endpoint) > RATE_LIMIT_ENDPOINT_MAX_LEN) { return NULL; }
+	for (int i=0; i<limiter->bucketsCount; i++) {
+		if (strcmp(limiter->buckets[i].endpoint, endpoint) == 0) { return &limiter->buckets[i]; }
+	}
+	if (limiter->bucketsCount >= RATE_LIMIT_ENDPOINTS_MAX) { return NULL; }
+
+	struct RateLimitBucket *bucket = &limiter->buckets[limiter->bucketsCount++];
+	strcpy(bucket->endpoint, endpoint);
+	bucket->rate = limiter->rate;
+	bucket->burst = limiter->burst;
+	bucket->tokens = bucket->burst;
+	bucket->refilledAt = rateLimitNowMs();
+	bucket->blockedUntil = 0;
+	return bucket;
+}
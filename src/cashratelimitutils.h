@@ -0,0 +1,41 @@
+#ifndef __CASHRATELIMITUTILS_H__
+#define __CASHRATELIMITUTILS_H__
+
+#include "cashfetchutils.h"
+
+/*
+ * token-bucket rate limiter over HTTP endpoints, kept in memory shared with any processes forked after its creation
+ * opaque outside of cashratelimitutils.c (stored in params as void *)
+ */
+struct RateLimiter;
+
+/*
+ * creates rate limiter allowing each endpoint rate requests per second on average, in bursts of up to burst requests
+   (burst is taken as rate, or 1, if less than that); a rate of 0 leaves endpoints unlimited but for the backoff they signal themselves
+ * will set params->rateLimiter on success
+ */
+CW_STATUS initRateLimiter(double rate, double burst, struct CWG_params *params);
+
+/*
+ * overrides rate/burst for given endpoint in the rate limiter stored in params
+ */
+CW_STATUS setRateLimit(const char *endpoint, double rate, double burst, struct CWG_params *params);
+
+/*
+ * releases the rate limiter stored in params (the shared memory itself goes once every process sharing it is done);
+ * params->rateLimiter will be set NULL
+ */
+void cleanupRateLimiter(struct CWG_params *params);
+
+/*
+ * takes a token for a request to endpoint if one is available
+ * returns 0 if a token was taken (or limiter is NULL), or otherwise the number of milliseconds until one should be
+ */
+long rateLimiterAcquire(struct RateLimiter *limiter, const char *endpoint);
+
+/*
+ * holds off all requests to endpoint (by every process sharing limiter) for the next ms milliseconds, e.g. upon a 429 response
+ */
+void rateLimiterBackoff(struct RateLimiter *limiter, const char *endpoint, long ms);
+
+#endif
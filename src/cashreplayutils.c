@@ -0,0 +1,424 @@
+#include "cashreplayutils.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * a fetch record is a header line (RECORD_HEADER) followed by a line per TX fetched (lines starting with '#' are ignored),
+   of tab-separated fields: type (FETCH_TYPE), nth claim (if BY_NAMETAG; otherwise 0), id, status (CW_STATUS), latency in microseconds
+   (that of the whole batch the TX was fetched in), whether the TX is confirmed (1 or 0), txid, and hex data; the latter two are "-" if the fetch failed
+ * the first three fields make up the key a fetch is replayed by
+ * a record of version 1 (RECORD_HEADER_V1) lacks the confirmed field, and is replayed with every TX unconfirmed
+ */
+#define RECORD_HEADER "#cashweb-fetch-record 2"
+#define RECORD_HEADER_V1 "#cashweb-fetch-record 1"
+#define RECORD_FIELDS 8
+#define RECORD_NONE "-"
+
+/*
+ * struct FetchRecorder wraps the params fetched through for recording, so that each fetch made through its fetcher is recorded to fd
+ */
+struct FetchRecorder {
+	struct CWG_params source;
+	struct CWG_fetcher fetcher;
+	int fd;
+};
+
+/*
+ * whether the source params of a recorder are initialized once and shared by all its fetches; otherwise (with a MongoDB client pool),
+   each fetch is made with a client of its own, popped from the pool
+ */
+static inline bool recorderSourceShared(const struct CWG_params *source);
+
+/*
+ * a single recorded fetch; strings point into the loaded record
+ */
+struct ReplayEntry {
+	const char *key;
+	CW_STATUS status;
+	long latencyMicros;
+	bool confirmed;
+	const char *txid;
+	const char *hex;
+};
+
+/*
+ * struct FetchReplay holds a loaded fetch record, with its entries sorted by key (a single one per key) for lookup
+ */
+struct FetchReplay {
+	struct CWG_fetcher fetcher;
+	char *record;
+	struct ReplayEntry *entries;
+	size_t entriesCount;
+	int latencyMs;
+};
+
+/*
+ * fetch_batch function of a struct CWG_fetcher with struct FetchRecorder as ctx; fetches the batch through its source params,
+   and appends a line per TX (or per id, if the fetch failed) recording it to its record, with the time taken by the fetch alone
+ * where the source doesn't report where each TX's hex data begins in a batch of several, the ids are refetched one at a time to be recorded
+ */
+static CW_STATUS recorderFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items);
+
+/*
+ * fetch_batch function of a struct CWG_fetcher with struct FetchReplay as ctx; answers from its record, delayed by its latency
+ */
+static CW_STATUS replayFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items);
+
+/*
+ * writes key of a fetch (the first three fields of its line) to given buffer (which must have room for strlen(id)+REPLAY_KEY_EXTRA)
+ */
+#define REPLAY_KEY_EXTRA 48
+static inline void replayKey(int type, size_t nth, const char *id, char *key);
+
+/*
+ * orders struct ReplayEntry by key, and those of the same key by whether they succeeded first (then by order recorded)
+ */
+static int compareReplayEntries(const void *a, const void *b);
+
+/*
+ * parses line of fetch record (of version 1 if v1) in place into given entry
+ * returns false if the line is malformed
+ */
+static bool parseReplayLine(char *line, bool v1, struct ReplayEntry *entry);
+
+/*
+ * sleeps for given number of microseconds
+ */
+static void replaySleep(long micros);
+
+/* ------------------------------------- PUBLIC ------------------------------------- */
+
+CW_STATUS initFetchRecorder(const char *recordPath, struct CWG_params *params) {
+	struct FetchRecorder *recorder;
+	if ((recorder = malloc(sizeof(struct FetchRecorder))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	copy_CWG_params(&recorder->source, params);
+
+	// each batch is written with a single write() in append mode, so concurrent fetches (and processes) don't interleave
+	if ((recorder->fd = open(recordPath, O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		fprintf(CWG_err_stream, "open() failed on fetch record %s: %s\n", recordPath, strerror(errno));
+		free(recorder);
+		return CW_SYS_ERR;
+	}
+	CW_STATUS status = CW_OK;
+	struct stat st;
+	char header[strlen(RECORD_HEADER"\n")];
+	if (fstat(recorder->fd, &st) != 0) { perror("fstat() failed"); status = CW_SYS_ERR; goto cleanup; }
+	if (st.st_size == 0) {
+		if (write(recorder->fd, RECORD_HEADER"\n", sizeof(header)) < (ssize_t)sizeof(header)) { perror("write() failed on fetch record"); status = CW_SYS_ERR; goto cleanup; }
+	}
+	else if (pread(recorder->fd, header, sizeof(header), 0) < (ssize_t)sizeof(header) || memcmp(header, RECORD_HEADER"\n", sizeof(header)) != 0) {
+		fprintf(CWG_err_stream, "%s is not a cashweb fetch record of the current version; can't append to it\n", recordPath);
+		status = CW_CALL_NO;
+		goto cleanup;
+	}
+	if (recorderSourceShared(&recorder->source) && (status = initFetcher(&recorder->source)) != CW_OK) { goto cleanup; }
+
+	// fetches are passed to the source as they're made, so that they're recorded (and replayed) in the same batches;
+	// a mongo client can't be shared between threads, so fetches are only made concurrently over HTTP, or with a client of their own from a pool
+	recorder->fetcher.fetch_batch = &recorderFetch;
+	recorder->fetcher.init = NULL;
+	recorder->fetcher.cleanup = NULL;
+	recorder->fetcher.ctx = recorder;
+	recorder->fetcher.capabilities = CWG_FETCHER_CAN_ALL;
+	recorder->fetcher.maxBatch = 0;
+	recorder->fetcher.concurrency = (params->mongodb || params->mongodbCli) && !params->mongodbCliPool ? 1 : params->fetchConcurrency;
+
+	params->fetcher = &recorder->fetcher;
+	params->cache = NULL;
+	params->index = NULL;
+
+	cleanup:
+		if (status != CW_OK) {
+			close(recorder->fd);
+			free(recorder);
+		}
+		return status;
+}
+
+void cleanupFetchRecorder(struct CWG_params *params) {
+	if (!params->fetcher || params->fetcher->fetch_batch != &recorderFetch) { return; }
+	struct FetchRecorder *recorder = (struct FetchRecorder *)params->fetcher->ctx;
+
+	params->fetcher = recorder->source.fetcher;
+	params->cache = recorder->source.cache;
+	params->index = recorder->source.index;
+	if (recorderSourceShared(&recorder->source)) { cleanupFetcher(&recorder->source); }
+	if (close(recorder->fd) != 0) { perror("close() failed on fetch record"); }
+	free(recorder);
+}
+
+CW_STATUS initFetchReplay(const char *recordPath, int latencyMs, struct CWG_params *params) {
+	struct FetchReplay *replay;
+	if ((replay = malloc(sizeof(struct FetchReplay))) == NULL) { perror("malloc failed"); return CW_SYS_ERR; }
+	replay->record = NULL;
+	replay->entries = NULL;
+	replay->entriesCount = 0;
+	replay->latencyMs = latencyMs;
+
+	FILE *recordFp = NULL;
+	CW_STATUS status = CW_OK;
+
+	if ((recordFp = fopen(recordPath, "rb")) == NULL) {
+		fprintf(CWG_err_stream, "fopen() failed on fetch record %s: %s\n", recordPath, strerror(errno));
+		status = CW_SYS_ERR;
+		goto cleanup;
+	}
+	long recordLen;
+	if (fseek(recordFp, 0, SEEK_END) != 0 || (recordLen = ftell(recordFp)) < 0 || fseek(recordFp, 0, SEEK_SET) != 0) {
+		perror("fseek()/ftell() failed on fetch record");
+		status = CW_SYS_ERR;
+		goto cleanup;
+	}
+	if ((replay->record = malloc(recordLen+1)) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+	if (fread(replay->record, 1, recordLen, recordFp) < (size_t)recordLen) { perror("fread() failed on fetch record"); status = CW_SYS_ERR; goto cleanup; }
+	replay->record[recordLen] = 0;
+
+	size_t lines = 1;
+	for (char *c = replay->record; (c = strchr(c, '\n')); c++) { ++lines; }
+	if ((replay->entries = malloc(lines*sizeof(struct ReplayEntry))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+
+	char *line = replay->record;
+	char *lineEnd;
+	size_t lineNum = 0;
+	bool v1 = false;
+	for (; *line; line = lineEnd ? lineEnd+1 : line+strlen(line)) {
+		++lineNum;
+		if ((lineEnd = strchr(line, '\n'))) { *lineEnd = 0; }
+		if (lineNum == 1) {
+			if (strcmp(line, RECORD_HEADER) == 0 || (v1 = strcmp(line, RECORD_HEADER_V1) == 0)) { continue; }
+			fprintf(CWG_err_stream, "%s is not a cashweb fetch record\n", recordPath);
+			status = CW_CALL_NO;
+			goto cleanup;
+		}
+		if (*line == '#' || *line == 0) { continue; }
+		if (!parseReplayLine(line, v1, &replay->entries[replay->entriesCount])) {
+			fprintf(CWG_err_stream, "fetch record %s is malformed at line %zu\n", recordPath, lineNum);
+			status = CW_CALL_NO;
+			goto cleanup;
+		}
+		++replay->entriesCount;
+	}
+	if (lineNum == 0) {
+		fprintf(CWG_err_stream, "%s is not a cashweb fetch record\n", recordPath);
+		status = CW_CALL_NO;
+		goto cleanup;
+	}
+
+	// a fetch recorded more than once is replayed as its first success, if any (e.g. a TX that has since been mined)
+	qsort(replay->entries, replay->entriesCount, sizeof(struct ReplayEntry), &compareReplayEntries);
+	size_t unique = 0;
+	for (size_t i=0; i<replay->entriesCount; i++) {
+		if (unique > 0 && strcmp(replay->entries[unique-1].key, replay->entries[i].key) == 0) { continue; }
+		replay->entries[unique++] = replay->entries[i];
+	}
+	replay->entriesCount = unique;
+
+	replay->fetcher.fetch_batch = &replayFetch;
+	replay->fetcher.init = NULL;
+	replay->fetcher.cleanup = NULL;
+	replay->fetcher.ctx = replay;
+	replay->fetcher.capabilities = CWG_FETCHER_CAN_ALL;
+	replay->fetcher.maxBatch = 0;
+	replay->fetcher.concurrency = params->fetchConcurrency;
+	params->fetcher = &replay->fetcher;
+
+	cleanup:
+		if (recordFp) { fclose(recordFp); }
+		if (status != CW_OK) {
+			if (replay->entries) { free(replay->entries); }
+			if (replay->record) { free(replay->record); }
+			free(replay);
+		}
+		return status;
+}
+
+void cleanupFetchReplay(struct CWG_params *params) {
+	if (!params->fetcher || params->fetcher->fetch_batch != &replayFetch) { return; }
+	struct FetchReplay *replay = (struct FetchReplay *)params->fetcher->ctx;
+
+	free(replay->entries);
+	free(replay->record);
+	free(replay);
+	params->fetcher = NULL;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+static CW_STATUS recorderFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items) {
+	struct FetchRecorder *recorder = (struct FetchRecorder *)ctx;
+
+	// a nametag fetch is of its nth claim, where count is nth
+	size_t itemsCount = type == BY_NAMETAG ? 1 : count;
+	size_t nth = type == BY_NAMETAG ? count : 0;
+	CW_STATUS status = CW_OK;
+	struct CWG_params pooled;
+	struct CWG_params *source = &recorder->source;
+	char (*recTxids)[CW_TXID_CHARS+1] = NULL;
+	char **recTxidPtrs = NULL;
+	struct FetchItemInfo *itemInfo = NULL;
+	char *lines = NULL;
+
+	if ((recTxids = malloc(itemsCount*sizeof(recTxids[0]))) == NULL ||
+	    (recTxidPtrs = malloc(itemsCount*sizeof(recTxidPtrs[0]))) == NULL ||
+	    (itemInfo = malloc(itemsCount*sizeof(struct FetchItemInfo))) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+	for (int i=0; i<itemsCount; i++) { recTxids[i][0] = 0; recTxidPtrs[i] = recTxids[i]; }
+	if (!recorderSourceShared(source)) {
+		copy_CWG_params(&pooled, source);
+		if ((status = initFetcher(&pooled)) != CW_OK) { goto cleanup; }
+	}
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	CW_STATUS fetchStatus = fetchHexDataItems(ids, count, (FETCH_TYPE)type, recorderSourceShared(source) ? source : &pooled, recTxidPtrs, hexDataAll, itemInfo);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (!recorderSourceShared(source)) { cleanupFetcher(&pooled); }
+	long latencyMicros = (end.tv_sec-start.tv_sec)*1000000L + (end.tv_nsec-start.tv_nsec)/1000L;
+
+	if (fetchStatus == CW_OK) {
+		if (itemsCount == 1 && itemInfo[0].hexLen == FETCH_ITEM_LEN_UNKNOWN) { itemInfo[0].hexLen = strlen(hexDataAll); }
+		for (int i=0; i<itemsCount; i++) {
+			if (itemInfo[i].hexLen != FETCH_ITEM_LEN_UNKNOWN) { continue; }
+			// the batch can't be told apart into TXs, so each is refetched (and recorded) on its own
+			char *hexDataPtr = hexDataAll;
+			for (int j=0; j<itemsCount; j++) {
+				if ((status = recorderFetch(ctx, ids+j, 1, type, txids ? txids+j : NULL, hexDataPtr, items ? items+j : NULL)) != CW_OK) { goto cleanup; }
+				hexDataPtr += strlen(hexDataPtr);
+			}
+			goto cleanup;
+		}
+	}
+
+	size_t linesSize = 1;
+	for (int i=0; i<itemsCount; i++) {
+		linesSize += strlen(ids[i]) + REPLAY_KEY_EXTRA + CW_TXID_CHARS + 64;
+		if (fetchStatus == CW_OK) { linesSize += itemInfo[i].hexLen; }
+	}
+	if ((lines = malloc(linesSize)) == NULL) { perror("malloc failed"); status = CW_SYS_ERR; goto cleanup; }
+
+	size_t linesLen = 0;
+	const char *hexDataPtr = hexDataAll;
+	for (int i=0; i<itemsCount; i++) {
+		replayKey(type, nth, ids[i], lines+linesLen);
+		linesLen += strlen(lines+linesLen);
+		if (fetchStatus != CW_OK) {
+			linesLen += sprintf(lines+linesLen, "\t%d\t%ld\t0\t%s\t%s\n", fetchStatus, latencyMicros, RECORD_NONE, RECORD_NONE);
+			continue;
+		}
+
+		if (!recTxids[i][0] && type == BY_TXID) { strcpy(recTxids[i], ids[i]); }
+		if (txids) { strcpy(txids[i], recTxids[i]); }
+		if (items) { items[i].hexLen = itemInfo[i].hexLen; items[i].confirmed = itemInfo[i].confirmed; }
+		linesLen += sprintf(lines+linesLen, "\t%d\t%ld\t%d\t%s\t", fetchStatus, latencyMicros, itemInfo[i].confirmed, recTxids[i][0] ? recTxids[i] : RECORD_NONE);
+		memcpy(lines+linesLen, hexDataPtr, itemInfo[i].hexLen);
+		linesLen += itemInfo[i].hexLen;
+		hexDataPtr += itemInfo[i].hexLen;
+		lines[linesLen++] = '\n';
+	}
+	if (write(recorder->fd, lines, linesLen) != (ssize_t)linesLen) { perror("write() failed on fetch record"); status = CW_SYS_ERR; goto cleanup; }
+	status = fetchStatus;
+
+	cleanup:
+		if (recTxids) { free(recTxids); }
+		if (recTxidPtrs) { free(recTxidPtrs); }
+		if (itemInfo) { free(itemInfo); }
+		if (lines) { free(lines); }
+		return status;
+}
+
+static CW_STATUS replayFetch(void *ctx, const char **ids, size_t count, int type, char **txids, char *hexDataAll, struct CWG_fetch_item *items) {
+	struct FetchReplay *replay = (struct FetchReplay *)ctx;
+
+	// a nametag fetch is of its nth claim, where count is nth
+	size_t itemsCount = type == BY_NAMETAG ? 1 : count;
+	size_t nth = type == BY_NAMETAG ? count : 0;
+	long latencyMicros = 0;
+	size_t hexLen = 0;
+	CW_STATUS status = CW_OK;
+	for (size_t i=0; i<itemsCount; i++) {
+		char key[strlen(ids[i])+REPLAY_KEY_EXTRA];
+		replayKey(type, nth, ids[i], key);
+		struct ReplayEntry find = { .key = key };
+		struct ReplayEntry *entry = bsearch(&find, replay->entries, replay->entriesCount, sizeof(struct ReplayEntry), &compareReplayEntries);
+		if (!entry) { status = CWG_FETCH_NO; break; }
+		if (entry->latencyMicros > latencyMicros) { latencyMicros = entry->latencyMicros; }
+		if (entry->status != CW_OK) { status = entry->status; break; }
+
+		size_t entryHexLen = strlen(entry->hex);
+		memcpy(hexDataAll+hexLen, entry->hex, entryHexLen);
+		hexLen += entryHexLen;
+		if (txids) { strcpy(txids[i], entry->txid); }
+		if (items) { items[i].hexLen = entryHexLen; items[i].confirmed = entry->confirmed; }
+	}
+	hexDataAll[hexLen] = 0;
+
+	replaySleep(replay->latencyMs == CWG_REPLAY_LATENCY_RECORDED ? latencyMicros : replay->latencyMs*1000L);
+	return status;
+}
+
+static inline bool recorderSourceShared(const struct CWG_params *source) {
+	return source->fetcher || !source->mongodbCliPool;
+}
+
+static inline void replayKey(int type, size_t nth, const char *id, char *key) {
+	sprintf(key, "%d\t%zu\t%s", type, nth, id);
+}
+
+static int compareReplayEntries(const void *a, const void *b) {
+	const struct ReplayEntry *entryA = (const struct ReplayEntry *)a;
+	const struct ReplayEntry *entryB = (const struct ReplayEntry *)b;
+	int cmp;
+	if ((cmp = strcmp(entryA->key, entryB->key)) != 0 || !entryA->txid || !entryB->txid) { return cmp; }
+	if ((entryA->status == CW_OK) != (entryB->status == CW_OK)) { return entryA->status == CW_OK ? -1 : 1; }
+	return (entryA->key > entryB->key) - (entryA->key < entryB->key);
+}
+
+static bool parseReplayLine(char *line, bool v1, struct ReplayEntry *entry) {
+	int fieldsCount = v1 ? RECORD_FIELDS-1 : RECORD_FIELDS;
+	char *fields[RECORD_FIELDS];
+	fields[0] = line;
+	for (int i=1; i<fieldsCount; i++) {
+		if ((fields[i] = strchr(fields[i-1], '\t')) == NULL) { return false; }
+		++fields[i];
+	}
+	if (strchr(fields[fieldsCount-1], '\t')) { return false; }
+
+	char *end;
+	long type = strtol(fields[0], &end, 10);
+	if (end == fields[0] || *end != '\t' || type < BY_TXID || type > BY_NAMETAG) { return false; }
+	strtoull(fields[1], &end, 10);
+	if (end == fields[1] || *end != '\t' || fields[3] == fields[2]+1) { return false; }
+	entry->status = (CW_STATUS)strtol(fields[3], &end, 10);
+	if (end == fields[3] || *end != '\t') { return false; }
+	entry->latencyMicros = strtol(fields[4], &end, 10);
+	if (end == fields[4] || *end != '\t' || entry->latencyMicros < 0) { return false; }
+	entry->confirmed = false;
+	if (!v1) {
+		if ((fields[5][0] != '0' && fields[5][0] != '1') || fields[5][1] != '\t') { return false; }
+		entry->confirmed = fields[5][0] == '1';
+	}
+
+	// terminates the key (type, nth, id) and the other fields where their tabs were
+	for (int i=3; i<fieldsCount; i++) { *(fields[i]-1) = 0; }
+	entry->key = line;
+	entry->txid = fields[fieldsCount-2];
+	entry->hex = fields[fieldsCount-1];
+	if (entry->status == CW_OK) {
+		if (strcmp(entry->txid, RECORD_NONE) == 0) { entry->txid = ""; }
+		else if (!CW_is_valid_txid(entry->txid)) { return false; }
+		if (strlen(entry->hex) > CW_TX_DATA_CHARS || strlen(entry->hex) % 2 != 0) { return false; }
+	} else {
+		entry->confirmed = false;
+		entry->txid = "";
+		entry->hex = "";
+	}
+	return true;
+}
+
+static void replaySleep(long micros) {
+	if (micros <= 0) { return; }
+	struct timespec wait = { .tv_sec = micros/1000000L, .tv_nsec = (micros%1000000L)*1000L };
+	while (nanosleep(&wait, &wait) != 0 && errno == EINTR) { }
+}
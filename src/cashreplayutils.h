@@ -0,0 +1,35 @@
+#ifndef __CASHREPLAYUTILS_H__
+#define __CASHREPLAYUTILS_H__
+
+#include "cashfetchutils.h"
+
+/*
+ * starts recording every fetch made through params to the fetch record at recordPath (created if absent, otherwise appended to):
+   the id/type fetched, the result, and how long the fetch source took, so that it may be replayed without it by initFetchReplay()
+ * params->fetcher is set to a recorder fetching through a copy of params as they were (initialized here), in the same batches as fetches are made,
+   with a line recorded per TX; params->cache/params->index are moved under it, so that fetches answered by them are recorded as well
+ * appending to an existing record fails with CW_CALL_NO if it is of an older version
+ * must be undone with cleanupFetchRecorder() before params are otherwise cleaned up
+ */
+CW_STATUS initFetchRecorder(const char *recordPath, struct CWG_params *params);
+
+/*
+ * stops recording fetches made through params, restoring them as they were before initFetchRecorder() (if it was called on them)
+ */
+void cleanupFetchRecorder(struct CWG_params *params);
+
+/*
+ * loads the fetch record at recordPath, and sets params->fetcher to a fetcher answering from it alone; fetches that weren't recorded
+   fail with CWG_FETCH_NO, and those that failed when recorded fail the same way
+ * each fetch is delayed by latencyMs milliseconds, or by the latency recorded for it (the longest of a batch's) if CWG_REPLAY_LATENCY_RECORDED
+ * must be undone with cleanupFetchReplay()
+ */
+CW_STATUS initFetchReplay(const char *recordPath, int latencyMs, struct CWG_params *params);
+
+/*
+ * frees the fetch record loaded into params by initFetchReplay() (if it was called on them);
+ * params->fetcher will be set NULL
+ */
+void cleanupFetchReplay(struct CWG_params *params);
+
+#endif
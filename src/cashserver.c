@@ -3,7 +3,8 @@
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <getopt.h>
-#include <sys/wait.h>
+#include <pthread.h>
+#include <signal.h>
 
 #define USAGE_STR "usage: %s [FLAGS]\n"
 #define HELP_STR \
@@ -14,8 +15,21 @@
 	"[none]   | host CashServer getting by local MongoDB ("MONGODB_LOCAL_ADDR") on port "CS_PORT_DEFAULT"\n"\
 	"-p <ARG> | specify hosting port (default if "CS_PORT_DEFAULT")\n"\
 	"-m <ARG> | specify MongoDB URI for querying (default is "MONGODB_LOCAL_ADDR")\n"\
-	"-b <ARG> | specify BitDB HTTP endpoint URL for querying instead of MongoDB\n"\
+	"-P <ARG> | specify maximum size of MongoDB client pool (default is the URI's maxPoolSize, or 100)\n"\
+	"-M <ARG> | specify MongoDB read preference, e.g. secondaryPreferred or nearest to spread reads over a replica set (default is the URI's, or primary)\n"\
+	"-T <ARG> | specify MongoDB socket and server selection timeouts in ms as <socket>[:<selection>] (default is the URI's, or mongoc's)\n"\
+	"-b <ARG> | specify BitDB HTTP endpoint URL for querying instead of MongoDB; may be a whitespace-separated list of equivalent URLs\n"\
+	"-R <ARG> | specify bitcoind JSON-RPC URL for querying instead of MongoDB (node must have txindex); may be a whitespace-separated list of equivalent URLs\n"\
+	"-A <ARG> | specify credentials for bitcoind JSON-RPC as <user>:<password>\n"\
+	"-I <ARG> | specify local index file (built/updated by cashindex) to serve from instead of MongoDB, shared by all requests; TXs it lacks are queried from -b/-r/-R if given\n"\
 	"-d <ARG> | specify location of valid cashwebtools data directory (default is install directory)\n"\
+	"-L <ARG> | limit HTTP requests to <rate>[:<burst>] per second per endpoint, shared by all requests (queued when over)\n"\
+	"-C <ARG> | specify directory for on-disk TXID cache (and learned endpoint batch sizes), shared by all requests (and other processes using the same directory)\n"\
+	"-W <ARG> | record every fetch made by requests (and how long it took) to fetch record file at location <ARG> (appended to, if it exists)\n"\
+	"-Y <ARG> | serve from fetch record file at location <ARG> (recorded by -W) instead of MongoDB, replaying its fetches; unrecorded fetches fail\n"\
+	"-K <ARG> | delay each replayed fetch by <ARG> ms (default is the latency recorded for it)\n"\
+	"-z       | resolve the exact size of each file requested by identifier before serving it, to send Content-Length rather than a chunked response;\n"\
+	"         | a tree's is found from the TXs along its last branch, but a chained file's links are then fetched twice (unless cached by -C)\n"\
 	"-c <ARG> | specify 'home' identifier; when query/subdomain is absent, cashserver will treat as a query for this ID at requested path (so must be a directory)\n"\
 	"-q <ARG> | specify URI prefix to be recognized for making query (default is "URI_QUERY_PREFIX_DEFAULT")\n"\
 	"-ns      | disable default behavior to treat any subdomain (*.X.X) in HTTP host header as a named CashWeb directory request\n"\
@@ -36,11 +50,17 @@ typedef char CS_CW_STATUS;
 #define CS_SYS_ERR -3
 
 #define RESPONSE_CALLBACK_BLOCK_SZ 1024
+#define RESPONSE_STREAM_BUF_SZ 65536
 #define RESP_BUF 110
 #define REQ_DESCRIPT_BUF 50
 #define TRAILING_BACKSLASH_APPEND "index.html"
 #define MIME_STR_DEFAULT "application/octet-stream"
 #define TMP_DIRFILE_PREFIX "cashserver-"
+#define CONTENT_RANGE_BUF 80
+
+#ifndef MHD_HTTP_RANGE_NOT_SATISFIABLE
+#define MHD_HTTP_RANGE_NOT_SATISFIABLE MHD_HTTP_REQUESTED_RANGE_NOT_SATISFIABLE
+#endif
 
 #define DOT_COUNT(h,c) for (c=0; h[c]; h[c]=='.' ? c++ : *h++);
 
@@ -50,6 +70,7 @@ static const char *uriQueryPrefix;
 static bool dirBySubdomain;
 static const char *tmpDirfilePath;
 static unsigned int tmpDirfileTimeout;
+static bool sendContentLength;
 
 struct cashRequestData {
 	const char *cwId;
@@ -57,15 +78,150 @@ struct cashRequestData {
 	const char *path;
 	const char *pathReplace;
 	char *resMimeType;
+	size_t resSize;
+	size_t rangeOffset;
+	size_t rangeLength;
+	bool ranged;
+	bool acceptRanges;
 	const char *clntip;
 };
 
+/*
+ * what the request's worker passes back along with the found status and mimetype, for the response headers
+ * fileSize is SIZE_MAX and contentLength MHD_SIZE_UNKNOWN when the size of the file wasn't resolved
+ */
+struct cashResponseInfo {
+	uint64_t contentLength;
+	size_t fileSize;
+	size_t rangeFirst;
+	size_t rangeLast;
+	bool ranged;
+	bool acceptRanges;
+};
+
+/*
+ * response to a request, written by its worker through a callback sink (see cashStreamWrite()) and read by the connection's thread
+   (see cashStreamRead()); held by both, and freed by whichever lets go of it last
+ * buf is a ring of the bytes written but not yet read, so a worker runs at most RESPONSE_STREAM_BUF_SZ bytes ahead of its client
+ * found is set, along with status/mimeType/info, once the worker has found what to respond with (see cashFoundHandler());
+   done once it has finished writing, and closed once the connection has finished reading (after which writes fail, cutting the get short)
+ */
+struct cashStream {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	char buf[RESPONSE_STREAM_BUF_SZ];
+	size_t head;
+	size_t used;
+	bool found;
+	bool done;
+	bool closed;
+	int refs;
+	CS_CW_STATUS status;
+	char mimeType[CWG_MIMESTR_BUF];
+	struct cashResponseInfo info;
+};
+
+static struct cashStream *newCashStream() {
+	struct cashStream *stream = malloc(sizeof(struct cashStream));
+	if (!stream) { return NULL; }
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->cond, NULL);
+	stream->head = 0;
+	stream->used = 0;
+	stream->found = false;
+	stream->done = false;
+	stream->closed = false;
+	stream->refs = 2;
+	return stream;
+}
+
+static void cashStreamRelease(struct cashStream *stream) {
+	pthread_mutex_lock(&stream->lock);
+	bool last = --stream->refs == 0;
+	pthread_mutex_unlock(&stream->lock);
+	if (!last) { return; }
+
+	pthread_cond_destroy(&stream->cond);
+	pthread_mutex_destroy(&stream->lock);
+	free(stream);
+}
+
+/*
+ * write callback of the worker's sink; blocks while the buffer is full, and fails once the connection has closed
+ */
+static ssize_t cashStreamWrite(const char *data, size_t n, void *cls) {
+	struct cashStream *stream = (struct cashStream *)cls;
+	pthread_mutex_lock(&stream->lock);
+	while (stream->used == RESPONSE_STREAM_BUF_SZ && !stream->closed) { pthread_cond_wait(&stream->cond, &stream->lock); }
+	if (stream->closed) { pthread_mutex_unlock(&stream->lock); return -1; }
+
+	size_t tail = (stream->head + stream->used) % RESPONSE_STREAM_BUF_SZ;
+	size_t w = RESPONSE_STREAM_BUF_SZ - stream->used;
+	if (w > RESPONSE_STREAM_BUF_SZ - tail) { w = RESPONSE_STREAM_BUF_SZ - tail; }
+	if (w > n) { w = n; }
+	memcpy(stream->buf+tail, data, w);
+	stream->used += w;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+	return w;
+}
+
+static void cashStreamWriteAll(struct cashStream *stream, const char *data, size_t n) {
+	ssize_t w;
+	while (n > 0 && (w = cashStreamWrite(data, n, stream)) > 0) { data += w; n -= w; }
+}
+
+static void cashStreamFinish(struct cashStream *stream) {
+	pthread_mutex_lock(&stream->lock);
+	stream->done = true;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+	cashStreamRelease(stream);
+}
+
+/*
+ * content reader callback of the response; blocks until the worker has written something or is done
+ */
+static ssize_t cashStreamRead(void *cls, uint64_t pos, char *buf, size_t max) {
+	struct cashStream *stream = (struct cashStream *)cls;
+	pthread_mutex_lock(&stream->lock);
+	while (stream->used == 0 && !stream->done) { pthread_cond_wait(&stream->cond, &stream->lock); }
+	if (stream->used == 0) { pthread_mutex_unlock(&stream->lock); return MHD_CONTENT_READER_END_OF_STREAM; }
+
+	size_t r = RESPONSE_STREAM_BUF_SZ - stream->head;
+	if (r > stream->used) { r = stream->used; }
+	if (r > max) { r = max; }
+	memcpy(buf, stream->buf+stream->head, r);
+	stream->head = (stream->head + r) % RESPONSE_STREAM_BUF_SZ;
+	stream->used -= r;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+	return r;
+}
+
+/*
+ * content reader free callback of the response, or called directly if none is made
+ */
+static void cashStreamClose(void *cls) {
+	struct cashStream *stream = (struct cashStream *)cls;
+	pthread_mutex_lock(&stream->lock);
+	stream->closed = true;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+	cashStreamRelease(stream);
+}
+
 static inline void initCashRequestData(struct cashRequestData *requestData, const char *clntip, char *resMimeType) {
 	requestData->cwId = NULL;
 	requestData->name = NULL;
 	requestData->path = NULL;
 	requestData->pathReplace = NULL;
 	requestData->resMimeType = resMimeType;	
+	requestData->resSize = SIZE_MAX;
+	requestData->rangeOffset = 0;
+	requestData->rangeLength = SIZE_MAX;
+	requestData->ranged = false;
+	requestData->acceptRanges = false;
 	requestData->clntip = clntip;
 }
 
@@ -82,6 +238,8 @@ static int cashStatusToResponseCode(CS_CW_STATUS status) {
 		case CS_REQUEST_HOST_NO:
 		case CS_REQUEST_CWID_NO:
 			return MHD_HTTP_BAD_REQUEST;
+		case CWG_RANGE_NO:
+			return MHD_HTTP_RANGE_NOT_SATISFIABLE;
 		default:
 			return MHD_HTTP_NOT_FOUND;
 	}
@@ -100,19 +258,42 @@ static char *cashStatusToResponseMsg(CS_CW_STATUS status) {
 		case CS_REQUEST_HOST_NO:
 		case CS_REQUEST_CWID_NO:
 			return "400 Bad Request";
+		case CWG_RANGE_NO:
+			return "416 Range Not Satisfiable";
 		default:
 			return "404 Not Found";
 	}
 }
 
-static void cashFoundHandler(CS_CW_STATUS status, void *requestData, int respfd) {
+static void cashFoundHandler(CS_CW_STATUS status, void *requestData, struct CWG_sink *sink) {
 	struct cashRequestData *rd = (struct cashRequestData *)requestData;	
+	struct cashStream *stream = (struct cashStream *)sink->writeData;
 
 	const char *mimeType = rd && rd->resMimeType && rd->resMimeType[0] ? rd->resMimeType : MIME_STR_DEFAULT;
 	if (status != CW_OK) { mimeType = "text/html"; }
 
-	if (write(respfd, &status, 1) < 1) { perror("write() failed on respfd status"); }
-	if (write(respfd, mimeType, CWG_MIMESTR_BUF) < CWG_MIMESTR_BUF) { perror("write() failed on resfd mimetype"); }
+	struct cashResponseInfo info;
+	info.contentLength = MHD_SIZE_UNKNOWN;
+	info.fileSize = rd ? rd->resSize : SIZE_MAX;
+	info.ranged = false;
+	info.acceptRanges = rd && rd->acceptRanges;
+	if (status == CW_OK && info.fileSize != SIZE_MAX) {
+		if (rd->ranged && info.fileSize > 0) {
+			info.ranged = true;
+			info.rangeFirst = rd->rangeOffset;
+			info.rangeLast = rd->rangeLength < info.fileSize-rd->rangeOffset ? rd->rangeOffset+rd->rangeLength-1 : info.fileSize-1;
+			info.contentLength = info.rangeLast-info.rangeFirst+1;
+		} else { info.contentLength = info.fileSize; }
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	stream->status = status;
+	stream->mimeType[0] = 0;
+	strncat(stream->mimeType, mimeType, CWG_MIMESTR_BUF-1);
+	stream->info = info;
+	stream->found = true;
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
 
 	const char *errMsg = "";
 	if (status == CS_REQUEST_HOST_NO) { errMsg = "Request is missing host header."; }
@@ -166,8 +347,7 @@ static void cashFoundHandler(CS_CW_STATUS status, void *requestData, int respfd)
 			 httpErrMsg, errMsg, reqDescript);
 
 		
-		size_t respStatusLen = strlen(respStatus);
-		if (write(respfd, respStatus, respStatusLen) < respStatusLen) { perror("write() failed on response body"); }
+		cashStreamWriteAll(stream, respStatus, strlen(respStatus));
 	} else {
 		if (reqName) {
 			if (reqPath) {
@@ -189,9 +369,9 @@ static void cashFoundHandler(CS_CW_STATUS status, void *requestData, int respfd)
 	}
 }
 
-static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_params *params, int respfd, char **pathId);
+static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_params *params, char **pathId);
 
-static CS_CW_STATUS cashGetDirPathIdFromStream(FILE *dirStream, const char *path, const char *tmpDirfileName, struct CWG_params *params, int respfd, char **pathId) {
+static CS_CW_STATUS cashGetDirPathIdFromStream(FILE *dirStream, const char *path, const char *tmpDirfileName, struct CWG_params *params, char **pathId) {
 	CW_STATUS status;
 	struct cashRequestData *rd = (struct cashRequestData *)params->foundHandleData;
 	const char *clntip = rd->clntip;
@@ -208,7 +388,7 @@ static CS_CW_STATUS cashGetDirPathIdFromStream(FILE *dirStream, const char *path
 			initCashRequestData(&dirReqN, clntip, NULL);
 			dirReqN.cwId = pathIdN;
 			dirReqN.path = subPath;
-			status = cashGetDirPathId(&dirReqN, params, respfd, pathId);
+			status = cashGetDirPathId(&dirReqN, params, pathId);
 		}
 		else if ((*pathId = strdup(pathIdN)) == NULL) { perror("strdup() failed"); status = CW_SYS_ERR; }
 	}
@@ -218,7 +398,17 @@ static CS_CW_STATUS cashGetDirPathIdFromStream(FILE *dirStream, const char *path
 	return status;
 }
 
-static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_params *params, int respfd, char **pathId) {
+/*
+ * thread routine for unlinking temporarily stored directory index at given path (heap-allocated, and freed here) once it times out
+ */
+static void *cashTmpDirfileUnlinker(void *tmpDirfileName) {
+	sleep(tmpDirfileTimeout);
+	if (unlink(tmpDirfileName) != -1) { fprintf(stderr, "unlinking saved directory index at %s; timeout\n", (char *)tmpDirfileName); }
+	free(tmpDirfileName);
+	return NULL;
+}
+
+static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_params *params, char **pathId) {
 	CW_STATUS status;
 	const char *clntip = dirReq->clntip;
 	const char *path = dirReq->path;
@@ -237,10 +427,10 @@ static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_
 
 	FILE *dirFp;
 	if (access(tmpDirfileName, F_OK) != -1 && (dirFp = fopen(tmpDirfileName, "rb"))) {
-		status = cashGetDirPathIdFromStream(dirFp, path, tmpDirfileName, params, respfd, pathId);
+		status = cashGetDirPathIdFromStream(dirFp, path, tmpDirfileName, params, pathId);
 		if (status == CWG_IN_DIR_NO && dirReq->pathReplace) {
 			rewind(dirFp);
-			status = cashGetDirPathIdFromStream(dirFp, dirReq->pathReplace, tmpDirfileName, params, respfd, pathId);
+			status = cashGetDirPathIdFromStream(dirFp, dirReq->pathReplace, tmpDirfileName, params, pathId);
 		}
 		fclose(dirFp);
 		if (status == CWG_IS_DIR_NO) {
@@ -256,6 +446,7 @@ static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_
 		copy_CWG_params(&paramsD, params);
 		paramsD.forceDir = true;
 		paramsD.foundHandler = NULL;
+		paramsD.saveFileSize = NULL;
 		const char *identifier;
 		if (dirReq->cwId) {
 			identifier = dirReq->cwId;
@@ -276,21 +467,17 @@ static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_
 			return status;
 		}
 
-		pid_t pid = fork();
-		if (pid == 0) {
-			close(respfd);
-			sleep(tmpDirfileTimeout);		
-			if (unlink(tmpDirfileName) != -1) { fprintf(stderr, "unlinking saved directory index at %s; timeout\n", tmpDirfileName); }
-			exit(0);
-		} else if (pid < 0) {
-			if (unlink(tmpDirfileName) != -1) { fprintf(stderr, "unlinking saved directory index at %s; fork failure\n", tmpDirfileName); }
-			perror("fork() failed");
+		char *unlinkName;
+		pthread_t unlinker;
+		if ((unlinkName = strdup(tmpDirfileName)) == NULL || pthread_create(&unlinker, NULL, &cashTmpDirfileUnlinker, unlinkName) != 0) {
+			if (unlinkName) { free(unlinkName); }
+			if (unlink(tmpDirfileName) != -1) { fprintf(stderr, "unlinking saved directory index at %s; thread failure\n", tmpDirfileName); }
+			perror("pthread_create() failed");
 			return CS_SYS_ERR;
-		}	
-
-		fprintf(stderr, "[pid=%d] unlinker child process created\n", (int)pid);
+		}
+		pthread_detach(unlinker);
 
-		return cashGetDirPathId(dirReq, params, respfd, pathId);
+		return cashGetDirPathId(dirReq, params, pathId);
 	}
 
 	fprintf(stderr, "ERROR: failed to save/read directory index at %s\n", tmpDirfileName);
@@ -298,19 +485,95 @@ static CS_CW_STATUS cashGetDirPathId(struct cashRequestData *dirReq, struct CWG_
 	return CS_SYS_ERR;
 }
 
-static CS_CW_STATUS cashRequestHandleByUri(const char *url, const char *clntip, int respfd) {
+/*
+ * parses HTTP Range header value for the offset and length of the range requested (length SIZE_MAX for through the end);
+   only a single range from a given offset is supported, so returns false for suffix ranges and multiple ranges (which get the whole file)
+ */
+static bool cashParseRange(const char *range, size_t *offset, size_t *length) {
+	if (!range || strncmp(range, "bytes=", 6) != 0 || !isdigit(range[6])) { return false; }
+
+	char *end;
+	unsigned long long first = strtoull(range+6, &end, 10);
+	if (*end != '-') { return false; }
+	if (*++end == 0) { *offset = first; *length = SIZE_MAX; return true; }
+	if (!isdigit(*end)) { return false; }
+
+	unsigned long long last = strtoull(end, &end, 10);
+	if (*end != 0 || last < first) { return false; }
+	*offset = first;
+	*length = last-first+1;
+	return true;
+}
+
+/*
+ * resolves cashweb id to the TXID of the one file it serves, writing it to txid: a TXID is its own, and a nametag ID's is the TXID its script
+   writes from, so long as that is all the script writes from (as a script may otherwise write any number of files); returns false if not so
+ */
+static bool cashResolveTxid(const char *id, struct CWG_params *params, char (*txid)[CW_TXID_CHARS+1]) {
+	(*txid)[0] = 0;
+	if (CW_is_valid_txid(id)) { strcat(*txid, id); return true; }
+
+	int rev;
+	const char *name;
+	if (!CW_is_valid_nametag_id(id, &rev, &name)) { return false; }
+
+	struct CWG_params paramsN;
+	copy_CWG_params(&paramsN, params);
+	paramsN.foundHandler = NULL;
+	paramsN.saveMimeStr = NULL;
+	paramsN.saveFileSize = NULL;
+	struct CWG_nametag_info info;
+	init_CWG_nametag_info(&info);
+	if (CWG_get_nametag_info(name, rev, &paramsN, &info) == CW_OK && (!info.nameRefs || !info.nameRefs[0]) &&
+	    info.txidRefs && info.txidRefs[0] && !info.txidRefs[1] && CW_is_valid_txid(info.txidRefs[0])) {
+		strcat(*txid, info.txidRefs[0]);
+	}
+	destroy_CWG_nametag_info(&info);
+	return (*txid)[0] != 0;
+}
+
+static CS_CW_STATUS cashGetFile(const char *id, const char *range, struct cashRequestData *rd, struct CWG_params *params, struct CWG_sink *sink) {
+	size_t offset;
+	size_t length;
+	char txid[CW_TXID_CHARS+1];
+	if (!cashParseRange(range, &offset, &length)) {
+		rd->acceptRanges = CW_is_valid_txid(id);
+		return CWG_get_by_id_to_sink(id, params, sink);
+	}
+
+	// a range is of a single file, so the id must first be resolved to its TXID
+	if (!cashResolveTxid(id, params, &txid)) {
+		fprintf(stderr, "%s: identifier '%s' doesn't resolve to a single file; ignoring range %s\n", rd->clntip, id, range+6);
+		return CWG_get_by_id_to_sink(id, params, sink);
+	}
+	rd->acceptRanges = true;
+	if (strcmp(txid, id) != 0) { fprintf(stderr, "%s: identifier '%s' resolved to file at txid %s\n", rd->clntip, id, txid); }
+
+	// the whole file is served as such, its size only resolved if asked for
+	fprintf(stderr, "%s: getting range %s of file\n", rd->clntip, range+6);
+	if (offset > 0 || length != SIZE_MAX) {
+		rd->ranged = true;
+		rd->rangeOffset = offset;
+		rd->rangeLength = length;
+		params->saveFileSize = &rd->resSize;
+	}
+	return CWG_get_range_to_sink(txid, offset, length, params, sink);
+}
+
+static CS_CW_STATUS cashRequestHandleByUri(const char *url, const char *range, const char *clntip, struct CWG_params *reqParams, struct CWG_sink *sink) {
 	char mimeType[CWG_MIMESTR_BUF]; memset(mimeType, 0, CWG_MIMESTR_BUF);
 
 	struct cashRequestData rd;
 	initCashRequestData(&rd, clntip, mimeType);
 
 	struct CWG_params getParams;
-	copy_CWG_params(&getParams, &genGetParams);
+	copy_CWG_params(&getParams, reqParams);
 	getParams.foundHandleData = &rd;
 	getParams.saveMimeStr = &mimeType;
+	if (sendContentLength) { getParams.saveFileSize = &rd.resSize; }
 
 	const char *idQuery = rd.cwId = url+1;
-	if (!CW_is_valid_cashweb_id(idQuery)) { cashFoundHandler(CS_REQUEST_CWID_NO, NULL, respfd); return CS_REQUEST_CWID_NO; } 
+	if (!CW_is_valid_cashweb_id(idQuery)) { cashFoundHandler(CS_REQUEST_CWID_NO, NULL, sink); return CS_REQUEST_CWID_NO; } 
 	int idQueryLen = strlen(idQuery);
 
 	char reqPathReplace[idQueryLen + strlen(TRAILING_BACKSLASH_APPEND) + 1]; 
@@ -333,29 +596,30 @@ static CS_CW_STATUS cashRequestHandleByUri(const char *url, const char *clntip,
 		}
 	
 		CS_CW_STATUS tmpdirStatus;
-		if ((tmpdirStatus = cashGetDirPathId(&dirRd, &getParams, respfd, &pathId)) == CW_OK) { idQuery = pathId; }
-		else if (tmpdirStatus != CS_SYS_ERR) { cashFoundHandler(tmpdirStatus, &rd, respfd); status = tmpdirStatus; goto cleanup; }
+		if ((tmpdirStatus = cashGetDirPathId(&dirRd, &getParams, &pathId)) == CW_OK) { idQuery = pathId; }
+		else if (tmpdirStatus != CS_SYS_ERR) { cashFoundHandler(tmpdirStatus, &rd, sink); status = tmpdirStatus; goto cleanup; }
 	}
 
 	fprintf(stderr, "%s: fetching requested file at identifier '%s'\n", clntip, idQuery);
 	getParams.dirPath = NULL;
-	status = CWG_get_by_id(idQuery, &getParams, respfd);
+	status = cashGetFile(idQuery, range, &rd, &getParams, sink);
 
 	cleanup:
 		if (pathId) { free(pathId); }
 		return status;
 }
 
-static CS_CW_STATUS cashRequestHandleBySubdomain(const char *host, const char *url, const char *clntip, int respfd) {
+static CS_CW_STATUS cashRequestHandleBySubdomain(const char *host, const char *url, const char *range, const char *clntip, struct CWG_params *reqParams, struct CWG_sink *sink) {
 	char mimeType[CWG_MIMESTR_BUF]; memset(mimeType, 0, CWG_MIMESTR_BUF);
 
 	struct cashRequestData rd;
 	initCashRequestData(&rd, clntip, mimeType);
 
 	struct CWG_params getParams;
-	copy_CWG_params(&getParams, &genGetParams);
+	copy_CWG_params(&getParams, reqParams);
 	getParams.foundHandleData = &rd;
 	getParams.saveMimeStr = &mimeType;
+	if (sendContentLength) { getParams.saveFileSize = &rd.resSize; }
 
 	int endPos = strlen(host);
 	int counter = 0;
@@ -385,24 +649,23 @@ static CS_CW_STATUS cashRequestHandleBySubdomain(const char *host, const char *u
 	CW_STATUS status = CW_OK;
 	char *pathId = NULL;
 	CS_CW_STATUS tmpdirStatus = CW_OK;
-	if (tmpDirfileTimeout > 0 && (tmpdirStatus = cashGetDirPathId(&rd, &getParams, respfd, &pathId)) == CW_OK) {
+	if (tmpDirfileTimeout > 0 && (tmpdirStatus = cashGetDirPathId(&rd, &getParams, &pathId)) == CW_OK) {
 		fprintf(stderr, "%s: fetching file at identifier '%s'\n", clntip, pathId);
 		getParams.dirPath = NULL;
-		status = CWG_get_by_id(pathId, &getParams, respfd);
+		status = cashGetFile(pathId, range, &rd, &getParams, sink);
 		goto cleanup;
-	} else if (tmpdirStatus != CS_SYS_ERR) { cashFoundHandler(tmpdirStatus, &rd, respfd); status = tmpdirStatus; goto cleanup; }
+	} else if (tmpdirStatus != CS_SYS_ERR) { cashFoundHandler(tmpdirStatus, &rd, sink); status = tmpdirStatus; goto cleanup; }
 
 	fprintf(stderr, "%s: fetching requested file at name '%s', path %s\n", clntip, rd.name, rd.path);
-	status = CWG_get_by_name(rd.name, CW_REV_LATEST, &getParams, respfd);
+	status = CWG_get_by_name_to_sink(rd.name, CW_REV_LATEST, &getParams, sink);
 
 	cleanup:
 		if (pathId) { free(pathId); }
 		return status;
 }
 
-static inline CS_CW_STATUS cashRequestHandle(struct MHD_Connection *connection, const char *url, const char *clntip, int respfd) {
-	const char *host = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Host");
-	if (host == NULL) { cashFoundHandler(CS_REQUEST_HOST_NO, NULL, respfd); return CS_REQUEST_HOST_NO; }
+static inline CS_CW_STATUS cashRequestHandle(const char *host, const char *url, const char *range, const char *clntip, struct CWG_params *reqParams, struct CWG_sink *sink) {
+	if (host == NULL) { cashFoundHandler(CS_REQUEST_HOST_NO, NULL, sink); return CS_REQUEST_HOST_NO; }
 
 	const char *hostPtr = host;
 	int dotCount;
@@ -411,34 +674,80 @@ static inline CS_CW_STATUS cashRequestHandle(struct MHD_Connection *connection,
 
 	if (dirBySubdomain && dotCount > 1) {
 		fprintf(stderr, "%s: requested %s%s\n", clntip, host, url);
-		return cashRequestHandleBySubdomain(host, url, clntip, respfd);
+		return cashRequestHandleBySubdomain(host, url, range, clntip, reqParams, sink);
 	} else if (strncmp(url, uriQueryPrefix, uriQueryPrefixLen) == 0) {
 		fprintf(stderr, "%s: queried %s\n", clntip, url+uriQueryPrefixLen);
-		return cashRequestHandleByUri(url+uriQueryPrefixLen, clntip, respfd);
+		return cashRequestHandleByUri(url+uriQueryPrefixLen, range, clntip, reqParams, sink);
 	} else if (defaultGetId) {
 		char query[1 + strlen(defaultGetId) + strlen(url) + 1]; query[0] = '/'; query[1] = 0;
 		strcat(query, defaultGetId);
 		strcat(query, url);
 		fprintf(stderr, "%s: home request %s\n", clntip, url);
-		return cashRequestHandleByUri(query, clntip, respfd);
+		return cashRequestHandleByUri(query, range, clntip, reqParams, sink);
 	} else {
-		cashFoundHandler(CS_REQUEST_CWID_NO, NULL, respfd);
+		cashFoundHandler(CS_REQUEST_CWID_NO, NULL, sink);
 		return CS_REQUEST_CWID_NO;
 	}
 }
 
-static inline ssize_t readPipe(void *cls, uint64_t pos, char *buf, size_t max) {
-	int readfd = *(int *)cls;
-	ssize_t r = read(readfd, buf, max);
+/*
+ * request served by a thread of its own (see cashRequestWorker()), with what it needs copied off the connection
+ * stream is what the response is written to and read from by the connection's thread, let go of by the worker once it's done
+ */
+struct cashRequest {
+	char *host;
+	char *url;
+	char *range;
+	char clntip[INET_ADDRSTRLEN];
+	struct cashStream *stream;
+};
 
-	if (r == 0) { return MHD_CONTENT_READER_END_OF_STREAM; }
-	else if (r < 0) { perror("read() failed"); return MHD_CONTENT_READER_END_WITH_ERROR; }
-	return r;
+static void freeCashRequest(struct cashRequest *req) {
+	if (req->host) { free(req->host); }
+	if (req->url) { free(req->url); }
+	if (req->range) { free(req->range); }
+	free(req);
 }
 
-static inline void closePipeFreeMem(void *cls) {
-	close(*(int *)cls);
-	free(cls);
+/*
+ * thread routine for serving request (freed here); every request is served in the one process, so the MongoDB/HTTP pools, rate limiter,
+   cache, and index set up in genGetParams are shared by all of them, and only the stats are kept per request
+ */
+static void *cashRequestWorker(void *arg) {
+	struct cashRequest *req = (struct cashRequest *)arg;
+	const char *clntip = req->clntip;
+	const char *url = req->url;
+
+	struct CWG_params reqParams;
+	copy_CWG_params(&reqParams, &genGetParams);
+	struct CWG_transfer_stats transferStats;
+	init_CWG_transfer_stats(&transferStats);
+	reqParams.transferStats = &transferStats;
+	struct CWG_mongo_pool_stats poolStats;
+	init_CWG_mongo_pool_stats(&poolStats);
+	reqParams.mongodbPoolStats = &poolStats;
+
+	struct CWG_sink sink;
+	init_CWG_sink_callback(&sink, &cashStreamWrite, req->stream);
+	CS_CW_STATUS status = cashRequestHandle(req->host, url, req->range, clntip, &reqParams, &sink);
+	if (status == CW_OK) { fprintf(stderr, "%s: requested file fetched and written to response\n", clntip); }
+	else if (status == CS_REQUEST_HOST_NO) { fprintf(stderr, "%s: bad request, no host header\n", clntip); }
+	else if (status == CS_REQUEST_CWID_NO) { fprintf(stderr, "%s: bad request %s, invalid identifier\n", clntip, url); }
+	else if (status == CS_SYS_ERR) { fprintf(stderr, "%s: cashserver-level system error\n", clntip); }
+	else { fprintf(stderr, "%s: request %s resulted in error code %d: %s\n", clntip, url, status, CWG_errno_to_msg(status)); }
+	if (transferStats.requests > 0) {
+		fprintf(stderr, "%s: HTTP transfer for request %s: %zu requests, %zu bytes on the wire, %zu bytes decoded\n",
+			clntip, url, transferStats.requests, transferStats.wireBytes, transferStats.decodedBytes);
+	}
+	if (poolStats.waits > 0) {
+		fprintf(stderr, "%s: MongoDB pool for request %s: waited for %zu of %zu clients, %.3f ms total (longest %.3f ms)\n",
+			clntip, url, poolStats.waits, poolStats.pops, poolStats.waitMicros/1000.0, poolStats.maxWaitMicros/1000.0);
+	}
+
+	destroy_CWG_sink(&sink);
+	cashStreamFinish(req->stream);
+	freeCashRequest(req);
+	return NULL;
 }
 
 static int requestHandler(void *cls,
@@ -457,55 +766,71 @@ static int requestHandler(void *cls,
 	*ptr = NULL;
 
 	const union MHD_ConnectionInfo *info_addr = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
-	const char *clntip = inet_ntoa(((struct sockaddr_in *) info_addr->client_addr)->sin_addr);
-
-	int pipefd[2];
-	if (pipe(pipefd) == -1) { perror("pipe() failed"); return MHD_NO; }
-
-	pid_t pid = fork();
-	if (pid == 0) {
-		close(pipefd[0]);
-		CS_CW_STATUS status = cashRequestHandle(connection, url, clntip, pipefd[1]);	
-		if (status == CW_OK) { fprintf(stderr, "%s: requested file fetched and written to response\n", clntip); }
-		else if (status == CS_REQUEST_HOST_NO) { fprintf(stderr, "%s: bad request, no host header\n", clntip); }
-		else if (status == CS_REQUEST_CWID_NO) { fprintf(stderr, "%s: bad request %s, invalid identifier\n", clntip, url); }
-		else if (status == CS_SYS_ERR) { fprintf(stderr, "%s: cashserver-level system error\n", clntip); }
-		else { fprintf(stderr, "%s: request %s resulted in error code %d: %s\n", clntip, url, status, CWG_errno_to_msg(status)); }
-		close(pipefd[1]);
-		exit(0);
-	} else if (pid < 0) {
-		perror("fork() failed");
-		close(pipefd[0]);
-		close(pipefd[1]);
+	struct cashRequest *req;
+	if ((req = malloc(sizeof(struct cashRequest))) == NULL) { perror("malloc failed"); return MHD_NO; }
+	const char *host = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Host");
+	const char *range = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Range");
+	req->host = host ? strdup(host) : NULL;
+	req->url = strdup(url);
+	req->range = range ? strdup(range) : NULL;
+	if ((host && !req->host) || !req->url || (range && !req->range)) { perror("strdup() failed"); freeCashRequest(req); return MHD_NO; }
+	if (!inet_ntop(AF_INET, &((struct sockaddr_in *)info_addr->client_addr)->sin_addr, req->clntip, sizeof(req->clntip))) { strcpy(req->clntip, "?"); }
+
+	if ((req->stream = newCashStream()) == NULL) { perror("malloc failed"); freeCashRequest(req); return MHD_NO; }
+	struct cashStream *stream = req->stream;
+
+	// the request is served from a thread of its own, writing its response to the stream for this connection's thread to read
+	pthread_t worker;
+	if (pthread_create(&worker, NULL, &cashRequestWorker, req) != 0) {
+		perror("pthread_create() failed");
+		freeCashRequest(req);
+		cashStreamRelease(stream);
+		cashStreamRelease(stream);
 		return MHD_NO;
 	}
-	close(pipefd[1]);
-	fprintf(stderr, "[pid=%d] request handler child process created\n", (int)pid);
-
-	while ((pid = waitpid((pid_t) -1, NULL, WNOHANG)) > 0) {
-        	fprintf(stderr, "[pid=%d] child process terminated\n", (int)pid);
-        }	
-
-	int *fdstore = malloc(sizeof(int));
-	if (!fdstore) { perror("malloc failed"); return MHD_NO; }
-	*fdstore = pipefd[0];
-	struct MHD_Response *resp = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, RESPONSE_CALLBACK_BLOCK_SZ, &readPipe, fdstore, &closePipeFreeMem);
+	pthread_detach(worker);
 
-	CW_STATUS foundStatus;
+	pthread_mutex_lock(&stream->lock);
+	while (!stream->found && !stream->done) { pthread_cond_wait(&stream->cond, &stream->lock); }
+	bool found = stream->found;
+	CS_CW_STATUS foundStatus = stream->status;
 	char mimeType[CWG_MIMESTR_BUF];
-	if (read(pipefd[0], &foundStatus, 1) < 1 || read(pipefd[0], mimeType, CWG_MIMESTR_BUF) < CWG_MIMESTR_BUF) {
-		perror("read() failed on respfd");
-		return MHD_NO;
+	memcpy(mimeType, stream->mimeType, CWG_MIMESTR_BUF);
+	struct cashResponseInfo info = stream->info;
+	pthread_mutex_unlock(&stream->lock);
+	if (!found) {
+		// the worker failed before finding anything to respond with (and so wrote nothing)
+		foundStatus = CS_SYS_ERR;
+		strcpy(mimeType, "text/html");
+		info.contentLength = MHD_SIZE_UNKNOWN;
+		info.fileSize = SIZE_MAX;
+		info.ranged = false;
+		info.acceptRanges = false;
 	}
 
+	struct MHD_Response *resp = MHD_create_response_from_callback(info.contentLength, RESPONSE_CALLBACK_BLOCK_SZ, &cashStreamRead, stream, &cashStreamClose);
+	if (!resp) { fprintf(stderr, "MHD_create_response_from_callback() failed\n"); cashStreamClose(stream); return MHD_NO; }
+
 	MHD_add_response_header(resp, "Content-Type", mimeType);
-	int ret = MHD_queue_response(connection, cashStatusToResponseCode(foundStatus), resp);
+	if (info.acceptRanges) { MHD_add_response_header(resp, "Accept-Ranges", "bytes"); }
+	char contentRange[CONTENT_RANGE_BUF];
+	if (info.ranged) {
+		snprintf(contentRange, sizeof(contentRange), "bytes %zu-%zu/%zu", info.rangeFirst, info.rangeLast, info.fileSize);
+		MHD_add_response_header(resp, "Content-Range", contentRange);
+	} else if (foundStatus == CWG_RANGE_NO && info.fileSize != SIZE_MAX) {
+		snprintf(contentRange, sizeof(contentRange), "bytes */%zu", info.fileSize);
+		MHD_add_response_header(resp, "Content-Range", contentRange);
+	}
+	int ret = MHD_queue_response(connection, info.ranged ? MHD_HTTP_PARTIAL_CONTENT : cashStatusToResponseCode(foundStatus), resp);
 	MHD_destroy_response (resp);	
 
 	return ret;
 }
 
 int main(int argc, char **argv) {
+	// a client going away mid-response should fail just the write to its socket, not the server
+	signal(SIGPIPE, SIG_IGN);
+
 	init_CWG_params(&genGetParams, NULL, NULL, NULL, NULL);
 	genGetParams.foundHandler = &cashFoundHandler;
 
@@ -514,13 +839,23 @@ int main(int argc, char **argv) {
 	dirBySubdomain = DIR_BY_SUBDOMAIN_DEFAULT;;
 	tmpDirfilePath = TMP_DIRFILE_PATH_DEFAULT;
 	tmpDirfileTimeout = atoi(TMP_DIRFILE_TIMEOUT_DEFAULT);
+	sendContentLength = false;
 
 	unsigned short port = atoi(CS_PORT_DEFAULT);
 	char *mongodb = MONGODB_LOCAL_ADDR;
+	char *cacheDir = NULL;
+	char *indexPath = NULL;
+	char *recordPath = NULL;
+	char *replayPath = NULL;
+	int replayLatencyMs = CWG_REPLAY_LATENCY_RECORDED;
+	double rateLimit = 0;
+	double rateBurst = 0;
+	char *rateBurstStr;
+	char *selectionTimeoutStr;
 
 	bool no = false;
 	int c;
-	while ((c = getopt(argc, argv, ":hp:m:b:r:d:c:q:nsf:t:")) != -1) {
+	while ((c = getopt(argc, argv, ":hp:m:P:M:T:b:r:R:A:I:d:L:C:W:Y:K:zc:q:nsf:t:")) != -1) {
 		switch (c) {
 			case 'h':
 				fprintf(stderr, HELP_STR, argv[0]);
@@ -531,6 +866,16 @@ int main(int argc, char **argv) {
 			case 'm':
 				mongodb = optarg;
 				break;
+			case 'P':
+				genGetParams.mongodbPoolMaxSize = atoi(optarg);
+				break;
+			case 'M':
+				genGetParams.mongodbReadPref = optarg;
+				break;
+			case 'T':
+				genGetParams.mongodbSocketTimeoutMS = strtol(optarg, &selectionTimeoutStr, 10);
+				genGetParams.mongodbServerSelectionTimeoutMS = *selectionTimeoutStr == ':' ? atoi(selectionTimeoutStr+1) : 0;
+				break;
 			case 'b':
 				genGetParams.bitdbNode = optarg;
 				mongodb = NULL;
@@ -539,9 +884,40 @@ int main(int argc, char **argv) {
 				genGetParams.restEndpoint = optarg;
 				mongodb = NULL;
 				break;
+			case 'R':
+				genGetParams.rpcEndpoint = optarg;
+				mongodb = NULL;
+				break;
+			case 'A':
+				genGetParams.rpcAuth = optarg;
+				break;
+			case 'I':
+				indexPath = optarg;
+				mongodb = NULL;
+				break;
 			case 'd':
 				genGetParams.datadir = optarg;
 				break;
+			case 'L':
+				rateLimit = strtod(optarg, &rateBurstStr);
+				rateBurst = *rateBurstStr == ':' ? strtod(rateBurstStr+1, NULL) : 0;
+				break;
+			case 'C':
+				cacheDir = optarg;
+				break;
+			case 'W':
+				recordPath = optarg;
+				break;
+			case 'Y':
+				replayPath = optarg;
+				mongodb = NULL;
+				break;
+			case 'K':
+				replayLatencyMs = atoi(optarg);
+				break;
+			case 'z':
+				sendContentLength = true;
+				break;
 			case 'c':
 				defaultGetId = optarg;
 				break;
@@ -577,7 +953,22 @@ int main(int argc, char **argv) {
 		}
 	}		
 
-	if (mongodb) { CWG_init_mongo_pool(mongodb, &genGetParams); }
+	// warns on startup if the queries served would scan whole collections
+	genGetParams.mongodbIndexCheck = true;
+	if (mongodb) {
+		if (CWG_init_mongo_pool(mongodb, &genGetParams) != CW_OK) { fprintf(stderr, "Failed to initialize MongoDB client pool.\n"); exit(1); }
+	}
+	else if (CWG_init_http_pool(&genGetParams) != CW_OK) { fprintf(stderr, "WARNING: failed to initialize HTTP connection pool; connections will not be reused\n"); }
+	if (!mongodb && rateLimit > 0 && CWG_init_rate_limiter(rateLimit, rateBurst, &genGetParams) != CW_OK) { fprintf(stderr, "WARNING: failed to initialize rate limiter; continuing without\n"); }
+	if (cacheDir && CWG_init_cache(cacheDir, CWG_CACHE_MAX_BYTES_DEFAULT, &genGetParams) != CW_OK) { fprintf(stderr, "WARNING: failed to open cache at %s; continuing without\n", cacheDir); }
+	if (indexPath && CWG_init_index(indexPath, &genGetParams) != CW_OK) { fprintf(stderr, "WARNING: failed to open index at %s; continuing without\n", indexPath); }
+	char batchSizesPath[cacheDir ? strlen(cacheDir)+sizeof(CWG_BATCH_SIZES_FILENAME)+1 : 1];
+	if (cacheDir) {
+		snprintf(batchSizesPath, sizeof(batchSizesPath), "%s/%s", cacheDir, CWG_BATCH_SIZES_FILENAME);
+		genGetParams.batchSizesPath = batchSizesPath;
+	}
+	if (replayPath && CWG_init_fetch_replay(replayPath, replayLatencyMs, &genGetParams) != CW_OK) { fprintf(stderr, "Failed to load fetch record at %s.\n", replayPath); exit(1); }
+	if (recordPath && CWG_init_fetch_recorder(recordPath, &genGetParams) != CW_OK) { fprintf(stderr, "Failed to open fetch record at %s.\n", recordPath); exit(1); }
 	struct MHD_Daemon *d;
 	if ((d = MHD_start_daemon(MHD_USE_THREAD_PER_CONNECTION,
 				  port,
@@ -586,12 +977,19 @@ int main(int argc, char **argv) {
 				  &requestHandler,
 				  NULL,
 				  MHD_OPTION_END)) == NULL) { perror("MHD_start_daemon() failed"); exit(1); }
-	fprintf(stderr, "Starting cashserver on port %u with home identifier %s... (source is %s at %s)\n", port, defaultGetId ? defaultGetId : "<none>", mongodb ? "MongoDB" : "BitDB HTTP endpoint", mongodb ? mongodb : genGetParams.bitdbNode);
+	fprintf(stderr, "Starting cashserver on port %u with home identifier %s... (source is %s at %s)\n", port, defaultGetId ? defaultGetId : "<none>", replayPath ? "fetch record" : mongodb ? "MongoDB" : genGetParams.bitdbNode ? "BitDB HTTP endpoint" : genGetParams.restEndpoint ? "REST HTTP endpoint" : genGetParams.rpcEndpoint ? "bitcoind JSON-RPC endpoint" : "local index",
+		replayPath ? replayPath : mongodb ? mongodb : genGetParams.bitdbNode ? genGetParams.bitdbNode : genGetParams.restEndpoint ? genGetParams.restEndpoint : genGetParams.rpcEndpoint ? genGetParams.rpcEndpoint : indexPath);
 
 	(void) getc (stdin);
 	fprintf(stderr, "Stopping cashserver...\n");
 	MHD_stop_daemon(d);
+	CWG_cleanup_fetch_recorder(&genGetParams);
+	CWG_cleanup_fetch_replay(&genGetParams);
 	if (mongodb) { CWG_cleanup_mongo_pool(&genGetParams); } 
+	else { CWG_cleanup_http_pool(&genGetParams); }
+	CWG_cleanup_rate_limiter(&genGetParams);
+	CWG_cleanup_cache(&genGetParams);
+	CWG_cleanup_index(&genGetParams);
 
 	return 0;
 }
@@ -0,0 +1,440 @@
+#include <cashgettools.h>
+#include "cashtxscanutils.h"
+#include <unistd.h>
+
+/*
+ * checks of cashgettools run offline by 'make check': files are laid out as cashsendtools would, in TXs mined into synthetic block files,
+   and gotten back out of them through a local index, then through a record of the fetches that made (whole, and by range)
+ * exits 0 if every check passes, 1 otherwise (having printed what failed)
+ */
+
+#define TEST_DIR_TEMPLATE "/tmp/cashtest-XXXXXX"
+#define TEST_CHAIN_FIRST_BYTES (CW_TX_DATA_BYTES-CW_TXID_BYTES-CW_METADATA_BYTES)
+#define TEST_CHAIN_MID_BYTES (CW_TX_DATA_BYTES-CW_TXID_BYTES)
+#define TEST_BLOCK_HEADER_BYTES 80
+#define TEST_BLOCK_FILES 2
+#define TEST_TX_MAX_BYTES 300
+
+/*
+ * a file laid out for the tests: its data, and the TXID it's gotten by
+ */
+struct testFile {
+	const char *name;
+	unsigned char *data;
+	size_t len;
+	char txid[CW_TXID_CHARS+1];
+};
+
+/*
+ * the TXs laid out so far, in order; each is mined into a block of the synthetic chain
+ */
+struct testTxs {
+	unsigned char (*raw)[TEST_TX_MAX_BYTES];
+	size_t *rawLens;
+	size_t count;
+	size_t size;
+};
+
+static int failures = 0;
+
+/*
+ * notes failure of check if cond is false, printing what failed
+ */
+#define TEST_CHECK(cond, ...) do { if (!(cond)) { fprintf(stderr, "FAIL: "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); failures++; } } while (0)
+
+/*
+ * appends a TX to txs whose first output is OP_RETURN pushing the given data, and writes its TXID (bytes in display order) to txid;
+   each spends a distinct (made-up) outpoint, so that TXs of the same data differ
+ */
+static bool testPutTx(struct testTxs *txs, const unsigned char *data, size_t len, unsigned char *txid);
+
+/*
+ * lays out data as a tree of TXs (as cashsendtools does for a file that isn't chained), writing the TXID of its root to txid
+ */
+static bool testPutTree(struct testTxs *txs, const unsigned char *data, size_t len, unsigned char *txid);
+
+/*
+ * lays out data as a chain of TXs, each holding the TXID of the next, with metadata of given depth in the first (as cashsendtools does for a chained file)
+ */
+static bool testPutChain(struct testTxs *txs, const unsigned char *data, size_t len, uint32_t depth, unsigned char *txid);
+
+/*
+ * writes the TXs to block files in dir, a block (after one of only a coinbase) per TEST_BLOCK_FILES'th of them,
+   stored out of order across the files as a node may store them
+ */
+static bool testWriteBlockFiles(struct testTxs *txs, const char *dir);
+
+/*
+ * gets each file by its TXID with params and checks that what's written is its data
+ */
+static void testGetFiles(struct testFile *files, size_t count, struct CWG_params *params, const char *what);
+
+/*
+ * checks the manifest of file gotten with params, then gets ranges of it with params starting/ending about its first, middle, and last leaves' boundaries
+   (and past its end), checking that what's written is that range of its data
+ */
+static void testGetRanges(struct testFile *file, struct CWG_params *params, const char *what);
+
+static inline void testTxidToHex(const unsigned char *txid, char *hex) {
+	for (int i=0; i<CW_TXID_BYTES; i++) { sprintf(hex+2*i, "%02x", txid[i]); }
+}
+
+static inline size_t testPutPush(unsigned char *script, size_t len) {
+	if (len < TX_SCAN_OP_PUSHDATA1) { script[0] = len; return 1; }
+	else if (len <= UINT8_MAX) { script[0] = TX_SCAN_OP_PUSHDATA1; script[1] = len; return 2; }
+	script[0] = TX_SCAN_OP_PUSHDATA2; script[1] = len & 0xff; script[2] = len >> 8; return 3;
+}
+
+static inline size_t testPutVarInt(unsigned char *buf, uint64_t n) {
+	if (n < 0xfd) { buf[0] = n; return 1; }
+	buf[0] = 0xfd; buf[1] = n & 0xff; buf[2] = n >> 8; return 3;
+}
+
+static inline void testPutMetadata(unsigned char *buf, uint32_t length, uint32_t depth) {
+	buf[0] = length >> 24; buf[1] = length >> 16; buf[2] = length >> 8; buf[3] = length;
+	buf[4] = depth >> 24; buf[5] = depth >> 16; buf[6] = depth >> 8; buf[7] = depth;
+	buf[8] = CW_T_FILE >> 8; buf[9] = CW_T_FILE & 0xff;
+	buf[10] = CW_P_VER >> 8; buf[11] = CW_P_VER & 0xff;
+}
+
+static bool testPutTx(struct testTxs *txs, const unsigned char *data, size_t len, unsigned char *txid) {
+	if (txs->count >= txs->size) {
+		txs->size = txs->size ? txs->size*2 : 64;
+		if ((txs->raw = realloc(txs->raw, txs->size*sizeof(txs->raw[0]))) == NULL ||
+		    (txs->rawLens = realloc(txs->rawLens, txs->size*sizeof(size_t))) == NULL) { perror("realloc failed"); return false; }
+	}
+	unsigned char *raw = txs->raw[txs->count];
+	size_t n = 0;
+
+	raw[n++] = 2; raw[n++] = 0; raw[n++] = 0; raw[n++] = 0;
+	raw[n++] = 1;
+	memset(raw+n, 0x11, CW_TXID_BYTES); memcpy(raw+n, &txs->count, sizeof(txs->count)); n += CW_TXID_BYTES;
+	memset(raw+n, 0, 4); n += 4;
+	raw[n++] = 0;
+	memset(raw+n, 0xff, 4); n += 4;
+
+	unsigned char script[TEST_TX_MAX_BYTES];
+	size_t scriptLen = 0;
+	script[scriptLen++] = TX_SCAN_OP_RETURN;
+	scriptLen += testPutPush(script+scriptLen, len);
+	memcpy(script+scriptLen, data, len); scriptLen += len;
+	raw[n++] = 1;
+	memset(raw+n, 0, 8); n += 8;
+	n += testPutVarInt(raw+n, scriptLen);
+	memcpy(raw+n, script, scriptLen); n += scriptLen;
+	memset(raw+n, 0, 4); n += 4;
+
+	// the TX is scanned back as the indexer will, so that a mistake in laying it out fails here rather than as a missing file
+	struct TxScan ts;
+	struct TxScanInfo info;
+	const char *push1;
+	const char *push2;
+	size_t push1Len;
+	size_t push2Len;
+	txScanInit(&ts, (const char *)raw, n, false);
+	if (!txScanTx(&ts, &info) || info.len != n ||
+	    !txScanOpReturn(info.out0Script, info.out0ScriptLen, false, &push1, &push1Len, &push2, &push2Len) ||
+	    push1Len != len || memcmp(push1, data, len) != 0 || push2) {
+		fprintf(stderr, "TX %zu laid out doesn't scan back to its data\n", txs->count);
+		return false;
+	}
+
+	txs->rawLens[txs->count++] = n;
+	txScanTxid((const char *)raw, n, txid);
+	return true;
+}
+
+static bool testPutTree(struct testTxs *txs, const unsigned char *data, size_t len, unsigned char *txid) {
+	unsigned char *level = NULL;
+	unsigned char *next = NULL;
+	unsigned char root[CW_TX_DATA_BYTES];
+	uint32_t depth = 0;
+	bool ok = false;
+
+	// each level is the TXIDs of the TXs holding the level below, until one fits in a TX along with the metadata
+	while (len+CW_METADATA_BYTES > CW_TX_DATA_BYTES) {
+		size_t count = (len+CW_TX_DATA_BYTES-1)/CW_TX_DATA_BYTES;
+		if ((next = malloc(count*CW_TXID_BYTES)) == NULL) { perror("malloc failed"); goto cleanup; }
+		for (size_t i=0; i<count; i++) {
+			size_t n = i < count-1 ? CW_TX_DATA_BYTES : len-i*CW_TX_DATA_BYTES;
+			if (!testPutTx(txs, data+i*CW_TX_DATA_BYTES, n, next+i*CW_TXID_BYTES)) { goto cleanup; }
+		}
+		if (level) { free(level); }
+		data = level = next; next = NULL;
+		len = count*CW_TXID_BYTES;
+		depth++;
+	}
+	memcpy(root, data, len);
+	testPutMetadata(root+len, 0, depth);
+	ok = testPutTx(txs, root, len+CW_METADATA_BYTES, txid);
+
+	cleanup:
+		if (level) { free(level); }
+		if (next) { free(next); }
+		return ok;
+}
+
+static bool testPutChain(struct testTxs *txs, const unsigned char *data, size_t len, uint32_t depth, unsigned char *txid) {
+	unsigned char link[CW_TX_DATA_BYTES];
+	if (len+CW_METADATA_BYTES <= CW_TX_DATA_BYTES) {
+		memcpy(link, data, len);
+		testPutMetadata(link+len, 0, depth);
+		return testPutTx(txs, link, len+CW_METADATA_BYTES, txid);
+	}
+
+	// links are put from the last back, as each holds the TXID of the one after it
+	size_t rest = len-TEST_CHAIN_FIRST_BYTES;
+	size_t mids = rest > CW_TX_DATA_BYTES ? (rest-CW_TX_DATA_BYTES+TEST_CHAIN_MID_BYTES-1)/TEST_CHAIN_MID_BYTES : 0;
+	size_t lastOffset = TEST_CHAIN_FIRST_BYTES+mids*TEST_CHAIN_MID_BYTES;
+	unsigned char next[CW_TXID_BYTES];
+	if (!testPutTx(txs, data+lastOffset, len-lastOffset, next)) { return false; }
+	for (size_t i=mids; i>0; i--) {
+		memcpy(link, data+TEST_CHAIN_FIRST_BYTES+(i-1)*TEST_CHAIN_MID_BYTES, TEST_CHAIN_MID_BYTES);
+		memcpy(link+TEST_CHAIN_MID_BYTES, next, CW_TXID_BYTES);
+		if (!testPutTx(txs, link, CW_TX_DATA_BYTES, next)) { return false; }
+	}
+	memcpy(link, data, TEST_CHAIN_FIRST_BYTES);
+	memcpy(link+TEST_CHAIN_FIRST_BYTES, next, CW_TXID_BYTES);
+	testPutMetadata(link+TEST_CHAIN_FIRST_BYTES+CW_TXID_BYTES, mids+1, depth);
+	return testPutTx(txs, link, CW_TX_DATA_BYTES, txid);
+}
+
+static bool testWriteBlockFiles(struct testTxs *txs, const char *dir) {
+	static const unsigned char magic[] = { 0xe3, 0xe1, 0xf3, 0xe8 };
+	// a coinbase's output isn't OP_RETURN, so it isn't indexed
+	unsigned char coinbase[4+1+CW_TXID_BYTES+4+2+4+1+8+2+4] = {1, 0, 0, 0, 1};
+	size_t coinbaseHeight = 4+1+CW_TXID_BYTES+4+1;
+	memset(coinbase+coinbaseHeight-5, 0xff, 4);
+	coinbase[coinbaseHeight-1] = 1;
+	memset(coinbase+coinbaseHeight+1, 0xff, 4);
+	coinbase[coinbaseHeight+5] = 1;
+	coinbase[coinbaseHeight+14] = 1;
+	coinbase[coinbaseHeight+15] = 0x51;
+	size_t blocks = 1+TEST_BLOCK_FILES;
+	size_t perBlock = (txs->count+TEST_BLOCK_FILES-1)/TEST_BLOCK_FILES;
+	unsigned char prevHash[CW_TXID_BYTES] = {0};
+	unsigned char hash[CW_TXID_BYTES];
+	FILE *fps[TEST_BLOCK_FILES] = {NULL};
+	bool ok = false;
+
+	char path[strlen(dir)+20];
+	for (int i=0; i<TEST_BLOCK_FILES; i++) {
+		snprintf(path, sizeof(path), "%s/blk%05d.dat", dir, i);
+		if ((fps[i] = fopen(path, "wb")) == NULL) { perror("fopen() failed on block file"); goto cleanup; }
+	}
+
+	// block b goes to file (b+1)%TEST_BLOCK_FILES, so that the first block stored is the child of one stored later
+	for (size_t b=0; b<blocks; b++) {
+		size_t first = b > 0 ? (b-1)*perBlock : 0;
+		size_t last = b > 0 ? first+perBlock : 0;
+		if (last > txs->count) { last = txs->count; }
+
+		unsigned char header[TEST_BLOCK_HEADER_BYTES] = {1};
+		for (int i=0; i<CW_TXID_BYTES; i++) { header[4+i] = prevHash[CW_TXID_BYTES-1-i]; }
+		header[76] = b;
+		coinbase[coinbaseHeight] = b;
+		unsigned char count[3];
+		size_t countLen = testPutVarInt(count, 1+last-first);
+		uint32_t len = sizeof(header)+countLen+sizeof(coinbase);
+		for (size_t i=first; i<last; i++) { len += txs->rawLens[i]; }
+		unsigned char lenLE[4] = { len & 0xff, len >> 8 & 0xff, len >> 16 & 0xff, len >> 24 };
+
+		FILE *fp = fps[(b+1)%TEST_BLOCK_FILES];
+		fwrite(magic, 1, sizeof(magic), fp);
+		fwrite(lenLE, 1, sizeof(lenLE), fp);
+		fwrite(header, 1, sizeof(header), fp);
+		fwrite(count, 1, countLen, fp);
+		fwrite(coinbase, 1, sizeof(coinbase), fp);
+		for (size_t i=first; i<last; i++) { fwrite(txs->raw[i], 1, txs->rawLens[i], fp); }
+		if (ferror(fp)) { perror("fwrite() failed on block file"); goto cleanup; }
+
+		txScanTxid((const char *)header, sizeof(header), hash);
+		memcpy(prevHash, hash, sizeof(hash));
+	}
+	ok = true;
+
+	cleanup:
+		for (int i=0; i<TEST_BLOCK_FILES; i++) {
+			// files are preallocated by a node, so end in zeroed space
+			if (fps[i]) {
+				if (ok) { for (int j=0; j<64; j++) { fputc(0, fps[i]); } }
+				if (fclose(fps[i]) != 0) { ok = false; }
+			}
+		}
+		return ok;
+}
+
+static void testGetFiles(struct testFile *files, size_t count, struct CWG_params *params, const char *what) {
+	CW_STATUS status;
+	struct CWG_sink sink;
+	for (size_t i=0; i<count; i++) {
+		init_CWG_sink_memory(&sink);
+		status = CWG_get_by_txid_to_sink(files[i].txid, params, &sink);
+		TEST_CHECK(status == CW_OK, "%s: getting %s failed with status %d: %s", what, files[i].name, status, CWG_errno_to_msg(status));
+		if (status == CW_OK) {
+			TEST_CHECK(sink.len == files[i].len && (sink.len == 0 || memcmp(sink.data, files[i].data, sink.len) == 0),
+				   "%s: %s got %zu bytes not matching its %zu", what, files[i].name, sink.len, files[i].len);
+		}
+		destroy_CWG_sink(&sink);
+	}
+}
+
+static void testGetRanges(struct testFile *file, struct CWG_params *params, const char *what) {
+	struct CWG_file_manifest manifest;
+	init_CWG_file_manifest(&manifest);
+	CW_STATUS status = CWG_get_file_manifest(file->txid, params, &manifest);
+	TEST_CHECK(status == CW_OK, "%s: getting manifest of %s failed with status %d: %s", what, file->name, status, CWG_errno_to_msg(status));
+	if (status != CW_OK) { return; }
+
+	size_t total = 0;
+	for (size_t i=0; i<manifest.count; i++) { total += manifest.sizes[i]; }
+	TEST_CHECK(manifest.size == file->len && total == file->len, "%s: manifest of %s sizes it %zu (leaves summing to %zu), not %zu",
+		   what, file->name, manifest.size, total, file->len);
+	TEST_CHECK(manifest.count >= 3, "%s: manifest of %s has only %zu leaves", what, file->name, manifest.count);
+	if (manifest.size != file->len || total != file->len || manifest.count < 3) { destroy_CWG_file_manifest(&manifest); return; }
+
+	// where the second, a middle, and the last leaf begin
+	size_t boundaries[3] = { manifest.sizes[0], 0, file->len-manifest.sizes[manifest.count-1] };
+	for (size_t i=0; i<manifest.count/2; i++) { boundaries[1] += manifest.sizes[i]; }
+	destroy_CWG_file_manifest(&manifest);
+
+	struct CWG_sink sink;
+	size_t offset;
+	size_t length;
+	size_t expected;
+	for (int b=0; b<sizeof(boundaries)/sizeof(boundaries[0]); b++) {
+		size_t ranges[][2] = {
+			{ 0, boundaries[b] }, { 0, boundaries[b]+1 }, { boundaries[b]-1, 1 }, { boundaries[b]-1, 2 },
+			{ boundaries[b], 1 }, { boundaries[b], SIZE_MAX }, { boundaries[b]-1, CW_TX_DATA_BYTES+2 }
+		};
+		for (int r=0; r<sizeof(ranges)/sizeof(ranges[0]); r++) {
+			offset = ranges[r][0];
+			length = ranges[r][1];
+			expected = length < file->len-offset ? length : file->len-offset;
+			init_CWG_sink_memory(&sink);
+			status = CWG_get_range_to_sink(file->txid, offset, length, params, &sink);
+			TEST_CHECK(status == CW_OK, "%s: getting %zu bytes of %s at %zu failed with status %d: %s",
+				   what, length, file->name, offset, status, CWG_errno_to_msg(status));
+			if (status == CW_OK) {
+				TEST_CHECK(sink.len == expected && (sink.len == 0 || memcmp(sink.data, file->data+offset, sink.len) == 0),
+					   "%s: %zu bytes of %s at %zu got %zu bytes not matching its %zu", what, length, file->name, offset, sink.len, expected);
+			}
+			destroy_CWG_sink(&sink);
+		}
+	}
+
+	init_CWG_sink_memory(&sink);
+	status = CWG_get_range_to_sink(file->txid, file->len, 1, params, &sink);
+	TEST_CHECK(status == CWG_RANGE_NO && sink.len == 0, "%s: range of %s past its end got status %d and %zu bytes", what, file->name, status, sink.len);
+	destroy_CWG_sink(&sink);
+}
+
+int main(int argc, char **argv) {
+	struct testFile files[] = {
+		{ .name = "small", .len = 14 },
+		{ .name = "tree", .len = 20000 },
+		{ .name = "chain", .len = 5000 },
+		{ .name = "chained tree", .len = 30000 }
+	};
+	size_t filesCount = sizeof(files)/sizeof(files[0]);
+	struct testTxs txs = { NULL, NULL, 0, 0 };
+	char dir[] = TEST_DIR_TEMPLATE;
+	char indexPath[sizeof(dir)+10]; indexPath[0] = 0;
+	char recordPath[sizeof(dir)+10]; recordPath[0] = 0;
+	unsigned char *leafTxids = NULL;
+	unsigned char txid[CW_TXID_BYTES];
+	bool dirMade = false;
+	uint32_t seed = 1;
+
+	CWG_err_stream = stderr;
+	for (size_t i=0; i<filesCount; i++) {
+		if ((files[i].data = malloc(files[i].len)) == NULL) { perror("malloc failed"); failures++; goto cleanup; }
+		for (size_t j=0; j<files[i].len; j++) { seed = seed*1103515245 + 12345; files[i].data[j] = seed >> 16; }
+	}
+	memcpy(files[0].data, "hello cashweb\n", files[0].len);
+
+	bool laidOut = testPutTree(&txs, files[0].data, files[0].len, txid);
+	testTxidToHex(txid, files[0].txid);
+	laidOut = laidOut && testPutTree(&txs, files[1].data, files[1].len, txid);
+	testTxidToHex(txid, files[1].txid);
+	laidOut = laidOut && testPutChain(&txs, files[2].data, files[2].len, 0, txid);
+	testTxidToHex(txid, files[2].txid);
+
+	// a chained tree's leaves are put as a tree's first level is, then the chain holds their TXIDs
+	size_t leaves = (files[3].len+CW_TX_DATA_BYTES-1)/CW_TX_DATA_BYTES;
+	if ((leafTxids = malloc(leaves*CW_TXID_BYTES)) == NULL) { perror("malloc failed"); failures++; goto cleanup; }
+	for (size_t i=0; laidOut && i<leaves; i++) {
+		size_t n = i < leaves-1 ? CW_TX_DATA_BYTES : files[3].len-i*CW_TX_DATA_BYTES;
+		laidOut = testPutTx(&txs, files[3].data+i*CW_TX_DATA_BYTES, n, leafTxids+i*CW_TXID_BYTES);
+	}
+	laidOut = laidOut && testPutChain(&txs, leafTxids, leaves*CW_TXID_BYTES, 1, txid);
+	testTxidToHex(txid, files[3].txid);
+	if (!laidOut) { failures++; goto cleanup; }
+
+	if (!mkdtemp(dir)) { perror("mkdtemp() failed"); failures++; goto cleanup; }
+	dirMade = true;
+	if (!testWriteBlockFiles(&txs, dir)) { failures++; goto cleanup; }
+
+	// index built offline from the block files serves every file, and nothing else
+	snprintf(indexPath, sizeof(indexPath), "%s/index", dir);
+	CW_STATUS status = CWG_update_index_from_blocks(indexPath, dir);
+	TEST_CHECK(status == CW_OK, "indexing block files failed with status %d: %s", status, CWG_errno_to_msg(status));
+	if (status != CW_OK) { goto cleanup; }
+
+	struct CWG_params params;
+	init_CWG_params(&params, NULL, NULL, NULL, NULL);
+	if ((status = CWG_init_index(indexPath, &params)) != CW_OK) { TEST_CHECK(false, "opening index failed with status %d", status); goto cleanup; }
+	testGetFiles(files, filesCount, &params, "index");
+
+	char missing[CW_TXID_CHARS+1];
+	memset(missing, 'a', CW_TXID_CHARS); missing[CW_TXID_CHARS] = 0;
+	struct CWG_sink sink;
+	init_CWG_sink_memory(&sink);
+	TEST_CHECK(CWG_get_by_txid_to_sink(missing, &params, &sink) != CW_OK, "index: got file at TXID not in it");
+	destroy_CWG_sink(&sink);
+
+	// updating again finds nothing new, and leaves the index as it was
+	CWG_cleanup_index(&params);
+	status = CWG_update_index_from_blocks(indexPath, dir);
+	TEST_CHECK(status == CW_OK, "updating index from the same block files failed with status %d: %s", status, CWG_errno_to_msg(status));
+	if ((status = CWG_init_index(indexPath, &params)) != CW_OK) { TEST_CHECK(false, "reopening index failed with status %d", status); goto cleanup; }
+	testGetFiles(files, filesCount, &params, "updated index");
+
+	// every fetch the gets make through the index is recorded, and the gets are then repeated from the record alone
+	snprintf(recordPath, sizeof(recordPath), "%s/record", dir);
+	struct CWG_params recordParams;
+	copy_CWG_params(&recordParams, &params);
+	if ((status = CWG_init_fetch_recorder(recordPath, &recordParams)) != CW_OK) {
+		TEST_CHECK(false, "starting fetch recorder failed with status %d", status);
+		CWG_cleanup_index(&params);
+		goto cleanup;
+	}
+	testGetFiles(files, filesCount, &recordParams, "recording");
+	CWG_cleanup_fetch_recorder(&recordParams);
+	CWG_cleanup_index(&params);
+
+	init_CWG_params(&params, NULL, NULL, NULL, NULL);
+	if ((status = CWG_init_fetch_replay(recordPath, 0, &params)) != CW_OK) { TEST_CHECK(false, "loading fetch record failed with status %d", status); goto cleanup; }
+	testGetFiles(files, filesCount, &params, "replay");
+	for (size_t i=1; i<filesCount; i++) { testGetRanges(&files[i], &params, "replay"); }
+	init_CWG_sink_memory(&sink);
+	TEST_CHECK(CWG_get_by_txid_to_sink(missing, &params, &sink) == CWG_FETCH_NO, "replay: got file at TXID not recorded");
+	destroy_CWG_sink(&sink);
+	CWG_cleanup_fetch_replay(&params);
+
+	cleanup:
+		for (size_t i=0; i<filesCount; i++) { if (files[i].data) { free(files[i].data); } }
+		if (leafTxids) { free(leafTxids); }
+		if (txs.raw) { free(txs.raw); }
+		if (txs.rawLens) { free(txs.rawLens); }
+		if (dirMade) {
+			char path[sizeof(dir)+20];
+			for (int i=0; i<TEST_BLOCK_FILES; i++) { snprintf(path, sizeof(path), "%s/blk%05d.dat", dir, i); unlink(path); }
+			if (indexPath[0]) { unlink(indexPath); }
+			if (recordPath[0]) { unlink(recordPath); }
+			rmdir(dir);
+		}
+		if (failures > 0) { fprintf(stderr, "%d check(s) failed\n", failures); }
+		else { fprintf(stderr, "all checks passed\n"); }
+		return failures > 0 ? 1 : 0;
+}
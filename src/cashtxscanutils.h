@@ -0,0 +1,285 @@
+#ifndef __CASHTXSCANUTILS_H__
+#define __CASHTXSCANUTILS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* script opcodes of interest */
+#define TX_SCAN_OP_RETURN 0x6a
+#define TX_SCAN_OP_PUSHDATA1 0x4c
+#define TX_SCAN_OP_PUSHDATA2 0x4d
+#define TX_SCAN_OP_PUSHDATA4 0x4e
+
+/* largest vin/vout count or script length accepted, as a guard against garbage */
+#define TX_SCAN_COUNT_MAX 100000
+#define TX_SCAN_SCRIPT_MAX 10000000
+
+/*
+ * minimal scanner over serialized transactions/blocks in memory, either as raw bytes or as hex text (two characters per byte),
+   for pulling out the few parts cashweb cares about without decoding or allocating
+ * positions and slices handed back point into the source (so into hex text if scanning hex, spanning twice as many characters)
+ * every function returns false on malformed/truncated input, leaving the scanner at the point of failure
+ */
+struct TxScan {
+	const char *p;
+	const char *end;
+	bool hex;
+};
+
+/*
+ * parts of a scanned transaction
+ * start/len: the serialized transaction within the source (for hashing to a txid)
+ * in0Txid: the txid spent by the first input, in serialized (little-endian) order; in0Vout is its output index (both unset if no inputs)
+ * out0Script/out0ScriptLen: the first output's script (NULL if no outputs)
+ */
+struct TxScanInfo {
+	const char *start;
+	size_t len;
+	const char *in0Txid;
+	uint32_t in0Vout;
+	const char *out0Script;
+	size_t out0ScriptLen;
+};
+
+/*
+ * initializes scanner over len characters at data, which is hex text if hex is set
+ */
+static inline void txScanInit(struct TxScan *ts, const char *data, size_t len, bool hex) {
+	ts->p = data;
+	ts->end = data + (hex ? len & ~(size_t)1 : len);
+	ts->hex = hex;
+}
+
+/*
+ * number of source characters taken up by n bytes
+ */
+static inline size_t txScanWidth(struct TxScan *ts, size_t n) {
+	return ts->hex ? 2*n : n;
+}
+
+static inline int txScanHexVal(char c) {
+	if (c >= '0' && c <= '9') { return c - '0'; }
+	if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+	if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+	return -1;
+}
+
+/*
+ * consumes a single byte, writing it to bytePtr
+ */
+static inline bool txScanByte(struct TxScan *ts, uint8_t *bytePtr) {
+	if (!ts->hex) {
+		if (ts->p >= ts->end) { return false; }
+		*bytePtr = (uint8_t)*ts->p++;
+		return true;
+	}
+	if (ts->end - ts->p < 2) { return false; }
+	int hi = txScanHexVal(ts->p[0]);
+	int lo = txScanHexVal(ts->p[1]);
+	if (hi < 0 || lo < 0) { return false; }
+	*bytePtr = (uint8_t)(hi << 4 | lo);
+	ts->p += 2;
+	return true;
+}
+
+/*
+ * consumes n bytes without reading them, writing their start in the source to startPtr (if not NULL)
+ */
+static inline bool txScanSkip(struct TxScan *ts, size_t n, const char **startPtr) {
+	if (n > (size_t)(ts->end - ts->p) || txScanWidth(ts, n) > (size_t)(ts->end - ts->p)) { return false; }
+	if (startPtr) { *startPtr = ts->p; }
+	ts->p += txScanWidth(ts, n);
+	return true;
+}
+
+/*
+ * consumes little-endian integer of n bytes (at most 8), writing it to valPtr
+ */
+static inline bool txScanUint(struct TxScan *ts, size_t n, uint64_t *valPtr) {
+	uint64_t val = 0;
+	uint8_t byte;
+	for (size_t i=0; i<n; i++) {
+		if (!txScanByte(ts, &byte)) { return false; }
+		val |= (uint64_t)byte << 8*i;
+	}
+	*valPtr = val;
+	return true;
+}
+
+/*
+ * consumes bitcoin variable-length integer (CompactSize), writing it to valPtr
+ */
+static inline bool txScanVarInt(struct TxScan *ts, uint64_t *valPtr) {
+	uint8_t first;
+	if (!txScanByte(ts, &first)) { return false; }
+	if (first < 0xfd) { *valPtr = first; return true; }
+	return txScanUint(ts, first == 0xfd ? 2 : first == 0xfe ? 4 : 8, valPtr);
+}
+
+/*
+ * consumes one serialized transaction, writing its parts to info
+ */
+static bool txScanTx(struct TxScan *ts, struct TxScanInfo *info) {
+	uint64_t count;
+	uint64_t val;
+	info->start = ts->p;
+	info->in0Txid = NULL;
+	info->in0Vout = 0;
+	info->out0Script = NULL;
+	info->out0ScriptLen = 0;
+
+	if (!txScanSkip(ts, 4, NULL)) { return false; } // version
+	if (!txScanVarInt(ts, &count) || count > TX_SCAN_COUNT_MAX) { return false; }
+	for (uint64_t i=0; i<count; i++) {
+		const char *prevTxid;
+		if (!txScanSkip(ts, 32, &prevTxid) || !txScanUint(ts, 4, &val)) { return false; }
+		if (i == 0) { info->in0Txid = prevTxid; info->in0Vout = (uint32_t)val; }
+		if (!txScanVarInt(ts, &val) || val > TX_SCAN_SCRIPT_MAX || !txScanSkip(ts, val, NULL)) { return false; } // unlocking script
+		if (!txScanSkip(ts, 4, NULL)) { return false; } // sequence
+	}
+	if (!txScanVarInt(ts, &count) || count > TX_SCAN_COUNT_MAX) { return false; }
+	for (uint64_t i=0; i<count; i++) {
+		const char *script;
+		if (!txScanSkip(ts, 8, NULL)) { return false; } // value
+		if (!txScanVarInt(ts, &val) || val > TX_SCAN_SCRIPT_MAX || !txScanSkip(ts, val, &script)) { return false; }
+		if (i == 0) { info->out0Script = script; info->out0ScriptLen = txScanWidth(ts, val); }
+	}
+	if (!txScanSkip(ts, 4, NULL)) { return false; } // locktime
+
+	info->len = ts->p - info->start;
+	return true;
+}
+
+/*
+ * reads the pushes of an OP_RETURN script (as found by txScanTx, in the same encoding as scanned),
+   writing the first and second pushed data to push1Ptr/push1LenPtr and push2Ptr/push2LenPtr as slices of the source;
+   a push that isn't there is written as NULL, as is anything past a non-push opcode
+ * returns false if script isn't OP_RETURN (or is malformed)
+ */
+static bool txScanOpReturn(const char *script, size_t scriptLen, bool hex,
+			   const char **push1Ptr, size_t *push1LenPtr, const char **push2Ptr, size_t *push2LenPtr) {
+	struct TxScan ts;
+	txScanInit(&ts, script, scriptLen, hex);
+	*push1Ptr = *push2Ptr = NULL;
+	*push1LenPtr = *push2LenPtr = 0;
+
+	uint8_t op;
+	uint64_t len;
+	if (!txScanByte(&ts, &op) || op != TX_SCAN_OP_RETURN) { return false; }
+	for (int i=0; i<2 && txScanByte(&ts, &op); i++) {
+		if (op > TX_SCAN_OP_PUSHDATA4) { break; }
+		if (op < TX_SCAN_OP_PUSHDATA1) { len = op; }
+		else if (!txScanUint(&ts, op == TX_SCAN_OP_PUSHDATA1 ? 1 : op == TX_SCAN_OP_PUSHDATA2 ? 2 : 4, &len)) { return false; }
+		const char **pushPtr = i == 0 ? push1Ptr : push2Ptr;
+		size_t *pushLenPtr = i == 0 ? push1LenPtr : push2LenPtr;
+		if (!txScanSkip(&ts, len, pushPtr)) { return false; }
+		*pushLenPtr = txScanWidth(&ts, len);
+	}
+	return true;
+}
+
+/*
+ * SHA-256, as needed for hashing serialized transactions to their txids
+ */
+struct TxSha256 {
+	uint32_t h[8];
+	uint8_t block[64];
+	size_t blockLen;
+	uint64_t totalLen;
+};
+
+static const uint32_t txSha256K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define TX_SHA256_ROTR(x, n) ((x) >> (n) | (x) << (32-(n)))
+
+static void txSha256Block(struct TxSha256 *sha, const uint8_t *block) {
+	uint32_t w[64];
+	for (int i=0; i<16; i++) { w[i] = (uint32_t)block[4*i] << 24 | (uint32_t)block[4*i+1] << 16 | (uint32_t)block[4*i+2] << 8 | block[4*i+3]; }
+	for (int i=16; i<64; i++) {
+		uint32_t s0 = TX_SHA256_ROTR(w[i-15], 7) ^ TX_SHA256_ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+		uint32_t s1 = TX_SHA256_ROTR(w[i-2], 17) ^ TX_SHA256_ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	uint32_t a = sha->h[0], b = sha->h[1], c = sha->h[2], d = sha->h[3], e = sha->h[4], f = sha->h[5], g = sha->h[6], h = sha->h[7];
+	for (int i=0; i<64; i++) {
+		uint32_t t1 = h + (TX_SHA256_ROTR(e, 6) ^ TX_SHA256_ROTR(e, 11) ^ TX_SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + txSha256K[i] + w[i];
+		uint32_t t2 = (TX_SHA256_ROTR(a, 2) ^ TX_SHA256_ROTR(a, 13) ^ TX_SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+	}
+	sha->h[0] += a; sha->h[1] += b; sha->h[2] += c; sha->h[3] += d; sha->h[4] += e; sha->h[5] += f; sha->h[6] += g; sha->h[7] += h;
+}
+
+static void txSha256Init(struct TxSha256 *sha) {
+	static const uint32_t init[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	memcpy(sha->h, init, sizeof(init));
+	sha->blockLen = 0;
+	sha->totalLen = 0;
+}
+
+static void txSha256Update(struct TxSha256 *sha, const uint8_t *data, size_t len) {
+	sha->totalLen += len;
+	while (len > 0) {
+		size_t n = 64 - sha->blockLen < len ? 64 - sha->blockLen : len;
+		memcpy(sha->block + sha->blockLen, data, n);
+		sha->blockLen += n;
+		data += n;
+		len -= n;
+		if (sha->blockLen == 64) { txSha256Block(sha, sha->block); sha->blockLen = 0; }
+	}
+}
+
+static void txSha256Final(struct TxSha256 *sha, uint8_t *digest) {
+	uint64_t bits = sha->totalLen*8;
+	uint8_t pad = 0x80;
+	txSha256Update(sha, &pad, 1);
+	pad = 0;
+	while (sha->blockLen != 56) { txSha256Update(sha, &pad, 1); }
+	uint8_t lenBytes[8];
+	for (int i=0; i<8; i++) { lenBytes[i] = (uint8_t)(bits >> (56-8*i)); }
+	txSha256Update(sha, lenBytes, 8);
+	for (int i=0; i<8; i++) {
+		digest[4*i] = (uint8_t)(sha->h[i] >> 24);
+		digest[4*i+1] = (uint8_t)(sha->h[i] >> 16);
+		digest[4*i+2] = (uint8_t)(sha->h[i] >> 8);
+		digest[4*i+3] = (uint8_t)sha->h[i];
+	}
+}
+
+/*
+ * hashes raw (not hex) serialized transaction to its txid, written to txid in display (big-endian) byte order
+ */
+static inline void txScanTxid(const char *tx, size_t len, uint8_t *txid) {
+	struct TxSha256 sha;
+	uint8_t digest[32];
+	txSha256Init(&sha);
+	txSha256Update(&sha, (const uint8_t *)tx, len);
+	txSha256Final(&sha, digest);
+	txSha256Init(&sha);
+	txSha256Update(&sha, digest, 32);
+	txSha256Final(&sha, digest);
+	for (int i=0; i<32; i++) { txid[i] = digest[31-i]; }
+}
+
+/*
+ * converts txid of 32 bytes in serialized (little-endian) order, in the given encoding, to bytes in display order
+ */
+static inline bool txScanTxidBytes(const char *txidSer, bool hex, uint8_t *txid) {
+	struct TxScan ts;
+	txScanInit(&ts, txidSer, hex ? 64 : 32, hex);
+	for (int i=31; i>=0; i--) { if (!txScanByte(&ts, &txid[i])) { return false; } }
+	return true;
+}
+
+#endif